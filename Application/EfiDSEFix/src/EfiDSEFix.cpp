@@ -89,6 +89,10 @@ QueryCiOptions(
 	if (NtHeaders == nullptr)
 		return 0;
 
+	const ULONG64 PageId = SectionNameToId("PAGE");
+	const ULONG64 DataId = SectionNameToId(".data");
+	const ULONG64 CiPolicyId = SectionNameToId("CiPolicy");
+
 	const PUCHAR CiInitialize = static_cast<PUCHAR>(GetProcedureAddress(reinterpret_cast<ULONG_PTR>(MappedBase), "CiInitialize"));
 	if (CiInitialize == nullptr)
 		return 0;
@@ -114,7 +118,7 @@ QueryCiOptions(
 
 				// Check the call target to skip calls to __security_init_cookie, wil_InitializeFeatureStaging, and other stuff in INIT. CipInitialize is in PAGE.
 				const PUCHAR CallTarget = CiInitialize + i + hs.len + Relative;
-				if (AddressIsInSection(static_cast<PUCHAR>(MappedBase), CallTarget, NtHeaders, "PAGE"))
+				if (AddressIsInSection(static_cast<PUCHAR>(MappedBase), CallTarget, NtHeaders, PageId))
 				{
 					break;
 				}
@@ -150,7 +154,7 @@ QueryCiOptions(
 		return 0;
 
 	const PUCHAR CipInitialize = CiInitialize + i + hs.len + Relative;
-	if (!AddressIsInSection(static_cast<PUCHAR>(MappedBase), CipInitialize, NtHeaders, "PAGE"))
+	if (!AddressIsInSection(static_cast<PUCHAR>(MappedBase), CipInitialize, NtHeaders, PageId))
 		return 0;
 
 	i = 0;
@@ -173,8 +177,8 @@ QueryCiOptions(
 	const PUCHAR MappedCiOptions = CipInitialize + i + hs.len + Relative;
 
 	// g_CiOptions is in .data or (newer builds) "CiPolicy"
-	if (!AddressIsInSection(static_cast<PUCHAR>(MappedBase), MappedCiOptions, NtHeaders, ".data") &&
-		!AddressIsInSection(static_cast<PUCHAR>(MappedBase), MappedCiOptions, NtHeaders, "CiPolicy"))
+	if (!AddressIsInSection(static_cast<PUCHAR>(MappedBase), MappedCiOptions, NtHeaders, DataId) &&
+		!AddressIsInSection(static_cast<PUCHAR>(MappedBase), MappedCiOptions, NtHeaders, CiPolicyId))
 		return 0;
 
 	*gCiOptionsAddress = CiDllBase + MappedCiOptions - static_cast<PUCHAR>(MappedBase);
@@ -478,6 +482,85 @@ TriggerExploit(
 	return STATUS_SUCCESS;
 }
 
+NTSTATUS
+DumpEfiGuardStatistics(
+	)
+{
+	BOOLEAN SeSystemEnvironmentWasEnabled;
+	NTSTATUS Status = SetSystemEnvironmentPrivilege(TRUE, &SeSystemEnvironmentWasEnabled);
+	if (!NT_SUCCESS(Status))
+	{
+		Printf(L"Fatal error: failed to acquire SE_SYSTEM_ENVIRONMENT_PRIVILEGE. Make sure you are running as administrator.\n");
+		return Status;
+	}
+
+	// Read the statistics the driver saved at ExitBootServices()
+	EFIGUARD_STATISTICS Statistics;
+	RtlZeroMemory(&Statistics, sizeof(Statistics));
+	ULONG Size = sizeof(Statistics);
+	UNICODE_STRING VariableName = RTL_CONSTANT_STRING(EFIGUARD_STATISTICS_VARIABLE_NAME);
+	Status = NtQuerySystemEnvironmentValueEx(&VariableName,
+											EFIGUARD_STATISTICS_VARIABLE_GUID,
+											&Statistics,
+											&Size,
+											nullptr);
+
+	SetSystemEnvironmentPrivilege(SeSystemEnvironmentWasEnabled, nullptr);
+
+	if (!NT_SUCCESS(Status))
+	{
+		Printf(L"Failure: NtQuerySystemEnvironmentValueEx error 0x%08lX\n"
+			"The EfiGuard DXE driver is either not loaded, or it is an older version that does not save statistics.\n", Status);
+		return Status;
+	}
+	if (Size != sizeof(Statistics))
+	{
+		Printf(L"Failure: unexpected statistics size %lu (expected %lu).\n", Size, static_cast<ULONG>(sizeof(Statistics)));
+		return STATUS_INFO_LENGTH_MISMATCH;
+	}
+
+	constexpr PCWCHAR StageNames[EfiGuardStageMax] = { L"bootmgr", L"winload", L"ntoskrnl" };
+	Printf(L"\n== Decode counters ==\n");
+	Printf(L"    %-12ls %16ls %16ls\n", L"Stage", L"Instructions", L"Resyncs");
+	for (ULONG i = 0; i < EfiGuardStageMax; ++i)
+	{
+		Printf(L"    %-12ls %16llu %16llu\n", StageNames[i],
+			Statistics.Stages[i].InstructionsDecoded, Statistics.Stages[i].DecodeResyncs);
+	}
+
+	Printf(L"\nBoot stage delays: %lu ms\n", Statistics.BootDelayMs);
+
+	const UINT64 TscFrequency = Statistics.TscFrequency;
+	const ULONG NumTimings = Statistics.NumTimings < EFIGUARD_MAX_STEP_TIMINGS ? Statistics.NumTimings : EFIGUARD_MAX_STEP_TIMINGS;
+	Printf(L"\n== Patch timings (%ls) ==\n", (TscFrequency != 0 ? L"us" : L"TSC ticks; not calibrated"));
+	for (ULONG i = 0; i < NumTimings; ++i)
+	{
+		const EFIGUARD_STEP_TIMING* Timing = &Statistics.Timings[i];
+
+		// Same nesting as the driver's own timing printout
+		ULONG Depth = 0;
+		for (ULONG j = 0; j < i; ++j)
+		{
+			if (Statistics.Timings[j].StartTsc <= Timing->StartTsc && Timing->StartTsc < Statistics.Timings[j].EndTsc)
+				Depth++;
+		}
+		if (Depth > 8)
+			Depth = 8;
+
+		if (Timing->EndTsc == 0)
+		{
+			Printf(L"    %*ls%-*.*ls %10ls\n", static_cast<int>(Depth * 2), L"", static_cast<int>(48 - Depth * 2), static_cast<int>(ARRAYSIZE(Timing->Name)), Timing->Name, L"-");
+			continue;
+		}
+
+		const UINT64 Ticks = Timing->EndTsc - Timing->StartTsc;
+		Printf(L"    %*ls%-*.*ls %10llu\n", static_cast<int>(Depth * 2), L"", static_cast<int>(48 - Depth * 2), static_cast<int>(ARRAYSIZE(Timing->Name)), Timing->Name,
+			(TscFrequency != 0 ? (Ticks * 1000000) / TscFrequency : Ticks));
+	}
+
+	return STATUS_SUCCESS;
+}
+
 NTSTATUS
 AdjustCiOptions(
 	_In_ ULONG CiOptionsValue,
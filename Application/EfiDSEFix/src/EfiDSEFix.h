@@ -35,6 +35,10 @@ AdjustCiOptions(
 	_In_ BOOLEAN ReadOnly
 	);
 
+NTSTATUS
+DumpEfiGuardStatistics(
+	);
+
 // sysinfo.cpp
 NTSTATUS
 DumpSystemInformation(
@@ -48,12 +52,27 @@ MapFileSectionView(
 	_Out_ PSIZE_T ViewSize
 	);
 
+// Packs a section name into a 64-bit ID: the (at most 8) name bytes, zero padded.
+// This is the same as reading the 8-byte Name field of a section header, so names can be compared with a single compare
+CONSTEXPR
+FORCEINLINE
+ULONG64
+SectionNameToId(
+	_In_ PCCH SectionName
+	)
+{
+	ULONG64 Id = 0;
+	for (ULONG i = 0; i < IMAGE_SIZEOF_SHORT_NAME && SectionName[i] != '\0'; ++i)
+		Id |= static_cast<ULONG64>(static_cast<UCHAR>(SectionName[i])) << (i * 8);
+	return Id;
+}
+
 BOOLEAN
 AddressIsInSection(
 	_In_ PUCHAR ImageBase,
 	_In_ PUCHAR Address,
 	_In_ PIMAGE_NT_HEADERS NtHeaders,
-	_In_ PCCH SectionName
+	_In_ ULONG64 SectionNameId
 	);
 
 PVOID
@@ -15,11 +15,12 @@ PrintUsage(
 		L"-r, --read%18lsRead current %ls value\n"
 		L"-d, --disable%15lsDisable DSE\n"
 		L"-e, --enable%ls%2ls(Re)enable DSE\n"
-		L"-i, --info%18lsDump system info\n",
+		L"-i, --info%18lsDump system info\n"
+		L"-s, --stats%17lsDump EfiGuard driver statistics\n",
 		ProgramName, L"", L"",
 		CiOptionsName, L"",
 		(Win8OrHigher ? L" [g_CiOptions]" : L"              "),
-		L"", L"");
+		L"", L"", L"");
 }
 
 int wmain(int argc, wchar_t** argv)
@@ -82,6 +83,11 @@ int wmain(int argc, wchar_t** argv)
 	{
 		return DumpSystemInformation();
 	}
+	else if (wcsncmp(argv[1], L"-s", sizeof(L"-s") / sizeof(WCHAR) - 1) == 0 ||
+		wcsncmp(argv[1], L"--stats", sizeof(L"--stats") / sizeof(WCHAR) - 1) == 0)
+	{
+		return DumpEfiGuardStatistics();
+	}
 	else
 	{
 		PrintUsage(argv[0]);
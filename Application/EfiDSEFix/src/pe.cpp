@@ -115,7 +115,7 @@ AddressIsInSection(
 	_In_ PUCHAR ImageBase,
 	_In_ PUCHAR Address,
 	_In_ PIMAGE_NT_HEADERS NtHeaders,
-	_In_ PCCH SectionName
+	_In_ ULONG64 SectionNameId
 	)
 {
 	if (ImageBase > Address)
@@ -131,7 +131,9 @@ AddressIsInSection(
 		if (Section->VirtualAddress <= Rva &&
 			Section->VirtualAddress + Section->Misc.VirtualSize > Rva)
 		{
-			if (strncmp(reinterpret_cast<PCCH>(Section->Name), SectionName, IMAGE_SIZEOF_SHORT_NAME) == 0)
+			ULONG64 NameId;
+			RtlCopyMemory(&NameId, Section->Name, sizeof(NameId));
+			if (NameId == SectionNameId)
 				return TRUE;
 		}
 		Section++;
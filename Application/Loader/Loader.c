@@ -303,6 +303,12 @@ StartAndConfigureDriver(
 											sizeof(YesNo) / sizeof(UINT16),
 											L'2');
 
+	Print(L"Pause after each boot stage so that its output can be read? Errors are always shown.\r\n"
+		L"    [1] Yes (default)\r\n    [2] No (fast boot)\r\n    ");
+	CONST UINT16 SelectedBootDelays = PromptInput(YesNo,
+											sizeof(YesNo) / sizeof(UINT16),
+											L'1');
+
 	EFIGUARD_CONFIGURATION_DATA ConfigData;
 	if (SelectedDseBypass == L'1')
 		ConfigData.DseBypassMethod = DSE_DISABLE_NONE;
@@ -312,6 +318,12 @@ StartAndConfigureDriver(
 		ConfigData.DseBypassMethod = DSE_DISABLE_SETVARIABLE_HOOK;
 	ConfigData.WaitForKeyPress = (BOOLEAN)(SelectedWaitForKeyPress == L'1');
 
+	CONST BOOLEAN UseBootDelays = (BOOLEAN)(SelectedBootDelays == L'1');
+	EFIGUARD_BOOT_DELAYS BootDelays;
+	BootDelays.LoadImage = UseBootDelays ? EFIGUARD_DEFAULT_LOAD_IMAGE_DELAY : 0;
+	BootDelays.Bootmgr = UseBootDelays ? EFIGUARD_DEFAULT_BOOTMGR_DELAY : 0;
+	BootDelays.Winload = UseBootDelays ? EFIGUARD_DEFAULT_WINLOAD_DELAY : 0;
+
 	//
 	// Send the configuration data to the driver
 	//
@@ -319,6 +331,13 @@ StartAndConfigureDriver(
 
 	if (EFI_ERROR(Status))
 		Print(L"[LOADER] Driver Configure() returned error %llx (%r).\r\n", Status, Status);
+	else
+	{
+		Status = EfiGuardDriverProtocol->SetBootDelays(&BootDelays);
+
+		if (EFI_ERROR(Status))
+			Print(L"[LOADER] Driver SetBootDelays() returned error %llx (%r).\r\n", Status, Status);
+	}
 #endif
 
 Exit:
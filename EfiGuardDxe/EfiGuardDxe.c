@@ -33,9 +33,16 @@ DriverConfigure(
 	IN CONST EFIGUARD_CONFIGURATION_DATA* ConfigurationData
 	);
 
+EFI_STATUS
+EFIAPI
+DriverSetBootDelays(
+	IN CONST EFIGUARD_BOOT_DELAYS* BootDelays
+	);
+
 EFIGUARD_DRIVER_PROTOCOL gEfiGuardDriverProtocol =
 {
-	DriverConfigure
+	DriverConfigure,
+	DriverSetBootDelays
 };
 
 //
@@ -46,6 +53,15 @@ EFIGUARD_CONFIGURATION_DATA gDriverConfig = {
 	FALSE							// WaitForKeyPress
 };
 
+//
+// Default boot stage delays used if SetBootDelays() is not called
+//
+EFIGUARD_BOOT_DELAYS gBootDelays = {
+	EFIGUARD_DEFAULT_LOAD_IMAGE_DELAY,	// LoadImage
+	EFIGUARD_DEFAULT_BOOTMGR_DELAY,		// Bootmgr
+	EFIGUARD_DEFAULT_WINLOAD_DELAY		// Winload
+};
+
 //
 // Bootmgfw.efi handle
 //
@@ -162,11 +178,11 @@ HookedLoadImage(
 
 	// Print what's being loaded or booted
 	CONST INT32 OriginalAttribute = SetConsoleTextColour(EFI_GREEN, FALSE);
-	Print(L"[HookedLoadImage] %S %S\r\n    (ParentImageHandle = %llx)\r\n",
+	ConsolePrint(L"[HookedLoadImage] %S %S\r\n    (ParentImageHandle = %llx)\r\n",
 		(IsBoot ? L"Booting" : L"Loading"), ImagePath, (UINTN)ParentImageHandle);
 	if (ImagePath != NULL)
 		FreePool(ImagePath);
-	RtlSleep(500);
+	BootStageDelay(gBootDelays.LoadImage);
 
 	// Q: If we loaded bootmgfw.efi manually, is there any benefit to flipping BootPolicy to TRUE
 	// to make it look like the load request came straight from the boot manager?
@@ -197,7 +213,7 @@ HookedLoadImage(
 															EFI_OPEN_PROTOCOL_GET_PROTOCOL);
 		if (EFI_ERROR(ImageInfoStatus))
 		{
-			Print(L"\r\nHookedLoadImage: failed to get loaded image info. Status: %llx (%r)\r\n",
+			ConsolePrint(L"\r\nHookedLoadImage: failed to get loaded image info. Status: %llx (%r)\r\n",
 				ImageInfoStatus, ImageInfoStatus);
 		}
 		else
@@ -228,6 +244,7 @@ HookedLoadImage(
 		}
 	}
 
+	FlushConsole();
 	gST->ConOut->SetAttribute(gST->ConOut, OriginalAttribute);
 	gST->ConOut->EnableCursor(gST->ConOut, FALSE);
 
@@ -349,8 +366,8 @@ ExitBootServicesEvent(
 	gBS->CloseEvent(gEfiExitBootServicesEvent);
 	gEfiExitBootServicesEvent = NULL;
 
-	// The message buffer may be empty if the patch process was aborted in one of the earlier stages
-	if (gKernelPatchInfo.Buffer[0] != CHAR_NULL)
+	// There may be no messages if the patch process was aborted in one of the earlier stages
+	if (gKernelPatchInfo.NumMessages != 0)
 	{
 		CONST EFI_STATUS Status = gKernelPatchInfo.Status;
 		CONST INT32 OriginalAttribute = gST->ConOut->Mode->Attribute;
@@ -361,11 +378,14 @@ ExitBootServicesEvent(
 		{
 			SetConsoleTextColour(EFI_GREEN, TRUE);
 			PrintKernelPatchInfo();
-			Print(L"\r\nSuccessfully patched ntoskrnl.exe.\r\n");
+			ConsolePrint(L"\r\nSuccessfully patched ntoskrnl.exe.\r\n");
+#if KERNEL_PATCH_LOG_LEVEL >= KERNEL_PATCH_LOG_TRACE
+			PrintPatchTimings();
+#endif
 
 			if (gDriverConfig.WaitForKeyPress)
 			{
-				Print(L"\r\nPress any key to continue.\r\n");
+				ConsolePrint(L"\r\nPress any key to continue.\r\n");
 				WaitForKey();
 			}
 		}
@@ -377,28 +397,40 @@ ExitBootServicesEvent(
 			gST->ConOut->SetAttribute(gST->ConOut, EFI_WHITE | EFI_BACKGROUND_BLUE);
 			gST->ConOut->ClearScreen(gST->ConOut);
 
-			Print(L"A problem has been detected and Windows has been paused to prevent damage\r\nto your botnets.\r\n\r\n"
+			ConsolePrint(L"A problem has been detected and Windows has been paused to prevent damage\r\nto your botnets.\r\n\r\n"
 				L"BOOTKIT_KERNEL_PATCH_FAILED\r\n\r\n"
 				L"Technical information:\r\n\r\n*** STOP: 0X%llX (%r, 0x%p)\r\n\r\n",
 				Status, Status, gKernelPatchInfo.KernelBase);
 			PrintKernelPatchInfo();
+#if KERNEL_PATCH_LOG_LEVEL >= KERNEL_PATCH_LOG_TRACE
+			PrintPatchTimings();
+#endif
 
 			// Give time for user to register their loss and allow for the grieving process to set in
 			RtlStall(2000);
 
 			// Prompt user to ask what they want to do
-			Print(L"\r\nPress any key to continue anyway, or press ESC to reboot.\r\n");
+			ConsolePrint(L"\r\nPress any key to continue anyway, or press ESC to reboot.\r\n");
 			if (!WaitForKey())
 			{
 				gRT->ResetSystem(EfiResetCold, EFI_SUCCESS, 0, NULL);
 			}
 		}
 
+		FlushConsole();
 		gST->ConOut->SetAttribute(gST->ConOut, OriginalAttribute);
 		if (Status != EFI_SUCCESS && ShowErrorMessage)
 			gST->ConOut->ClearScreen(gST->ConOut);
 	}
 
+	// Make the statistics available to the OS. They are only diagnostics, so failure is not fatal
+	CONST EFI_STATUS StatisticsStatus = SaveDriverStatistics();
+	if (EFI_ERROR(StatisticsStatus))
+	{
+		ConsolePrint(L"WARNING: failed to save driver statistics: %llx (%r).\r\n", StatisticsStatus, StatisticsStatus);
+		FlushConsole();
+	}
+
 	// If the DSE bypass method is *not* DSE_DISABLE_SETVARIABLE_HOOK, perform some cleanup now. In principle this should allow
 	// linking with /SUBSYSTEM:EFI_BOOT_SERVICE_DRIVER, because our driver image may be freed after this callback returns.
 	// Using DSE_DISABLE_SETVARIABLE_HOOK requires linking with /SUBSYSTEM:EFI_RUNTIME_DRIVER, because the image must not be freed.
@@ -479,6 +511,24 @@ DriverConfigure(
 	return EFI_SUCCESS;
 }
 
+EFI_STATUS
+EFIAPI
+DriverSetBootDelays(
+	IN CONST EFIGUARD_BOOT_DELAYS* BootDelays
+	)
+{
+	// Same rules as Configure()
+	if (gEfiAtRuntime || gBootmgfwHandle != NULL)
+		return EFI_ACCESS_DENIED;
+
+	if (BootDelays == NULL)
+		return EFI_INVALID_PARAMETER;
+
+	gBootDelays = *BootDelays;
+
+	return EFI_SUCCESS;
+}
+
 //
 // Driver unload
 //
@@ -636,14 +686,20 @@ EfiGuardInitialize(
 
 	// Initialize the global kernel patch info struct.
 	gKernelPatchInfo.Status = EFI_SUCCESS;
-	gKernelPatchInfo.BufferSize = 0;
-	SetMem64(gKernelPatchInfo.Buffer, sizeof(gKernelPatchInfo.Buffer), 0ULL);
+	gKernelPatchInfo.NumMessages = 0;
+	gKernelPatchInfo.NumTraceMessages = 0;
+	gKernelPatchInfo.NumTimings = 0;
+	SetMem64(gKernelPatchInfo.Timings, sizeof(gKernelPatchInfo.Timings), 0ULL);
+	SetMem64(gKernelPatchInfo.Messages, sizeof(gKernelPatchInfo.Messages), 0ULL);
 	gKernelPatchInfo.WinloadBuildNumber = 0;
 	gKernelPatchInfo.KernelBuildNumber = 0;
 	gKernelPatchInfo.KernelBase = NULL;
+	gKernelPatchInfo.BootDelayMs = 0;
+	ZeroMem(gKernelPatchInfo.Stages, sizeof(gKernelPatchInfo.Stages));
 
-	// The ASCII banner is very pretty - ensure the user has enough time to admire it
-	RtlSleep(1500);
+	// The ASCII banner is very pretty - ensure the user has enough time to admire it.
+	// This wait is also used to measure the TSC frequency for the patch timings
+	SleepAndCalibrateTsc(1500);
 
 Exit:
 	if (EFI_ERROR(Status))
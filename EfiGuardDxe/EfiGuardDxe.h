@@ -29,6 +29,7 @@ extern EFIGUARD_DRIVER_PROTOCOL gEfiGuardDriverProtocol;
 // Driver configuration data
 //
 extern EFIGUARD_CONFIGURATION_DATA gDriverConfig;
+extern EFIGUARD_BOOT_DELAYS gBootDelays;
 
 //
 // Bootmgfw.efi handle
@@ -138,21 +139,20 @@ EFI_STATUS
 EFIAPI
 PatchImgpValidateImageHash(
 	IN INPUT_FILETYPE FileType,
-	IN UINT8* ImageBase,
-	IN PEFI_IMAGE_NT_HEADERS NtHeaders
+	IN OUT PIMAGE_CONTEXT ImageContext
 	);
 
 //
 // Patches ImgpFilterValidationFailure in bootmgfw.efi, bootmgr.efi, and winload.[efi|exe]
 // This patch is completely optional, unless you want to boot a custom kernel or winload image.
 // It is applied if possible, but failures are ignored.
+// If the image context's cross-reference index has been built, it is used to find the code that references the string.
 //
 EFI_STATUS
 EFIAPI
 PatchImgpFilterValidationFailure(
 	IN INPUT_FILETYPE FileType,
-	IN UINT8* ImageBase,
-	IN PEFI_IMAGE_NT_HEADERS NtHeaders
+	IN OUT PIMAGE_CONTEXT ImageContext
 	);
 
 //
@@ -188,38 +188,118 @@ PatchNtoskrnl(
 	);
 
 
+#define KERNEL_PATCH_MSG_MAX_ARGS		6
+#define KERNEL_PATCH_MSG_MAX_RECORDS	128
+
+//
+// A kernel patch message as recorded by AppendKernelPatchMessage(). Formatting is deferred until the message is printed,
+// so the arguments are stored as a BASE_LIST for UnicodeBSPrint(). String arguments are stored as pointers, and must be
+// string literals (or otherwise remain valid until ExitBootServices()).
+//
+typedef struct _KERNEL_PATCH_MESSAGE
+{
+	CONST CHAR16* Format;
+	UINT64 Arguments[KERNEL_PATCH_MSG_MAX_ARGS];
+} KERNEL_PATCH_MESSAGE;
+
+#define KERNEL_PATCH_MAX_TIMINGS		EFIGUARD_MAX_STEP_TIMINGS
+
+//
+// A timed patch step, as recorded by StartPatchTiming() and StopPatchTiming(). The values are raw TSC readings,
+// which are converted to microseconds with KERNEL_PATCH_INFORMATION::TscFrequency when the timings are printed.
+//
+typedef struct _KERNEL_PATCH_TIMING
+{
+	CONST CHAR16* Name;
+	UINT64 StartTsc;
+	UINT64 EndTsc;		// 0 if the step was never stopped
+} KERNEL_PATCH_TIMING;
+
 //
 // The kernel patch result. This is used to hold data generated during
 // HookedOslFwpKernelSetupPhase1 and PatchNtoskrnl until we can safely access
 // boot services to print the output. This is done during the ExitBootServices() callback.
 //
-// Status holds the final patch status. If this is not EFI_SUCCESS, the buffer holds an
+// Status holds the final patch status. If this is not EFI_SUCCESS, the messages contain an
 // error message, and the user will be prompted to reboot or continue.
-// If Status is EFI_SUCCESS, the buffer holds concatenated patch information similar to what
+// If Status is EFI_SUCCESS, the messages contain patch information similar to what
 // is printed during the patching of bootmgfw.efi/bootmgr.efi/winload.efi.
 //
 typedef struct _KERNEL_PATCH_INFORMATION
 {
 	EFI_STATUS Status;
-	UINTN BufferSize;			// In bytes, excluding null terminator. This may be 0. The maximum buffer size is simply sizeof(Buffer).
-	CHAR16 Buffer[8192];		// 8K ought to be enough for everyone
+	UINT32 NumMessages;			// Total number of messages recorded. This may be 0. Only the last KERNEL_PATCH_MSG_MAX_RECORDS are kept
+	UINT32 NumTraceMessages;	// Total number of trace messages issued, including those dropped after KERNEL_PATCH_MAX_TRACE_MSGS
+	KERNEL_PATCH_MESSAGE Messages[KERNEL_PATCH_MSG_MAX_RECORDS];	// Ring buffer, indexed by message number % KERNEL_PATCH_MSG_MAX_RECORDS
+	UINT64 TscFrequency;		// TSC ticks per second, measured by SleepAndCalibrateTsc() while the driver banner is shown
+	UINT32 NumTimings;
+	KERNEL_PATCH_TIMING Timings[KERNEL_PATCH_MAX_TIMINGS];	// Patch step timings for all stages (not only the kernel), in start order
 	UINT32 WinloadBuildNumber;	// Used to determine whether the loader block provided by winload.efi will be for Vista (or older) kernels
 	UINT32 KernelBuildNumber;	// Used to determine whether an error message should be shown
 	VOID* KernelBase;
+	UINT32 BootDelayMs;			// Total time spent in BootStageDelay() by all stages, shown in the patch summary
+	EFIGUARD_STAGE_STATISTICS Stages[EfiGuardStageMax];	// Decode counters per boot stage, added by RecordDecodeStatistics()
 } KERNEL_PATCH_INFORMATION;
 
 extern KERNEL_PATCH_INFORMATION gKernelPatchInfo;
 
 
 //
-// Appends a kernel patch status info or error message to the buffer for delayed printing,
+// Kernel patch message log levels. KERNEL_PATCH_LOG_LEVEL selects the most verbose level that is compiled in;
+// messages above it expand to nothing. This can be set in EfiGuardPkg.dsc with -D KERNEL_PATCH_LOG_LEVEL=<n>.
+// The DSC defaults to KERNEL_PATCH_LOG_INFO for RELEASE builds; everything else gets KERNEL_PATCH_LOG_TRACE.
+//
+#define KERNEL_PATCH_LOG_NONE			0
+#define KERNEL_PATCH_LOG_ERROR			1	// Failures that cause or explain a non-successful gKernelPatchInfo.Status
+#define KERNEL_PATCH_LOG_INFO			2	// Patch summary: kernel version, patched functions and RVAs
+#define KERNEL_PATCH_LOG_TRACE			3	// Pattern search progress and intermediate matches
+
+#ifndef KERNEL_PATCH_LOG_LEVEL
+#define KERNEL_PATCH_LOG_LEVEL			KERNEL_PATCH_LOG_TRACE
+#endif
+
+//
+// Maximum number of trace messages recorded per boot. Trace messages beyond this are counted but not printed,
+// so that they can't push errors and patch info out of the message ring or flood a boot debugger.
+//
+#define KERNEL_PATCH_MAX_TRACE_MSGS		48
+
+//
+// Records a kernel patch status info or error message for delayed printing,
 // and prints it to a boot debugger immediately if one is connected.
 //
+#if KERNEL_PATCH_LOG_LEVEL >= KERNEL_PATCH_LOG_INFO
 #define PRINT_KERNEL_PATCH_MSG(Fmt, ...) \
 	do { \
 		gBlStatusPrint(Fmt, ##__VA_ARGS__); \
 		AppendKernelPatchMessage(Fmt, ##__VA_ARGS__); \
 	} while (FALSE)
+#else
+#define PRINT_KERNEL_PATCH_MSG(Fmt, ...)	do { } while (FALSE)
+#endif
+
+#if KERNEL_PATCH_LOG_LEVEL >= KERNEL_PATCH_LOG_ERROR
+#define PRINT_KERNEL_PATCH_ERROR(Fmt, ...) \
+	do { \
+		gBlStatusPrint(Fmt, ##__VA_ARGS__); \
+		AppendKernelPatchMessage(Fmt, ##__VA_ARGS__); \
+	} while (FALSE)
+#else
+#define PRINT_KERNEL_PATCH_ERROR(Fmt, ...)	do { } while (FALSE)
+#endif
+
+#if KERNEL_PATCH_LOG_LEVEL >= KERNEL_PATCH_LOG_TRACE
+#define PRINT_KERNEL_PATCH_TRACE(Fmt, ...) \
+	do { \
+		if (gKernelPatchInfo.NumTraceMessages++ < KERNEL_PATCH_MAX_TRACE_MSGS) \
+		{ \
+			gBlStatusPrint(Fmt, ##__VA_ARGS__); \
+			AppendKernelPatchMessage(Fmt, ##__VA_ARGS__); \
+		} \
+	} while (FALSE)
+#else
+#define PRINT_KERNEL_PATCH_TRACE(Fmt, ...)	do { } while (FALSE)
+#endif
 
 #ifdef __cplusplus
 }
@@ -32,9 +32,10 @@ CONST UINTN gHookTemplateAddressOffset = 1;
 
 
 // Signature for [bootmgfw|bootmgr]!ImgArch[Efi]StartBootApplication
-STATIC CONST UINT8 SigImgArchStartBootApplication[] = {
+STATIC CONST UINT8 SigImgArchStartBootApplicationBytes[] = {
 	0x41, 0xB8, 0x09, 0x00, 0x00, 0xD0				// mov r8d, 0D0000009h
 };
+STATIC BYTE_SIGNATURE SigImgArchStartBootApplication = BYTE_SIGNATURE_INIT(SigImgArchStartBootApplicationBytes, 0xCC);
 
 
 //
@@ -64,7 +65,7 @@ HookedBootManagerImgArchStartBootApplication(
 	INPUT_FILETYPE FileType = Unknown;
 	if (NtHeaders == NULL)
 	{
-		Print(L"\r\nHookedBootmanagerImgArchStartBootApplication: PE image at 0x%p with size 0x%lx is invalid!\r\nPress any key to continue anyway, or press ESC to reboot.\r\n",
+		ConsolePrint(L"\r\nHookedBootmanagerImgArchStartBootApplication: PE image at 0x%p with size 0x%lx is invalid!\r\nPress any key to continue anyway, or press ESC to reboot.\r\n",
 			ImageBase, ImageSize);
 		if (!WaitForKey())
 		{
@@ -84,28 +85,28 @@ HookedBootManagerImgArchStartBootApplication(
 	}
 
 	// Print info
-	Print(L"[ %S!ImgArchStartBootApplication ]\r\n", (OriginalFunctionBytes == gBootmgrImgArchStartBootApplicationBackup ? L"bootmgr" : L"bootmgfw"));
-	Print(L"ImageBase: 0x%p\r\n", ImageBase);
-	Print(L"ImageSize: %lx\r\n", ImageSize);
-	Print(L"File type: %S\r\n", FileTypeToString(FileType));
-	Print(L"EntryPoint: 0x%p\r\n", ((UINT8*)ImageBase + HEADER_FIELD(NtHeaders, AddressOfEntryPoint)));
-	Print(L"AppEntry:\r\n");
-	Print(L"  Signature: %a\r\n", AppEntry->Signature);
-	Print(L"  Flags: %lx\r\n", AppEntry->Flags);
-	Print(L"  GUID: %08x-%04x-%04x-%02x%02x-%02x%02x%02x%02x%02x%02x\r\n",
+	ConsolePrint(L"[ %S!ImgArchStartBootApplication ]\r\n", (OriginalFunctionBytes == gBootmgrImgArchStartBootApplicationBackup ? L"bootmgr" : L"bootmgfw"));
+	ConsolePrint(L"ImageBase: 0x%p\r\n", ImageBase);
+	ConsolePrint(L"ImageSize: %lx\r\n", ImageSize);
+	ConsolePrint(L"File type: %S\r\n", FileTypeToString(FileType));
+	ConsolePrint(L"EntryPoint: 0x%p\r\n", ((UINT8*)ImageBase + HEADER_FIELD(NtHeaders, AddressOfEntryPoint)));
+	ConsolePrint(L"AppEntry:\r\n");
+	ConsolePrint(L"  Signature: %a\r\n", AppEntry->Signature);
+	ConsolePrint(L"  Flags: %lx\r\n", AppEntry->Flags);
+	ConsolePrint(L"  GUID: %08x-%04x-%04x-%02x%02x-%02x%02x%02x%02x%02x%02x\r\n",
 		AppEntry->Guid.Data1, AppEntry->Guid.Data2, AppEntry->Guid.Data3,
 		AppEntry->Guid.Data4[0], AppEntry->Guid.Data4[1], AppEntry->Guid.Data4[2], AppEntry->Guid.Data4[3],
 		AppEntry->Guid.Data4[4], AppEntry->Guid.Data4[5], AppEntry->Guid.Data4[6], AppEntry->Guid.Data4[7]);
 #ifdef EFI_DEBUG
 	// Stuff likely no one cares about
-	Print(L"  Unknown: %lx %lx %lx %lx\r\n", AppEntry->Unknown[0], AppEntry->Unknown[1], AppEntry->Unknown[2], AppEntry->Unknown[3]);
-	Print(L"  BcdData:\r\n");
-	Print(L"    Type: %lx\r\n", AppEntry->BcdData.Type);
-	Print(L"    DataOffset: %lx\r\n", AppEntry->BcdData.DataOffset);
-	Print(L"    DataSize: %lx\r\n", AppEntry->BcdData.DataSize);
-	Print(L"    ListOffset: %lx\r\n", AppEntry->BcdData.ListOffset);
-	Print(L"    NextEntryOffset: %lx\r\n", AppEntry->BcdData.NextEntryOffset);
-	Print(L"    Empty: %lx\r\n", AppEntry->BcdData.Empty);
+	ConsolePrint(L"  Unknown: %lx %lx %lx %lx\r\n", AppEntry->Unknown[0], AppEntry->Unknown[1], AppEntry->Unknown[2], AppEntry->Unknown[3]);
+	ConsolePrint(L"  BcdData:\r\n");
+	ConsolePrint(L"    Type: %lx\r\n", AppEntry->BcdData.Type);
+	ConsolePrint(L"    DataOffset: %lx\r\n", AppEntry->BcdData.DataOffset);
+	ConsolePrint(L"    DataSize: %lx\r\n", AppEntry->BcdData.DataSize);
+	ConsolePrint(L"    ListOffset: %lx\r\n", AppEntry->BcdData.ListOffset);
+	ConsolePrint(L"    NextEntryOffset: %lx\r\n", AppEntry->BcdData.NextEntryOffset);
+	ConsolePrint(L"    Empty: %lx\r\n", AppEntry->BcdData.Empty);
 #endif
 
 	if (FileType == WinloadEfi)
@@ -251,12 +252,15 @@ PatchBootManager(
 	// Get PE headers
 	CONST BOOLEAN PatchingBootmgrEfi = FileType == BootmgrEfi;
 	CONST CHAR16* ShortFileName = PatchingBootmgrEfi ? L"bootmgr" : L"bootmgfw";
+	CONST UINT32 Timing = StartPatchTiming(PatchingBootmgrEfi ? L"PatchBootManager (bootmgr)" : L"PatchBootManager (bootmgfw)");
 	CONST PEFI_IMAGE_NT_HEADERS NtHeaders = RtlpImageNtHeaderEx(ImageBase, ImageSize);
+	IMAGE_CONTEXT ImageContext;
+	ZeroMem(&ImageContext, sizeof(ImageContext));
 	EFI_STATUS Status;
 	if (NtHeaders == NULL)
 	{
 		Status = EFI_LOAD_ERROR;
-		Print(L"\r\nPatchBootManager: %S.efi PE image at 0x%p with size 0x%llx is invalid!\r\nPress any key to continue anyway, or press ESC to reboot.\r\n",
+		ConsolePrint(L"\r\nPatchBootManager: %S.efi PE image at 0x%p with size 0x%llx is invalid!\r\nPress any key to continue anyway, or press ESC to reboot.\r\n",
 			ShortFileName, ImageBase, ImageSize);
 		if (!WaitForKey())
 		{
@@ -269,16 +273,16 @@ PatchBootManager(
 	UINT16 MajorVersion = 0, MinorVersion = 0, BuildNumber = 0, Revision = 0;
 	Status = GetPeFileVersionInfo(ImageBase, &MajorVersion, &MinorVersion, &BuildNumber, &Revision, NULL);
 	if (EFI_ERROR(Status))
-		Print(L"\r\nPatchBootManager: WARNING: failed to obtain %S.efi version info. Status: %llx\r\n", ShortFileName, Status);
+		ConsolePrint(L"\r\nPatchBootManager: WARNING: failed to obtain %S.efi version info. Status: %llx\r\n", ShortFileName, Status);
 	else
 	{
-		Print(L"\r\nPatching %S.efi v%u.%u.%u.%u...\r\n", ShortFileName, MajorVersion, MinorVersion, BuildNumber, Revision);
+		ConsolePrint(L"\r\nPatching %S.efi v%u.%u.%u.%u...\r\n", ShortFileName, MajorVersion, MinorVersion, BuildNumber, Revision);
 
 		// Check if this is a supported boot manager version. All patches should work on all versions since Vista SP1,
 		// except for the ImgpFilterValidationFailure patch because this function only exists on Windows 7 and higher.
 		if (BuildNumber < 6001)
 		{
-			Print(L"\r\nPatchBootManager: ERROR: Unsupported %S.efi image version.\r\n"
+			ConsolePrint(L"\r\nPatchBootManager: ERROR: Unsupported %S.efi image version.\r\n"
 				L"The minimum supported boot manager version is Windows Vista SP1.\r\n"
 				L"It is recommended to use the Windows 10 boot manager even when running an older OS.\r\n", ShortFileName);
 			Status = EFI_UNSUPPORTED;
@@ -286,19 +290,31 @@ PatchBootManager(
 		}
 	}
 
+	// Initialize the decoder and find the .text section. This context is shared by all patches below
+	Status = InitializeImageContext(ImageBase, NtHeaders, &ImageContext);
+	if (EFI_ERROR(Status))
+	{
+		ConsolePrint(L"\r\nPatchBootManager: failed to initialize disassembler engine.\r\n");
+		goto Exit;
+	}
+
+	// Use the application processors for large scans if possible. Failure just means everything runs on the BSP
+	InitializeScanScheduler(&ImageContext.Scheduler);
+
 	// Find [bootmgfw|bootmgr]!ImgArch[Efi]StartBootApplication
 	CONST CHAR16* FunctionName = BuildNumber >= 17134 ? L"ImgArchStartBootApplication" : L"ImgArchEfiStartBootApplication";
-	CONST PEFI_IMAGE_SECTION_HEADER CodeSection = IMAGE_FIRST_SECTION(NtHeaders);
+	CONST PEFI_IMAGE_SECTION_HEADER CodeSection = ImageContext.TextSection;
 	UINT8* Found = NULL;
-	Status = FindPattern(SigImgArchStartBootApplication,
-							0xCC,
-							sizeof(SigImgArchStartBootApplication),
-							(UINT8*)ImageBase + CodeSection->VirtualAddress,
-							CodeSection->SizeOfRawData,
-							(VOID**)&Found);
+	CONST UINT32 SearchTiming = StartPatchTiming(L"ImgArchStartBootApplication search");
+	Status = FindSignatureParallel(&ImageContext.Scheduler,
+									&SigImgArchStartBootApplication,
+									(UINT8*)ImageBase + CodeSection->VirtualAddress,
+									CodeSection->SizeOfRawData,
+									(VOID**)&Found);
+	StopPatchTiming(SearchTiming);
 	if (EFI_ERROR(Status))
 	{
-		Print(L"\r\nPatchBootManager: failed to find %S!%S signature. Status: %llx\r\n", ShortFileName, FunctionName, Status);
+		ConsolePrint(L"\r\nPatchBootManager: failed to find %S!%S signature. Status: %llx\r\n", ShortFileName, FunctionName, Status);
 		goto Exit;
 	}
 
@@ -309,7 +325,7 @@ PatchBootManager(
 	CONST VOID* OriginalAddress = *pOriginalAddress;
 	if (OriginalAddress == NULL)
 	{
-		Print(L"\r\nPatchBootManager: failed to find %S!%S function start [signature at 0x%p].\r\n", ShortFileName, FunctionName, (VOID*)Found);
+		ConsolePrint(L"\r\nPatchBootManager: failed to find %S!%S function start [signature at 0x%p].\r\n", ShortFileName, FunctionName, (VOID*)Found);
 		Status = EFI_NOT_FOUND;
 		goto Exit;
 	}
@@ -321,8 +337,8 @@ PatchBootManager(
 	else
 		HookAddress = PatchingBootmgrEfi ? (VOID*)&HookedBootmgrImgArchStartBootApplication_Eight : (VOID*)&HookedBootmgfwImgArchStartBootApplication_Eight;
 	UINT8* BackupAddress = PatchingBootmgrEfi ? gBootmgrImgArchStartBootApplicationBackup : gBootmgfwImgArchStartBootApplicationBackup;
-	Print(L"\r\nFound %S!%S at 0x%p.\r\n", ShortFileName, FunctionName, (VOID*)OriginalAddress);
-	Print(L"Hooked%S%S at 0x%p.\r\n", (PatchingBootmgrEfi ? L"Bootmgr" : L"Bootmgfw"), FunctionName, HookAddress);
+	ConsolePrint(L"\r\nFound %S!%S at 0x%p.\r\n", ShortFileName, FunctionName, (VOID*)OriginalAddress);
+	ConsolePrint(L"Hooked%S%S at 0x%p.\r\n", (PatchingBootmgrEfi ? L"Bootmgr" : L"Bootmgfw"), FunctionName, HookAddress);
 
 	CONST EFI_TPL Tpl = gBS->RaiseTPL(TPL_HIGH_LEVEL); // Note: implies cli
 
@@ -337,24 +353,30 @@ PatchBootManager(
 
 	// Patch ImgpValidateImageHash to allow custom boot loaders. This is completely
 	// optional (unless booting a custom winload.efi), and failures are ignored
+	UINT32 PatchTiming = StartPatchTiming(L"PatchImgpValidateImageHash");
 	PatchImgpValidateImageHash(FileType,
-								ImageBase,
-								NtHeaders);
+								&ImageContext);
+	StopPatchTiming(PatchTiming);
 
 	if (BuildNumber >= 7600)
 	{
 		// Patch ImgpFilterValidationFailure so it doesn't silently
 		// rat out every violation to a TPM or SI log. Also optional
+		PatchTiming = StartPatchTiming(L"PatchImgpFilterValidationFailure");
 		PatchImgpFilterValidationFailure(FileType,
-										ImageBase,
-										NtHeaders);
+										&ImageContext);
+		StopPatchTiming(PatchTiming);
 	}
 
 Exit:
+	RecordDecodeStatistics(EfiGuardStageBootmgr, &ImageContext.Zydis);
+	FreeImageContext(&ImageContext);
+	StopPatchTiming(Timing);
+
 	if (EFI_ERROR(Status))
 	{
 		// Patch failed. Prompt user to ask what they want to do
-		Print(L"\r\nPress any key to continue anyway, or press ESC to reboot.\r\n");
+		ConsolePrint(L"\r\nPress any key to continue anyway, or press ESC to reboot.\r\n");
 		if (!WaitForKey())
 		{
 			gRT->ResetSystem(EfiResetCold, EFI_SUCCESS, 0, NULL);
@@ -362,12 +384,12 @@ Exit:
 	}
 	else
 	{
-		Print(L"Successfully patched %S!%S.\r\n", ShortFileName, FunctionName);
-		RtlSleep(2000);
+		ConsolePrint(L"Successfully patched %S!%S.\r\n", ShortFileName, FunctionName);
+		BootStageDelay(gBootDelays.Bootmgr);
 
 		if (gDriverConfig.WaitForKeyPress)
 		{
-			Print(L"\r\nPress any key to continue.\r\n");
+			ConsolePrint(L"\r\nPress any key to continue.\r\n");
 			WaitForKey();
 		}
 	}
@@ -39,6 +39,13 @@ STATIC CONST UINT8 SigKiVerifyScopesExecute[] = {
 	0x48, 0xB8, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFE	// mov rax, 0FEFFFFFFFFFFFFFFh
 };
 
+// Address of SharedUserData->KdDebuggerEnabled (0xFFFFF780000002D4). Both CcInitializeBcbProfiler and ExpLicenseWatchInitWorker
+// read it with this address as a 64-bit operand on Windows 8+, so only the functions containing these bytes need to be decoded
+STATIC CONST UINT8 SigKdDebuggerEnabledAddressBytes[] = {
+	0xD4, 0x02, 0x00, 0x00, 0x80, 0xF7, 0xFF, 0xFF
+};
+STATIC BYTE_SIGNATURE SigKdDebuggerEnabledAddress = BYTE_SIGNATURE_INIT(SigKdDebuggerEnabledAddressBytes, 0xCC);
+
 #ifndef EAC_COMPAT_MODE
 // Signature for nt!KiMcaDeferredRecoveryService
 // This function is present since Windows 8.1 and bugchecks the system with bugcode 0x109 after zeroing registers.
@@ -67,13 +74,14 @@ STATIC CONST UINT8 SigKiSwInterrupt[] = {
 // Signature for nt!SeCodeIntegrityQueryInformation, called through NtQuerySystemInformation(SystemCodeIntegrityInformation).
 // This function has actually existed since Vista in various forms, sometimes (8/8.1/early 10) inlined in ExpQuerySystemInformation.
 // This signature is only for the Windows 10 RS3+ version. I could add more signatures but this is a pretty superficial patch anyway.
-STATIC CONST UINT8 SigSeCodeIntegrityQueryInformation[] = {
+STATIC CONST UINT8 SigSeCodeIntegrityQueryInformationBytes[] = {
 	0x48, 0x83, 0xEC,										// sub rsp, XX
 	0xCC, 0x48, 0x83, 0x3D, 0xCC, 0xCC, 0xCC, 0xCC, 0x00,	// cmp cs:qword_14035E638, 0
 	0x4D, 0x8B, 0xC8,										// mov r9, r8
 	0x4C, 0x8B, 0xD1,										// mov r10, rcx
 	0x74, 0xCC												// jz XX
 };
+STATIC BYTE_SIGNATURE SigSeCodeIntegrityQueryInformation = BYTE_SIGNATURE_INIT(SigSeCodeIntegrityQueryInformationBytes, 0xCC);
 
 // Patched SeCodeIntegrityQueryInformation which reports that DSE is enabled
 STATIC CONST UINT8 SeCodeIntegrityQueryInformationPatch[] = {
@@ -84,7 +92,108 @@ STATIC CONST UINT8 SeCodeIntegrityQueryInformationPatch[] = {
 };
 
 
+// STATUS_INVALID_IMAGE_HASH (0xC0000428), as the immediate of 'mov eax, 0xC0000428' in SeValidateImageData on Windows 8+
+STATIC CONST UINT8 SigInvalidImageHashStatusBytes[] = {
+	0x28, 0x04, 0x00, 0xC0
+};
+STATIC BYTE_SIGNATURE SigInvalidImageHashStatus = BYTE_SIGNATURE_INIT(SigInvalidImageHashStatusBytes, 0xCC);
+
+
 #ifndef DO_NOT_DISABLE_PATCHGUARD
+typedef struct _BCB_PROFILER_MATCH_STATE
+{
+	UINT16 BuildNumber;
+	UINTN RtlPcToFileHeader;				// Windows Vista/7 only
+	UINT8* PatternAddress;					// Out
+} BCB_PROFILER_MATCH_STATE, *PBCB_PROFILER_MATCH_STATE;
+
+typedef struct _LICENSE_WATCH_MATCH_STATE
+{
+	PBCB_PROFILER_MATCH_STATE BcbProfilerState;
+	UINT8* PatternAddress;					// Out
+} LICENSE_WATCH_MATCH_STATE, *PLICENSE_WATCH_MATCH_STATE;
+
+//
+// Matches the SharedUserData->KdDebuggerEnabled read in CcInitializeBcbProfiler (Win 8+), or 'call RtlPcToFileHeader' in <HUGEFUNC> (Win Vista/7)
+//
+STATIC
+BOOLEAN
+EFIAPI
+MatchCcInitializeBcbProfiler(
+	IN OUT PZYDIS_CONTEXT Context,
+	IN OUT VOID *State
+	)
+{
+	CONST PBCB_PROFILER_MATCH_STATE MatchState = (PBCB_PROFILER_MATCH_STATE)State;
+
+	if (MatchState->BuildNumber < 9200)
+	{
+		// Windows Vista/7: check if this is 'call IMM'
+		if (Context->Instruction.mnemonic == ZYDIS_MNEMONIC_CALL && Context->Instruction.operand_count == 4 &&
+			ZYAN_SUCCESS(ZydisDecodeOperands(Context)) &&
+			Context->Operands[0].type == ZYDIS_OPERAND_TYPE_IMMEDIATE && Context->Operands[0].imm.is_relative == ZYAN_TRUE)
+		{
+			// Check if this is 'call RtlPcToFileHeader'
+			ZyanU64 OperandAddress = 0;
+			if (ZYAN_SUCCESS(ZydisCalcAbsoluteAddress(&Context->Instruction, &Context->Operands[0], Context->InstructionAddress, &OperandAddress)) &&
+				OperandAddress == MatchState->RtlPcToFileHeader)
+			{
+				MatchState->PatternAddress = (UINT8*)Context->InstructionAddress;
+				PRINT_KERNEL_PATCH_TRACE(L"    Found 'call RtlPcToFileHeader' at 0x%llX.\r\n", (UINTN)MatchState->PatternAddress);
+				return TRUE;
+			}
+		}
+	}
+	else
+	{
+		// Windows 8+: check if this is 'mov [al|rax], 0x0FFFFF780000002D4' ; SharedUserData->KdDebuggerEnabled
+		if ((Context->Instruction.operand_count == 2 && Context->Instruction.mnemonic == ZYDIS_MNEMONIC_MOV &&
+			ZYAN_SUCCESS(ZydisDecodeOperands(Context)) && Context->Operands[0].type == ZYDIS_OPERAND_TYPE_REGISTER) &&
+			((Context->Operands[0].reg.value == ZYDIS_REGISTER_AL && Context->Operands[1].type == ZYDIS_OPERAND_TYPE_MEMORY &&
+				(UINT64)(Context->Operands[1].mem.disp.value) == 0x0FFFFF780000002D4ULL) ||
+			(Context->Operands[0].reg.value == ZYDIS_REGISTER_RAX && Context->Operands[1].type == ZYDIS_OPERAND_TYPE_IMMEDIATE &&
+				Context->Operands[1].imm.value.u == 0x0FFFFF780000002D4ULL)))
+		{
+			MatchState->PatternAddress = (UINT8*)Context->InstructionAddress;
+			PRINT_KERNEL_PATCH_TRACE(L"    Found CcInitializeBcbProfiler pattern at 0x%llX.\r\n", (UINTN)MatchState->PatternAddress);
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+//
+// Matches the SharedUserData->KdDebuggerEnabled read in ExpLicenseWatchInitWorker (Win 8+).
+// Must come after MatchCcInitializeBcbProfiler in the matcher list, since it excludes the address found by that matcher
+//
+STATIC
+BOOLEAN
+EFIAPI
+MatchExpLicenseWatchInitWorker(
+	IN OUT PZYDIS_CONTEXT Context,
+	IN OUT VOID *State
+	)
+{
+	CONST PLICENSE_WATCH_MATCH_STATE MatchState = (PLICENSE_WATCH_MATCH_STATE)State;
+
+	// Check if this is 'mov al, ds:[0x0FFFFF780000002D4]' ; SharedUserData->KdDebuggerEnabled
+	// The address must also obviously not be the CcInitializeBcbProfiler one
+	if ((UINT8*)Context->InstructionAddress != MatchState->BcbProfilerState->PatternAddress &&
+		Context->Instruction.operand_count == 2 && Context->Instruction.mnemonic == ZYDIS_MNEMONIC_MOV &&
+		ZYAN_SUCCESS(ZydisDecodeOperands(Context)) &&
+		Context->Operands[0].type == ZYDIS_OPERAND_TYPE_REGISTER && Context->Operands[0].reg.value == ZYDIS_REGISTER_AL &&
+		Context->Operands[1].type == ZYDIS_OPERAND_TYPE_MEMORY && Context->Operands[1].mem.segment == ZYDIS_REGISTER_DS &&
+		Context->Operands[1].mem.disp.value == 0x0FFFFF780000002D4LL)
+	{
+		MatchState->PatternAddress = (UINT8*)Context->InstructionAddress;
+		PRINT_KERNEL_PATCH_TRACE(L"    Found ExpLicenseWatchInitWorker pattern at 0x%llX.\r\n", (UINTN)MatchState->PatternAddress);
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
 //
 // Defuses PatchGuard initialization routines before execution is transferred to the kernel.
 // All code accessed here is located in the INIT and .text sections.
@@ -93,45 +202,54 @@ STATIC
 EFI_STATUS
 EFIAPI
 DisablePatchGuard(
-	IN UINT8* ImageBase,
-	IN PEFI_IMAGE_NT_HEADERS NtHeaders,
-	IN PEFI_IMAGE_SECTION_HEADER InitSection,
-	IN PEFI_IMAGE_SECTION_HEADER TextSection,
+	IN OUT PIMAGE_CONTEXT ImageContext,
 	IN UINT16 BuildNumber
 	)
 {
+	UINT8* ImageBase = ImageContext->ImageBase;
+	CONST PEFI_IMAGE_NT_HEADERS NtHeaders = ImageContext->NtHeaders;
+	CONST PEFI_IMAGE_SECTION_HEADER InitSection = ImageContext->InitSection;
+	CONST PEFI_IMAGE_SECTION_HEADER TextSection = ImageContext->TextSection;
+	CONST PZYDIS_CONTEXT Context = &ImageContext->Zydis;
+
 	UINT32 StartRva = InitSection->VirtualAddress;
 	UINT32 SizeOfRawData = InitSection->SizeOfRawData;
 	UINT8* StartVa = ImageBase + StartRva;
 
-	// Search for KeInitAmd64SpecificState
-	PRINT_KERNEL_PATCH_MSG(L"\r\n== Searching for nt!KeInitAmd64SpecificState pattern in INIT ==\r\n");
-	UINT8* KeInitAmd64SpecificStatePatternAddress = NULL;
-	for (UINT8* Address = StartVa; Address < StartVa + SizeOfRawData - sizeof(SigKeInitAmd64SpecificState); ++Address)
-	{
-		if (CompareMem(Address, SigKeInitAmd64SpecificState, sizeof(SigKeInitAmd64SpecificState)) == 0)
-		{
-			KeInitAmd64SpecificStatePatternAddress = Address;
-			PRINT_KERNEL_PATCH_MSG(L"    Found KeInitAmd64SpecificState pattern at 0x%llX.\r\n", (UINTN)KeInitAmd64SpecificStatePatternAddress);
-			break;
-		}
-	}
+	// Search for KeInitAmd64SpecificState, and for KiVerifyScopesExecute (only exists on Windows >= 8.1) in the same pass
+	PRINT_KERNEL_PATCH_TRACE(L"\r\n== Searching for nt!KeInitAmd64SpecificState%S pattern%S in INIT ==\r\n",
+		(BuildNumber >= 9600 ? L" and nt!KiVerifyScopesExecute" : L""), (BuildNumber >= 9600 ? L"s" : L""));
+	PATTERN_SEARCH InitPatterns[] = {
+		{ SigKeInitAmd64SpecificState, sizeof(SigKeInitAmd64SpecificState), 0xCC, NULL },
+		{ SigKiVerifyScopesExecute, sizeof(SigKiVerifyScopesExecute), 0xCC, NULL }
+	};
+	UINT32 Timing = StartPatchTiming(L"KeInitAmd64SpecificState search (INIT)");
+	FindPatterns(InitPatterns,
+				BuildNumber >= 9600 ? 2 : 1,
+				StartVa,
+				SizeOfRawData);
+	StopPatchTiming(Timing);
+
+	UINT8* KeInitAmd64SpecificStatePatternAddress = (UINT8*)InitPatterns[0].Found;
+	if (KeInitAmd64SpecificStatePatternAddress != NULL)
+		PRINT_KERNEL_PATCH_TRACE(L"    Found KeInitAmd64SpecificState pattern at 0x%llX.\r\n", (UINTN)KeInitAmd64SpecificStatePatternAddress);
 
 	// Backtrack to function start
 	UINT8* KeInitAmd64SpecificState = BacktrackToFunctionStart(ImageBase, NtHeaders, KeInitAmd64SpecificStatePatternAddress);
 	if (KeInitAmd64SpecificState == NULL)
 	{
-		PRINT_KERNEL_PATCH_MSG(L"    Failed to find KeInitAmd64SpecificState%S.\r\n",
+		PRINT_KERNEL_PATCH_ERROR(L"    Failed to find KeInitAmd64SpecificState%S.\r\n",
 			(KeInitAmd64SpecificStatePatternAddress == NULL ? L" pattern" : L""));
 		return EFI_NOT_FOUND;
 	}
 
-	// Search for CcInitializeBcbProfiler (Win 8+) / <HUGEFUNC> (Win Vista/7)
+	// Search for CcInitializeBcbProfiler (Win 8+) / <HUGEFUNC> (Win Vista/7), and for ExpLicenseWatchInitWorker (only exists on Windows >= 8) in the same pass
 	// Most variables below use the 'CcInitializeBcbProfiler' name, which is not really accurate for Windows Vista/7 but close enough.
 	// For debug prints, call the function "<HUGEFUNC>" instead if we're on Windows Vista/7. (seriously, it's fucking huge)
 	CONST CHAR16* FuncName = BuildNumber >= 9200 ? L"CcInitializeBcbProfiler" : L"<HUGEFUNC>";
-	PRINT_KERNEL_PATCH_MSG(L"== Disassembling INIT to find nt!%S ==\r\n", FuncName);
-	UINT8* CcInitializeBcbProfilerPatternAddress = NULL;
+	(VOID)FuncName; // Only used in messages, which may be compiled out
+	PRINT_KERNEL_PATCH_TRACE(L"== Disassembling INIT to find nt!%S%S ==\r\n",
+		FuncName, (BuildNumber >= 9200 ? L" and nt!ExpLicenseWatchInitWorker" : L""));
 
 	// On Windows Vista/7 we need to find the address of RtlPcToFileHeader, which will help identify HUGEFUNC as no other function calls this
 	UINTN RtlPcToFileHeader = 0;
@@ -140,125 +258,67 @@ DisablePatchGuard(
 		RtlPcToFileHeader = (UINTN)GetProcedureAddress((UINTN)ImageBase, NtHeaders, "RtlPcToFileHeader");
 		if (RtlPcToFileHeader == 0)
 		{
-			PRINT_KERNEL_PATCH_MSG(L"Failed to find RtlPcToFileHeader export.\r\n");
+			PRINT_KERNEL_PATCH_ERROR(L"Failed to find RtlPcToFileHeader export.\r\n");
 			return EFI_NOT_FOUND;
 		}
 	}
 
-	// Initialize Zydis
-	ZYDIS_CONTEXT Context;
-	ZyanStatus Status = ZydisInit(NtHeaders, &Context);
-	if (!ZYAN_SUCCESS(Status))
+	BCB_PROFILER_MATCH_STATE BcbProfilerState = { BuildNumber, RtlPcToFileHeader, NULL };
+	LICENSE_WATCH_MATCH_STATE LicenseWatchState = { &BcbProfilerState, NULL };
+	INSTRUCTION_MATCHER InitMatchers[] = {
+		{ MatchCcInitializeBcbProfiler, &BcbProfilerState, FALSE },
+		{ MatchExpLicenseWatchInitWorker, &LicenseWatchState, FALSE }
+	};
+	Timing = StartPatchTiming(L"CcInitializeBcbProfiler decode (INIT)");
+	if (BuildNumber >= 9200)
 	{
-		PRINT_KERNEL_PATCH_MSG(L"Failed to initialize disassembler engine.\r\n");
-		return EFI_LOAD_ERROR;
+		DecodeSignatureSitesAndMatch(Context,
+									ImageBase,
+									NtHeaders,
+									&SigKdDebuggerEnabledAddress,
+									StartVa,
+									SizeOfRawData,
+									InitMatchers,
+									2);
 	}
-
-	Context.Length = SizeOfRawData;
-	Context.Offset = 0;
-
-	// Start decode loop
-	while ((Context.InstructionAddress = (ZyanU64)(StartVa + Context.Offset),
-			Status = ZydisDecoderDecodeFull(&Context.Decoder,
-											(VOID*)Context.InstructionAddress,
-											Context.Length - Context.Offset,
-											&Context.Instruction,
-											Context.Operands)) != ZYDIS_STATUS_NO_MORE_DATA)
+	else
 	{
-		if (!ZYAN_SUCCESS(Status))
-		{
-			Context.Offset++;
-			continue;
-		}
-
-		if (BuildNumber < 9200)
-		{
-			// Windows Vista/7: check if this is 'call IMM'
-			if (Context.Instruction.operand_count == 4 &&
-				Context.Operands[0].type == ZYDIS_OPERAND_TYPE_IMMEDIATE && Context.Operands[0].imm.is_relative == ZYAN_TRUE &&
-				Context.Instruction.mnemonic == ZYDIS_MNEMONIC_CALL)
-			{
-				// Check if this is 'call RtlPcToFileHeader'
-				ZyanU64 OperandAddress = 0;
-				if (ZYAN_SUCCESS(ZydisCalcAbsoluteAddress(&Context.Instruction, &Context.Operands[0], Context.InstructionAddress, &OperandAddress)) &&
-					OperandAddress == RtlPcToFileHeader)
-				{
-					CcInitializeBcbProfilerPatternAddress = (UINT8*)Context.InstructionAddress;
-					PRINT_KERNEL_PATCH_MSG(L"    Found 'call RtlPcToFileHeader' at 0x%llX.\r\n", (UINTN)CcInitializeBcbProfilerPatternAddress);
-					break;
-				}
-			}
-		}
-		else
-		{
-			// Windows 8+: check if this is 'mov [al|rax], 0x0FFFFF780000002D4' ; SharedUserData->KdDebuggerEnabled
-			if ((Context.Instruction.operand_count == 2 && Context.Instruction.mnemonic == ZYDIS_MNEMONIC_MOV && Context.Operands[0].type == ZYDIS_OPERAND_TYPE_REGISTER) &&
-				((Context.Operands[0].reg.value == ZYDIS_REGISTER_AL && Context.Operands[1].type == ZYDIS_OPERAND_TYPE_MEMORY &&
-					(UINT64)(Context.Operands[1].mem.disp.value) == 0x0FFFFF780000002D4ULL) ||
-				(Context.Operands[0].reg.value == ZYDIS_REGISTER_RAX && Context.Operands[1].type == ZYDIS_OPERAND_TYPE_IMMEDIATE &&
-					Context.Operands[1].imm.value.u == 0x0FFFFF780000002D4ULL)))
-			{
-				CcInitializeBcbProfilerPatternAddress = (UINT8*)Context.InstructionAddress;
-				PRINT_KERNEL_PATCH_MSG(L"    Found CcInitializeBcbProfiler pattern at 0x%llX.\r\n", (UINTN)CcInitializeBcbProfilerPatternAddress);
-				break;
-			}
-		}
-
-		Context.Offset += Context.Instruction.length;
+		DecodeFunctionsAndMatch(Context,
+								ImageBase,
+								NtHeaders,
+								StartVa,
+								SizeOfRawData,
+								InitMatchers,
+								1);
 	}
+	StopPatchTiming(Timing);
+
+	// Backtrack to function start for both functions at once
+	CONST UINT8* CcInitializeBcbProfilerPatternAddress = BcbProfilerState.PatternAddress;
+	CONST UINT8* ExpLicenseWatchInitWorkerPatternAddress = LicenseWatchState.PatternAddress;
+	CONST UINT8* InitPatternAddresses[] = { CcInitializeBcbProfilerPatternAddress, ExpLicenseWatchInitWorkerPatternAddress };
+	UINT8* InitFunctions[ARRAY_SIZE(InitPatternAddresses)];
+	BacktrackToFunctionStarts(ImageBase,
+							NtHeaders,
+							InitPatternAddresses,
+							BuildNumber >= 9200 ? 2 : 1,
+							InitFunctions);
 
-	// Backtrack to function start
-	UINT8* CcInitializeBcbProfiler = BacktrackToFunctionStart(ImageBase, NtHeaders, CcInitializeBcbProfilerPatternAddress);
+	UINT8* CcInitializeBcbProfiler = InitFunctions[0];
 	if (CcInitializeBcbProfiler == NULL)
 	{
-		PRINT_KERNEL_PATCH_MSG(L"    Failed to find %S%S.\r\n",
+		PRINT_KERNEL_PATCH_ERROR(L"    Failed to find %S%S.\r\n",
 			FuncName, (CcInitializeBcbProfilerPatternAddress == NULL ? L" pattern" : L""));
 		return EFI_NOT_FOUND;
 	}
 
-	// Search for ExpLicenseWatchInitWorker (only exists on Windows >= 8)
 	UINT8* ExpLicenseWatchInitWorker = NULL;
 	if (BuildNumber >= 9200)
 	{
-		PRINT_KERNEL_PATCH_MSG(L"== Disassembling INIT to find nt!ExpLicenseWatchInitWorker ==\r\n");
-		UINT8* ExpLicenseWatchInitWorkerPatternAddress = NULL;
-
-		// Start decode loop
-		Context.Offset = 0;
-		while ((Context.InstructionAddress = (ZyanU64)(StartVa + Context.Offset),
-				Status = ZydisDecoderDecodeFull(&Context.Decoder,
-												(VOID*)Context.InstructionAddress,
-												Context.Length - Context.Offset,
-												&Context.Instruction,
-												Context.Operands)) != ZYDIS_STATUS_NO_MORE_DATA)
-		{
-			if (!ZYAN_SUCCESS(Status))
-			{
-				Context.Offset++;
-				continue;
-			}
-
-			// Check if this is 'mov al, ds:[0x0FFFFF780000002D4]' ; SharedUserData->KdDebuggerEnabled
-			// The address must also obviously not be the CcInitializeBcbProfiler one we just found
-			if ((UINT8*)Context.InstructionAddress != CcInitializeBcbProfilerPatternAddress &&
-				Context.Instruction.operand_count == 2 && Context.Instruction.mnemonic == ZYDIS_MNEMONIC_MOV &&
-				Context.Operands[0].type == ZYDIS_OPERAND_TYPE_REGISTER && Context.Operands[0].reg.value == ZYDIS_REGISTER_AL &&
-				Context.Operands[1].type == ZYDIS_OPERAND_TYPE_MEMORY && Context.Operands[1].mem.segment == ZYDIS_REGISTER_DS &&
-				Context.Operands[1].mem.disp.value == 0x0FFFFF780000002D4LL)
-			{
-				ExpLicenseWatchInitWorkerPatternAddress = (UINT8*)Context.InstructionAddress;
-				PRINT_KERNEL_PATCH_MSG(L"    Found ExpLicenseWatchInitWorker pattern at 0x%llX.\r\n", (UINTN)ExpLicenseWatchInitWorkerPatternAddress);
-				break;
-			}
-
-			Context.Offset += Context.Instruction.length;
-		}
-
-		// Backtrack to function start
-		ExpLicenseWatchInitWorker = BacktrackToFunctionStart(ImageBase, NtHeaders, ExpLicenseWatchInitWorkerPatternAddress);
+		ExpLicenseWatchInitWorker = InitFunctions[1];
 		if (ExpLicenseWatchInitWorker == NULL)
 		{
-			PRINT_KERNEL_PATCH_MSG(L"    Failed to find ExpLicenseWatchInitWorker%S.\r\n",
+			PRINT_KERNEL_PATCH_ERROR(L"    Failed to find ExpLicenseWatchInitWorker%S.\r\n",
 				(ExpLicenseWatchInitWorkerPatternAddress == NULL ? L" pattern" : L""));
 			return EFI_NOT_FOUND;
 		}
@@ -268,26 +328,19 @@ DisablePatchGuard(
 	UINT8* KiVerifyScopesExecute = NULL;
 	if (BuildNumber >= 9600)
 	{
-		PRINT_KERNEL_PATCH_MSG(L"== Searching for nt!KiVerifyScopesExecute pattern in INIT ==\r\n");
-		UINT8* KiVerifyScopesExecutePatternAddress = NULL;
-		CONST EFI_STATUS FindKiVerifyScopesExecuteStatus = FindPattern(SigKiVerifyScopesExecute,
-																	0xCC,
-																	sizeof(SigKiVerifyScopesExecute),
-																	StartVa,
-																	SizeOfRawData,
-																	(VOID**)&KiVerifyScopesExecutePatternAddress);
-		if (EFI_ERROR(FindKiVerifyScopesExecuteStatus))
+		CONST UINT8* KiVerifyScopesExecutePatternAddress = (UINT8*)InitPatterns[1].Found;
+		if (KiVerifyScopesExecutePatternAddress == NULL)
 		{
-			PRINT_KERNEL_PATCH_MSG(L"    Failed to find KiVerifyScopesExecute pattern.\r\n");
+			PRINT_KERNEL_PATCH_ERROR(L"    Failed to find KiVerifyScopesExecute pattern.\r\n");
 			return EFI_NOT_FOUND;
 		}
-		PRINT_KERNEL_PATCH_MSG(L"    Found KiVerifyScopesExecute pattern at 0x%llX.\r\n", (UINTN)KiVerifyScopesExecutePatternAddress);
+		PRINT_KERNEL_PATCH_TRACE(L"    Found KiVerifyScopesExecute pattern at 0x%llX.\r\n", (UINTN)KiVerifyScopesExecutePatternAddress);
 
 		// Backtrack to function start
 		KiVerifyScopesExecute = BacktrackToFunctionStart(ImageBase, NtHeaders, KiVerifyScopesExecutePatternAddress);
 		if (KiVerifyScopesExecute == NULL)
 		{
-			PRINT_KERNEL_PATCH_MSG(L"    Failed to find KiVerifyScopesExecute.\r\n");
+			PRINT_KERNEL_PATCH_ERROR(L"    Failed to find KiVerifyScopesExecute.\r\n");
 			return EFI_NOT_FOUND;
 		}
 	}
@@ -296,73 +349,55 @@ DisablePatchGuard(
 	// Search for callers of KiMcaDeferredRecoveryService (only exists on Windows >= 8.1)
 	UINT8* KiMcaDeferredRecoveryServiceCallers[2];
 	ZeroMem(KiMcaDeferredRecoveryServiceCallers, sizeof(KiMcaDeferredRecoveryServiceCallers));
+	PATTERN_SEARCH TextPatterns[] = {
+		{ SigKiMcaDeferredRecoveryService, sizeof(SigKiMcaDeferredRecoveryService), 0xCC, NULL },
+		{ SigKiSwInterrupt, sizeof(SigKiSwInterrupt), 0xCC, NULL }
+	};
 	if (BuildNumber >= 9600)
 	{
 		StartRva = TextSection->VirtualAddress;
 		SizeOfRawData = TextSection->SizeOfRawData;
 		StartVa = ImageBase + StartRva;
 
-		// Search for KiMcaDeferredRecoveryService
-		PRINT_KERNEL_PATCH_MSG(L"== Searching for nt!KiMcaDeferredRecoveryService pattern in .text ==\r\n");
-		UINT8* KiMcaDeferredRecoveryService = NULL;
-		for (UINT8* Address = StartVa; Address < StartVa + SizeOfRawData - sizeof(SigKiMcaDeferredRecoveryService); ++Address)
-		{
-			if (CompareMem(Address, SigKiMcaDeferredRecoveryService, sizeof(SigKiMcaDeferredRecoveryService)) == 0)
-			{
-				KiMcaDeferredRecoveryService = Address;
-				PRINT_KERNEL_PATCH_MSG(L"    Found KiMcaDeferredRecoveryService pattern at 0x%llX.\r\n", (UINTN)KiMcaDeferredRecoveryService);
-				break;
-			}
-		}
-
+		// Search for KiMcaDeferredRecoveryService, and for KiSwInterrupt (only exists on Windows >= 10) in the same pass
+		PRINT_KERNEL_PATCH_TRACE(L"== Searching for nt!KiMcaDeferredRecoveryService%S pattern%S in .text ==\r\n",
+			(BuildNumber >= 10240 ? L" and nt!KiSwInterrupt" : L""), (BuildNumber >= 10240 ? L"s" : L""));
+		Timing = StartPatchTiming(L"KiMcaDeferredRecoveryService search (.text)");
+		FindPatterns(TextPatterns,
+					BuildNumber >= 10240 ? 2 : 1,
+					StartVa,
+					SizeOfRawData);
+		StopPatchTiming(Timing);
+
+		CONST UINT8* KiMcaDeferredRecoveryService = (UINT8*)TextPatterns[0].Found;
 		if (KiMcaDeferredRecoveryService == NULL)
 		{
-			PRINT_KERNEL_PATCH_MSG(L"    Failed to find KiMcaDeferredRecoveryService.\r\n");
+			PRINT_KERNEL_PATCH_ERROR(L"    Failed to find KiMcaDeferredRecoveryService.\r\n");
 			return EFI_NOT_FOUND;
 		}
-
-		// Start decode loop
-		Context.Length = SizeOfRawData;
-		Context.Offset = 0;
-		while ((Context.InstructionAddress = (ZyanU64)(StartVa + Context.Offset),
-				Status = ZydisDecoderDecodeFull(&Context.Decoder,
-												(VOID*)Context.InstructionAddress,
-												Context.Length - Context.Offset,
-												&Context.Instruction,
-												Context.Operands)) != ZYDIS_STATUS_NO_MORE_DATA)
-		{
-			if (!ZYAN_SUCCESS(Status))
-			{
-				Context.Offset++;
-				continue;
-			}
-
-			// Check if this is 'call KiMcaDeferredRecoveryService'
-			ZyanU64 OperandAddress = 0;	
-			if (Context.Instruction.mnemonic == ZYDIS_MNEMONIC_CALL &&
-				ZYAN_SUCCESS(ZydisCalcAbsoluteAddress(&Context.Instruction, &Context.Operands[0], Context.InstructionAddress, &OperandAddress)) &&
-				OperandAddress == (UINTN)KiMcaDeferredRecoveryService)
-			{
-				if (KiMcaDeferredRecoveryServiceCallers[0] == NULL)
-				{
-					KiMcaDeferredRecoveryServiceCallers[0] = (UINT8*)Context.InstructionAddress;
-				}
-				else if (KiMcaDeferredRecoveryServiceCallers[1] == NULL)
-				{
-					KiMcaDeferredRecoveryServiceCallers[1] = (UINT8*)Context.InstructionAddress;
-					break;
-				}
-			}
-
-			Context.Offset += Context.Instruction.length;
-		}
-
-		// Backtrack to function start
-		KiMcaDeferredRecoveryServiceCallers[0] = BacktrackToFunctionStart(ImageBase, NtHeaders, KiMcaDeferredRecoveryServiceCallers[0]);
-		KiMcaDeferredRecoveryServiceCallers[1] = BacktrackToFunctionStart(ImageBase, NtHeaders, KiMcaDeferredRecoveryServiceCallers[1]);
+		PRINT_KERNEL_PATCH_TRACE(L"    Found KiMcaDeferredRecoveryService pattern at 0x%llX.\r\n", (UINTN)KiMcaDeferredRecoveryService);
+
+		// Find the first two calls to KiMcaDeferredRecoveryService. Only these need to be decoded
+		UINT8* McaCallers[2] = { NULL, NULL };
+		Timing = StartPatchTiming(L"KiMcaDeferredRecoveryService callers (.text)");
+		FindReferencesTo(Context,
+						StartVa,
+						SizeOfRawData,
+						KiMcaDeferredRecoveryService,
+						1U << XrefCall,
+						McaCallers,
+						ARRAY_SIZE(McaCallers));
+		StopPatchTiming(Timing);
+
+		// Backtrack to function start. The callers are in ascending order, so this is a single pass over the function table
+		BacktrackToFunctionStarts(ImageBase,
+								NtHeaders,
+								(CONST UINT8* CONST*)McaCallers,
+								ARRAY_SIZE(McaCallers),
+								KiMcaDeferredRecoveryServiceCallers);
 		if (KiMcaDeferredRecoveryServiceCallers[0] == NULL || KiMcaDeferredRecoveryServiceCallers[1] == NULL)
 		{
-			PRINT_KERNEL_PATCH_MSG(L"    Failed to find KiMcaDeferredRecoveryService callers.\r\n");
+			PRINT_KERNEL_PATCH_ERROR(L"    Failed to find KiMcaDeferredRecoveryService callers.\r\n");
 			return EFI_NOT_FOUND;
 		}
 	}
@@ -371,14 +406,8 @@ DisablePatchGuard(
 	UINT8* KiSwInterruptPatternAddress = NULL;
 	if (BuildNumber >= 10240)
 	{
-		PRINT_KERNEL_PATCH_MSG(L"== Searching for nt!KiSwInterrupt pattern in .text ==\r\n");
-		CONST EFI_STATUS FindKiSwInterruptStatus = FindPattern(SigKiSwInterrupt,
-																0xCC,
-																sizeof(SigKiSwInterrupt),
-																StartVa,
-																SizeOfRawData,
-																(VOID**)&KiSwInterruptPatternAddress);
-		if (EFI_ERROR(FindKiSwInterruptStatus))
+		KiSwInterruptPatternAddress = (UINT8*)TextPatterns[1].Found;
+		if (KiSwInterruptPatternAddress == NULL)
 		{
 			// This is not a fatal error as the system can still boot without patching KiSwInterrupt.
 			// However note that in this case, any attempt to issue int 20h from kernel mode later will result in a bugcheck.
@@ -386,7 +415,7 @@ DisablePatchGuard(
 		}
 		else
 		{
-			PRINT_KERNEL_PATCH_MSG(L"    Found KiSwInterrupt pattern at 0x%llX.\r\n", (UINTN)KiSwInterruptPatternAddress);
+			PRINT_KERNEL_PATCH_TRACE(L"    Found KiSwInterrupt pattern at 0x%llX.\r\n", (UINTN)KiSwInterruptPatternAddress);
 		}
 	}
 #endif
@@ -443,6 +472,202 @@ DisablePatchGuard(
 }
 #endif
 
+typedef struct _CI_INITIALIZE_MATCH_STATE
+{
+	CONST UINT8* ImageBase;
+	UINT16 BuildNumber;
+	UINTN CiInitialize;						// IAT address of CiInitialize, or the import thunk on Windows Vista/7
+	UINT8* LastMovIntoEcx;
+	UINT8* MovEcxAddress;					// Out
+} CI_INITIALIZE_MATCH_STATE, *PCI_INITIALIZE_MATCH_STATE;
+
+typedef struct _VALIDATE_IMAGE_DATA_MATCH_STATE
+{
+	CONST UINT8* ImageBase;
+	UINT16 BuildNumber;
+	ZyanU64 gCiEnabled;						// Windows Vista/7 only
+	UINT8* MovEaxAddress;					// Out (Win 8+)
+	UINT8* JzAddress;						// Out (Win Vista/7)
+} VALIDATE_IMAGE_DATA_MATCH_STATE, *PVALIDATE_IMAGE_DATA_MATCH_STATE;
+
+typedef struct _CI_INITIALIZE_THUNK_MATCH_STATE
+{
+	UINTN CiInitialize;						// IAT address of CiInitialize
+	UINT8* JmpAddress;						// Out
+} CI_INITIALIZE_THUNK_MATCH_STATE, *PCI_INITIALIZE_THUNK_MATCH_STATE;
+
+typedef struct _CI_ENABLED_MATCH_STATE
+{
+	ZyanU64 gCiEnabled;						// Out
+} CI_ENABLED_MATCH_STATE, *PCI_ENABLED_MATCH_STATE;
+
+//
+// Matches the 'jmp qword ptr ds:[__imp_CiInitialize]' import thunk in .text (Windows Vista/7)
+//
+STATIC
+BOOLEAN
+EFIAPI
+MatchCiInitializeThunk(
+	IN OUT PZYDIS_CONTEXT Context,
+	IN OUT VOID *State
+	)
+{
+	CONST PCI_INITIALIZE_THUNK_MATCH_STATE MatchState = (PCI_INITIALIZE_THUNK_MATCH_STATE)State;
+
+	if (Context->Instruction.mnemonic == ZYDIS_MNEMONIC_JMP && Context->Instruction.operand_count == 2 &&
+		ZYAN_SUCCESS(ZydisDecodeOperands(Context)) &&
+		Context->Operands[0].type == ZYDIS_OPERAND_TYPE_MEMORY && Context->Operands[0].mem.base == ZYDIS_REGISTER_RIP)
+	{
+		// Check if this is 'jmp qword ptr ds:[CiInitialize IAT RVA]'
+		ZyanU64 OperandAddress = 0;
+		if (ZYAN_SUCCESS(ZydisCalcAbsoluteAddress(&Context->Instruction, &Context->Operands[0], Context->InstructionAddress, &OperandAddress)) &&
+			OperandAddress == MatchState->CiInitialize)
+		{
+			MatchState->JmpAddress = (UINT8*)Context->InstructionAddress;
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+//
+// Matches 'mov g_CiEnabled, REG8' after the 'mov ecx, xxx' in SepInitializeCodeIntegrity (Windows Vista/7)
+//
+STATIC
+BOOLEAN
+EFIAPI
+MatchCiEnabledStore(
+	IN OUT PZYDIS_CONTEXT Context,
+	IN OUT VOID *State
+	)
+{
+	CONST PCI_ENABLED_MATCH_STATE MatchState = (PCI_ENABLED_MATCH_STATE)State;
+
+	if (Context->Instruction.operand_count == 2 &&
+		Context->Instruction.mnemonic == ZYDIS_MNEMONIC_MOV &&
+		ZYAN_SUCCESS(ZydisDecodeOperands(Context)) &&
+		Context->Operands[0].type == ZYDIS_OPERAND_TYPE_MEMORY && Context->Operands[0].mem.base == ZYDIS_REGISTER_RIP &&
+		Context->Operands[1].type == ZYDIS_OPERAND_TYPE_REGISTER)
+	{
+		if (ZYAN_SUCCESS(ZydisCalcAbsoluteAddress(&Context->Instruction, &Context->Operands[0], Context->InstructionAddress, &MatchState->gCiEnabled)))
+		{
+			PRINT_KERNEL_PATCH_TRACE(L"    Found g_CiEnabled at 0x%llX.\r\n", MatchState->gCiEnabled);
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+//
+// Matches the last 'mov ecx, xxx' before the call/jmp to CiInitialize in SepInitializeCodeIntegrity
+//
+STATIC
+BOOLEAN
+EFIAPI
+MatchSepInitializeCodeIntegrity(
+	IN OUT PZYDIS_CONTEXT Context,
+	IN OUT VOID *State
+	)
+{
+	CONST PCI_INITIALIZE_MATCH_STATE MatchState = (PCI_INITIALIZE_MATCH_STATE)State;
+
+	// Check if this is a 2-byte (size of our patch) 'mov ecx, <anything>' and store the instruction address if so
+	if (Context->Instruction.operand_count == 2 && Context->Instruction.length == 2 && Context->Instruction.mnemonic == ZYDIS_MNEMONIC_MOV &&
+		ZYAN_SUCCESS(ZydisDecodeOperands(Context)) &&
+		Context->Operands[0].type == ZYDIS_OPERAND_TYPE_REGISTER && Context->Operands[0].reg.value == ZYDIS_REGISTER_ECX)
+	{
+		MatchState->LastMovIntoEcx = (UINT8*)Context->InstructionAddress;
+	}
+	else if ((MatchState->BuildNumber >= 9200 &&
+			((Context->Instruction.mnemonic == ZYDIS_MNEMONIC_JMP && Context->Instruction.operand_count == 2) ||
+			(Context->Instruction.mnemonic == ZYDIS_MNEMONIC_CALL && Context->Instruction.operand_count == 4)) &&
+			ZYAN_SUCCESS(ZydisDecodeOperands(Context)) &&
+			(Context->Operands[0].type == ZYDIS_OPERAND_TYPE_MEMORY && Context->Operands[0].mem.base == ZYDIS_REGISTER_RIP))
+		||
+		(MatchState->BuildNumber < 9200 &&
+			(Context->Instruction.mnemonic == ZYDIS_MNEMONIC_CALL && Context->Instruction.operand_count == 4 &&
+			ZYAN_SUCCESS(ZydisDecodeOperands(Context)) &&
+			Context->Operands[0].type == ZYDIS_OPERAND_TYPE_IMMEDIATE && Context->Operands[0].imm.is_relative == ZYAN_TRUE)))
+	{
+		// Check if this is
+		// 'call IMM:CiInitialize thunk'				// E8 ?? ?? ?? ??			// Windows Vista/7
+		// or
+		// 'jmp qword ptr ds:[CiInitialize IAT RVA]'	// 48 FF 25 ?? ?? ?? ??		// Windows 8 through 10.0.15063.0
+		// or
+		// 'call qword ptr ds:[CiInitialize IAT RVA]'	// FF 15 ?? ?? ?? ??		// Windows 10.0.16299.0+
+		ZyanU64 OperandAddress = 0;
+		if (ZYAN_SUCCESS(ZydisCalcAbsoluteAddress(&Context->Instruction, &Context->Operands[0], Context->InstructionAddress, &OperandAddress)) &&
+			OperandAddress == MatchState->CiInitialize)
+		{
+			MatchState->MovEcxAddress = MatchState->LastMovIntoEcx; // The last 'mov ecx, xxx' before the call/jmp is the instruction we want
+			PRINT_KERNEL_PATCH_TRACE(L"    Found 'mov ecx, xxx' in SepInitializeCodeIntegrity [RVA: 0x%X].\r\n",
+				(UINT32)(MatchState->MovEcxAddress - MatchState->ImageBase));
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+//
+// Matches 'mov eax, 0xC0000428' (Win 8+) or 'cmp g_CiEnabled, al' (Win Vista/7) in SeValidateImageData
+//
+STATIC
+BOOLEAN
+EFIAPI
+MatchSeValidateImageData(
+	IN OUT PZYDIS_CONTEXT Context,
+	IN OUT VOID *State
+	)
+{
+	CONST PVALIDATE_IMAGE_DATA_MATCH_STATE MatchState = (PVALIDATE_IMAGE_DATA_MATCH_STATE)State;
+
+	// On Windows >= 8, check if this is 'mov eax, 0xC0000428' (STATUS_INVALID_IMAGE_HASH) in SeValidateImageData
+	if ((MatchState->BuildNumber >= 9200 &&
+		(Context->Instruction.operand_count == 2 && Context->Instruction.mnemonic == ZYDIS_MNEMONIC_MOV) &&
+		ZYAN_SUCCESS(ZydisDecodeOperands(Context)) &&
+		(Context->Operands[0].type == ZYDIS_OPERAND_TYPE_REGISTER && Context->Operands[0].reg.value == ZYDIS_REGISTER_EAX) &&
+		Context->Operands[1].type == ZYDIS_OPERAND_TYPE_IMMEDIATE && (Context->Operands[1].imm.value.s & 0xFFFFFFFFLL) == 0xc0000428LL))
+	{
+		// Exclude false positives: next instruction must be jmp rel32 (Win 8), jmp rel8 (Win 8.1/10) or ret
+		CONST UINT8* Address = (UINT8*)Context->InstructionAddress;
+		CONST UINT8 JmpOpcode = MatchState->BuildNumber >= 9600 ? 0xEB : 0xE9;
+		if (*(Address + Context->Instruction.length) == JmpOpcode || *(Address + Context->Instruction.length) == 0xC3)
+		{
+			MatchState->MovEaxAddress = (UINT8*)Address;
+			PRINT_KERNEL_PATCH_TRACE(L"    Found 'mov eax, 0xC0000428' in SeValidateImageData [RVA: 0x%X].\r\n",
+				(UINT32)(MatchState->MovEaxAddress - MatchState->ImageBase));
+			return TRUE;
+		}
+	}
+	// On Windows Vista/7, check if this is 'cmp g_CiEnabled, al' in SeValidateImageData
+	else if (MatchState->BuildNumber < 9200 &&
+		(Context->Instruction.operand_count == 3 && Context->Instruction.mnemonic == ZYDIS_MNEMONIC_CMP) &&
+		ZYAN_SUCCESS(ZydisDecodeOperands(Context)) &&
+		(Context->Operands[0].type == ZYDIS_OPERAND_TYPE_MEMORY && Context->Operands[0].mem.base == ZYDIS_REGISTER_RIP) &&
+		(Context->Operands[1].type == ZYDIS_OPERAND_TYPE_REGISTER && Context->Operands[1].reg.value == ZYDIS_REGISTER_AL))
+	{
+		ZyanU64 OperandAddress = 0;
+		if (ZYAN_SUCCESS(ZydisCalcAbsoluteAddress(&Context->Instruction, &Context->Operands[0], Context->InstructionAddress, &OperandAddress)) &&
+			OperandAddress == MatchState->gCiEnabled)
+		{
+			// Verify the next instruction is jz, and store its address instead of the cmp, as we will be patching the jz
+			CONST UINT8* Address = (UINT8*)Context->InstructionAddress;
+			if (*(Address + Context->Instruction.length) == 0x74)
+			{
+				MatchState->JzAddress = (UINT8*)(Address + Context->Instruction.length);
+				PRINT_KERNEL_PATCH_TRACE(L"    Found 'cmp g_CiEnabled, al' in SeValidateImageData [RVA: 0x%X].\r\n",
+					(UINT32)(Address - MatchState->ImageBase));
+				return TRUE;
+			}
+		}
+	}
+
+	return FALSE;
+}
+
 //
 // Disables DSE for the duration of the boot by preventing it from initializing.
 // This function is only called if DseBypassMethod is DSE_DISABLE_AT_BOOT, or if the Windows version is Vista or 7
@@ -454,9 +679,7 @@ STATIC
 EFI_STATUS
 EFIAPI
 DisableDSE(
-	IN UINT8* ImageBase,
-	IN PEFI_IMAGE_NT_HEADERS NtHeaders,
-	IN PEFI_IMAGE_SECTION_HEADER PageSection,
+	IN OUT PIMAGE_CONTEXT ImageContext,
 	IN EFIGUARD_DSE_BYPASS_TYPE BypassType,
 	IN UINT16 BuildNumber
 	)
@@ -464,6 +687,11 @@ DisableDSE(
 	if (BypassType == DSE_DISABLE_NONE)
 		return EFI_INVALID_PARAMETER;
 
+	UINT8* ImageBase = ImageContext->ImageBase;
+	CONST PEFI_IMAGE_NT_HEADERS NtHeaders = ImageContext->NtHeaders;
+	CONST PEFI_IMAGE_SECTION_HEADER PageSection = ImageContext->PageSection;
+	CONST PZYDIS_CONTEXT Context = &ImageContext->Zydis;
+
 	CONST UINT32 PageSizeOfRawData = PageSection->SizeOfRawData;
 	CONST UINT8* PageStartVa = ImageBase + PageSection->VirtualAddress;
 
@@ -476,242 +704,131 @@ DisableDSE(
 														&CiInitialize);
 	if (EFI_ERROR(IatStatus))
 	{
-		PRINT_KERNEL_PATCH_MSG(L"Failed to find IAT address of CI.dll!CiInitialize.\r\n");
+		PRINT_KERNEL_PATCH_ERROR(L"Failed to find IAT address of CI.dll!CiInitialize.\r\n");
 		return IatStatus;
 	}
 
-	PRINT_KERNEL_PATCH_MSG(L"\r\n== Disassembling PAGE to find nt!SepInitializeCodeIntegrity 'mov ecx, xxx' ==\r\n");
-
-	// Initialize Zydis
-	ZYDIS_CONTEXT Context;
-	ZyanStatus Status = ZydisInit(NtHeaders, &Context);
-	if (!ZYAN_SUCCESS(Status))
-	{
-		PRINT_KERNEL_PATCH_MSG(L"Failed to initialize disassembler engine.\r\n");
-		return EFI_LOAD_ERROR;
-	}
-
-	UINT8* SepInitializeCodeIntegrityMovEcxAddress = NULL;
+	PRINT_KERNEL_PATCH_TRACE(L"\r\n== Disassembling PAGE to find nt!SepInitializeCodeIntegrity 'mov ecx, xxx'%S ==\r\n",
+		(BuildNumber >= 9200 ? L" and nt!SeValidateImageData 'mov eax, 0xC0000428'" : L""));
 
 	if (BuildNumber < 9200)
 	{
 		// On Windows Vista/7 we have an enormously annoying import thunk in .text to find. All it does is 'jmp __imp_CiInitialize'.
 		// SepInitializeCodeIntegrity will then call this thunk. What a waste
-		CONST PEFI_IMAGE_SECTION_HEADER TextSection = IMAGE_FIRST_SECTION(NtHeaders);
-		VOID* JmpCiInitializeAddress = NULL;
-		Context.Length = TextSection->SizeOfRawData;
-		Context.Offset = 0;
-
-		// Start decode loop
-		while ((Context.InstructionAddress = (ZyanU64)(ImageBase + TextSection->VirtualAddress + Context.Offset),
-				Status = ZydisDecoderDecodeFull(&Context.Decoder,
-												(VOID*)Context.InstructionAddress,
-												Context.Length - Context.Offset,
-												&Context.Instruction,
-												Context.Operands)) != ZYDIS_STATUS_NO_MORE_DATA)
-		{
-			if (!ZYAN_SUCCESS(Status))
-			{
-				Context.Offset++;
-				continue;
-			}
-
-			if ((Context.Instruction.operand_count == 2 &&
-				Context.Operands[0].type == ZYDIS_OPERAND_TYPE_MEMORY && Context.Operands[0].mem.base == ZYDIS_REGISTER_RIP) &&
-				Context.Instruction.mnemonic == ZYDIS_MNEMONIC_JMP)
-			{
-				// Check if this is 'jmp qword ptr ds:[CiInitialize IAT RVA]'
-				ZyanU64 OperandAddress = 0;
-				if (ZYAN_SUCCESS(ZydisCalcAbsoluteAddress(&Context.Instruction, &Context.Operands[0], Context.InstructionAddress, &OperandAddress)) &&
-					OperandAddress == (UINTN)CiInitialize)
-				{
-					JmpCiInitializeAddress = (VOID*)Context.InstructionAddress;
-					break;
-				}
-			}
-
-			Context.Offset += Context.Instruction.length;
-		}
-
-		if (JmpCiInitializeAddress == NULL)
+		CONST PEFI_IMAGE_SECTION_HEADER TextSection = ImageContext->TextSection;
+		CI_INITIALIZE_THUNK_MATCH_STATE ThunkState = { (UINTN)CiInitialize, NULL };
+		INSTRUCTION_MATCHER ThunkMatcher = { MatchCiInitializeThunk, &ThunkState, FALSE };
+		CONST UINT32 ThunkTiming = StartPatchTiming(L"CiInitialize import thunk decode (.text)");
+		DecodeAndMatch(Context,
+						ImageBase + TextSection->VirtualAddress,
+						TextSection->SizeOfRawData,
+						&ThunkMatcher,
+						1);
+		StopPatchTiming(ThunkTiming);
+
+		if (ThunkState.JmpAddress == NULL)
 		{
-			PRINT_KERNEL_PATCH_MSG(L"    Failed to find 'jmp __imp_CiInitialize' import thunk.\r\n");
+			PRINT_KERNEL_PATCH_ERROR(L"    Failed to find 'jmp __imp_CiInitialize' import thunk.\r\n");
 			return EFI_NOT_FOUND;
 		}
 
 		// Make this the new 'IAT address' to simplify checks below
-		CiInitialize = JmpCiInitializeAddress;
+		CiInitialize = ThunkState.JmpAddress;
 	}
 
-	UINT8* LastMovIntoEcx = NULL; // Keep track of 'mov ecx, xxx' - the last one before call/jmp cs:__imp_CiInitialize is the one we want to patch
-	Context.Length = PageSizeOfRawData;
-	Context.Offset = 0;
-
-	// Start decode loop
-	while ((Context.InstructionAddress = (ZyanU64)(PageStartVa + Context.Offset),
-			Status = ZydisDecoderDecodeFull(&Context.Decoder,
-											(VOID*)Context.InstructionAddress,
-											Context.Length - Context.Offset,
-											&Context.Instruction,
-											Context.Operands)) != ZYDIS_STATUS_NO_MORE_DATA)
+	// On Windows >= 8, SeValidateImageData is found by its 'mov eax, 0xC0000428'. On Windows Vista/7 it is found by its reference to g_CiEnabled,
+	// which is located relative to the 'mov ecx, xxx' in SepInitializeCodeIntegrity, so a second pass is needed after that has been found
+	CI_INITIALIZE_MATCH_STATE CiInitializeState = { ImageBase, BuildNumber, (UINTN)CiInitialize, NULL, NULL };
+	VALIDATE_IMAGE_DATA_MATCH_STATE ValidateImageDataState = { ImageBase, BuildNumber, 0, NULL, NULL };
+	INSTRUCTION_MATCHER PageMatchers[] = {
+		{ MatchSepInitializeCodeIntegrity, &CiInitializeState, FALSE },
+		{ MatchSeValidateImageData, &ValidateImageDataState, FALSE }
+	};
+	UINT32 Timing = StartPatchTiming(L"SepInitializeCodeIntegrity decode (PAGE)");
+	if (BuildNumber >= 9200)
 	{
-		if (!ZYAN_SUCCESS(Status))
-		{
-			Context.Offset++;
-			continue;
-		}
-
-		// Check if this is a 2-byte (size of our patch) 'mov ecx, <anything>' and store the instruction address if so
-		if (Context.Instruction.operand_count == 2 && Context.Instruction.length == 2 && Context.Instruction.mnemonic == ZYDIS_MNEMONIC_MOV &&
-			Context.Operands[0].type == ZYDIS_OPERAND_TYPE_REGISTER && Context.Operands[0].reg.value == ZYDIS_REGISTER_ECX)
-		{
-			LastMovIntoEcx = (UINT8*)Context.InstructionAddress;
-		}
-		else if ((BuildNumber >= 9200 &&
-				((Context.Instruction.operand_count == 2 || Context.Instruction.operand_count == 4) &&
-				(Context.Operands[0].type == ZYDIS_OPERAND_TYPE_MEMORY && Context.Operands[0].mem.base == ZYDIS_REGISTER_RIP) &&
-				((Context.Instruction.mnemonic == ZYDIS_MNEMONIC_JMP && Context.Instruction.operand_count == 2) ||
-				(Context.Instruction.mnemonic == ZYDIS_MNEMONIC_CALL && Context.Instruction.operand_count == 4))))
-			||
-			(BuildNumber < 9200 &&
-				(Context.Instruction.operand_count == 4 &&
-				Context.Operands[0].type == ZYDIS_OPERAND_TYPE_IMMEDIATE && Context.Operands[0].imm.is_relative == ZYAN_TRUE &&
-				Context.Instruction.mnemonic == ZYDIS_MNEMONIC_CALL)))
-		{
-			// Check if this is
-			// 'call IMM:CiInitialize thunk'				// E8 ?? ?? ?? ??			// Windows Vista/7
-			// or
-			// 'jmp qword ptr ds:[CiInitialize IAT RVA]'	// 48 FF 25 ?? ?? ?? ??		// Windows 8 through 10.0.15063.0
-			// or
-			// 'call qword ptr ds:[CiInitialize IAT RVA]'	// FF 15 ?? ?? ?? ??		// Windows 10.0.16299.0+
-			ZyanU64 OperandAddress = 0;
-			if (ZYAN_SUCCESS(ZydisCalcAbsoluteAddress(&Context.Instruction, &Context.Operands[0], Context.InstructionAddress, &OperandAddress)) &&
-				OperandAddress == (UINTN)CiInitialize)
-			{
-				SepInitializeCodeIntegrityMovEcxAddress = LastMovIntoEcx; // The last 'mov ecx, xxx' before the call/jmp is the instruction we want
-				PRINT_KERNEL_PATCH_MSG(L"    Found 'mov ecx, xxx' in SepInitializeCodeIntegrity [RVA: 0x%X].\r\n",
-					(UINT32)(SepInitializeCodeIntegrityMovEcxAddress - ImageBase));
-				break;
-			}
-		}
-
-		Context.Offset += Context.Instruction.length;
+		// The call/jmp through the CiInitialize IAT entry and the STATUS_INVALID_IMAGE_HASH immediate can both be found without
+		// decoding PAGE. Only the functions containing them are decoded, so that the matchers can confirm them.
+		// The sweep can also hit displacements that are not really instructions, so pass all sites and let the matcher filter them
+		UINT8* CiInitializeCallers[8];
+		CONST UINTN NumCiInitializeCallers = FindReferencesTo(Context,
+															PageStartVa,
+															PageSizeOfRawData,
+															CiInitialize,
+															(1U << XrefCall) | (1U << XrefJmp),
+															CiInitializeCallers,
+															ARRAY_SIZE(CiInitializeCallers));
+		DecodeSitesAndMatch(Context,
+							ImageBase,
+							NtHeaders,
+							(CONST UINT8* CONST*)CiInitializeCallers,
+							NumCiInitializeCallers,
+							&PageMatchers[0],
+							1);
+
+		DecodeSignatureSitesAndMatch(Context,
+									ImageBase,
+									NtHeaders,
+									&SigInvalidImageHashStatus,
+									PageStartVa,
+									PageSizeOfRawData,
+									&PageMatchers[1],
+									1);
+	}
+	else
+	{
+		DecodeFunctionsAndMatch(Context,
+								ImageBase,
+								NtHeaders,
+								PageStartVa,
+								PageSizeOfRawData,
+								PageMatchers,
+								1);
 	}
+	StopPatchTiming(Timing);
 
+	UINT8* SepInitializeCodeIntegrityMovEcxAddress = CiInitializeState.MovEcxAddress;
 	if (SepInitializeCodeIntegrityMovEcxAddress == NULL)
 	{
-		PRINT_KERNEL_PATCH_MSG(L"    Failed to find SepInitializeCodeIntegrity 'mov ecx, xxx' pattern.\r\n");
+		PRINT_KERNEL_PATCH_ERROR(L"    Failed to find SepInitializeCodeIntegrity 'mov ecx, xxx' pattern.\r\n");
 		return EFI_NOT_FOUND;
 	}
 
-	ZyanU64 gCiEnabled = 0;
 	if (BuildNumber < 9200)
 	{
 		// On Windows Vista/7, find g_CiEnabled now because it's a few bytes away and we'll it need later
-		Context.Length = 32;
-		Context.Offset = 0;
-
-		while ((Context.InstructionAddress = (ZyanU64)(SepInitializeCodeIntegrityMovEcxAddress + Context.Offset),
-				Status = ZydisDecoderDecodeFull(&Context.Decoder,
-												(VOID*)Context.InstructionAddress,
-												Context.Length - Context.Offset,
-												&Context.Instruction,
-												Context.Operands)) != ZYDIS_STATUS_NO_MORE_DATA)
+		CI_ENABLED_MATCH_STATE CiEnabledState = { 0 };
+		INSTRUCTION_MATCHER CiEnabledMatcher = { MatchCiEnabledStore, &CiEnabledState, FALSE };
+		DecodeAndMatch(Context,
+						SepInitializeCodeIntegrityMovEcxAddress,
+						32,
+						&CiEnabledMatcher,
+						1);
+
+		if (CiEnabledState.gCiEnabled == 0)
 		{
-			if (!ZYAN_SUCCESS(Status))
-			{
-				Context.Offset++;
-				continue;
-			}
-
-			// Check if this is 'mov g_CiEnabled, REG8'
-			if (Context.Instruction.operand_count == 2 &&
-				Context.Instruction.mnemonic == ZYDIS_MNEMONIC_MOV &&
-				Context.Operands[0].type == ZYDIS_OPERAND_TYPE_MEMORY && Context.Operands[0].mem.base == ZYDIS_REGISTER_RIP &&
-				Context.Operands[1].type == ZYDIS_OPERAND_TYPE_REGISTER)
-			{
-				if (ZYAN_SUCCESS(ZydisCalcAbsoluteAddress(&Context.Instruction, &Context.Operands[0], Context.InstructionAddress, &gCiEnabled)))
-				{
-					PRINT_KERNEL_PATCH_MSG(L"    Found g_CiEnabled at 0x%llX.\r\n", gCiEnabled);
-					break;
-				}
-			}
-
-			Context.Offset += Context.Instruction.length;
-		}
-
-		if (gCiEnabled == 0)
-		{
-			PRINT_KERNEL_PATCH_MSG(L"    Failed to find g_CiEnabled.\r\n");
+			PRINT_KERNEL_PATCH_ERROR(L"    Failed to find g_CiEnabled.\r\n");
 			return EFI_NOT_FOUND;
 		}
-	}
-
-	PRINT_KERNEL_PATCH_MSG(L"== Disassembling PAGE to find nt!SeValidateImageData '%S' ==\r\n",
-		(BuildNumber >= 9200 ? L"mov eax, 0xC0000428" : L"cmp g_CiEnabled, al"));
-	UINT8 *SeValidateImageDataMovEaxAddress = NULL, *SeValidateImageDataJzAddress = NULL;
-
-	// Start decode loop
-	Context.Length = PageSizeOfRawData;
-	Context.Offset = 0;
-	while ((Context.InstructionAddress = (ZyanU64)(PageStartVa + Context.Offset),
-			Status = ZydisDecoderDecodeFull(&Context.Decoder,
-											(VOID*)Context.InstructionAddress,
-											Context.Length - Context.Offset,
-											&Context.Instruction,
-											Context.Operands)) != ZYDIS_STATUS_NO_MORE_DATA)
-	{
-		if (!ZYAN_SUCCESS(Status))
-		{
-			Context.Offset++;
-			continue;
-		}
-
-		// On Windows >= 8, check if this is 'mov eax, 0xC0000428' (STATUS_INVALID_IMAGE_HASH) in SeValidateImageData
-		if ((BuildNumber >= 9200 &&
-			(Context.Instruction.operand_count == 2 && Context.Instruction.mnemonic == ZYDIS_MNEMONIC_MOV) &&
-			(Context.Operands[0].type == ZYDIS_OPERAND_TYPE_REGISTER && Context.Operands[0].reg.value == ZYDIS_REGISTER_EAX) &&
-			Context.Operands[1].type == ZYDIS_OPERAND_TYPE_IMMEDIATE && (Context.Operands[1].imm.value.s & 0xFFFFFFFFLL) == 0xc0000428LL))
-		{
-			// Exclude false positives: next instruction must be jmp rel32 (Win 8), jmp rel8 (Win 8.1/10) or ret
-			CONST UINT8* Address = (UINT8*)Context.InstructionAddress;
-			CONST UINT8 JmpOpcode = BuildNumber >= 9600 ? 0xEB : 0xE9;
-			if (*(Address + Context.Instruction.length) == JmpOpcode || *(Address + Context.Instruction.length) == 0xC3)
-			{
-				SeValidateImageDataMovEaxAddress = (UINT8*)Address;
-				PRINT_KERNEL_PATCH_MSG(L"    Found 'mov eax, 0xC0000428' in SeValidateImageData [RVA: 0x%X].\r\n",
-					(UINT32)(SeValidateImageDataMovEaxAddress - ImageBase));
-				break;
-			}
-		}
-		// On Windows Vista/7, check if this is 'cmp g_CiEnabled, al' in SeValidateImageData
-		else if (BuildNumber < 9200 &&
-			(Context.Instruction.operand_count == 3 && Context.Instruction.mnemonic == ZYDIS_MNEMONIC_CMP) &&
-			(Context.Operands[0].type == ZYDIS_OPERAND_TYPE_MEMORY && Context.Operands[0].mem.base == ZYDIS_REGISTER_RIP) &&
-			(Context.Operands[1].type == ZYDIS_OPERAND_TYPE_REGISTER && Context.Operands[1].reg.value == ZYDIS_REGISTER_AL))
-		{
-			ZyanU64 OperandAddress = 0;
-			if (ZYAN_SUCCESS(ZydisCalcAbsoluteAddress(&Context.Instruction, &Context.Operands[0], Context.InstructionAddress, &OperandAddress)) &&
-				OperandAddress == gCiEnabled)
-			{
-				// Verify the next instruction is jz, and store its address instead of the cmp, as we will be patching the jz
-				CONST UINT8* Address = (UINT8*)Context.InstructionAddress;
-				if (*(Address + Context.Instruction.length) == 0x74)
-				{
-					SeValidateImageDataJzAddress = (UINT8*)(Address + Context.Instruction.length);
-					PRINT_KERNEL_PATCH_MSG(L"    Found 'cmp g_CiEnabled, al' in SeValidateImageData [RVA: 0x%X].\r\n",
-						(UINT32)(Address - ImageBase));
-					break;
-				}
-			}
-		}
 
-		Context.Offset += Context.Instruction.length;
+		PRINT_KERNEL_PATCH_TRACE(L"== Disassembling PAGE to find nt!SeValidateImageData 'cmp g_CiEnabled, al' ==\r\n");
+		ValidateImageDataState.gCiEnabled = CiEnabledState.gCiEnabled;
+		Timing = StartPatchTiming(L"SeValidateImageData decode (PAGE)");
+		DecodeFunctionsAndMatch(Context,
+								ImageBase,
+								NtHeaders,
+								PageStartVa,
+								PageSizeOfRawData,
+								&PageMatchers[1],
+								1);
+		StopPatchTiming(Timing);
 	}
 
+	UINT8* SeValidateImageDataMovEaxAddress = ValidateImageDataState.MovEaxAddress;
+	UINT8* SeValidateImageDataJzAddress = ValidateImageDataState.JzAddress;
 	if (SeValidateImageDataMovEaxAddress == NULL && SeValidateImageDataJzAddress == NULL)
 	{
-		PRINT_KERNEL_PATCH_MSG(L"    Failed to find SeValidateImageData '%S' pattern.\r\n",
+		PRINT_KERNEL_PATCH_ERROR(L"    Failed to find SeValidateImageData '%S' pattern.\r\n",
 			(BuildNumber >= 9200 ? L"mov eax, 0xC0000428" : L"cmp g_CiEnabled, al"));
 		return EFI_NOT_FOUND;
 	}
@@ -739,12 +856,12 @@ DisableDSE(
 		// We are on RS3 or higher. If we can find and patch SeCodeIntegrityQueryInformation, great.
 		// But DSE has been disabled at this point, so success will be returned regardless.
 		UINT8* Found = NULL;
-		CONST EFI_STATUS CiStatus = FindPattern(SigSeCodeIntegrityQueryInformation,
-												0xCC,
-												sizeof(SigSeCodeIntegrityQueryInformation),
+		Timing = StartPatchTiming(L"SeCodeIntegrityQueryInformation search (PAGE)");
+		CONST EFI_STATUS CiStatus = FindSignature(&SigSeCodeIntegrityQueryInformation,
 												(VOID*)PageStartVa, // SeCodeIntegrityQueryInformation is in PAGE, so start there
 												PageSizeOfRawData,
 												(VOID**)&Found);
+		StopPatchTiming(Timing);
 		if (EFI_ERROR(CiStatus))
 		{
 			PRINT_KERNEL_PATCH_MSG(L"\r\nFailed to find SeCodeIntegrityQueryInformation. Skipping patch.\r\n");
@@ -777,7 +894,7 @@ PatchNtoskrnl(
 	EFI_STATUS Status = GetPeFileVersionInfo(ImageBase, &MajorVersion, &MinorVersion, &BuildNumber, &Revision, &FileFlags);
 	if (EFI_ERROR(Status))
 	{
-		PRINT_KERNEL_PATCH_MSG(L"[PatchNtoskrnl] WARNING: failed to obtain ntoskrnl.exe version info. Status: %llx\r\n", Status);
+		PRINT_KERNEL_PATCH_ERROR(L"[PatchNtoskrnl] WARNING: failed to obtain ntoskrnl.exe version info. Status: %llx\r\n", Status);
 	}
 	else
 	{
@@ -789,7 +906,7 @@ PatchNtoskrnl(
 		// and the only real changes were an added spyware bundle and the removal of the classic theme. Seriously, fuck whoever did that
 		if (BuildNumber < 6001)
 		{
-			PRINT_KERNEL_PATCH_MSG(L"[PatchNtoskrnl] ERROR: Unsupported kernel image version.\r\n");
+			PRINT_KERNEL_PATCH_ERROR(L"[PatchNtoskrnl] ERROR: Unsupported kernel image version.\r\n");
 			return EFI_UNSUPPORTED;
 		}
 		
@@ -797,45 +914,37 @@ PatchNtoskrnl(
 		{
 			// Do not patch checked kernels. There is too much difference in PG and DSE initialization code due to missing optimizations.
 			// This is a moot point anyway because MS has stopped releasing checked OS builds or even kernels to common plebs (i.e. not Intel or Nvidia)
-			PRINT_KERNEL_PATCH_MSG(L"[PatchNtoskrnl] ERROR: Checked kernels are not supported.\r\n");
+			PRINT_KERNEL_PATCH_ERROR(L"[PatchNtoskrnl] ERROR: Checked kernels are not supported.\r\n");
 			return EFI_UNSUPPORTED;
 		}
 	}
 
-	// Find the INIT and PAGE sections
-	PEFI_IMAGE_SECTION_HEADER InitSection = NULL, TextSection = NULL, PageSection = NULL;
-	PEFI_IMAGE_SECTION_HEADER Section = IMAGE_FIRST_SECTION(NtHeaders);
-	for (UINT16 i = 0; i < NtHeaders->FileHeader.NumberOfSections; ++i)
+	// Initialize the decoder and find the INIT, .text and PAGE sections. This context is shared by all patches below.
+	// Nothing in it is allocated here (the cross-reference index is never built in this phase), so it does not need to be freed
+	IMAGE_CONTEXT ImageContext;
+	Status = InitializeImageContext(ImageBase, NtHeaders, &ImageContext);
+	if (EFI_ERROR(Status))
 	{
-		CHAR8 SectionName[EFI_IMAGE_SIZEOF_SHORT_NAME + 1];
-		CopyMem(SectionName, Section->Name, EFI_IMAGE_SIZEOF_SHORT_NAME);
-		SectionName[EFI_IMAGE_SIZEOF_SHORT_NAME] = '\0';
-
-		if (AsciiStrCmp(SectionName, "INIT") == 0)
-			InitSection = Section;
-		else if (AsciiStrCmp(SectionName, ".text") == 0)
-			TextSection = Section;
-		else if (AsciiStrCmp(SectionName, "PAGE") == 0)
-			PageSection = Section;
-
-		Section++;
+		PRINT_KERNEL_PATCH_ERROR(L"[PatchNtoskrnl] Failed to initialize disassembler engine.\r\n");
+		return Status;
 	}
 
+	CONST PEFI_IMAGE_SECTION_HEADER InitSection = ImageContext.InitSection;
+	CONST PEFI_IMAGE_SECTION_HEADER PageSection = ImageContext.PageSection;
 	ASSERT(InitSection != NULL);
-	ASSERT(TextSection != NULL);
+	ASSERT(ImageContext.TextSection != NULL);
 	ASSERT(PageSection != NULL);
 
 #ifndef DO_NOT_DISABLE_PATCHGUARD
 	// Patch INIT and .text sections to disable PatchGuard
 	PRINT_KERNEL_PATCH_MSG(L"[PatchNtoskrnl] Disabling PatchGuard... [INIT RVA: 0x%X - 0x%X]\r\n",
 		InitSection->VirtualAddress, InitSection->VirtualAddress + InitSection->SizeOfRawData);
-	Status = DisablePatchGuard(ImageBase,
-								NtHeaders,
-								InitSection,
-								TextSection,
+	CONST UINT32 PatchGuardTiming = StartPatchTiming(L"DisablePatchGuard");
+	Status = DisablePatchGuard(&ImageContext,
 								BuildNumber);
+	StopPatchTiming(PatchGuardTiming);
 	if (EFI_ERROR(Status))
-		return Status;
+		goto Exit;
 
 	PRINT_KERNEL_PATCH_MSG(L"\r\n[PatchNtoskrnl] Successfully disabled PatchGuard.\r\n");
 #else
@@ -849,17 +958,19 @@ PatchNtoskrnl(
 		PRINT_KERNEL_PATCH_MSG(L"[PatchNtoskrnl] %S... [PAGE RVA: 0x%X - 0x%X]\r\n",
 			gDriverConfig.DseBypassMethod == DSE_DISABLE_AT_BOOT ? L"Disabling DSE" : L"Ensuring safe DSE bypass",
 			PageSection->VirtualAddress, PageSection->VirtualAddress + PageSection->SizeOfRawData);
-		Status = DisableDSE(ImageBase,
-							NtHeaders,
-							PageSection,
+		CONST UINT32 DseTiming = StartPatchTiming(L"DisableDSE");
+		Status = DisableDSE(&ImageContext,
 							gDriverConfig.DseBypassMethod,
 							BuildNumber);
+		StopPatchTiming(DseTiming);
 		if (EFI_ERROR(Status))
-			return Status;
+			goto Exit;
 
 		if (gDriverConfig.DseBypassMethod == DSE_DISABLE_AT_BOOT)
 			PRINT_KERNEL_PATCH_MSG(L"\r\n[PatchNtoskrnl] Successfully disabled DSE.\r\n");
 	}
 
+Exit:
+	RecordDecodeStatistics(EfiGuardStageKernel, &ImageContext.Zydis);
 	return Status;
 }
@@ -9,18 +9,26 @@ UINT8 gOslFwpKernelSetupPhase1Backup[sizeof(gHookTemplate)] = { 0 };
 
 // Signature for winload!OslFwpKernelSetupPhase1+XX, where the value of XX needs to be determined by backtracking.
 // Windows 10 only. On older OSes, and on Windows 10 as fallback, OslFwpKernelSetupPhase1 is found via xrefs to EfipGetRsdt
-STATIC CONST UINT8 SigOslFwpKernelSetupPhase1[] = {
+STATIC CONST UINT8 SigOslFwpKernelSetupPhase1Bytes[] = {
 	0xE8, 0xCC, 0xCC, 0xCC, 0xCC,					// call BlpArchSwitchContext
 	0x48, 0x8B, 0x05, 0xCC, 0xCC, 0xCC, 0xCC,		// mov rax, gBS
 	0xCC, 0x8B, 0xCC,								// mov rdx, XX
 	0x48, 0x8B, 0x0D, 0xCC, 0xCC, 0xCC, 0xCC		// mov rcx, EfiImageHandle
 };
+STATIC BYTE_SIGNATURE SigOslFwpKernelSetupPhase1 = BYTE_SIGNATURE_INIT(SigOslFwpKernelSetupPhase1Bytes, 0xCC);
+
+// Signature for the 'and REG32, 0FFFFFFD7h' in ImgpValidateImageHash, which is encoded with a sign-extended imm8: [41] 83 /4 D7.
+// Only the functions containing these bytes need to be decoded to find it
+STATIC CONST UINT8 SigAndMinusFortyOneBytes[] = {
+	0x83, 0xCC, 0xD7								// and REG32, 0FFFFFFD7h
+};
+STATIC BYTE_SIGNATURE SigAndMinusFortyOne = BYTE_SIGNATURE_INIT(SigAndMinusFortyOneBytes, 0xCC);
 
 STATIC UNICODE_STRING ImgpFilterValidationFailureMessage = RTL_CONSTANT_STRING(L"*** Windows is unable to verify the signature of"); // newline, etc etc...
 
 // Signature for winload!BlStatusPrint. This is only needed if winload.efi does not export it (RS4 and earlier)
 // Windows 10 only. I could find a universal signature for this, but I rarely need the debugger output anymore...
-STATIC CONST UINT8 SigBlStatusPrint[] = {
+STATIC CONST UINT8 SigBlStatusPrintBytes[] = {
 	0x48, 0x8B, 0xC4,								// mov rax, rsp
 	0x48, 0x89, 0x48, 0x08,							// mov [rax+8], rcx
 	0x48, 0x89, 0x50, 0x10,							// mov [rax+10h], rdx
@@ -32,6 +40,7 @@ STATIC CONST UINT8 SigBlStatusPrint[] = {
 	0x84, 0xC0,										// test al, al
 	0x74, 0xCC										// jz XX
 };
+STATIC BYTE_SIGNATURE SigBlStatusPrint = BYTE_SIGNATURE_INIT(SigBlStatusPrintBytes, 0xCC);
 
 // EFI vendor GUID used by Microsoft
 STATIC CONST EFI_GUID MicrosoftVendorGuid = {
@@ -143,7 +152,7 @@ HookedOslFwpKernelSetupPhase1(
 	if (KernelEntry == NULL)
 	{
 		gKernelPatchInfo.Status = EFI_LOAD_ERROR;
-		PRINT_KERNEL_PATCH_MSG(L"[HookedOslFwpKernelSetupPhase1] Failed to find ntoskrnl.exe in LoadOrderList!\r\n");
+		PRINT_KERNEL_PATCH_ERROR(L"[HookedOslFwpKernelSetupPhase1] Failed to find ntoskrnl.exe in LoadOrderList!\r\n");
 		goto CallOriginal;
 	}
 
@@ -155,14 +164,16 @@ HookedOslFwpKernelSetupPhase1(
 	if (KernelBase == NULL || KernelSize == 0)
 	{
 		gKernelPatchInfo.Status = EFI_NOT_FOUND;
-		PRINT_KERNEL_PATCH_MSG(L"[HookedOslFwpKernelSetupPhase1] Kernel image at 0x%p with size 0x%lx is invalid!\r\n", KernelBase, KernelSize);
+		PRINT_KERNEL_PATCH_ERROR(L"[HookedOslFwpKernelSetupPhase1] Kernel image at 0x%p with size 0x%lx is invalid!\r\n", KernelBase, KernelSize);
 		goto CallOriginal;
 	}
 
 	// Patch the kernel
 	gKernelPatchInfo.KernelBase = KernelBase;
+	CONST UINT32 Timing = StartPatchTiming(L"PatchNtoskrnl");
 	gKernelPatchInfo.Status = PatchNtoskrnl(KernelBase,
 											NtHeaders);
+	StopPatchTiming(Timing);
 
 CallOriginal:
 	// No error handling here (not a lot of options). This is done in the ExitBootServices() callback which reads the patch status
@@ -171,6 +182,34 @@ CallOriginal:
 	return gOriginalOslFwpKernelSetupPhase1(LoaderBlock);
 }
 
+//
+// Matches 'and REG32, 0FFFFFFD7h' in ImgpValidateImageHash
+//
+STATIC
+BOOLEAN
+EFIAPI
+MatchImgpValidateImageHash(
+	IN OUT PZYDIS_CONTEXT Context,
+	IN OUT VOID *State
+	)
+{
+	// Check if this is 'and REG32, 0FFFFFFD7h' (only esi and r8d are used here really)
+	if (Context->Instruction.operand_count == 3 &&
+		(Context->Instruction.length == 3 || Context->Instruction.length == 4) &&
+		Context->Instruction.mnemonic == ZYDIS_MNEMONIC_AND &&
+		ZYAN_SUCCESS(ZydisDecodeOperands(Context)) &&
+		Context->Operands[0].type == ZYDIS_OPERAND_TYPE_REGISTER &&
+		Context->Operands[1].type == ZYDIS_OPERAND_TYPE_IMMEDIATE &&
+		Context->Operands[1].imm.is_signed == ZYAN_TRUE &&
+		Context->Operands[1].imm.value.s == (ZyanI64)((ZyanI32)0xFFFFFFD7)) // Sign extend to 64 bits
+	{
+		*(UINT8**)State = (UINT8*)Context->InstructionAddress;
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
 //
 // Patches ImgpValidateImageHash in bootmgfw.efi, bootmgr.efi, and winload.[efi|exe] to allow loading modified kernels and boot loaders.
 // Failures are ignored because this patch is not needed for the bootkit to work
@@ -179,69 +218,38 @@ EFI_STATUS
 EFIAPI
 PatchImgpValidateImageHash(
 	IN INPUT_FILETYPE FileType,
-	IN UINT8* ImageBase,
-	IN PEFI_IMAGE_NT_HEADERS NtHeaders
+	IN OUT PIMAGE_CONTEXT ImageContext
 	)
 {
 	// This works on pretty much anything really
 	ASSERT(FileType == WinloadExe || FileType == BootmgfwEfi || FileType == BootmgrEfi || FileType == WinloadEfi);
 	CONST CHAR16* ShortName = FileType == BootmgfwEfi ? L"bootmgfw" : (FileType == BootmgrEfi ? L"bootmgr" : L"winload");
 
-	CONST PEFI_IMAGE_SECTION_HEADER CodeSection = IMAGE_FIRST_SECTION(NtHeaders);
+	UINT8* ImageBase = ImageContext->ImageBase;
+	CONST PEFI_IMAGE_NT_HEADERS NtHeaders = ImageContext->NtHeaders;
+	CONST PEFI_IMAGE_SECTION_HEADER CodeSection = ImageContext->TextSection;
 
 	CONST UINT32 CodeSizeOfRawData = CodeSection->SizeOfRawData;
 	CONST UINT8* CodeStartVa = ImageBase + CodeSection->VirtualAddress;
 
-	Print(L"== Disassembling .text to find %S!ImgpValidateImageHash ==\r\n", ShortName);
+	ConsolePrint(L"== Disassembling .text to find %S!ImgpValidateImageHash ==\r\n", ShortName);
 	UINT8* AndMinusFortyOneAddress = NULL;
 
-	// Initialize Zydis
-	ZYDIS_CONTEXT Context;
-	ZyanStatus Status = ZydisInit(NtHeaders, &Context);
-	if (!ZYAN_SUCCESS(Status))
-	{
-		Print(L"Failed to initialize disassembler engine.\r\n");
-		return EFI_LOAD_ERROR;
-	}
-
-	Context.Length = CodeSizeOfRawData;
-	Context.Offset = 0;
-
-	// Start decode loop
-	while ((Context.InstructionAddress = (ZyanU64)(CodeStartVa + Context.Offset),
-			Status = ZydisDecoderDecodeFull(&Context.Decoder,
-											(VOID*)Context.InstructionAddress,
-											Context.Length - Context.Offset,
-											&Context.Instruction,
-											Context.Operands)) != ZYDIS_STATUS_NO_MORE_DATA)
-	{
-		if (!ZYAN_SUCCESS(Status))
-		{
-			Context.Offset++;
-			continue;
-		}
-
-		// Check if this is 'and REG32, 0FFFFFFD7h' (only esi and r8d are used here really)
-		if (Context.Instruction.operand_count == 3 &&
-			(Context.Instruction.length == 3 || Context.Instruction.length == 4) &&
-			Context.Instruction.mnemonic == ZYDIS_MNEMONIC_AND &&
-			Context.Operands[0].type == ZYDIS_OPERAND_TYPE_REGISTER &&
-			Context.Operands[1].type == ZYDIS_OPERAND_TYPE_IMMEDIATE &&
-			Context.Operands[1].imm.is_signed == ZYAN_TRUE &&
-			Context.Operands[1].imm.value.s == (ZyanI64)((ZyanI32)0xFFFFFFD7)) // Sign extend to 64 bits
-		{
-			AndMinusFortyOneAddress = (UINT8*)Context.InstructionAddress;
-			break;
-		}
-
-		Context.Offset += Context.Instruction.length;
-	}
+	INSTRUCTION_MATCHER Matcher = { MatchImgpValidateImageHash, &AndMinusFortyOneAddress, FALSE };
+	DecodeSignatureSitesAndMatch(&ImageContext->Zydis,
+								ImageBase,
+								NtHeaders,
+								&SigAndMinusFortyOne,
+								CodeStartVa,
+								CodeSizeOfRawData,
+								&Matcher,
+								1);
 
 	// Backtrack to function start
 	UINT8* ImgpValidateImageHash = BacktrackToFunctionStart(ImageBase, NtHeaders, AndMinusFortyOneAddress);
 	if (ImgpValidateImageHash == NULL)
 	{
-		Print(L"    Failed to find %S!ImgpValidateImageHash%S.\r\n",
+		ConsolePrint(L"    Failed to find %S!ImgpValidateImageHash%S.\r\n",
 			ShortName, (AndMinusFortyOneAddress == NULL ? L" 'and xxx, 0FFFFFFD7h' instruction" : L""));
 		return EFI_NOT_FOUND;
 	}
@@ -251,7 +259,7 @@ PatchImgpValidateImageHash(
 	CopyWpMem(ImgpValidateImageHash, &Ok, sizeof(Ok));
 
 	// Print info
-	Print(L"    Patched %S!ImgpValidateImageHash [RVA: 0x%X].\r\n",
+	ConsolePrint(L"    Patched %S!ImgpValidateImageHash [RVA: 0x%X].\r\n",
 		ShortName, (UINT32)(ImgpValidateImageHash - ImageBase));
 
 	return EFI_SUCCESS;
@@ -265,62 +273,56 @@ EFI_STATUS
 EFIAPI
 PatchImgpFilterValidationFailure(
 	IN INPUT_FILETYPE FileType,
-	IN UINT8* ImageBase,
-	IN PEFI_IMAGE_NT_HEADERS NtHeaders
+	IN OUT PIMAGE_CONTEXT ImageContext
 	)
 {
 	// This works on pretty much anything really
 	ASSERT(FileType == WinloadExe || FileType == BootmgfwEfi || FileType == BootmgrEfi || FileType == WinloadEfi);
 	CONST CHAR16* ShortName = FileType == BootmgfwEfi ? L"bootmgfw" : (FileType == BootmgrEfi ? L"bootmgr" : L"winload");
 
-	// Find .text and/or .rdata sections
-	PEFI_IMAGE_SECTION_HEADER PatternSection = NULL, CodeSection = NULL;
-	PEFI_IMAGE_SECTION_HEADER Section = IMAGE_FIRST_SECTION(NtHeaders);
-	for (UINT16 i = 0; i < NtHeaders->FileHeader.NumberOfSections; ++i)
-	{
-		if (CompareMem(Section->Name, ".text", sizeof(".text") - 1) == 0)
-			CodeSection = Section;
-		if (((FileType == BootmgfwEfi || FileType == BootmgrEfi) &&
-			CompareMem(Section->Name, ".text", sizeof(".text") - 1) == 0) // [bootmgfw|bootmgr].efi (usually) has no .rdata section, and starting at .text is always fine
-			||
-			((FileType == WinloadExe || FileType == WinloadEfi) &&
-			CompareMem(Section->Name, ".rdata", sizeof(".rdata") - 1) == 0)) // For winload.[exe|efi] the string is in .rdata
-			PatternSection = Section;
-		Section++;
-	}
+	UINT8* ImageBase = ImageContext->ImageBase;
+	CONST PEFI_IMAGE_NT_HEADERS NtHeaders = ImageContext->NtHeaders;
+	CONST PEFI_IMAGE_SECTION_HEADER CodeSection = ImageContext->TextSection;
+
+	// [bootmgfw|bootmgr].efi (usually) has no .rdata section, and starting at .text is always fine. For winload.[exe|efi] the string is in .rdata
+	CONST PEFI_IMAGE_SECTION_HEADER PatternSection = FileType == BootmgfwEfi || FileType == BootmgrEfi
+		? ImageContext->TextSection
+		: ImageContext->RdataSection;
 
 	ASSERT(PatternSection != NULL);
 	ASSERT(CodeSection != NULL);
 
 	CONST UINT32 PatternStartRva = PatternSection->VirtualAddress;
-	CONST UINT32 PatternSizeOfRawData = PatternSection->SizeOfRawData;
 	CONST UINT8* PatternStartVa = ImageBase + PatternStartRva;
 
+	// Where the search stops. For winload the string is always in .rdata, so the search is bounded to that section.
+	// For [bootmgfw|bootmgr].efi the string lives in whichever data section follows .text, so like the original
+	// byte-by-byte loop we keep searching up to the end of the image
+	CONST UINT32 SearchEnd = FileType == BootmgfwEfi || FileType == BootmgrEfi
+		? NtHeaders->OptionalHeader.SizeOfImage
+		: PatternStartRva + PatternSection->SizeOfRawData;
+
 	CHAR8 SectionName[EFI_IMAGE_SIZEOF_SHORT_NAME + 1];
 	CopyMem(SectionName, PatternSection->Name, EFI_IMAGE_SIZEOF_SHORT_NAME);
 	SectionName[EFI_IMAGE_SIZEOF_SHORT_NAME] = '\0';
-	Print(L"\r\n== Searching for load failure string in %a [RVA: 0x%X - 0x%X] ==\r\n",
-		SectionName, PatternStartRva, PatternStartRva + PatternSizeOfRawData);
+	ConsolePrint(L"\r\n== Searching for load failure string in %a [RVA: 0x%X - 0x%X] ==\r\n",
+		SectionName, PatternStartRva, SearchEnd);
 
 	// Search for the black screen of death string "Windows is unable to verify the integrity of the file [...]"
+	// The string is UTF-16 ASCII, so it never contains the 0xCC wildcard byte
 	UINT8* IntegrityFailureStringAddress = NULL;
-	for (UINT8* Address = (UINT8*)PatternStartVa;
-		Address < ImageBase + NtHeaders->OptionalHeader.SizeOfImage - ImgpFilterValidationFailureMessage.MaximumLength;
-		++Address)
-	{
-		if (CompareMem(Address, ImgpFilterValidationFailureMessage.Buffer, ImgpFilterValidationFailureMessage.Length) == 0)
-		{
-			IntegrityFailureStringAddress = Address;
-			Print(L"    Found load failure string at 0x%llx.\r\n", (UINTN)IntegrityFailureStringAddress);
-			break;
-		}
-	}
-
-	if (IntegrityFailureStringAddress == NULL)
+	CONST EFI_STATUS Status = FindPattern((CONST UINT8*)ImgpFilterValidationFailureMessage.Buffer,
+										0xCC,
+										ImgpFilterValidationFailureMessage.Length,
+										PatternStartVa,
+										SearchEnd - PatternStartRva,
+										(VOID**)&IntegrityFailureStringAddress);
+	if (EFI_ERROR(Status))
 	{
-		Print(L"    Failed to find load failure string.\r\n");
+		ConsolePrint(L"    Failed to find load failure string.\r\n");
 		return EFI_NOT_FOUND;
 	}
+	ConsolePrint(L"    Found load failure string at 0x%llx.\r\n", (UINTN)IntegrityFailureStringAddress);
 
 	CONST UINT32 CodeStartRva = CodeSection->VirtualAddress;
 	CONST UINT32 CodeSizeOfRawData = CodeSection->SizeOfRawData;
@@ -328,58 +330,43 @@ PatchImgpFilterValidationFailure(
 
 	ZeroMem(SectionName, sizeof(SectionName));
 	CopyMem(SectionName, CodeSection->Name, EFI_IMAGE_SIZEOF_SHORT_NAME);
-	Print(L"== Disassembling %a to find %S!ImgpFilterValidationFailure ==\r\n", SectionName, ShortName);
-	UINT8* LeaIntegrityFailureAddress = NULL;
-
-	// Initialize Zydis
-	ZYDIS_CONTEXT Context;
-	ZyanStatus Status = ZydisInit(NtHeaders, &Context);
-	if (!ZYAN_SUCCESS(Status))
-	{
-		Print(L"Failed to initialize disassembler engine.\r\n");
-		return EFI_LOAD_ERROR;
-	}
-
-	Context.Length = CodeSizeOfRawData;
-	Context.Offset = 0;
+	ConsolePrint(L"== Searching %a for references to find %S!ImgpFilterValidationFailure ==\r\n", SectionName, ShortName);
 
-	// Start decode loop
-	while ((Context.InstructionAddress = (ZyanU64)(CodeStartVa + Context.Offset),
-			Status = ZydisDecoderDecodeFull(&Context.Decoder,
-											(VOID*)Context.InstructionAddress,
-											Context.Length - Context.Offset,
-											&Context.Instruction,
-											Context.Operands)) != ZYDIS_STATUS_NO_MORE_DATA)
+	// Find "lea REG, ds:[rip + offset_to_bsod_string]". If the image's cross-reference index has already been built, look it up there.
+	// Otherwise sweep the code section for RIP-relative displacements to the string, which avoids disassembling it for a single reference
+	UINT8* LeaIntegrityFailureAddress = NULL;
+	if (ImageContext->XrefIndex.Xrefs != NULL)
 	{
-		if (!ZYAN_SUCCESS(Status))
-		{
-			Context.Offset++;
-			continue;
-		}
-
-		// Check if this is "lea REG, ds:[rip + offset_to_bsod_string]"
-		if (Context.Instruction.operand_count == 2 && Context.Instruction.mnemonic == ZYDIS_MNEMONIC_LEA &&
-			Context.Operands[1].type == ZYDIS_OPERAND_TYPE_MEMORY &&
-			Context.Operands[1].mem.base == ZYDIS_REGISTER_RIP)
+		CONST XREF* Xrefs;
+		CONST UINTN NumXrefs = FindXrefsTo(&ImageContext->XrefIndex, IntegrityFailureStringAddress, &Xrefs);
+		for (UINTN i = 0; i < NumXrefs; ++i)
 		{
-			ZyanU64 OperandAddress = 0;
-			if (ZYAN_SUCCESS(ZydisCalcAbsoluteAddress(&Context.Instruction, &Context.Operands[1], Context.InstructionAddress, &OperandAddress)) &&
-				OperandAddress == (UINTN)IntegrityFailureStringAddress)
+			if (Xrefs[i].Kind == XrefLea)
 			{
-				LeaIntegrityFailureAddress = (UINT8*)Context.InstructionAddress;
-				Print(L"    Found load instruction for load failure string at 0x%llx.\r\n", (UINTN)LeaIntegrityFailureAddress);
+				LeaIntegrityFailureAddress = ImageBase + Xrefs[i].SiteRva;
 				break;
 			}
 		}
-
-		Context.Offset += Context.Instruction.length;
 	}
+	else
+	{
+		FindReferencesTo(&ImageContext->Zydis,
+						CodeStartVa,
+						CodeSizeOfRawData,
+						IntegrityFailureStringAddress,
+						1U << XrefLea,
+						&LeaIntegrityFailureAddress,
+						1);
+	}
+
+	if (LeaIntegrityFailureAddress != NULL)
+		ConsolePrint(L"    Found load instruction for load failure string at 0x%llx.\r\n", (UINTN)LeaIntegrityFailureAddress);
 
 	// Backtrack to function start
 	UINT8* ImgpFilterValidationFailure = BacktrackToFunctionStart(ImageBase, NtHeaders, LeaIntegrityFailureAddress);
 	if (ImgpFilterValidationFailure == NULL)
 	{
-		Print(L"    Failed to find %S!ImgpFilterValidationFailure%S.\r\n",
+		ConsolePrint(L"    Failed to find %S!ImgpFilterValidationFailure%S.\r\n",
 			ShortName, (LeaIntegrityFailureAddress == NULL ? L" load failure string load instruction" : L""));
 		return EFI_NOT_FOUND;
 	}
@@ -389,49 +376,49 @@ PatchImgpFilterValidationFailure(
 	CopyWpMem(ImgpFilterValidationFailure, &Ok, sizeof(Ok));
 
 	// Print info
-	Print(L"    Patched %S!ImgpFilterValidationFailure [RVA: 0x%X].\r\n\r\n",
+	ConsolePrint(L"    Patched %S!ImgpFilterValidationFailure [RVA: 0x%X].\r\n\r\n",
 		ShortName, (UINT32)(ImgpFilterValidationFailure - ImageBase));
 
 	return EFI_SUCCESS;
 }
 
 //
-// Finds OslFwpKernelSetupPhase1 in winload.efi
+// Finds OslFwpKernelSetupPhase1 in winload.efi. If the signature scan fails, XrefIndex is built for the code section
 //
 EFI_STATUS
 EFIAPI
 FindOslFwpKernelSetupPhase1(
-	IN CONST UINT8* ImageBase,
-	IN PEFI_IMAGE_NT_HEADERS NtHeaders,
-	IN PEFI_IMAGE_SECTION_HEADER CodeSection,
-	IN PEFI_IMAGE_SECTION_HEADER PatternSection,
+	IN OUT PIMAGE_CONTEXT ImageContext,
 	IN BOOLEAN TryPatternMatch,
 	OUT UINT8** OslFwpKernelSetupPhase1Address
 	)
 {
 	*OslFwpKernelSetupPhase1Address = NULL;
 
+	CONST UINT8* ImageBase = ImageContext->ImageBase;
+	CONST PEFI_IMAGE_NT_HEADERS NtHeaders = ImageContext->NtHeaders;
+	CONST PEFI_IMAGE_SECTION_HEADER CodeSection = ImageContext->TextSection;
+	CONST PXREF_INDEX XrefIndex = &ImageContext->XrefIndex;
+
 	CONST UINT8* CodeStartVa = ImageBase + CodeSection->VirtualAddress;
 	CONST UINT32 CodeSizeOfRawData = CodeSection->SizeOfRawData;
-	CONST UINT8* PatternStartVa = ImageBase + PatternSection->VirtualAddress;
 
 	if (TryPatternMatch)
 	{
 		// On Windows 10, try simple pattern matching first since it will most likely work
 		UINT8* Found = NULL;
-		CONST EFI_STATUS Status = FindPattern(SigOslFwpKernelSetupPhase1,
-											0xCC,
-											sizeof(SigOslFwpKernelSetupPhase1),
-											(VOID*)CodeStartVa,
-											CodeSizeOfRawData,
-											(VOID**)&Found);
+		CONST EFI_STATUS Status = FindSignatureParallel(&ImageContext->Scheduler,
+													&SigOslFwpKernelSetupPhase1,
+													(VOID*)CodeStartVa,
+													CodeSizeOfRawData,
+													(VOID**)&Found);
 		if (!EFI_ERROR(Status))
 		{
 			// Found signature; backtrack to function start
 			*OslFwpKernelSetupPhase1Address = BacktrackToFunctionStart(ImageBase, NtHeaders, Found);
 			if (*OslFwpKernelSetupPhase1Address != NULL)
 			{
-				Print(L"\r\nFound OslFwpKernelSetupPhase1 at 0x%llX.\r\n", (UINTN)(*OslFwpKernelSetupPhase1Address));
+				ConsolePrint(L"\r\nFound OslFwpKernelSetupPhase1 at 0x%llX.\r\n", (UINTN)(*OslFwpKernelSetupPhase1Address));
 				return EFI_SUCCESS; // Found; early out
 			}
 		}
@@ -441,151 +428,114 @@ FindOslFwpKernelSetupPhase1(
 	// This of course implies finding EfipGetRsdt first. After that, find all calls to this function, and for each, calculate
 	// the distance from the start of the function to the call. OslFwpKernelSetupPhase1 is reliably (Vista through 10)
 	// the function that has the smallest value for this distance, i.e. the call happens very early in the function.
-	CHAR8 SectionName[EFI_IMAGE_SIZEOF_SHORT_NAME + 1];
-	CopyMem(SectionName, PatternSection->Name, EFI_IMAGE_SIZEOF_SHORT_NAME);
-	SectionName[EFI_IMAGE_SIZEOF_SHORT_NAME] = '\0';
-	Print(L"\r\n== Searching for EfipGetRsdt pattern in %a ==\r\n", SectionName);
+	ConsolePrint(L"\r\n== Searching for EfipGetRsdt pattern in data sections ==\r\n");
 
 	// Search for EFI ACPI 2.0 table GUID: { 8868e871-e4f1-11d3-bc22-0080c73c8881 }
 	UINT8* PatternAddress = NULL;
-	for (UINT8* Address = (UINT8*)PatternStartVa;
-		Address < ImageBase + NtHeaders->OptionalHeader.SizeOfImage - sizeof(gEfiAcpi20TableGuid);
-		++Address)
-	{
-		if (CompareGuid((CONST GUID*)Address, &gEfiAcpi20TableGuid))
-		{
-			PatternAddress = Address;
-			Print(L"    Found EFI ACPI 2.0 GUID at 0x%llX.\r\n", (UINTN)PatternAddress);
-			break;
-		}
-	}
+	if (!EFI_ERROR(FindConstantInDataSections(ImageBase, NtHeaders, &gEfiAcpi20TableGuid, sizeof(gEfiAcpi20TableGuid), 1, (VOID**)&PatternAddress)))
+		ConsolePrint(L"    Found EFI ACPI 2.0 GUID at 0x%llX.\r\n", (UINTN)PatternAddress);
 
 	if (PatternAddress == NULL)
 	{
-		Print(L"    Failed to find EFI ACPI 2.0 GUID.\r\n");
+		ConsolePrint(L"    Failed to find EFI ACPI 2.0 GUID.\r\n");
 		return EFI_NOT_FOUND;
 	}
 
-	Print(L"\r\n== Disassembling .text to find EfipGetRsdt ==\r\n");
-	UINT8* LeaEfiAcpiTableGuidAddress = NULL;
+	ConsolePrint(L"\r\n== Disassembling .text to find EfipGetRsdt ==\r\n");
 
-	// Initialize Zydis
-	ZYDIS_CONTEXT Context;
-	ZyanStatus Status = ZydisInit(NtHeaders, &Context);
-	if (!ZYAN_SUCCESS(Status))
+	CONST EFI_STATUS Status = BuildXrefIndex(&ImageContext->Scheduler,
+											&ImageContext->Zydis,
+											ImageBase,
+											NtHeaders,
+											CodeStartVa,
+											CodeSizeOfRawData,
+											XrefIndex);
+	if (EFI_ERROR(Status))
 	{
-		Print(L"Failed to initialize disassembler engine.\r\n");
-		return EFI_LOAD_ERROR;
+		ConsolePrint(L"    Failed to build cross-reference index. Status: %llx\r\n", Status);
+		return Status;
 	}
 
-	Context.Length = CodeSizeOfRawData;
-	Context.Offset = 0;
-
-	// Start decode loop
-	while ((Context.InstructionAddress = (ZyanU64)(CodeStartVa + Context.Offset),
-			Status = ZydisDecoderDecodeFull(&Context.Decoder,
-											(VOID*)Context.InstructionAddress,
-											Context.Length - Context.Offset,
-											&Context.Instruction,
-											Context.Operands)) != ZYDIS_STATUS_NO_MORE_DATA)
+	// Find "lea rcx, ds:[rip + offset_to_acpi20_guid]"
+	CONST UINT8* LeaEfiAcpiTableGuidAddress = NULL;
+	CONST XREF* Xrefs;
+	UINTN NumXrefs = FindXrefsTo(XrefIndex, PatternAddress, &Xrefs);
+	for (UINTN i = 0; i < NumXrefs; ++i)
 	{
-		if (!ZYAN_SUCCESS(Status))
-		{
-			Context.Offset++;
+		if (Xrefs[i].Kind != XrefLea || Xrefs[i].Register != ZYDIS_REGISTER_RCX)
 			continue;
-		}
 
-		// Check if this is "lea rcx, ds:[rip + offset_to_acpi20_guid]"
-		if (Context.Instruction.operand_count == 2 && Context.Instruction.mnemonic == ZYDIS_MNEMONIC_LEA &&
-			Context.Operands[0].type == ZYDIS_OPERAND_TYPE_REGISTER &&
-			Context.Operands[0].reg.value == ZYDIS_REGISTER_RCX &&
-			Context.Operands[1].type == ZYDIS_OPERAND_TYPE_MEMORY &&
-			Context.Operands[1].mem.base == ZYDIS_REGISTER_RIP)
+		// Check for false positives (BlFwGetSystemTable)
+		CONST UINT8* Check = ImageBase + Xrefs[i].SiteRva - 4; // 4 = length of 'lea rdx, [r11+18h]' which precedes this instruction in EfipGetRsdt
+		if (Check[0] == 0x49 && Check[1] == 0x8D && Check[2] == 0x53) // If no match, this is not EfipGetRsdt
 		{
-			ZyanU64 OperandAddress = 0;
-			if (ZYAN_SUCCESS(ZydisCalcAbsoluteAddress(&Context.Instruction, &Context.Operands[1], Context.InstructionAddress, &OperandAddress)) &&
-				OperandAddress == (UINTN)PatternAddress)
-			{
-				// Check for false positives (BlFwGetSystemTable)
-				CONST UINT8* Check = (UINT8*)(CodeStartVa + Context.Offset - 4); // 4 = length of 'lea rdx, [r11+18h]' which precedes this instruction in EfipGetRsdt
-				if (Check[0] == 0x49 && Check[1] == 0x8D && Check[2] == 0x53) // If no match, this is not EfipGetRsdt
-				{
-					LeaEfiAcpiTableGuidAddress = (UINT8*)Context.InstructionAddress;
-					Print(L"    Found load instruction for EFI ACPI 2.0 GUID at 0x%llX.\r\n", (UINTN)LeaEfiAcpiTableGuidAddress);
-					break;
-				}
-			}
+			LeaEfiAcpiTableGuidAddress = ImageBase + Xrefs[i].SiteRva;
+			ConsolePrint(L"    Found load instruction for EFI ACPI 2.0 GUID at 0x%llX.\r\n", (UINTN)LeaEfiAcpiTableGuidAddress);
+			break;
 		}
-
-		Context.Offset += Context.Instruction.length;
 	}
 
 	if (LeaEfiAcpiTableGuidAddress == NULL)
 	{
-		Print(L"    Failed to find load instruction for EFI ACPI 2.0 GUID.\r\n");
+		ConsolePrint(L"    Failed to find load instruction for EFI ACPI 2.0 GUID.\r\n");
 		return EFI_NOT_FOUND;
 	}
 
 	CONST UINT8* EfipGetRsdt = BacktrackToFunctionStart(ImageBase, NtHeaders, LeaEfiAcpiTableGuidAddress);
 	if (EfipGetRsdt == NULL)
 	{
-		Print(L"    Failed to find EfipGetRsdt.\r\n");
+		ConsolePrint(L"    Failed to find EfipGetRsdt.\r\n");
 		return EFI_NOT_FOUND;
 	}
 
-	Print(L"    Found EfipGetRsdt at 0x%llX.\r\n", (UINTN)EfipGetRsdt);
-	Print(L"\r\n== Disassembling .text to find OslFwpKernelSetupPhase1 ==\r\n");
-	UINT8* CallEfipGetRsdtAddress = NULL;
+	ConsolePrint(L"    Found EfipGetRsdt at 0x%llX.\r\n", (UINTN)EfipGetRsdt);
+	ConsolePrint(L"\r\n== Searching for calls to EfipGetRsdt to find OslFwpKernelSetupPhase1 ==\r\n");
+
+	// Collect all 'call EfipGetRsdt' instructions. These are in ascending order, so their functions can be found in a single pass
+	NumXrefs = FindXrefsTo(XrefIndex, EfipGetRsdt, &Xrefs);
+	CONST UINT8** CallAddresses = (CONST UINT8**)AllocatePool(MAX(NumXrefs, 1) * sizeof(UINT8*));
+	UINT8** StartsOfFunctions = (UINT8**)AllocatePool(MAX(NumXrefs, 1) * sizeof(UINT8*));
+	if (CallAddresses == NULL || StartsOfFunctions == NULL)
+	{
+		if (CallAddresses != NULL)
+			FreePool(CallAddresses);
+		if (StartsOfFunctions != NULL)
+			FreePool(StartsOfFunctions);
+		return EFI_OUT_OF_RESOURCES;
+	}
+
+	UINTN NumCalls = 0;
+	for (UINTN i = 0; i < NumXrefs; ++i)
+	{
+		if (Xrefs[i].Kind == XrefCall && !Xrefs[i].Indirect)
+			CallAddresses[NumCalls++] = ImageBase + Xrefs[i].SiteRva;
+	}
+	BacktrackToFunctionStarts(ImageBase, NtHeaders, CallAddresses, NumCalls, StartsOfFunctions);
 
-	// Start decode loop
-	Context.Offset = 0;
+	// Find the call that is closest to the start of its function. OslFwpKernelSetupPhase1 will always have the shortest distance
+	UINT8* CallEfipGetRsdtAddress = NULL;
 	UINTN ShortestDistanceToCall = MAX_UINTN;
-	while ((Context.InstructionAddress = (ZyanU64)(CodeStartVa + Context.Offset),
-			Status = ZydisDecoderDecodeFull(&Context.Decoder,
-											(VOID*)Context.InstructionAddress,
-											Context.Length - Context.Offset,
-											&Context.Instruction,
-											Context.Operands)) != ZYDIS_STATUS_NO_MORE_DATA)
+	for (UINTN i = 0; i < NumCalls; ++i)
 	{
-		if (!ZYAN_SUCCESS(Status))
+		CONST UINTN Distance = (UINTN)CallAddresses[i] - (UINTN)StartsOfFunctions[i];
+		if (Distance < ShortestDistanceToCall)
 		{
-			Context.Offset++;
-			continue;
+			CallEfipGetRsdtAddress = (UINT8*)CallAddresses[i];
+			ShortestDistanceToCall = Distance;
 		}
-
-		// Check if this is 'call IMM'
-		if (Context.Instruction.operand_count == 4 &&
-			Context.Operands[0].type == ZYDIS_OPERAND_TYPE_IMMEDIATE && Context.Operands[0].imm.is_relative == ZYAN_TRUE &&
-			Context.Instruction.mnemonic == ZYDIS_MNEMONIC_CALL)
-		{
-			// Check if this is 'call EfipGetRsdt'
-			ZyanU64 OperandAddress = 0;
-			if (ZYAN_SUCCESS(ZydisCalcAbsoluteAddress(&Context.Instruction, &Context.Operands[0], Context.InstructionAddress, &OperandAddress)) &&
-				OperandAddress == (UINTN)EfipGetRsdt)
-			{
-				// Calculate the distance from the start of the function to the instruction. OslFwpKernelSetupPhase1 will always have the shortest distance
-				CONST UINTN StartOfFunction = (UINTN)BacktrackToFunctionStart(ImageBase, NtHeaders, (UINT8*)Context.InstructionAddress);
-				CONST UINTN Distance = Context.InstructionAddress - StartOfFunction;
-				if (Distance < ShortestDistanceToCall)
-				{
-					CallEfipGetRsdtAddress = (UINT8*)Context.InstructionAddress;
-					ShortestDistanceToCall = Distance;
-				}
-			}
-		}
-
-		Context.Offset += Context.Instruction.length;
 	}
+	FreePool(CallAddresses);
+	FreePool(StartsOfFunctions);
 
 	if (CallEfipGetRsdtAddress == NULL)
 	{
-		Print(L"    Failed to find a single 'call EfipGetRsdt' instruction.\r\n");
+		ConsolePrint(L"    Failed to find a single 'call EfipGetRsdt' instruction.\r\n");
 		return EFI_NOT_FOUND;
 	}
 
 	// Found
 	*OslFwpKernelSetupPhase1Address = CallEfipGetRsdtAddress - ShortestDistanceToCall;
-	Print(L"    Found OslFwpKernelSetupPhase1 at 0x%llX.\r\n\r\n", (UINTN)(*OslFwpKernelSetupPhase1Address));
+	ConsolePrint(L"    Found OslFwpKernelSetupPhase1 at 0x%llX.\r\n\r\n", (UINTN)(*OslFwpKernelSetupPhase1Address));
 
 	return EFI_SUCCESS;
 }
@@ -600,14 +550,18 @@ PatchWinload(
 	IN PEFI_IMAGE_NT_HEADERS NtHeaders
 	)
 {
+	CONST UINT32 Timing = StartPatchTiming(L"PatchWinload");
+
 	// Print file and version info
 	UINT16 MajorVersion = 0, MinorVersion = 0, BuildNumber = 0, Revision = 0;
+	IMAGE_CONTEXT ImageContext;
+	ZeroMem(&ImageContext, sizeof(ImageContext));
 	EFI_STATUS Status = GetPeFileVersionInfo(ImageBase, &MajorVersion, &MinorVersion, &BuildNumber, &Revision, NULL);
 	if (EFI_ERROR(Status))
-		Print(L"\r\nPatchWinload: WARNING: failed to obtain winload.efi version info. Status: %llx\r\n", Status);
+		ConsolePrint(L"\r\nPatchWinload: WARNING: failed to obtain winload.efi version info. Status: %llx\r\n", Status);
 	else
 	{
-		Print(L"\r\nPatching winload.efi v%u.%u.%u.%u...\r\n", MajorVersion, MinorVersion, BuildNumber, Revision);
+		ConsolePrint(L"\r\nPatching winload.efi v%u.%u.%u.%u...\r\n", MajorVersion, MinorVersion, BuildNumber, Revision);
 
 		// Some... adjustments... need to be made later on in the case of pre-Windows 7 loader blocks, so store the build number
 		gKernelPatchInfo.WinloadBuildNumber = BuildNumber;
@@ -616,31 +570,25 @@ PatchWinload(
 		// except for the ImgpFilterValidationFailure patch because this function only exists on Windows 7 and higher.
 		if (BuildNumber < 6001)
 		{
-			Print(L"\r\nPatchWinload: ERROR: Unsupported winload.efi image version.\r\n");
+			ConsolePrint(L"\r\nPatchWinload: ERROR: Unsupported winload.efi image version.\r\n");
 			Status = EFI_UNSUPPORTED;
 			goto Exit;
 		}
 	}
 
-	// Find the .text and .rdata sections
-	PEFI_IMAGE_SECTION_HEADER CodeSection = NULL, PatternSection = NULL;
-	PEFI_IMAGE_SECTION_HEADER Section = IMAGE_FIRST_SECTION(NtHeaders);
-	for (UINT16 i = 0; i < NtHeaders->FileHeader.NumberOfSections; ++i)
+	// Initialize the decoder and find the .text and .rdata sections. This context is shared by all patches below
+	Status = InitializeImageContext(ImageBase, NtHeaders, &ImageContext);
+	if (EFI_ERROR(Status))
 	{
-		CHAR8 SectionName[EFI_IMAGE_SIZEOF_SHORT_NAME + 1];
-		CopyMem(SectionName, Section->Name, EFI_IMAGE_SIZEOF_SHORT_NAME);
-		SectionName[EFI_IMAGE_SIZEOF_SHORT_NAME] = '\0';
-
-		if (AsciiStrCmp(SectionName, ".text") == 0)
-			CodeSection = Section;
-		else if (AsciiStrCmp(SectionName, ".rdata") == 0)
-			PatternSection = Section;
-
-		Section++;
+		ConsolePrint(L"\r\nPatchWinload: failed to initialize disassembler engine.\r\n");
+		goto Exit;
 	}
 
-	ASSERT(CodeSection != NULL);
-	ASSERT(PatternSection != NULL);
+	// Use the application processors for large scans if possible. Failure just means everything runs on the BSP
+	InitializeScanScheduler(&ImageContext.Scheduler);
+
+	CONST PEFI_IMAGE_SECTION_HEADER CodeSection = ImageContext.TextSection;
+	ASSERT(ImageContext.RdataSection != NULL);
 
 	if (BuildNumber >= 10240)
 	{
@@ -649,40 +597,40 @@ PatchWinload(
 		if (gBlStatusPrint == NULL)
 		{
 			// Not exported (RS4 and earlier) - try to find by signature
-			FindPattern(SigBlStatusPrint,
-						0xCC,
-						sizeof(SigBlStatusPrint),
-						(UINT8*)ImageBase + CodeSection->VirtualAddress,
-						CodeSection->SizeOfRawData,
-						(VOID**)&gBlStatusPrint);
+			CONST UINT32 SearchTiming = StartPatchTiming(L"BlStatusPrint search");
+			FindSignatureParallel(&ImageContext.Scheduler,
+								&SigBlStatusPrint,
+								(UINT8*)ImageBase + CodeSection->VirtualAddress,
+								CodeSection->SizeOfRawData,
+								(VOID**)&gBlStatusPrint);
+			StopPatchTiming(SearchTiming);
 			if (gBlStatusPrint == NULL)
 			{
 				gBlStatusPrint = BlStatusPrintNoop;
-				Print(L"\r\nWARNING: winload!BlStatusPrint not found. No boot debugger output will be available.\r\n");
+				ConsolePrint(L"\r\nWARNING: winload!BlStatusPrint not found. No boot debugger output will be available.\r\n");
 			}
 		}
 
 		// Disable VBS for the duration of this boot
 		Status = DisableVbs();
 		if (EFI_ERROR(Status))
-			Print(L"\r\nWARNING: failed to set EFI runtime variable \"%ls\" in order to disable VBS.\r\n", VbsPolicyDisabledVariableName);
+			ConsolePrint(L"\r\nWARNING: failed to set EFI runtime variable \"%ls\" in order to disable VBS.\r\n", VbsPolicyDisabledVariableName);
 	}
 
 	// Find winload!OslFwpKernelSetupPhase1
-	Status = FindOslFwpKernelSetupPhase1(ImageBase,
-										NtHeaders,
-										CodeSection,
-										PatternSection,
+	CONST UINT32 FindTiming = StartPatchTiming(L"FindOslFwpKernelSetupPhase1");
+	Status = FindOslFwpKernelSetupPhase1(&ImageContext,
 										BuildNumber >= 10240,
 										(UINT8**)&gOriginalOslFwpKernelSetupPhase1);
+	StopPatchTiming(FindTiming);
 	if (EFI_ERROR(Status))
 	{
-		Print(L"\r\nPatchWinload: failed to find OslFwpKernelSetupPhase1. Status: %llx\r\n", Status);
+		ConsolePrint(L"\r\nPatchWinload: failed to find OslFwpKernelSetupPhase1. Status: %llx\r\n", Status);
 		goto Exit;
 	}
 
 	CONST UINTN HookedOslFwpKernelSetupPhase1Address = (UINTN)&HookedOslFwpKernelSetupPhase1;
-	Print(L"HookedOslFwpKernelSetupPhase1 at 0x%p.\r\n", (VOID*)HookedOslFwpKernelSetupPhase1Address);
+	ConsolePrint(L"HookedOslFwpKernelSetupPhase1 at 0x%p.\r\n", (VOID*)HookedOslFwpKernelSetupPhase1Address);
 
 	CONST EFI_TPL Tpl = gBS->RaiseTPL(TPL_HIGH_LEVEL); // Note: implies cli
 
@@ -698,24 +646,30 @@ PatchWinload(
 
 	// Patch ImgpValidateImageHash to allow custom boot loaders. This is completely
 	// optional (unless booting a custom ntoskrnl.exe), and failures are ignored
+	UINT32 PatchTiming = StartPatchTiming(L"PatchImgpValidateImageHash");
 	PatchImgpValidateImageHash(WinloadEfi,
-								ImageBase,
-								NtHeaders);
+								&ImageContext);
+	StopPatchTiming(PatchTiming);
 
 	if (BuildNumber >= 7600)
 	{
 		// Patch ImgpFilterValidationFailure so it doesn't silently
 		// rat out every violation to a TPM or SI log. Also optional
+		PatchTiming = StartPatchTiming(L"PatchImgpFilterValidationFailure");
 		PatchImgpFilterValidationFailure(WinloadEfi,
-										ImageBase,
-										NtHeaders);
+										&ImageContext);
+		StopPatchTiming(PatchTiming);
 	}
 
 Exit:
+	RecordDecodeStatistics(EfiGuardStageWinload, &ImageContext.Zydis);
+	FreeImageContext(&ImageContext);
+	StopPatchTiming(Timing);
+
 	if (EFI_ERROR(Status))
 	{
 		// Patch failed. Prompt user to ask what they want to do
-		Print(L"\r\nPress any key to continue anyway, or press ESC to reboot.\r\n");
+		ConsolePrint(L"\r\nPress any key to continue anyway, or press ESC to reboot.\r\n");
 		if (!WaitForKey())
 		{
 			gRT->ResetSystem(EfiResetCold, EFI_SUCCESS, 0, NULL);
@@ -723,12 +677,12 @@ Exit:
 	}
 	else
 	{
-		Print(L"Successfully patched winload!OslFwpKernelSetupPhase1.\r\n");
-		RtlSleep(2000);
+		ConsolePrint(L"Successfully patched winload!OslFwpKernelSetupPhase1.\r\n");
+		BootStageDelay(gBootDelays.Winload);
 
 		if (gDriverConfig.WaitForKeyPress)
 		{
-			Print(L"\r\nPress any key to continue.\r\n");
+			ConsolePrint(L"\r\nPress any key to continue.\r\n");
 			WaitForKey();
 		}
 	}
@@ -5,6 +5,7 @@
 
 #include <Uefi.h>
 #include <Protocol/DriverSupportedEfiVersion.h>
+#include <Protocol/MpService.h>
 #include <Protocol/EfiGuard.h>
 #include <Guid/Acpi.h>
 #include <Library/DebugLib.h>
@@ -32,6 +33,7 @@ EFI_GUID gEfiGuardDriverProtocolGuid = EFI_EFIGUARD_DRIVER_PROTOCOL_GUID;
 //
 EFI_GUID gEfiDriverSupportedEfiVersionProtocolGuid = EFI_DRIVER_SUPPORTED_EFI_VERSION_PROTOCOL_GUID;
 EFI_GUID gEfiAcpi20TableGuid = EFI_ACPI_20_TABLE_GUID;
+EFI_GUID gEfiMpServiceProtocolGuid = EFI_MP_SERVICES_PROTOCOL_GUID;
 
 
 //
@@ -60,6 +60,59 @@ RtlpImageNtHeaderEx(
 	return NtHeaders;
 }
 
+// Resource directories nest type -> name -> language. Named entries only occur on the first two levels
+#define RESOURCE_MAX_NAMED_DEPTH		2
+
+// Walks the type and name levels of a resource directory tree looking for an entry with the given name.
+// The cost depends on the number of directory entries, not on the size of the resource data
+STATIC
+BOOLEAN
+EFIAPI
+ResourceDirectoryHasNamedEntry(
+	IN CONST UINT8* ResourceDirVa,
+	IN UINT32 ResourceDirSize,
+	IN CONST EFI_IMAGE_RESOURCE_DIRECTORY* ResourceDirTable,
+	IN CONST CHAR16* Name,
+	IN UINT32 Depth
+	)
+{
+	CONST UINTN NameLength = StrLen(Name);
+	CONST UINT32 NumEntries = (UINT32)ResourceDirTable->NumberOfNamedEntries + ResourceDirTable->NumberOfIdEntries;
+	CONST EFI_IMAGE_RESOURCE_DIRECTORY_ENTRY* Entries = (CONST EFI_IMAGE_RESOURCE_DIRECTORY_ENTRY*)(ResourceDirTable + 1);
+	if ((UINT8*)(Entries + NumEntries) > ResourceDirVa + ResourceDirSize)
+		return FALSE;
+
+	for (UINT32 i = 0; i < NumEntries; ++i)
+	{
+		if (i < ResourceDirTable->NumberOfNamedEntries && Entries[i].u1.s.NameIsString)
+		{
+			CONST UINT32 NameOffset = Entries[i].u1.s.NameOffset;
+			if (NameOffset + sizeof(UINT16) <= ResourceDirSize)
+			{
+				CONST EFI_IMAGE_RESOURCE_DIRECTORY_STRING* EntryName =
+					(CONST EFI_IMAGE_RESOURCE_DIRECTORY_STRING*)(ResourceDirVa + NameOffset);
+				if (EntryName->Length == NameLength &&
+					NameOffset + sizeof(UINT16) + NameLength * sizeof(CHAR16) <= ResourceDirSize &&
+					CompareMem(EntryName->String, Name, NameLength * sizeof(CHAR16)) == 0)
+				{
+					return TRUE;
+				}
+			}
+		}
+
+		if (Depth + 1 < RESOURCE_MAX_NAMED_DEPTH &&
+			Entries[i].u2.s.DataIsDirectory &&
+			Entries[i].u2.s.OffsetToDirectory + sizeof(EFI_IMAGE_RESOURCE_DIRECTORY) <= ResourceDirSize)
+		{
+			CONST EFI_IMAGE_RESOURCE_DIRECTORY* SubDirectory =
+				(CONST EFI_IMAGE_RESOURCE_DIRECTORY*)(ResourceDirVa + Entries[i].u2.s.OffsetToDirectory);
+			if (ResourceDirectoryHasNamedEntry(ResourceDirVa, ResourceDirSize, SubDirectory, Name, Depth + 1))
+				return TRUE;
+		}
+	}
+	return FALSE;
+}
+
 INPUT_FILETYPE
 EFIAPI
 GetInputFileType(
@@ -84,13 +137,9 @@ GetInputFileType(
 		// Of the Windows loaders, only bootmgfw.efi has this subsystem type.
 		// Check for the BCD Bootmgr GUID, { 9DEA862C-5CDD-4E70-ACC1-F32B344D4795 }, which is present in bootmgfw/bootmgr (and on Win >= 8 also winload.[exe|efi])
 		CONST EFI_GUID BcdWindowsBootmgrGuid = { 0x9dea862c, 0x5cdd, 0x4e70, { 0xac, 0xc1, 0xf3, 0x2b, 0x34, 0x4d, 0x47, 0x95 } };
-		for (UINT8* Address = (UINT8*)ImageBase; Address < ImageBase + ImageSize - sizeof(BcdWindowsBootmgrGuid); Address += sizeof(VOID*))
-		{
-			if (CompareGuid((CONST GUID*)Address, &BcdWindowsBootmgrGuid))
-			{
-				return BootmgfwEfi;
-			}
-		}
+		VOID* Found;
+		if (!EFI_ERROR(FindConstantInDataSections(ImageBase, NtHeaders, &BcdWindowsBootmgrGuid, sizeof(BcdWindowsBootmgrGuid), sizeof(VOID*), &Found)))
+			return BootmgfwEfi;
 
 		// Some other OS is being booted
 		return Unknown;
@@ -103,7 +152,7 @@ GetInputFileType(
 		return Unknown;
 	}
 
-	// Brute force scan .rsrc to check if this is either winload.efi or bootmgr.efi.
+	// Check the resource directory for the boot menu stylesheet to tell whether this is winload.efi or bootmgr.efi.
 	// We've already eliminated bootmgr and bootmgfw.efi as candidates, so there will be no false positives
 	UINT32 Size = 0;
 	EFI_IMAGE_RESOURCE_DIRECTORY *ResourceDirTable =
@@ -114,7 +163,16 @@ GetInputFileType(
 	if (ResourceDirTable == NULL || Size == 0)
 		return Unknown;
 
-	for (UINT8* Address = (UINT8*)ResourceDirTable; Address < ImageBase + ImageSize - sizeof(L"OSLOADER.XSL"); Address += sizeof(CHAR16))
+	if (ResourceDirectoryHasNamedEntry((UINT8*)ResourceDirTable, Size, ResourceDirTable, L"BOOTMGR.XSL", 0))
+		return BootmgrEfi;
+	if (ResourceDirectoryHasNamedEntry((UINT8*)ResourceDirTable, Size, ResourceDirTable, L"OSLOADER.XSL", 0))
+		return WinloadEfi;
+
+	// Not a named resource. Fall back to scanning the resource data itself, which is still bounded by the size of .rsrc
+	CONST UINT8* ResourceEnd = (UINT8*)ResourceDirTable + Size;
+	if (ResourceEnd > ImageBase + ImageSize)
+		ResourceEnd = ImageBase + ImageSize;
+	for (CONST UINT8* Address = (UINT8*)ResourceDirTable; Address + sizeof(L"OSLOADER.XSL") <= ResourceEnd; Address += sizeof(CHAR16))
 	{
 		if (CompareMem(Address, L"BOOTMGR.XSL", sizeof(L"BOOTMGR.XSL") - sizeof(CHAR16)) == 0)
 		{
@@ -229,20 +287,10 @@ FindIATAddressForImport(
 	if (ImportDirSize == 0 || DescriptorTable == NULL)
 		return EFI_NOT_FOUND;
 
-	// Count the number of DLL import descriptors
-	PIMAGE_IMPORT_DESCRIPTOR Entry = DescriptorTable;
-	UINT32 DllCount;
-	for (DllCount = 0; Entry->u.OriginalFirstThunk != 0; ++DllCount)
-	{
-		Entry = (PIMAGE_IMPORT_DESCRIPTOR)((UINTN)(Entry) +
-			sizeof(IMAGE_IMPORT_DESCRIPTOR));
-	}
-
-	// Iterate over the import descriptors
-	for (UINT32 i = 0; i < DllCount; ++i)
+	// Iterate over the import descriptors until the null terminator entry
+	for (PIMAGE_IMPORT_DESCRIPTOR Descriptor = DescriptorTable; Descriptor->u.OriginalFirstThunk != 0; ++Descriptor)
 	{
 		// Is this the import descriptor for our DLL?
-		CONST PIMAGE_IMPORT_DESCRIPTOR Descriptor = &DescriptorTable[i];
 		CONST CHAR8* DllName = (CHAR8*)((UINTN)ImageBase + Descriptor->Name);
 		if (DllName == NULL || AsciiStriCmp(DllName, ImportDllName) != 0)
 			continue; // No - skip
@@ -305,28 +353,70 @@ FindIATAddressForImport(
 }
 
 
-UINT32
+// Packs a section name into a 64-bit ID: the (at most 8) name bytes, zero padded. Names are compared by comparing their IDs
+UINT64
 EFIAPI
-RvaToOffset(
+SectionNameToId(
+	IN CONST CHAR8* SectionName
+	)
+{
+	UINT64 Id = 0;
+	for (UINT32 i = 0; i < EFI_IMAGE_SIZEOF_SHORT_NAME && SectionName[i] != '\0'; ++i)
+		Id |= LShiftU64((UINT64)(UINT8)SectionName[i], i * 8);
+	return Id;
+}
+
+// Returns the name ID of a section header. Header names are already zero padded, so this is a plain load
+UINT64
+EFIAPI
+SectionHeaderNameId(
+	IN CONST EFI_IMAGE_SECTION_HEADER* Section
+	)
+{
+	return ReadUnaligned64((CONST UINT64*)Section->Name);
+}
+
+// The section table of a valid image is sorted by ascending virtual address (the loader rejects anything else), so it can
+// be binary searched in place without building a separate index
+PEFI_IMAGE_SECTION_HEADER
+EFIAPI
+FindSectionByRva(
 	IN PEFI_IMAGE_NT_HEADERS NtHeaders,
 	IN UINT32 Rva
 	)
 {
-	PEFI_IMAGE_SECTION_HEADER SectionHeaders = IMAGE_FIRST_SECTION(NtHeaders);
-	CONST UINT16 NumberOfSections = NtHeaders->FileHeader.NumberOfSections;
-	UINT32 Result = 0;
-	for (UINT16 i = 0; i < NumberOfSections; ++i)
+	CONST PEFI_IMAGE_SECTION_HEADER SectionHeaders = IMAGE_FIRST_SECTION(NtHeaders);
+
+	// Find the last section starting at or below the RVA
+	UINT32 Low = 0, High = NtHeaders->FileHeader.NumberOfSections;
+	while (Low < High)
 	{
-		if (SectionHeaders->VirtualAddress <= Rva &&
-			SectionHeaders->VirtualAddress + SectionHeaders->Misc.VirtualSize > Rva)
-		{
-			Result = Rva - SectionHeaders->VirtualAddress +
-							SectionHeaders->PointerToRawData;
-			break;
-		}
-		SectionHeaders++;
+		CONST UINT32 Middle = Low + (High - Low) / 2;
+		if (SectionHeaders[Middle].VirtualAddress <= Rva)
+			Low = Middle + 1;
+		else
+			High = Middle;
 	}
-	return Result;
+	if (Low == 0)
+		return NULL;
+
+	CONST PEFI_IMAGE_SECTION_HEADER Section = &SectionHeaders[Low - 1];
+	return Rva < Section->VirtualAddress + Section->Misc.VirtualSize
+		? Section
+		: NULL;
+}
+
+UINT32
+EFIAPI
+RvaToOffset(
+	IN PEFI_IMAGE_NT_HEADERS NtHeaders,
+	IN UINT32 Rva
+	)
+{
+	CONST PEFI_IMAGE_SECTION_HEADER Section = FindSectionByRva(NtHeaders, Rva);
+	return Section != NULL
+		? Rva - Section->VirtualAddress + Section->PointerToRawData
+		: 0;
 }
 
 // The kernel and ntdll divide this into [ RtlImageDirectoryEntryToData -> RtlpImageDirectoryEntryToData ->
@@ -370,6 +460,34 @@ RtlpImageDirectoryEntryToDataEx(
 	return (UINT8*)(Base) + RvaToOffset(NtHeaders, Rva);
 }
 
+// Resource directories store their named entries first, followed by the ID entries sorted by ascending ID.
+// This does a binary search over the ID entries.
+STATIC
+EFI_IMAGE_RESOURCE_DIRECTORY_ENTRY*
+EFIAPI
+FindResourceDirectoryEntryById(
+	IN CONST EFI_IMAGE_RESOURCE_DIRECTORY* ResourceDirTable,
+	IN UINT16 Id
+	)
+{
+	EFI_IMAGE_RESOURCE_DIRECTORY_ENTRY* IdEntries =
+		(EFI_IMAGE_RESOURCE_DIRECTORY_ENTRY*)(ResourceDirTable + 1) + ResourceDirTable->NumberOfNamedEntries;
+
+	UINT32 Low = 0, High = ResourceDirTable->NumberOfIdEntries;
+	while (Low < High)
+	{
+		CONST UINT32 Middle = Low + (High - Low) / 2;
+		if (IdEntries[Middle].u1.Id < Id)
+			Low = Middle + 1;
+		else
+			High = Middle;
+	}
+
+	if (Low == ResourceDirTable->NumberOfIdEntries || IdEntries[Low].u1.s.NameIsString || IdEntries[Low].u1.Id != Id)
+		return NULL;
+	return &IdEntries[Low];
+}
+
 // Similar to LdrFindResource_U + LdrAccessResource combined, with some shortcuts for size optimization:
 // - Only IDs are supported for type/name/language, not strings. Named entries ("MUI", "RCDATA", ...) are ignored.
 // - Only images are supported, not mapped data files (e.g. LoadLibrary(..., LOAD_LIBRARY_AS_DATAFILE) data).
@@ -406,42 +524,28 @@ FindResourceDataById(
 		return EFI_NOT_FOUND;
 
 	CONST UINT8* ResourceDirVa = (UINT8*)ResourceDirTable;
-	EFI_IMAGE_RESOURCE_DIRECTORY_ENTRY *DirEntry = NULL;
-	for (UINT16 i = ResourceDirTable->NumberOfNamedEntries; i < ResourceDirTable->NumberOfNamedEntries + ResourceDirTable->NumberOfIdEntries; ++i)
-	{
-		DirEntry = (EFI_IMAGE_RESOURCE_DIRECTORY_ENTRY*)((UINT8*)ResourceDirTable + sizeof(EFI_IMAGE_RESOURCE_DIRECTORY) + (i * sizeof(EFI_IMAGE_RESOURCE_DIRECTORY_ENTRY)));
-		if ((BOOLEAN)DirEntry->u1.s.NameIsString)
-			continue;
-		if (DirEntry->u1.Id == TypeId && DirEntry->u2.s.DataIsDirectory)
-			break;
-	}
-	if (DirEntry == NULL || DirEntry->u1.Id != TypeId)
+	EFI_IMAGE_RESOURCE_DIRECTORY_ENTRY *DirEntry = FindResourceDirectoryEntryById(ResourceDirTable, TypeId);
+	if (DirEntry == NULL || !DirEntry->u2.s.DataIsDirectory)
 		return EFI_NOT_FOUND;
 
 	ResourceDirTable = (EFI_IMAGE_RESOURCE_DIRECTORY*)(ResourceDirVa + DirEntry->u2.s.OffsetToDirectory);
-	DirEntry = NULL;
-	for (UINT16 i = ResourceDirTable->NumberOfNamedEntries; i < ResourceDirTable->NumberOfNamedEntries + ResourceDirTable->NumberOfIdEntries; ++i)
-	{
-		DirEntry = (EFI_IMAGE_RESOURCE_DIRECTORY_ENTRY*)((UINT8*)ResourceDirTable + sizeof(EFI_IMAGE_RESOURCE_DIRECTORY) + (i * sizeof(EFI_IMAGE_RESOURCE_DIRECTORY_ENTRY)));
-		if ((BOOLEAN)DirEntry->u1.s.NameIsString)
-			continue;
-		if (DirEntry->u1.Id == NameId && DirEntry->u2.s.DataIsDirectory)
-			break;
-	}
-	if (DirEntry == NULL || DirEntry->u1.Id != NameId)
+	DirEntry = FindResourceDirectoryEntryById(ResourceDirTable, NameId);
+	if (DirEntry == NULL || !DirEntry->u2.s.DataIsDirectory)
 		return EFI_NOT_FOUND;
 
 	ResourceDirTable = (EFI_IMAGE_RESOURCE_DIRECTORY*)(ResourceDirVa + DirEntry->u2.s.OffsetToDirectory);
-	DirEntry = NULL;
-	for (UINT16 i = ResourceDirTable->NumberOfNamedEntries; i < ResourceDirTable->NumberOfNamedEntries + ResourceDirTable->NumberOfIdEntries; ++i)
+	if (LanguageId != 0)
 	{
-		DirEntry = (EFI_IMAGE_RESOURCE_DIRECTORY_ENTRY*)((UINT8*)ResourceDirTable + sizeof(EFI_IMAGE_RESOURCE_DIRECTORY) + (i * sizeof(EFI_IMAGE_RESOURCE_DIRECTORY_ENTRY)));
-		if ((BOOLEAN)DirEntry->u1.s.NameIsString)
-			continue;
-		if ((LanguageId == 0 || DirEntry->u1.Id == LanguageId) && !DirEntry->u2.s.DataIsDirectory)
-			break;
+		DirEntry = FindResourceDirectoryEntryById(ResourceDirTable, LanguageId);
+	}
+	else
+	{
+		// Language neutral: take the first language available
+		DirEntry = ResourceDirTable->NumberOfIdEntries > 0
+			? (EFI_IMAGE_RESOURCE_DIRECTORY_ENTRY*)(ResourceDirTable + 1) + ResourceDirTable->NumberOfNamedEntries
+			: NULL;
 	}
-	if (DirEntry == NULL || (LanguageId != 0 && DirEntry->u1.Id != LanguageId))
+	if (DirEntry == NULL || DirEntry->u2.s.DataIsDirectory)
 		return EFI_INVALID_LANGUAGE;
 
 	EFI_IMAGE_RESOURCE_DATA_ENTRY *DataEntry = (EFI_IMAGE_RESOURCE_DATA_ENTRY*)(ResourceDirVa + DirEntry->u2.OffsetToData);
@@ -230,6 +230,25 @@ FindIATAddressForImport(
 	OUT VOID **FunctionIATAddress
 	);
 
+UINT64
+EFIAPI
+SectionNameToId(
+	IN CONST CHAR8* SectionName
+	);
+
+UINT64
+EFIAPI
+SectionHeaderNameId(
+	IN CONST EFI_IMAGE_SECTION_HEADER* Section
+	);
+
+PEFI_IMAGE_SECTION_HEADER
+EFIAPI
+FindSectionByRva(
+	IN PEFI_IMAGE_NT_HEADERS NtHeaders,
+	IN UINT32 Rva
+	);
+
 UINT32
 EFIAPI
 RvaToOffset(
@@ -6,6 +6,8 @@
 #include <Library/DevicePathLib.h>
 #include <Library/PrintLib.h>
 #include <Library/UefiBootServicesTableLib.h>
+#include <Library/SynchronizationLib.h>
+#include <Protocol/MpService.h>
 
 #ifndef ZYDIS_DISABLE_FORMATTER
 #include <Library/PrintLib.h>
@@ -22,6 +24,7 @@ RtlSleep(
 	)
 {
 	ASSERT(gBS != NULL);
+	FlushConsole();
 
 	// Create a timer event, set its timeout, and wait for it
 	EFI_EVENT TimerEvent;
@@ -49,9 +52,89 @@ RtlStall(
 	)
 {
 	ASSERT(gBS != NULL);
+	FlushConsole();
 	return gBS->Stall(Milliseconds * 1000);
 }
 
+VOID
+EFIAPI
+BootStageDelay(
+	IN UINT32 Milliseconds
+	)
+{
+	if (Milliseconds == 0)
+	{
+		// Still show the output of the stage before moving on
+		FlushConsole();
+		return;
+	}
+
+	gKernelPatchInfo.BootDelayMs += Milliseconds;
+	RtlSleep(Milliseconds);
+}
+
+//
+// Console output buffer used by ConsolePrint(). A message may be at most CONSOLE_MAX_MESSAGE_LENGTH characters including
+// the terminator; the buffer is flushed first if it can't hold a message of that length.
+//
+#define CONSOLE_BUFFER_LENGTH			4096
+#define CONSOLE_MAX_MESSAGE_LENGTH		512
+
+STATIC CHAR16 mConsoleBuffer[CONSOLE_BUFFER_LENGTH];
+STATIC UINTN mConsoleBufferLength = 0;
+
+//
+// Returns a pointer to the end of the console buffer with room for at least CONSOLE_MAX_MESSAGE_LENGTH characters.
+// The caller formats into it and then adds the number of characters written to mConsoleBufferLength.
+//
+STATIC
+CHAR16*
+ReserveConsoleBuffer(
+	OUT UINTN *BufferSize
+	)
+{
+	if (CONSOLE_BUFFER_LENGTH - mConsoleBufferLength < CONSOLE_MAX_MESSAGE_LENGTH)
+		FlushConsole();
+
+	*BufferSize = CONSOLE_MAX_MESSAGE_LENGTH * sizeof(CHAR16);
+	return &mConsoleBuffer[mConsoleBufferLength];
+}
+
+UINTN
+EFIAPI
+ConsolePrint(
+	IN CONST CHAR16 *Format,
+	...
+	)
+{
+	UINTN BufferSize;
+	CHAR16* Buffer = ReserveConsoleBuffer(&BufferSize);
+
+	VA_LIST Marker;
+	VA_START(Marker, Format);
+	CONST UINTN Length = UnicodeVSPrint(Buffer, BufferSize, Format, Marker);
+	VA_END(Marker);
+
+	mConsoleBufferLength += Length;
+	return Length;
+}
+
+VOID
+EFIAPI
+FlushConsole(
+	VOID
+	)
+{
+	if (mConsoleBufferLength == 0)
+		return;
+
+	ASSERT(gST->ConOut != NULL);
+
+	// The last UnicodeVSPrint/UnicodeBSPrint has already terminated the string
+	gST->ConOut->OutputString(gST->ConOut, mConsoleBuffer);
+	mConsoleBufferLength = 0;
+}
+
 VOID
 EFIAPI
 PrintLoadedImageInfo(
@@ -59,13 +142,110 @@ PrintLoadedImageInfo(
 	)
 {
 	CHAR16* PathString = ConvertDevicePathToText(ImageInfo->FilePath, TRUE, TRUE);
-	Print(L"\r\n[+] %s\r\n", PathString);
-	Print(L"    -> ImageBase = %llx\r\n", ImageInfo->ImageBase);
-	Print(L"    -> ImageSize = %llx\r\n", ImageInfo->ImageSize);
+	ConsolePrint(L"\r\n[+] %s\r\n", PathString);
+	ConsolePrint(L"    -> ImageBase = %llx\r\n", ImageInfo->ImageBase);
+	ConsolePrint(L"    -> ImageSize = %llx\r\n", ImageInfo->ImageSize);
 	if (PathString != NULL)
 		FreePool(PathString);
 }
 
+//
+// Appends one argument to a BASE_LIST. Slots is the number of UINTNs that BASE_ARG() advances the list by for the
+// argument's type, i.e. _BASE_INT_SIZE_OF(TYPE)
+//
+STATIC
+BOOLEAN
+EFIAPI
+PushBaseListArgument(
+	IN OUT BASE_LIST* Marker,
+	IN CONST UINTN* End,
+	IN UINT64 Value,
+	IN UINTN Slots
+	)
+{
+	if ((UINTN)(End - *Marker) < Slots)
+		return FALSE;
+
+	if (Slots * sizeof(UINTN) == sizeof(UINT64))
+		*(UINT64*)*Marker = Value;
+	else
+		**Marker = (UINTN)Value;
+	*Marker += Slots;
+	return TRUE;
+}
+
+//
+// Copies the arguments of a PrintLib format string from a VA_LIST to a BASE_LIST, using the same rules as PrintLib
+// to determine the type of each argument. Returns FALSE if the arguments do not fit in MarkerSize bytes
+//
+STATIC
+BOOLEAN
+EFIAPI
+CaptureFormatArguments(
+	IN CONST CHAR16* Format,
+	IN VA_LIST VaList,
+	OUT BASE_LIST Marker,
+	IN UINTN MarkerSize
+	)
+{
+	CONST UINTN* End = Marker + MarkerSize / sizeof(UINTN);
+	for (; *Format != CHAR_NULL; ++Format)
+	{
+		if (*Format != L'%')
+			continue;
+
+		// Skip the flags, width and precision. A '*' width or precision is taken from the argument list
+		BOOLEAN Long = FALSE;
+		CHAR16 Type;
+		while ((Type = *++Format) != CHAR_NULL)
+		{
+			if (Type == L'l' || Type == L'L')
+				Long = TRUE;
+			else if (Type == L'*')
+			{
+				if (!PushBaseListArgument(&Marker, End, VA_ARG(VaList, UINTN), _BASE_INT_SIZE_OF(UINTN)))
+					return FALSE;
+			}
+			else if (!(Type == L'.' || Type == L'-' || Type == L'+' || Type == L' ' || Type == L',' || (Type >= L'0' && Type <= L'9')))
+				break;
+		}
+
+		BOOLEAN Pushed = TRUE;
+		switch (Type)
+		{
+			case CHAR_NULL:
+				return TRUE;
+			case L'X':
+			case L'x':
+			case L'd':
+			case L'u':
+				Pushed = Long
+					? PushBaseListArgument(&Marker, End, VA_ARG(VaList, UINT64), _BASE_INT_SIZE_OF(UINT64))
+					: PushBaseListArgument(&Marker, End, (UINT64)(INT64)VA_ARG(VaList, int), _BASE_INT_SIZE_OF(int));
+				break;
+			case L'p':
+			case L's':
+			case L'S':
+			case L'a':
+			case L'g':
+			case L't':
+				Pushed = PushBaseListArgument(&Marker, End, (UINTN)VA_ARG(VaList, VOID*), _BASE_INT_SIZE_OF(VOID*));
+				break;
+			case L'c':
+			case L'r':
+				Pushed = PushBaseListArgument(&Marker, End, VA_ARG(VaList, UINTN), _BASE_INT_SIZE_OF(UINTN));
+				break;
+			default:
+				break;
+		}
+
+		if (!Pushed)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
 VOID
 EFIAPI
 AppendKernelPatchMessage(
@@ -73,26 +253,17 @@ AppendKernelPatchMessage(
 	...
 	)
 {
-	ASSERT(gKernelPatchInfo.BufferSize % sizeof(CHAR16) == 0);
-	ASSERT(gKernelPatchInfo.BufferSize < sizeof(gKernelPatchInfo.Buffer));
+	// Only record the format string and arguments here. Formatting is done by PrintKernelPatchInfo() after ExitBootServices()
+	KERNEL_PATCH_MESSAGE* Message = &gKernelPatchInfo.Messages[gKernelPatchInfo.NumMessages % KERNEL_PATCH_MSG_MAX_RECORDS];
+	gKernelPatchInfo.NumMessages++;
 
 	VA_LIST VaList;
 	VA_START(VaList, Format);
-	CONST UINTN NumCharsPrinted = UnicodeVSPrint(gKernelPatchInfo.Buffer + (gKernelPatchInfo.BufferSize / sizeof(CHAR16)),
-												sizeof(gKernelPatchInfo.Buffer) - gKernelPatchInfo.BufferSize,
-												Format,
-												VaList);
+	CONST BOOLEAN Captured = CaptureFormatArguments(Format, VaList, (BASE_LIST)Message->Arguments, sizeof(Message->Arguments));
 	VA_END(VaList);
 
-	ASSERT(gKernelPatchInfo.BufferSize + (NumCharsPrinted * sizeof(CHAR16)) < sizeof(gKernelPatchInfo.Buffer));
-	gKernelPatchInfo.BufferSize += (NumCharsPrinted * sizeof(CHAR16));
-
-	// Paranoid null terminator (UnicodeVSPrint should do this)
-	*(gKernelPatchInfo.Buffer + (gKernelPatchInfo.BufferSize / sizeof(CHAR16))) = CHAR_NULL;
-
-	// Separate the next message using the null terminator. This is because most Print() implementations crap out
-	// after ~4 lines (depending on PCDs), so we will print the final buffer using multiple calls to Print()
-	gKernelPatchInfo.BufferSize += sizeof(CHAR16);
+	ASSERT(Captured);
+	Message->Format = Captured ? Format : L"[Kernel patch message with too many arguments]\r\n";
 }
 
 VOID
@@ -103,20 +274,149 @@ PrintKernelPatchInfo(
 {
 	ASSERT(gST->ConOut != NULL);
 
-	UINTN NumChars = gKernelPatchInfo.BufferSize / sizeof(CHAR16);
-	if (NumChars * sizeof(CHAR16) >= sizeof(gKernelPatchInfo.Buffer) - sizeof(CHAR16))
-		NumChars = sizeof(gKernelPatchInfo.Buffer) - (2 * sizeof(CHAR16)); // Avoid buffer overrun
+	// If the ring buffer has wrapped around, the oldest messages have been overwritten
+	CONST UINT32 NumMessages = gKernelPatchInfo.NumMessages;
+	CONST UINT32 First = NumMessages > KERNEL_PATCH_MSG_MAX_RECORDS ? NumMessages - KERNEL_PATCH_MSG_MAX_RECORDS : 0;
+	if (First > 0)
+		ConsolePrint(L"[%u earlier messages were dropped]\r\n", First);
+
+	for (UINT32 i = First; i < NumMessages; ++i)
+	{
+		CONST KERNEL_PATCH_MESSAGE* Message = &gKernelPatchInfo.Messages[i % KERNEL_PATCH_MSG_MAX_RECORDS];
+		UINTN BufferSize;
+		CHAR16* Buffer = ReserveConsoleBuffer(&BufferSize);
+		mConsoleBufferLength += UnicodeBSPrint(Buffer, BufferSize, Message->Format, (BASE_LIST)Message->Arguments);
+	}
+
+	if (gKernelPatchInfo.NumTraceMessages > KERNEL_PATCH_MAX_TRACE_MSGS)
+		ConsolePrint(L"[%u trace messages were suppressed]\r\n", gKernelPatchInfo.NumTraceMessages - KERNEL_PATCH_MAX_TRACE_MSGS);
+
+	ConsolePrint(L"Total boot stage delay: %u ms.\r\n", gKernelPatchInfo.BootDelayMs);
+}
+
+UINT32
+EFIAPI
+StartPatchTiming(
+	IN CONST CHAR16 *Name
+	)
+{
+	CONST UINT32 Index = gKernelPatchInfo.NumTimings;
+	if (Index >= KERNEL_PATCH_MAX_TIMINGS)
+		return MAX_UINT32;
+
+	gKernelPatchInfo.NumTimings++;
+	KERNEL_PATCH_TIMING* Timing = &gKernelPatchInfo.Timings[Index];
+	Timing->Name = Name;
+	Timing->EndTsc = 0;
+	Timing->StartTsc = AsmReadTsc();
+	return Index;
+}
+
+VOID
+EFIAPI
+StopPatchTiming(
+	IN UINT32 Index
+	)
+{
+	CONST UINT64 Tsc = AsmReadTsc();
+	if (Index < KERNEL_PATCH_MAX_TIMINGS)
+		gKernelPatchInfo.Timings[Index].EndTsc = Tsc;
+}
+
+VOID
+EFIAPI
+SleepAndCalibrateTsc(
+	IN UINTN Milliseconds
+	)
+{
+	// Flush first, so that printing to the console is not measured
+	FlushConsole();
+
+	CONST UINT64 StartTsc = AsmReadTsc();
+	RtlSleep(Milliseconds);
+	CONST UINT64 EndTsc = AsmReadTsc();
+
+	gKernelPatchInfo.TscFrequency = ((EndTsc - StartTsc) * 1000) / Milliseconds;
+}
+
+VOID
+EFIAPI
+PrintPatchTimings(
+	VOID
+	)
+{
+	CONST UINT32 NumTimings = gKernelPatchInfo.NumTimings;
+	if (NumTimings == 0)
+		return;
+
+	CONST UINT64 TscFrequency = gKernelPatchInfo.TscFrequency;
+	ConsolePrint(L"\r\n== Patch timings (%S) ==\r\n", (TscFrequency != 0 ? L"us" : L"TSC ticks; not calibrated"));
+
+	for (UINT32 i = 0; i < NumTimings; ++i)
+	{
+		CONST KERNEL_PATCH_TIMING* Timing = &gKernelPatchInfo.Timings[i];
+
+		// Steps are nested, so the steps that contain this one are those that started before it and ended after it started
+		UINTN Depth = 0;
+		for (UINT32 j = 0; j < i; ++j)
+		{
+			if (gKernelPatchInfo.Timings[j].StartTsc <= Timing->StartTsc && Timing->StartTsc < gKernelPatchInfo.Timings[j].EndTsc)
+				Depth++;
+		}
+		Depth = MIN(Depth, 8);
+
+		if (Timing->EndTsc == 0)
+		{
+			ConsolePrint(L"    %*s%-*s %10s\r\n", Depth * 2, L"", 48 - Depth * 2, Timing->Name, L"-");
+			continue;
+		}
+
+		CONST UINT64 Ticks = Timing->EndTsc - Timing->StartTsc;
+		ConsolePrint(L"    %*s%-*s %10lu\r\n", Depth * 2, L"", 48 - Depth * 2, Timing->Name,
+			(TscFrequency != 0 ? (Ticks * 1000000) / TscFrequency : Ticks));
+	}
+}
 
-	CHAR16* String = gKernelPatchInfo.Buffer;
-	String[NumChars] = String[NumChars + 1] = CHAR_NULL; // Ensure we have a double null terminator at the end
-	UINTN Length;
+VOID
+EFIAPI
+RecordDecodeStatistics(
+	IN EFIGUARD_BOOT_STAGE Stage,
+	IN CONST ZYDIS_CONTEXT* Context
+	)
+{
+	gKernelPatchInfo.Stages[Stage].InstructionsDecoded += Context->InstructionsDecoded;
+	gKernelPatchInfo.Stages[Stage].DecodeResyncs += Context->DecodeResyncs;
+}
 
-	// A double null terminator marks the end. It's just like that lovely Win32 getenv API that makes me want to kill myself every time I see it
-	while ((Length = StrLen(String)) != 0)
+EFI_STATUS
+EFIAPI
+SaveDriverStatistics(
+	VOID
+	)
+{
+	// Not on the stack: a frame this close to a page in size makes MSVC emit a __chkstk call, which EDK2 does not provide.
+	// This runs at ExitBootServices(), so it can not be allocated either
+	STATIC EFIGUARD_STATISTICS Statistics;
+	ZeroMem(&Statistics, sizeof(Statistics));
+
+	CopyMem(Statistics.Stages, gKernelPatchInfo.Stages, sizeof(Statistics.Stages));
+	Statistics.BootDelayMs = gKernelPatchInfo.BootDelayMs;
+	Statistics.TscFrequency = gKernelPatchInfo.TscFrequency;
+	Statistics.NumTimings = MIN(gKernelPatchInfo.NumTimings, KERNEL_PATCH_MAX_TIMINGS);
+	for (UINT32 i = 0; i < Statistics.NumTimings; ++i)
 	{
-		gST->ConOut->OutputString(gST->ConOut, String);
-		String += Length + 1;
+		CONST KERNEL_PATCH_TIMING* Timing = &gKernelPatchInfo.Timings[i];
+		EFIGUARD_STEP_TIMING* StepTiming = &Statistics.Timings[i];
+		StrnCpyS(StepTiming->Name, ARRAY_SIZE(StepTiming->Name), Timing->Name, ARRAY_SIZE(StepTiming->Name) - 1);
+		StepTiming->StartTsc = Timing->StartTsc;
+		StepTiming->EndTsc = Timing->EndTsc;
 	}
+
+	return gRT->SetVariable(EFIGUARD_STATISTICS_VARIABLE_NAME,
+							EFIGUARD_STATISTICS_VARIABLE_GUID,
+							EFIGUARD_STATISTICS_VARIABLE_ATTRIBUTES,
+							sizeof(Statistics),
+							&Statistics);
 }
 
 VOID*
@@ -205,6 +505,8 @@ WaitForKey(
 	VOID
 	)
 {
+	FlushConsole();
+
 	// Hack: because we call this at TPL_NOTIFY in ExitBootServices, we cannot use WaitForEvent()
 	// in that scenario because it requires TPL == TPL_APPLICATION. So check the TPL
 	CONST EFI_TPL Tpl = EfiGetCurrentTpl();
@@ -236,6 +538,8 @@ SetConsoleTextColour(
 	IN BOOLEAN ClearScreen
 	)
 {
+	FlushConsole();
+
 	CONST INT32 OriginalAttribute = gST->ConOut->Mode->Attribute;
 	CONST UINTN BackgroundColour = (UINTN)((OriginalAttribute >> 4) & 0x7);
 
@@ -246,29 +550,245 @@ SetConsoleTextColour(
 	return OriginalAttribute;
 }
 
-// TODO: #ifdef EFI_DEBUG, this should keep a match count and continue until the end of the buffer, then ASSERT(MatchCount == 1)
-EFI_STATUS
+// Bytes that are the most common in x64 code, in roughly decreasing order of frequency.
+// FindPattern uses this to anchor its search on the least common bytes of a signature.
+// Any byte not in this list is considered rare, which is almost always true for immediates and displacements
+STATIC CONST UINT8 CommonCodeBytes[] = {
+	0x00, 0xFF, 0x48, 0x8B, 0x89, 0x24, 0xCC, 0x4C, 0x0F, 0x8D, 0x44, 0x01, 0xE8, 0x85, 0xC0, 0x83,
+	0x74, 0x08, 0x41, 0x49, 0x10, 0x45, 0x4D, 0x20, 0x33, 0x40, 0x75, 0xC3, 0x90, 0xEB, 0x84, 0x18,
+	0x8A, 0x05, 0xC7, 0x0D, 0x15, 0x28, 0x30, 0x38, 0x50, 0x54, 0x5C, 0x4E, 0x3B, 0xD8, 0xF8, 0xC1
+};
+
+STATIC
+UINT32
 EFIAPI
-FindPattern(
+GetCodeByteFrequency(
+	IN UINT8 Value
+	)
+{
+	for (UINT32 i = 0; i < sizeof(CommonCodeBytes); ++i)
+	{
+		if (CommonCodeBytes[i] == Value)
+			return sizeof(CommonCodeBytes) - i;
+	}
+	return 0;
+}
+
+//
+// Picks the anchor bytes and builds the value/mask words for a pattern. If Mask is not NULL, bytes with a 0x00 mask are wildcards;
+// otherwise bytes equal to Wildcard are. Returns FALSE if the pattern is unsuitable for an anchored search (too long, or wildcards only)
+//
+STATIC
+BOOLEAN
+EFIAPI
+InitializePatternMatcher(
 	IN CONST UINT8* Pattern,
+	IN CONST UINT8* Mask OPTIONAL,
 	IN UINT8 Wildcard,
 	IN UINT32 PatternLength,
+	OUT PATTERN_MATCHER *Matcher
+	)
+{
+	if (PatternLength == 0 || PatternLength > PATTERN_MAX_WORDS * sizeof(UINT64))
+		return FALSE;
+
+	UINT32 Anchor = MAX_UINT32, SecondAnchor = MAX_UINT32;
+	UINT32 AnchorFrequency = MAX_UINT32, SecondAnchorFrequency = MAX_UINT32;
+	for (UINT32 i = 0; i < PatternLength; ++i)
+	{
+		if (Mask != NULL ? Mask[i] == 0x00 : Pattern[i] == Wildcard)
+			continue;
+
+		CONST UINT32 Frequency = GetCodeByteFrequency(Pattern[i]);
+		if (Frequency < AnchorFrequency)
+		{
+			SecondAnchor = Anchor;
+			SecondAnchorFrequency = AnchorFrequency;
+			Anchor = i;
+			AnchorFrequency = Frequency;
+		}
+		else if (Frequency < SecondAnchorFrequency)
+		{
+			SecondAnchor = i;
+			SecondAnchorFrequency = Frequency;
+		}
+	}
+
+	if (Anchor == MAX_UINT32)
+		return FALSE;
+
+	Matcher->Length = PatternLength;
+	Matcher->Anchor = Anchor;
+	Matcher->SecondAnchor = SecondAnchor != MAX_UINT32 ? SecondAnchor : Anchor;
+	Matcher->AnchorByte = Pattern[Anchor];
+	Matcher->SecondAnchorByte = Pattern[Matcher->SecondAnchor];
+	Matcher->AnchorBytes = 0x0101010101010101ULL * Pattern[Anchor];
+	Matcher->NumWords = PatternLength >= sizeof(UINT64)
+		? (PatternLength + sizeof(UINT64) - 1) / sizeof(UINT64)
+		: 0;
+
+	// Patterns shorter than a word are stored in the first word and compared one byte at a time
+	for (UINT32 i = 0; i < MAX(Matcher->NumWords, 1); ++i)
+	{
+		CONST UINT32 Offset = Matcher->NumWords > 0
+			? MIN(i * (UINT32)sizeof(UINT64), PatternLength - (UINT32)sizeof(UINT64))
+			: 0;
+		UINT64 Value = 0, WordMask = 0;
+		for (UINT32 j = 0; j < sizeof(UINT64) && Offset + j < PatternLength; ++j)
+		{
+			if (Mask != NULL ? Mask[Offset + j] != 0x00 : Pattern[Offset + j] != Wildcard)
+			{
+				Value |= (UINT64)Pattern[Offset + j] << (j * 8);
+				WordMask |= (UINT64)0xFF << (j * 8);
+			}
+		}
+		Matcher->WordOffsets[i] = Offset;
+		Matcher->Values[i] = Value;
+		Matcher->Masks[i] = WordMask;
+	}
+
+	return TRUE;
+}
+
+//
+// Checks a candidate address whose anchor byte is already known to match
+//
+STATIC
+BOOLEAN
+EFIAPI
+IsPatternMatch(
+	IN CONST PATTERN_MATCHER *Matcher,
+	IN CONST UINT8* Address
+	)
+{
+	if (Address[Matcher->SecondAnchor] != Matcher->SecondAnchorByte)
+		return FALSE;
+
+	if (Matcher->NumWords == 0)
+	{
+		for (UINT32 i = 0; i < Matcher->Length; ++i)
+		{
+			if (((Address[i] ^ (UINT8)(Matcher->Values[0] >> (i * 8))) & (UINT8)(Matcher->Masks[0] >> (i * 8))) != 0)
+				return FALSE;
+		}
+		return TRUE;
+	}
+
+	for (UINT32 i = 0; i < Matcher->NumWords; ++i)
+	{
+		if (((ReadUnaligned64((CONST UINT64*)(Address + Matcher->WordOffsets[i])) ^ Matcher->Values[i]) & Matcher->Masks[i]) != 0)
+			return FALSE;
+	}
+	return TRUE;
+}
+
+//
+// Tests the (up to) eight candidate addresses Start + Index ... Start + Index + 7 that are below Start + NumCandidates.
+// Returns the first matching address, or NULL if there is none
+//
+STATIC
+CONST UINT8*
+EFIAPI
+MatchPatternBlock(
+	IN CONST PATTERN_MATCHER *Matcher,
+	IN CONST UINT8* Start,
+	IN UINTN Index,
+	IN UINTN NumCandidates
+	)
+{
+	CONST UINT8* AnchorStart = Start + Matcher->Anchor;
+
+	if (Index + sizeof(UINT64) > NumCandidates)
+	{
+		// Tail of the range: test one byte at a time so that we do not read past its end
+		for (; Index < NumCandidates; ++Index)
+		{
+			if (AnchorStart[Index] == Matcher->AnchorByte && IsPatternMatch(Matcher, Start + Index))
+				return Start + Index;
+		}
+		return NULL;
+	}
+
+	// Test eight anchor positions at once. Zero has a 0 byte wherever the anchor byte occurs, and (x - 0x01..) & ~x & 0x80..
+	// sets the high bit of every 0 byte. Bytes above a 0 byte may also be flagged, but these are filtered out by IsPatternMatch
+	CONST UINT64 Zero = ReadUnaligned64((CONST UINT64*)(AnchorStart + Index)) ^ Matcher->AnchorBytes;
+	UINT64 Hits = (Zero - 0x0101010101010101ULL) & ~Zero & 0x8080808080808080ULL;
+	while (Hits != 0)
+	{
+		CONST UINT8* Address = Start + Index + (UINTN)(LowBitSet64(Hits) >> 3);
+		if (IsPatternMatch(Matcher, Address))
+			return Address;
+		Hits &= Hits - 1;
+	}
+	return NULL;
+}
+
+//
+// Searches for the first match of an initialized matcher in [Base, Base + Size)
+//
+STATIC
+EFI_STATUS
+EFIAPI
+FindPatternWithMatcher(
+	IN CONST PATTERN_MATCHER *Matcher,
 	IN CONST VOID* Base,
 	IN UINT32 Size,
 	OUT VOID **Found
 	)
 {
-	if (Found == NULL || Pattern == NULL || Base == NULL)
-		return EFI_INVALID_PARAMETER;
+	// Candidate start addresses are [Base, Base + Size - PatternLength)
+	if (Size <= Matcher->Length)
+		return EFI_NOT_FOUND;
+	CONST UINTN NumCandidates = Size - Matcher->Length;
 
-	*Found = NULL;
+	for (UINTN i = 0; i < NumCandidates; i += sizeof(UINT64))
+	{
+		CONST UINT8* Address = MatchPatternBlock(Matcher, (CONST UINT8*)Base, i, NumCandidates);
+		if (Address != NULL)
+		{
+			*Found = (VOID*)Address;
+			return EFI_SUCCESS;
+		}
+	}
 
-	for (UINT8 *Address = (UINT8*)Base; Address < (UINT8*)((UINTN)Base + Size - PatternLength); ++Address)
+	return EFI_NOT_FOUND;
+}
+
+//
+// Finds a pattern that is too long for a single matcher (such as a UTF-16 string) by searching for its first
+// PATTERN_MAX_WORDS * 8 bytes with a matcher, and comparing the remainder only where the prefix matches
+//
+STATIC
+EFI_STATUS
+EFIAPI
+FindLongPattern(
+	IN CONST UINT8* Pattern,
+	IN UINT8 Wildcard,
+	IN UINT32 PatternLength,
+	IN CONST VOID* Base,
+	IN UINT32 Size,
+	OUT VOID **Found
+	)
+{
+	CONST UINT32 PrefixLength = PATTERN_MAX_WORDS * sizeof(UINT64);
+	PATTERN_MATCHER Matcher;
+	if (Size <= PatternLength || !InitializePatternMatcher(Pattern, NULL, Wildcard, PrefixLength, &Matcher))
+		return FindPatternBytewise(Pattern, Wildcard, PatternLength, Base, Size, Found);
+
+	// Shrink the buffer so that the prefix search yields the same candidate start addresses as a search for the full pattern
+	CONST UINT8* Start = (CONST UINT8*)Base;
+	CONST UINT8* End = Start + Size - PatternLength + PrefixLength;
+	while (Start < End)
 	{
+		VOID* Candidate;
+		if (EFI_ERROR(FindPatternWithMatcher(&Matcher, Start, (UINT32)(End - Start), &Candidate)))
+			break;
+
+		CONST UINT8* Address = (CONST UINT8*)Candidate;
 		UINT32 i;
-		for (i = 0; i < PatternLength; ++i)
+		for (i = PrefixLength; i < PatternLength; ++i)
 		{
-			if (Pattern[i] != Wildcard && (*(Address + i) != Pattern[i]))
+			if (Pattern[i] != Wildcard && Address[i] != Pattern[i])
 				break;
 		}
 
@@ -277,16 +797,19 @@ FindPattern(
 			*Found = (VOID*)Address;
 			return EFI_SUCCESS;
 		}
+
+		Start = Address + 1;
 	}
 
 	return EFI_NOT_FOUND;
 }
 
-// For debugging non-working signatures. Not that I would ever need to do such a thing of course. Ha ha... ha
+// Finds a byte pattern by searching for its least common byte eight bytes at a time, and only comparing the full
+// pattern at addresses where that byte occurs. The search order is the same as a plain byte-by-byte loop, so the first match is returned.
 // TODO: #ifdef EFI_DEBUG, this should keep a match count and continue until the end of the buffer, then ASSERT(MatchCount == 1)
 EFI_STATUS
 EFIAPI
-FindPatternVerbose(
+FindPattern(
 	IN CONST UINT8* Pattern,
 	IN UINT8 Wildcard,
 	IN UINT32 PatternLength,
@@ -300,19 +823,531 @@ FindPatternVerbose(
 
 	*Found = NULL;
 
-	CONST UINTN Start = (UINTN)Base;
-	CONST UINTN End = Start + Size - PatternLength;
-	EFI_STATUS Status = EFI_NOT_FOUND;
+	if (PatternLength > PATTERN_MAX_WORDS * sizeof(UINT64))
+		return FindLongPattern(Pattern, Wildcard, PatternLength, Base, Size, Found);
 
-	UINT32 Max = 0;
-	UINT8 *AddrOfMax = NULL;
+	PATTERN_MATCHER Matcher;
+	if (!InitializePatternMatcher(Pattern, NULL, Wildcard, PatternLength, &Matcher))
+		return FindPatternBytewise(Pattern, Wildcard, PatternLength, Base, Size, Found);
 
-	for (UINT8 *Address = (UINT8*)Start; Address < (UINT8*)End; ++Address)
+	return FindPatternWithMatcher(&Matcher, Base, Size, Found);
+}
+
+//
+// Builds the matcher of a signature on first use. Signatures that are unsuitable for an anchored search get a matcher Length of 0
+//
+STATIC
+VOID
+EFIAPI
+InitializeSignatureMatcher(
+	IN OUT PBYTE_SIGNATURE Signature
+	)
+{
+	if (!Signature->Initialized)
+	{
+		if (!InitializePatternMatcher(Signature->Pattern, Signature->Mask, Signature->Wildcard, Signature->PatternLength, &Signature->Matcher))
+			Signature->Matcher.Length = 0;
+		Signature->Initialized = TRUE;
+	}
+}
+
+// Same as FindPattern, except that the matcher is only built once per signature. Signatures that are unsuitable
+// for an anchored search have a matcher Length of 0 and are compared byte by byte
+EFI_STATUS
+EFIAPI
+FindSignature(
+	IN OUT PBYTE_SIGNATURE Signature,
+	IN CONST VOID* Base,
+	IN UINT32 Size,
+	OUT VOID **Found
+	)
+{
+	if (Found == NULL || Signature == NULL || Signature->Pattern == NULL || Base == NULL)
+		return EFI_INVALID_PARAMETER;
+
+	*Found = NULL;
+
+	InitializeSignatureMatcher(Signature);
+
+	if (Signature->Matcher.Length != 0)
+		return FindPatternWithMatcher(&Signature->Matcher, Base, Size, Found);
+
+	if (Signature->Mask == NULL)
+		return FindPatternBytewise(Signature->Pattern, Signature->Wildcard, Signature->PatternLength, Base, Size, Found);
+
+	for (UINT8 *Address = (UINT8*)Base; Address < (UINT8*)((UINTN)Base + Size - Signature->PatternLength); ++Address)
 	{
 		UINT32 i;
-		for (i = 0; i < PatternLength; ++i)
+		for (i = 0; i < Signature->PatternLength; ++i)
 		{
-			if (Pattern[i] != Wildcard  && (*(Address + i) != Pattern[i]))
+			if (Signature->Mask[i] != 0x00 && (*(Address + i) != Signature->Pattern[i]))
+				break;
+		}
+
+		if (i == Signature->PatternLength)
+		{
+			*Found = (VOID*)Address;
+			return EFI_SUCCESS;
+		}
+	}
+
+	return EFI_NOT_FOUND;
+}
+
+//
+// Processes one chunk of a scan job
+//
+typedef
+VOID
+(EFIAPI *SCAN_CHUNK_ROUTINE)(
+	IN OUT VOID* Context,
+	IN UINT32 Chunk
+	);
+
+typedef struct _SCAN_JOB
+{
+	SCAN_CHUNK_ROUTINE Routine;
+	VOID* Context;
+	UINT32 NumChunks;
+	volatile UINT32 NextChunk;
+} SCAN_JOB, *PSCAN_JOB;
+
+//
+// Claims and processes chunks of a job until there are none left. This runs on all processors of a scheduler at once
+//
+STATIC
+VOID
+EFIAPI
+ScanJobWorker(
+	IN OUT VOID* Argument
+	)
+{
+	CONST PSCAN_JOB Job = (PSCAN_JOB)Argument;
+	while (TRUE)
+	{
+		CONST UINT32 Chunk = InterlockedIncrement(&Job->NextChunk) - 1;
+		if (Chunk >= Job->NumChunks)
+			break;
+
+		Job->Routine(Job->Context, Chunk);
+	}
+}
+
+//
+// Processes all chunks of a job and returns when they are done. Without a scheduler, the chunks are processed in ascending order
+//
+STATIC
+VOID
+EFIAPI
+RunScanJob(
+	IN CONST SCAN_SCHEDULER* Scheduler OPTIONAL,
+	IN SCAN_CHUNK_ROUTINE Routine,
+	IN OUT VOID* Context,
+	IN UINT32 NumChunks
+	)
+{
+	SCAN_JOB Job = { Routine, Context, NumChunks, 0 };
+	if (Scheduler != NULL && Scheduler->RunOnProcessors != NULL && NumChunks > 1)
+	{
+		CONST EFI_STATUS Status = Scheduler->RunOnProcessors(Scheduler->Platform, ScanJobWorker, &Job);
+		if (EFI_ERROR(Status))
+			ConsolePrint(L"    Parallel scan failed to start (%llx). Scanning on the boot processor only.\r\n", Status);
+	}
+
+	// Process any chunks that were not claimed by another processor, e.g. because none could be started
+	ScanJobWorker(&Job);
+}
+
+//
+// Returns the number of chunks to split Size bytes of work into, or 1 if it should not be split
+//
+STATIC
+UINT32
+EFIAPI
+GetNumScanChunks(
+	IN CONST SCAN_SCHEDULER* Scheduler OPTIONAL,
+	IN UINTN Size,
+	IN UINTN MinChunkSize
+	)
+{
+	if (Scheduler == NULL || Scheduler->RunOnProcessors == NULL || Scheduler->NumProcessors < 2)
+		return 1;
+
+	// Use a few chunks per processor, so that processors that finish early can take over some of the work of the others
+	CONST UINTN NumChunks = MIN(MIN(Size / MinChunkSize, (UINTN)Scheduler->NumProcessors * 4), SCAN_MAX_CHUNKS);
+	return NumChunks > 1 ? (UINT32)NumChunks : 1;
+}
+
+#if EFIGUARD_PARALLEL_SCAN
+
+// The APs are started in non-blocking mode, so that the BSP can work on the job too. The MP driver signals the wait event
+// from a timer callback once all APs have finished, which needs the TPL to be below TPL_NOTIFY while waiting
+STATIC
+EFI_STATUS
+EFIAPI
+RunOnApplicationProcessors(
+	IN VOID* Platform,
+	IN SCAN_WORKER Worker,
+	IN OUT VOID* Argument
+	)
+{
+	EFI_MP_SERVICES_PROTOCOL* MpServices = (EFI_MP_SERVICES_PROTOCOL*)Platform;
+	EFI_EVENT WaitEvent;
+	EFI_STATUS Status = gBS->CreateEvent(0, TPL_CALLBACK, NULL, NULL, &WaitEvent);
+	if (EFI_ERROR(Status))
+		return Status;
+
+	Status = MpServices->StartupAllAPs(MpServices,
+										(EFI_AP_PROCEDURE)Worker,
+										FALSE,
+										WaitEvent,
+										0,
+										Argument,
+										NULL);
+	if (EFI_ERROR(Status))
+	{
+		gBS->CloseEvent(WaitEvent);
+		return Status;
+	}
+
+	Worker(Argument);
+
+	// WaitForEvent() is only allowed at TPL_APPLICATION. At a higher TPL, poll the event instead
+	UINTN Index;
+	if (EFI_ERROR(gBS->WaitForEvent(1, &WaitEvent, &Index)))
+	{
+		while (gBS->CheckEvent(WaitEvent) == EFI_NOT_READY)
+			CpuPause();
+	}
+
+	gBS->CloseEvent(WaitEvent);
+	return EFI_SUCCESS;
+}
+
+#endif
+
+EFI_STATUS
+EFIAPI
+InitializeScanScheduler(
+	OUT PSCAN_SCHEDULER Scheduler
+	)
+{
+	ZeroMem(Scheduler, sizeof(*Scheduler));
+
+#if EFIGUARD_PARALLEL_SCAN
+	EFI_MP_SERVICES_PROTOCOL* MpServices;
+	EFI_STATUS Status = gBS->LocateProtocol(&gEfiMpServiceProtocolGuid,
+											NULL,
+											(VOID**)&MpServices);
+	if (EFI_ERROR(Status))
+		return Status;
+
+	UINTN NumProcessors, NumEnabledProcessors;
+	Status = MpServices->GetNumberOfProcessors(MpServices, &NumProcessors, &NumEnabledProcessors);
+	if (EFI_ERROR(Status))
+		return Status;
+	if (NumEnabledProcessors < 2)
+		return EFI_UNSUPPORTED;
+
+	// The BSP works on each job together with the APs (see RunOnApplicationProcessors), so it is counted
+	Scheduler->RunOnProcessors = RunOnApplicationProcessors;
+	Scheduler->Platform = MpServices;
+	Scheduler->NumProcessors = (UINT32)NumEnabledProcessors;
+	return EFI_SUCCESS;
+#else
+	return EFI_UNSUPPORTED;
+#endif
+}
+
+typedef struct _SIGNATURE_SCAN
+{
+	CONST PATTERN_MATCHER* Matcher;
+	CONST UINT8* Base;
+	UINTN NumCandidates;
+	UINTN ChunkSize;						// Number of candidate start addresses per chunk
+	volatile UINT32 FirstChunkFound;		// Lowest chunk with a match so far, or MAX_UINT32
+	CONST UINT8* Found[SCAN_MAX_CHUNKS];
+} SIGNATURE_SCAN, *PSIGNATURE_SCAN;
+
+STATIC
+VOID
+EFIAPI
+ScanSignatureChunk(
+	IN OUT VOID* Context,
+	IN UINT32 Chunk
+	)
+{
+	CONST PSIGNATURE_SCAN Scan = (PSIGNATURE_SCAN)Context;
+
+	// A match in a higher chunk than one that already has a match can never be the first
+	if (Chunk > Scan->FirstChunkFound)
+		return;
+
+	// Each chunk is searched up to its last candidate plus the pattern length, so chunks overlap by the pattern length
+	CONST UINTN Start = Chunk * Scan->ChunkSize;
+	CONST UINTN End = MIN(Start + Scan->ChunkSize, Scan->NumCandidates);
+	VOID* Found;
+	if (Start >= End ||
+		EFI_ERROR(FindPatternWithMatcher(Scan->Matcher, Scan->Base + Start, (UINT32)(End - Start + Scan->Matcher->Length), &Found)))
+		return;
+
+	Scan->Found[Chunk] = (CONST UINT8*)Found;
+
+	UINT32 FirstChunkFound = Scan->FirstChunkFound;
+	while (Chunk < FirstChunkFound)
+	{
+		CONST UINT32 Previous = InterlockedCompareExchange32(&Scan->FirstChunkFound, FirstChunkFound, Chunk);
+		if (Previous == FirstChunkFound)
+			break;
+		FirstChunkFound = Previous;
+	}
+}
+
+EFI_STATUS
+EFIAPI
+FindSignatureParallel(
+	IN CONST SCAN_SCHEDULER* Scheduler OPTIONAL,
+	IN OUT PBYTE_SIGNATURE Signature,
+	IN CONST VOID* Base,
+	IN UINT32 Size,
+	OUT VOID **Found
+	)
+{
+	if (Found == NULL || Signature == NULL || Signature->Pattern == NULL || Base == NULL)
+		return EFI_INVALID_PARAMETER;
+
+	// Build the matcher here, so that it is not built by multiple processors at once
+	InitializeSignatureMatcher(Signature);
+
+	CONST UINT32 NumChunks = Signature->Matcher.Length != 0 && Size > Signature->Matcher.Length
+		? GetNumScanChunks(Scheduler, Size, SCAN_MIN_CHUNK_SIZE)
+		: 1;
+	if (NumChunks == 1)
+		return FindSignature(Signature, Base, Size, Found);
+
+	*Found = NULL;
+
+	SIGNATURE_SCAN Scan;
+	ZeroMem(&Scan, sizeof(Scan));
+	Scan.Matcher = &Signature->Matcher;
+	Scan.Base = (CONST UINT8*)Base;
+	Scan.NumCandidates = Size - Signature->Matcher.Length;
+	Scan.ChunkSize = (Scan.NumCandidates + NumChunks - 1) / NumChunks;
+	Scan.FirstChunkFound = MAX_UINT32;
+
+	RunScanJob(Scheduler, ScanSignatureChunk, &Scan, NumChunks);
+
+	if (Scan.FirstChunkFound == MAX_UINT32)
+		return EFI_NOT_FOUND;
+
+	*Found = (VOID*)Scan.Found[Scan.FirstChunkFound];
+	return EFI_SUCCESS;
+}
+
+// All patterns advance through the buffer together, one 8 byte block at a time, so that the buffer is only read from memory once
+// regardless of the number of patterns. Patterns that cannot be searched for by anchor byte are handed off to FindPattern.
+EFI_STATUS
+EFIAPI
+FindPatterns(
+	IN OUT PPATTERN_SEARCH Searches,
+	IN UINT32 NumSearches,
+	IN CONST VOID* Base,
+	IN UINT32 Size
+	)
+{
+	if (Searches == NULL || NumSearches == 0 || NumSearches > PATTERN_SEARCH_MAX_PATTERNS || Base == NULL)
+		return EFI_INVALID_PARAMETER;
+
+	PATTERN_MATCHER Matchers[PATTERN_SEARCH_MAX_PATTERNS];
+	UINTN NumCandidates[PATTERN_SEARCH_MAX_PATTERNS];
+	BOOLEAN Pending[PATTERN_SEARCH_MAX_PATTERNS];
+	UINT32 NumPending = 0;
+
+	for (UINT32 i = 0; i < NumSearches; ++i)
+	{
+		if (Searches[i].Pattern == NULL)
+			return EFI_INVALID_PARAMETER;
+
+		Searches[i].Found = NULL;
+		Pending[i] = FALSE;
+		if (!InitializePatternMatcher(Searches[i].Pattern, NULL, Searches[i].Wildcard, Searches[i].PatternLength, &Matchers[i]))
+		{
+			FindPattern(Searches[i].Pattern, Searches[i].Wildcard, Searches[i].PatternLength, Base, Size, &Searches[i].Found);
+			continue;
+		}
+
+		NumCandidates[i] = Size > Searches[i].PatternLength ? Size - Searches[i].PatternLength : 0;
+		if (NumCandidates[i] > 0)
+		{
+			Pending[i] = TRUE;
+			NumPending++;
+		}
+	}
+
+	for (UINTN Index = 0; NumPending > 0; Index += sizeof(UINT64))
+	{
+		for (UINT32 i = 0; i < NumSearches; ++i)
+		{
+			if (!Pending[i])
+				continue;
+
+			CONST UINT8* Address = MatchPatternBlock(&Matchers[i], (CONST UINT8*)Base, Index, NumCandidates[i]);
+			if (Address != NULL || Index + sizeof(UINT64) >= NumCandidates[i])
+			{
+				// Either found, or this was the last block for this pattern
+				Searches[i].Found = (VOID*)Address;
+				Pending[i] = FALSE;
+				NumPending--;
+			}
+		}
+	}
+
+	for (UINT32 i = 0; i < NumSearches; ++i)
+	{
+		if (Searches[i].Found == NULL)
+			return EFI_NOT_FOUND;
+	}
+	return EFI_SUCCESS;
+}
+
+// Unaligned searches use the same anchored matcher as FindPattern, with a full mask so that every byte of the constant
+// is significant. Aligned searches only need one 8 byte compare per aligned offset
+EFI_STATUS
+EFIAPI
+FindConstantInDataSections(
+	IN CONST UINT8* ImageBase,
+	IN PEFI_IMAGE_NT_HEADERS NtHeaders,
+	IN CONST VOID* Constant,
+	IN UINT32 ConstantSize,
+	IN UINT32 Alignment,
+	OUT VOID **Found
+	)
+{
+	if (Found == NULL || ImageBase == NULL || NtHeaders == NULL || Constant == NULL ||
+		ConstantSize < sizeof(UINT64) || Alignment == 0)
+		return EFI_INVALID_PARAMETER;
+
+	*Found = NULL;
+
+	PATTERN_MATCHER Matcher;
+	BOOLEAN UseMatcher = FALSE;
+	if (Alignment == 1 && ConstantSize <= PATTERN_MAX_WORDS * sizeof(UINT64))
+	{
+		UINT8 Mask[PATTERN_MAX_WORDS * sizeof(UINT64)];
+		SetMem(Mask, ConstantSize, 0xFF);
+		UseMatcher = InitializePatternMatcher((CONST UINT8*)Constant, Mask, 0, ConstantSize, &Matcher);
+	}
+	CONST UINT64 FirstWord = ReadUnaligned64((CONST UINT64*)Constant);
+
+	CONST UINT32 SizeOfImage = HEADER_FIELD(NtHeaders, SizeOfImage);
+	CONST PEFI_IMAGE_SECTION_HEADER SectionHeaders = IMAGE_FIRST_SECTION(NtHeaders);
+	for (UINT16 i = 0; i < NtHeaders->FileHeader.NumberOfSections; ++i)
+	{
+		CONST PEFI_IMAGE_SECTION_HEADER Section = &SectionHeaders[i];
+		if ((Section->Characteristics & EFI_IMAGE_SCN_CNT_INITIALIZED_DATA) == 0 ||
+			(Section->Characteristics & EFI_IMAGE_SCN_MEM_EXECUTE) != 0 ||
+			Section->VirtualAddress >= SizeOfImage)
+			continue;
+
+		CONST UINT8* Base = ImageBase + Section->VirtualAddress;
+		CONST UINT32 Size = MIN(Section->Misc.VirtualSize, SizeOfImage - Section->VirtualAddress);
+
+		if (UseMatcher)
+		{
+			if (!EFI_ERROR(FindPatternWithMatcher(&Matcher, Base, Size, Found)))
+				return EFI_SUCCESS;
+
+			// The matcher stops one byte short of the end like FindPatternBytewise, but a constant may end at the end of a section
+			if (Size >= ConstantSize && CompareMem(Base + Size - ConstantSize, Constant, ConstantSize) == 0)
+			{
+				*Found = (VOID*)(Base + Size - ConstantSize);
+				return EFI_SUCCESS;
+			}
+			continue;
+		}
+
+		// Section RVAs are page aligned, so offsets from the section start have the same alignment as the address
+		for (UINT32 Offset = 0; Offset + ConstantSize <= Size; Offset += Alignment)
+		{
+			if (ReadUnaligned64((CONST UINT64*)(Base + Offset)) == FirstWord &&
+				CompareMem(Base + Offset + sizeof(UINT64), (CONST UINT8*)Constant + sizeof(UINT64), ConstantSize - sizeof(UINT64)) == 0)
+			{
+				*Found = (VOID*)(Base + Offset);
+				return EFI_SUCCESS;
+			}
+		}
+	}
+
+	return EFI_NOT_FOUND;
+}
+
+// Reference implementation of FindPattern. This is used for patterns that cannot be searched for by anchor byte
+EFI_STATUS
+EFIAPI
+FindPatternBytewise(
+	IN CONST UINT8* Pattern,
+	IN UINT8 Wildcard,
+	IN UINT32 PatternLength,
+	IN CONST VOID* Base,
+	IN UINT32 Size,
+	OUT VOID **Found
+	)
+{
+	if (Found == NULL || Pattern == NULL || Base == NULL)
+		return EFI_INVALID_PARAMETER;
+
+	*Found = NULL;
+
+	for (UINT8 *Address = (UINT8*)Base; Address < (UINT8*)((UINTN)Base + Size - PatternLength); ++Address)
+	{
+		UINT32 i;
+		for (i = 0; i < PatternLength; ++i)
+		{
+			if (Pattern[i] != Wildcard && (*(Address + i) != Pattern[i]))
+				break;
+		}
+
+		if (i == PatternLength)
+		{
+			*Found = (VOID*)Address;
+			return EFI_SUCCESS;
+		}
+	}
+
+	return EFI_NOT_FOUND;
+}
+
+// For debugging non-working signatures. Not that I would ever need to do such a thing of course. Ha ha... ha
+// TODO: #ifdef EFI_DEBUG, this should keep a match count and continue until the end of the buffer, then ASSERT(MatchCount == 1)
+EFI_STATUS
+EFIAPI
+FindPatternVerbose(
+	IN CONST UINT8* Pattern,
+	IN UINT8 Wildcard,
+	IN UINT32 PatternLength,
+	IN CONST VOID* Base,
+	IN UINT32 Size,
+	OUT VOID **Found
+	)
+{
+	if (Found == NULL || Pattern == NULL || Base == NULL)
+		return EFI_INVALID_PARAMETER;
+
+	*Found = NULL;
+
+	CONST UINTN Start = (UINTN)Base;
+	CONST UINTN End = Start + Size - PatternLength;
+	EFI_STATUS Status = EFI_NOT_FOUND;
+
+	UINT32 Max = 0;
+	UINT8 *AddrOfMax = NULL;
+
+	for (UINT8 *Address = (UINT8*)Start; Address < (UINT8*)End; ++Address)
+	{
+		UINT32 i;
+		for (i = 0; i < PatternLength; ++i)
+		{
+			if (Pattern[i] != Wildcard  && (*(Address + i) != Pattern[i]))
 				break;
 		}
 
@@ -329,16 +1364,16 @@ FindPatternVerbose(
 		}
 	}
 
-	Print(L"\r\nBest match: %lu/%lu matched at 0x%p\r\n", Max, PatternLength, (VOID*)AddrOfMax);
+	ConsolePrint(L"\r\nBest match: %lu/%lu matched at 0x%p\r\n", Max, PatternLength, (VOID*)AddrOfMax);
 
 	for (UINT32 i = 0; i < PatternLength && AddrOfMax != NULL; ++i)
 	{
 		if (Pattern[i] != Wildcard && (*(AddrOfMax + i) != Pattern[i]))
-			Print(L"[%lu] [X] %02X != %02X\r\n", i, (*(AddrOfMax + i)), Pattern[i]); // Mismatch
+			ConsolePrint(L"[%lu] [X] %02X != %02X\r\n", i, (*(AddrOfMax + i)), Pattern[i]); // Mismatch
 		else if (Pattern[i] == Wildcard)
-			Print(L"[%lu] [ ] %02X\r\n", i, (*(AddrOfMax + i))); // Matched wildcard byte
+			ConsolePrint(L"[%lu] [ ] %02X\r\n", i, (*(AddrOfMax + i))); // Matched wildcard byte
 		else
-			Print(L"[%lu] [v] %02X\r\n", i, Pattern[i]); // Matched exact byte
+			ConsolePrint(L"[%lu] [v] %02X\r\n", i, Pattern[i]); // Matched exact byte
 	}
 
 	return Status;
@@ -413,6 +1448,9 @@ ZydisInit(
 	OUT PZYDIS_CONTEXT Context
 	)
 {
+	Context->InstructionsDecoded = 0;
+	Context->DecodeResyncs = 0;
+
 	ZyanStatus Status;
 	if (!ZYAN_SUCCESS((Status = ZydisDecoderInit(&Context->Decoder,
 										IMAGE64(NtHeaders) ? ZYDIS_MACHINE_MODE_LONG_64 : ZYDIS_MACHINE_MODE_LONG_COMPAT_32,
@@ -435,32 +1473,991 @@ ZydisInit(
 	return ZYAN_STATUS_SUCCESS;
 }
 
-UINT8*
+ZyanStatus
 EFIAPI
-BacktrackToFunctionStart(
-	IN CONST UINT8* ImageBase,
-	IN PEFI_IMAGE_NT_HEADERS NtHeaders,
-	IN CONST UINT8* AddressInFunction
+ZydisDecodeOperands(
+	IN OUT PZYDIS_CONTEXT Context
 	)
 {
-	// Test for null. This allows callers to do 'FindPattern(..., &Address); X = Backtrack(Address, ...)' with a single failure branch
-	if (AddressInFunction == NULL)
-		return NULL;
-	if (NtHeaders->OptionalHeader.NumberOfRvaAndSizes <= EFI_IMAGE_DIRECTORY_ENTRY_EXCEPTION)
-		return NULL;
-
-	CONST PIMAGE_RUNTIME_FUNCTION_ENTRY FunctionTable = (PIMAGE_RUNTIME_FUNCTION_ENTRY)(ImageBase + NtHeaders->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_EXCEPTION].VirtualAddress);
-	CONST UINT32 FunctionTableSize = NtHeaders->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_EXCEPTION].Size;
-	if (FunctionTableSize == 0)
-		return NULL;
+	return ZydisDecoderDecodeOperands(&Context->Decoder,
+									&Context->DecoderContext,
+									&Context->Instruction,
+									Context->Operands,
+									Context->Instruction.operand_count);
+}
 
-	// Do a binary search until we find the function that contains our address
-	CONST UINT32 RelativeAddress = (UINT32)(AddressInFunction - ImageBase);
-	PIMAGE_RUNTIME_FUNCTION_ENTRY FunctionEntry = NULL;
-	INT32 Low = 0;
-	INT32 High = (INT32)(FunctionTableSize / sizeof(IMAGE_RUNTIME_FUNCTION_ENTRY)) - 1;
-	
-	while (High >= Low)
+//
+// Passes the instruction in Context to all matchers that are not done yet
+//
+STATIC
+VOID
+EFIAPI
+RunMatchers(
+	IN OUT PZYDIS_CONTEXT Context,
+	IN OUT PINSTRUCTION_MATCHER Matchers,
+	IN UINT32 NumMatchers,
+	IN OUT UINT32* NumPending
+	)
+{
+	// Only the instruction itself has been decoded at this point; matchers call ZydisDecodeOperands() as needed.
+	// Matchers are called in array order, so a matcher can rely on the state of the ones before it being up to date for this instruction
+	for (UINT32 i = 0; i < NumMatchers; ++i)
+	{
+		if (!Matchers[i].Done && Matchers[i].Match(Context, Matchers[i].State))
+		{
+			Matchers[i].Done = TRUE;
+			(*NumPending)--;
+		}
+	}
+}
+
+//
+// Decodes [Base, Base + Size) and passes each instruction to all matchers that are not done yet, until NumPending reaches 0
+//
+STATIC
+VOID
+EFIAPI
+DecodeRangeAndMatch(
+	IN OUT PZYDIS_CONTEXT Context,
+	IN CONST UINT8* Base,
+	IN UINTN Size,
+	IN OUT PINSTRUCTION_MATCHER Matchers,
+	IN UINT32 NumMatchers,
+	IN OUT UINT32* NumPending
+	)
+{
+	Context->Length = Size;
+	Context->Offset = 0;
+
+	// Start decode loop
+	ZyanStatus Status;
+	while ((Context->InstructionAddress = (ZyanU64)(Base + Context->Offset),
+			Status = ZydisDecoderDecodeInstruction(&Context->Decoder,
+													&Context->DecoderContext,
+													(VOID*)Context->InstructionAddress,
+													Context->Length - Context->Offset,
+													&Context->Instruction)) != ZYDIS_STATUS_NO_MORE_DATA)
+	{
+		if (!ZYAN_SUCCESS(Status))
+		{
+			Context->DecodeResyncs++;
+			Context->Offset++;
+			continue;
+		}
+
+		Context->InstructionsDecoded++;
+		RunMatchers(Context, Matchers, NumMatchers, NumPending);
+		if (*NumPending == 0)
+			return;
+
+		Context->Offset += Context->Instruction.length;
+	}
+}
+
+EFI_STATUS
+EFIAPI
+DecodeAndMatch(
+	IN OUT PZYDIS_CONTEXT Context,
+	IN CONST UINT8* Base,
+	IN UINTN Size,
+	IN OUT PINSTRUCTION_MATCHER Matchers,
+	IN UINT32 NumMatchers
+	)
+{
+	if (Context == NULL || Base == NULL || Matchers == NULL || NumMatchers == 0)
+		return EFI_INVALID_PARAMETER;
+
+	UINT32 NumPending = NumMatchers;
+	for (UINT32 i = 0; i < NumMatchers; ++i)
+		Matchers[i].Done = FALSE;
+
+	DecodeRangeAndMatch(Context, Base, Size, Matchers, NumMatchers, &NumPending);
+
+	return NumPending == 0 ? EFI_SUCCESS : EFI_NOT_FOUND;
+}
+
+EFI_STATUS
+EFIAPI
+DecodeFunctionsAndMatch(
+	IN OUT PZYDIS_CONTEXT Context,
+	IN CONST UINT8* ImageBase,
+	IN PEFI_IMAGE_NT_HEADERS NtHeaders,
+	IN CONST UINT8* Base,
+	IN UINTN Size,
+	IN OUT PINSTRUCTION_MATCHER Matchers,
+	IN UINT32 NumMatchers
+	)
+{
+	if (Context == NULL || Base == NULL || Matchers == NULL || NumMatchers == 0)
+		return EFI_INVALID_PARAMETER;
+
+	FUNCTION_ITERATOR Iterator;
+	if (EFI_ERROR(InitializeFunctionIterator(ImageBase, NtHeaders, Base, Size, &Iterator)))
+		return DecodeAndMatch(Context, Base, Size, Matchers, NumMatchers);
+
+	UINT32 NumPending = NumMatchers;
+	for (UINT32 i = 0; i < NumMatchers; ++i)
+		Matchers[i].Done = FALSE;
+
+	CONST UINT8* FunctionStart;
+	UINTN FunctionSize;
+	while (NumPending > 0 && GetNextFunction(&Iterator, &FunctionStart, &FunctionSize))
+	{
+		// Do not decode past the end of the range if the last function extends beyond it
+		if (FunctionStart + FunctionSize > Base + Size)
+			FunctionSize = (UINTN)(Base + Size - FunctionStart);
+
+		DecodeRangeAndMatch(Context, FunctionStart, FunctionSize, Matchers, NumMatchers, &NumPending);
+	}
+
+	return NumPending == 0 ? EFI_SUCCESS : EFI_NOT_FOUND;
+}
+
+EFI_STATUS
+EFIAPI
+InitializeFunctionIterator(
+	IN CONST UINT8* ImageBase,
+	IN PEFI_IMAGE_NT_HEADERS NtHeaders,
+	IN CONST UINT8* Base,
+	IN UINTN Size,
+	OUT PFUNCTION_ITERATOR Iterator
+	)
+{
+	if (!IMAGE64(NtHeaders) || NtHeaders->OptionalHeader.NumberOfRvaAndSizes <= EFI_IMAGE_DIRECTORY_ENTRY_EXCEPTION)
+		return EFI_NOT_FOUND;
+
+	CONST IMAGE_RUNTIME_FUNCTION_ENTRY* FunctionTable = (CONST IMAGE_RUNTIME_FUNCTION_ENTRY*)(ImageBase + NtHeaders->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_EXCEPTION].VirtualAddress);
+	CONST UINT32 NumFunctions = NtHeaders->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_EXCEPTION].Size / sizeof(IMAGE_RUNTIME_FUNCTION_ENTRY);
+	if (NumFunctions == 0)
+		return EFI_NOT_FOUND;
+
+	// The table is sorted by address, so find the first function starting at or after StartRva and EndRva with a binary search
+	CONST UINT32 StartRva = (UINT32)(Base - ImageBase);
+	CONST UINT32 EndRva = (UINT32)(Base + Size - ImageBase);
+	UINT32 Low = 0, High = NumFunctions;
+	while (Low < High)
+	{
+		CONST UINT32 Middle = (Low + High) >> 1;
+		if (FunctionTable[Middle].BeginAddress < StartRva)
+			Low = Middle + 1;
+		else
+			High = Middle;
+	}
+	Iterator->Entry = &FunctionTable[Low];
+
+	High = NumFunctions;
+	while (Low < High)
+	{
+		CONST UINT32 Middle = (Low + High) >> 1;
+		if (FunctionTable[Middle].BeginAddress < EndRva)
+			Low = Middle + 1;
+		else
+			High = Middle;
+	}
+	Iterator->EndEntry = &FunctionTable[Low];
+	Iterator->ImageBase = ImageBase;
+
+	return EFI_SUCCESS;
+}
+
+BOOLEAN
+EFIAPI
+GetNextFunction(
+	IN OUT PFUNCTION_ITERATOR Iterator,
+	OUT CONST UINT8** FunctionStart,
+	OUT UINTN* FunctionSize
+	)
+{
+	// Skip any invalid entries
+	while (Iterator->Entry < Iterator->EndEntry && Iterator->Entry->EndAddress <= Iterator->Entry->BeginAddress)
+		Iterator->Entry++;
+
+	if (Iterator->Entry >= Iterator->EndEntry)
+		return FALSE;
+
+	*FunctionStart = Iterator->ImageBase + Iterator->Entry->BeginAddress;
+	*FunctionSize = Iterator->Entry->EndAddress - Iterator->Entry->BeginAddress;
+	Iterator->Entry++;
+	return TRUE;
+}
+
+//
+// Decoding position for DecodeSitesAndMatch(). Sites are visited in ascending order, so consecutive sites in the same
+// function continue decoding where the previous one stopped
+//
+typedef struct _SITE_DECODER
+{
+	CONST UINT8* ImageBase;
+	CONST IMAGE_RUNTIME_FUNCTION_ENTRY* FunctionTable;
+	UINT32 NumFunctions;
+	CONST UINT8* FunctionStart;				// Exception table entry containing the previous site, or NULL
+	CONST UINT8* FunctionEnd;
+	CONST UINT8* Next;						// Next instruction to decode in [FunctionStart, FunctionEnd)
+} SITE_DECODER, *PSITE_DECODER;
+
+STATIC
+EFI_STATUS
+EFIAPI
+InitializeSiteDecoder(
+	IN CONST UINT8* ImageBase,
+	IN PEFI_IMAGE_NT_HEADERS NtHeaders,
+	OUT PSITE_DECODER Decoder
+	)
+{
+	if (!IMAGE64(NtHeaders) || NtHeaders->OptionalHeader.NumberOfRvaAndSizes <= EFI_IMAGE_DIRECTORY_ENTRY_EXCEPTION)
+		return EFI_NOT_FOUND;
+
+	Decoder->ImageBase = ImageBase;
+	Decoder->FunctionTable = (CONST IMAGE_RUNTIME_FUNCTION_ENTRY*)(ImageBase + NtHeaders->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_EXCEPTION].VirtualAddress);
+	Decoder->NumFunctions = NtHeaders->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_EXCEPTION].Size / sizeof(IMAGE_RUNTIME_FUNCTION_ENTRY);
+	Decoder->FunctionStart = NULL;
+	Decoder->FunctionEnd = NULL;
+	Decoder->Next = NULL;
+
+	return Decoder->NumFunctions > 0 ? EFI_SUCCESS : EFI_NOT_FOUND;
+}
+
+//
+// Decodes the function containing Site through the instruction that contains Site. Sites found by FindReferencesTo() may
+// be one byte off from the instruction start in either direction, depending on whether the byte before the opcode was
+// taken as a REX prefix. So an instruction starting at Site + SITE_START_SLACK is also decoded
+//
+#define SITE_START_SLACK		1
+
+STATIC
+VOID
+EFIAPI
+DecodeToSite(
+	IN OUT PZYDIS_CONTEXT Context,
+	IN OUT PSITE_DECODER Decoder,
+	IN CONST UINT8* Site,
+	IN OUT PINSTRUCTION_MATCHER Matchers,
+	IN UINT32 NumMatchers,
+	IN OUT UINT32* NumPending
+	)
+{
+	if (Decoder->FunctionStart != NULL && Site >= Decoder->FunctionStart && Site < Decoder->FunctionEnd)
+	{
+		// Already seen while decoding up to an earlier site?
+		if (Site < Decoder->Next)
+			return;
+	}
+	else
+	{
+		// Find the entry containing the site. This deliberately does not follow chained entries like BacktrackToFunctionStart()
+		// does, since the code of a chained entry is not contiguous with its parent. Its start is still an instruction boundary
+		CONST UINT32 Rva = (UINT32)(Site - Decoder->ImageBase);
+		UINT32 Low = 0, High = Decoder->NumFunctions;
+		while (Low < High)
+		{
+			CONST UINT32 Middle = (Low + High) >> 1;
+			if (Decoder->FunctionTable[Middle].BeginAddress <= Rva)
+				Low = Middle + 1;
+			else
+				High = Middle;
+		}
+		if (Low == 0 || Rva >= Decoder->FunctionTable[Low - 1].EndAddress)
+			return; // Not in any function
+
+		Decoder->FunctionStart = Decoder->ImageBase + Decoder->FunctionTable[Low - 1].BeginAddress;
+		Decoder->FunctionEnd = Decoder->ImageBase + Decoder->FunctionTable[Low - 1].EndAddress;
+		Decoder->Next = Decoder->FunctionStart;
+	}
+
+	Context->Length = (ZyanUSize)(Decoder->FunctionEnd - Decoder->FunctionStart);
+	while (Decoder->Next <= Site + SITE_START_SLACK && Decoder->Next < Decoder->FunctionEnd && *NumPending > 0)
+	{
+		Context->Offset = (ZyanUSize)(Decoder->Next - Decoder->FunctionStart);
+		Context->InstructionAddress = (ZyanU64)Decoder->Next;
+		CONST ZyanStatus Status = ZydisDecoderDecodeInstruction(&Context->Decoder,
+																&Context->DecoderContext,
+																(VOID*)Context->InstructionAddress,
+																Context->Length - Context->Offset,
+																&Context->Instruction);
+		if (!ZYAN_SUCCESS(Status))
+		{
+			Context->DecodeResyncs++;
+			Decoder->Next++;
+			continue;
+		}
+
+		Context->InstructionsDecoded++;
+		RunMatchers(Context, Matchers, NumMatchers, NumPending);
+		Decoder->Next += Context->Instruction.length;
+	}
+}
+
+EFI_STATUS
+EFIAPI
+DecodeSitesAndMatch(
+	IN OUT PZYDIS_CONTEXT Context,
+	IN CONST UINT8* ImageBase,
+	IN PEFI_IMAGE_NT_HEADERS NtHeaders,
+	IN CONST UINT8* CONST* Sites,
+	IN UINTN NumSites,
+	IN OUT PINSTRUCTION_MATCHER Matchers,
+	IN UINT32 NumMatchers
+	)
+{
+	if (Context == NULL || Sites == NULL || Matchers == NULL || NumMatchers == 0)
+		return EFI_INVALID_PARAMETER;
+
+	SITE_DECODER Decoder;
+	if (EFI_ERROR(InitializeSiteDecoder(ImageBase, NtHeaders, &Decoder)))
+		return EFI_NOT_FOUND;
+
+	UINT32 NumPending = NumMatchers;
+	for (UINT32 i = 0; i < NumMatchers; ++i)
+		Matchers[i].Done = FALSE;
+
+	for (UINTN i = 0; i < NumSites && NumPending > 0; ++i)
+	{
+		if (Sites[i] != NULL)
+			DecodeToSite(Context, &Decoder, Sites[i], Matchers, NumMatchers, &NumPending);
+	}
+
+	return NumPending == 0 ? EFI_SUCCESS : EFI_NOT_FOUND;
+}
+
+EFI_STATUS
+EFIAPI
+DecodeSignatureSitesAndMatch(
+	IN OUT PZYDIS_CONTEXT Context,
+	IN CONST UINT8* ImageBase,
+	IN PEFI_IMAGE_NT_HEADERS NtHeaders,
+	IN OUT PBYTE_SIGNATURE Signature,
+	IN CONST UINT8* Base,
+	IN UINTN Size,
+	IN OUT PINSTRUCTION_MATCHER Matchers,
+	IN UINT32 NumMatchers
+	)
+{
+	if (Context == NULL || Signature == NULL || Signature->Pattern == NULL || Base == NULL || Matchers == NULL || NumMatchers == 0)
+		return EFI_INVALID_PARAMETER;
+
+	InitializeSignatureMatcher(Signature);
+
+	SITE_DECODER Decoder;
+	if (Signature->Matcher.Length == 0 || EFI_ERROR(InitializeSiteDecoder(ImageBase, NtHeaders, &Decoder)))
+		return DecodeFunctionsAndMatch(Context, ImageBase, NtHeaders, Base, Size, Matchers, NumMatchers);
+
+	UINT32 NumPending = NumMatchers;
+	for (UINT32 i = 0; i < NumMatchers; ++i)
+		Matchers[i].Done = FALSE;
+
+	// Occurrences are found in ascending order, which is the order DecodeToSite() expects
+	CONST UINT8* Start = Base;
+	VOID* Found;
+	while (NumPending > 0 && Start < Base + Size &&
+		!EFI_ERROR(FindPatternWithMatcher(&Signature->Matcher, Start, (UINT32)(Base + Size - Start), &Found)))
+	{
+		DecodeToSite(Context, &Decoder, (CONST UINT8*)Found, Matchers, NumMatchers, &NumPending);
+		Start = (CONST UINT8*)Found + 1;
+	}
+
+	return NumPending == 0 ? EFI_SUCCESS : EFI_NOT_FOUND;
+}
+
+typedef struct _XREF_BUILD_STATE
+{
+	PXREF_INDEX Index;
+	BOOLEAN CanGrow;						// FALSE if this may be running on an AP, which cannot allocate memory
+	EFI_STATUS Status;						// Out
+} XREF_BUILD_STATE, *PXREF_BUILD_STATE;
+
+//
+// Appends every relative reference that can be the subject of an xref query to the index. This matcher only
+// finishes early if the index is full and could not be grown
+//
+STATIC
+BOOLEAN
+EFIAPI
+AddXref(
+	IN OUT PZYDIS_CONTEXT Context,
+	IN OUT VOID *State
+	)
+{
+	CONST PXREF_BUILD_STATE BuildState = (PXREF_BUILD_STATE)State;
+	CONST PXREF_INDEX Index = BuildState->Index;
+
+	// Most instructions have no relative operands at all, so filter these out before decoding operands
+	if ((Context->Instruction.attributes & ZYDIS_ATTRIB_IS_RELATIVE) == 0)
+		return FALSE;
+
+	XREF_KIND Kind;
+	switch (Context->Instruction.mnemonic)
+	{
+		case ZYDIS_MNEMONIC_CALL:
+			Kind = XrefCall;
+			break;
+		case ZYDIS_MNEMONIC_JMP:
+			// Short jumps never leave the function they are in
+			if (Context->Instruction.raw.imm[0].size == 8)
+				return FALSE;
+			Kind = XrefJmp;
+			break;
+		case ZYDIS_MNEMONIC_LEA:
+			Kind = XrefLea;
+			break;
+		default:
+			Kind = XrefMemory;
+			break;
+	}
+
+	if (!ZYAN_SUCCESS(ZydisDecodeOperands(Context)))
+		return FALSE;
+
+	for (UINT8 i = 0; i < Context->Instruction.operand_count_visible; ++i)
+	{
+		// Branch targets are only recorded for call and jmp. Jcc, loop and the like are function-local
+		CONST ZydisDecodedOperand* Operand = &Context->Operands[i];
+		CONST BOOLEAN IsRipRelative = Operand->type == ZYDIS_OPERAND_TYPE_MEMORY && Operand->mem.base == ZYDIS_REGISTER_RIP;
+		CONST BOOLEAN IsBranchTarget = Operand->type == ZYDIS_OPERAND_TYPE_IMMEDIATE && Operand->imm.is_relative == ZYAN_TRUE &&
+			(Kind == XrefCall || Kind == XrefJmp);
+		if (!IsRipRelative && !IsBranchTarget)
+			continue;
+
+		ZyanU64 OperandAddress = 0;
+		if (!ZYAN_SUCCESS(ZydisCalcAbsoluteAddress(&Context->Instruction, Operand, Context->InstructionAddress, &OperandAddress)) ||
+			OperandAddress < (UINTN)Index->ImageBase || OperandAddress - (UINTN)Index->ImageBase > MAX_UINT32)
+			return FALSE;
+
+		if (Index->Count == Index->Capacity)
+		{
+			if (!BuildState->CanGrow)
+			{
+				BuildState->Status = EFI_BUFFER_TOO_SMALL;
+				return TRUE;
+			}
+
+			CONST UINTN NewCapacity = Index->Capacity * 2;
+			CONST PXREF NewXrefs = (PXREF)ReallocatePool(Index->Capacity * sizeof(XREF), NewCapacity * sizeof(XREF), Index->Xrefs);
+			if (NewXrefs == NULL)
+			{
+				BuildState->Status = EFI_OUT_OF_RESOURCES;
+				return TRUE;
+			}
+			Index->Xrefs = NewXrefs;
+			Index->Capacity = NewCapacity;
+		}
+
+		CONST PXREF Xref = &Index->Xrefs[Index->Count++];
+		Xref->TargetRva = (UINT32)(OperandAddress - (UINTN)Index->ImageBase);
+		Xref->SiteRva = (UINT32)(Context->InstructionAddress - (UINTN)Index->ImageBase);
+		Xref->Register = (UINT16)(Context->Operands[0].type == ZYDIS_OPERAND_TYPE_REGISTER
+			? Context->Operands[0].reg.value
+			: ZYDIS_REGISTER_NONE);
+		Xref->Kind = (UINT8)Kind;
+		Xref->Indirect = IsRipRelative;
+		break;
+	}
+
+	return FALSE;
+}
+
+STATIC
+BOOLEAN
+XrefLessThan(
+	IN CONST XREF* A,
+	IN CONST XREF* B
+	)
+{
+	return A->TargetRva < B->TargetRva || (A->TargetRva == B->TargetRva && A->SiteRva < B->SiteRva);
+}
+
+STATIC
+VOID
+SiftDownXref(
+	IN OUT PXREF Xrefs,
+	IN UINTN Root,
+	IN UINTN Count
+	)
+{
+	while (TRUE)
+	{
+		UINTN Child = 2 * Root + 1;
+		if (Child >= Count)
+			break;
+		if (Child + 1 < Count && XrefLessThan(&Xrefs[Child], &Xrefs[Child + 1]))
+			Child++;
+		if (!XrefLessThan(&Xrefs[Root], &Xrefs[Child]))
+			break;
+
+		CONST XREF Temp = Xrefs[Root];
+		Xrefs[Root] = Xrefs[Child];
+		Xrefs[Child] = Temp;
+		Root = Child;
+	}
+}
+
+//
+// Heap sort. In-place and non-recursive, so it does not need any memory or stack beyond what the index already has
+//
+STATIC
+VOID
+SortXrefs(
+	IN OUT PXREF Xrefs,
+	IN UINTN Count
+	)
+{
+	if (Count < 2)
+		return;
+
+	for (UINTN i = Count / 2; i-- > 0; )
+		SiftDownXref(Xrefs, i, Count);
+
+	for (UINTN End = Count - 1; End > 0; --End)
+	{
+		CONST XREF Temp = Xrefs[0];
+		Xrefs[0] = Xrefs[End];
+		Xrefs[End] = Temp;
+		SiftDownXref(Xrefs, 0, End);
+	}
+}
+
+#define XREF_MIN_CHUNK_SIZE		(32 * 1024)
+
+typedef struct _XREF_CHUNK
+{
+	CONST UINT8* Base;						// The chunk holds the functions starting in [Base, Base + Size)
+	UINTN Size;
+	XREF_INDEX Index;
+	EFI_STATUS Status;
+	UINT64 InstructionsDecoded;				// Decode counters of the chunk's copy of the context
+	UINT64 DecodeResyncs;
+} XREF_CHUNK, *PXREF_CHUNK;
+
+typedef struct _XREF_BUILD_JOB
+{
+	CONST ZYDIS_CONTEXT* Context;			// Copied by each chunk, since decoding modifies it
+	CONST UINT8* ImageBase;
+	PEFI_IMAGE_NT_HEADERS NtHeaders;
+	XREF_CHUNK Chunks[SCAN_MAX_CHUNKS];
+} XREF_BUILD_JOB, *PXREF_BUILD_JOB;
+
+//
+// Decodes the functions of one chunk into the chunk's index. This may run on an AP, so the index can not be grown;
+// if it fills up, Status is set to EFI_BUFFER_TOO_SMALL and BuildXrefIndexInChunks() redoes the chunk on the BSP
+//
+STATIC
+VOID
+EFIAPI
+BuildXrefChunk(
+	IN OUT VOID* Context,
+	IN UINT32 Chunk
+	)
+{
+	CONST PXREF_BUILD_JOB Job = (PXREF_BUILD_JOB)Context;
+	CONST PXREF_CHUNK XrefChunk = &Job->Chunks[Chunk];
+
+	ZYDIS_CONTEXT Zydis;
+	CopyMem(&Zydis, Job->Context, sizeof(Zydis));
+
+	XREF_BUILD_STATE BuildState = { &XrefChunk->Index, FALSE, EFI_SUCCESS };
+	INSTRUCTION_MATCHER Matcher = { AddXref, &BuildState, FALSE };
+	Zydis.InstructionsDecoded = 0;
+	Zydis.DecodeResyncs = 0;
+	DecodeFunctionsAndMatch(&Zydis,
+							Job->ImageBase,
+							Job->NtHeaders,
+							XrefChunk->Base,
+							XrefChunk->Size,
+							&Matcher,
+							1);
+	XrefChunk->Status = BuildState.Status;
+	XrefChunk->InstructionsDecoded = Zydis.InstructionsDecoded;
+	XrefChunk->DecodeResyncs = Zydis.DecodeResyncs;
+}
+
+//
+// Splits the functions in the range into chunks at function starts and decodes the chunks in parallel. Each function is
+// decoded by exactly one chunk, and the chunk indices are concatenated in address order, so the result is the same as that of a single pass
+//
+STATIC
+EFI_STATUS
+EFIAPI
+BuildXrefIndexInChunks(
+	IN CONST SCAN_SCHEDULER* Scheduler,
+	IN OUT PZYDIS_CONTEXT Context,
+	IN CONST UINT8* ImageBase,
+	IN PEFI_IMAGE_NT_HEADERS NtHeaders,
+	IN CONST FUNCTION_ITERATOR* Iterator,
+	IN CONST UINT8* Base,
+	IN UINTN Size,
+	IN UINT32 NumChunks,
+	IN OUT PXREF_INDEX Index
+	)
+{
+	XREF_BUILD_JOB Job;
+	ZeroMem(&Job, sizeof(Job));
+	Job.Context = Context;
+	Job.ImageBase = ImageBase;
+	Job.NtHeaders = NtHeaders;
+
+	// Chunk i starts at the first function starting at or after Base + i * Size / NumChunks. Function starts are taken
+	// from the (sorted) exception table, so chunk boundaries never split a function
+	CONST UINT32 StartRva = (UINT32)(Base - ImageBase);
+	CONST UINT8* ChunkStarts[SCAN_MAX_CHUNKS + 1];
+	ChunkStarts[0] = Base;
+	ChunkStarts[NumChunks] = Base + Size;
+	for (UINT32 i = 1; i < NumChunks; ++i)
+	{
+		CONST UINT32 BoundaryRva = StartRva + (UINT32)(i * Size / NumChunks);
+		CONST IMAGE_RUNTIME_FUNCTION_ENTRY* Low = Iterator->Entry;
+		CONST IMAGE_RUNTIME_FUNCTION_ENTRY* High = Iterator->EndEntry;
+		while (Low < High)
+		{
+			CONST IMAGE_RUNTIME_FUNCTION_ENTRY* Middle = Low + (High - Low) / 2;
+			if (Middle->BeginAddress < BoundaryRva)
+				Low = Middle + 1;
+			else
+				High = Middle;
+		}
+		ChunkStarts[i] = Low < Iterator->EndEntry ? ImageBase + Low->BeginAddress : Base + Size;
+	}
+
+	EFI_STATUS Status = EFI_SUCCESS;
+	for (UINT32 i = 0; i < NumChunks; ++i)
+	{
+		CONST PXREF_CHUNK Chunk = &Job.Chunks[i];
+		Chunk->Base = ChunkStarts[i];
+		Chunk->Size = (UINTN)(ChunkStarts[i + 1] - ChunkStarts[i]);
+
+		// The APs can not allocate memory, so reserve twice the usual estimate of one reference per 32 bytes of code up front
+		Chunk->Index.ImageBase = ImageBase;
+		Chunk->Index.Capacity = MAX(Chunk->Size / 16, 256);
+		Chunk->Index.Xrefs = (PXREF)AllocatePool(Chunk->Index.Capacity * sizeof(XREF));
+		if (Chunk->Index.Xrefs == NULL)
+		{
+			Status = EFI_OUT_OF_RESOURCES;
+			goto Exit;
+		}
+	}
+
+	RunScanJob(Scheduler, BuildXrefChunk, &Job, NumChunks);
+
+	// The chunks decoded copies of the context, so add their counters to it
+	for (UINT32 i = 0; i < NumChunks; ++i)
+	{
+		Context->InstructionsDecoded += Job.Chunks[i].InstructionsDecoded;
+		Context->DecodeResyncs += Job.Chunks[i].DecodeResyncs;
+	}
+
+	UINTN Count = 0;
+	for (UINT32 i = 0; i < NumChunks; ++i)
+	{
+		CONST PXREF_CHUNK Chunk = &Job.Chunks[i];
+		if (Chunk->Status == EFI_BUFFER_TOO_SMALL)
+		{
+			// Redo the chunk on this processor, where the index can be grown
+			Chunk->Index.Count = 0;
+			XREF_BUILD_STATE BuildState = { &Chunk->Index, TRUE, EFI_SUCCESS };
+			INSTRUCTION_MATCHER Matcher = { AddXref, &BuildState, FALSE };
+			DecodeFunctionsAndMatch(Context,
+									ImageBase,
+									NtHeaders,
+									Chunk->Base,
+									Chunk->Size,
+									&Matcher,
+									1);
+			Chunk->Status = BuildState.Status;
+		}
+		if (EFI_ERROR(Chunk->Status))
+		{
+			Status = Chunk->Status;
+			goto Exit;
+		}
+		Count += Chunk->Index.Count;
+	}
+
+	Index->ImageBase = ImageBase;
+	Index->Count = 0;
+	Index->Capacity = MAX(Count, 1);
+	Index->Xrefs = (PXREF)AllocatePool(Index->Capacity * sizeof(XREF));
+	if (Index->Xrefs == NULL)
+	{
+		Index->Capacity = 0;
+		Status = EFI_OUT_OF_RESOURCES;
+		goto Exit;
+	}
+
+	for (UINT32 i = 0; i < NumChunks; ++i)
+	{
+		CopyMem(&Index->Xrefs[Index->Count], Job.Chunks[i].Index.Xrefs, Job.Chunks[i].Index.Count * sizeof(XREF));
+		Index->Count += Job.Chunks[i].Index.Count;
+	}
+
+	SortXrefs(Index->Xrefs, Index->Count);
+
+Exit:
+	for (UINT32 i = 0; i < NumChunks; ++i)
+		FreeXrefIndex(&Job.Chunks[i].Index);
+
+	return Status;
+}
+
+EFI_STATUS
+EFIAPI
+BuildXrefIndex(
+	IN CONST SCAN_SCHEDULER* Scheduler OPTIONAL,
+	IN OUT PZYDIS_CONTEXT Context,
+	IN CONST UINT8* ImageBase,
+	IN PEFI_IMAGE_NT_HEADERS NtHeaders,
+	IN CONST UINT8* Base,
+	IN UINTN Size,
+	IN OUT PXREF_INDEX Index
+	)
+{
+	if (Context == NULL || ImageBase == NULL || Base == NULL || Index == NULL)
+		return EFI_INVALID_PARAMETER;
+	if (Index->Xrefs != NULL)
+		return EFI_SUCCESS;
+
+	// Decoding is split into chunks of functions, so this needs an exception table
+	FUNCTION_ITERATOR Iterator;
+	CONST UINT32 NumChunks = GetNumScanChunks(Scheduler, Size, XREF_MIN_CHUNK_SIZE);
+	if (NumChunks > 1 && !EFI_ERROR(InitializeFunctionIterator(ImageBase, NtHeaders, Base, Size, &Iterator)))
+		return BuildXrefIndexInChunks(Scheduler, Context, ImageBase, NtHeaders, &Iterator, Base, Size, NumChunks, Index);
+
+	// Start with room for one reference per 32 bytes of code, which is close to the real density in Windows boot loaders
+	Index->ImageBase = ImageBase;
+	Index->Count = 0;
+	Index->Capacity = MAX(Size / 32, 256);
+	Index->Xrefs = (PXREF)AllocatePool(Index->Capacity * sizeof(XREF));
+	if (Index->Xrefs == NULL)
+	{
+		Index->Capacity = 0;
+		return EFI_OUT_OF_RESOURCES;
+	}
+
+	XREF_BUILD_STATE BuildState = { Index, TRUE, EFI_SUCCESS };
+	INSTRUCTION_MATCHER Matcher = { AddXref, &BuildState, FALSE };
+	DecodeFunctionsAndMatch(Context,
+							ImageBase,
+							NtHeaders,
+							Base,
+							Size,
+							&Matcher,
+							1);
+	if (EFI_ERROR(BuildState.Status))
+	{
+		FreeXrefIndex(Index);
+		return BuildState.Status;
+	}
+
+	SortXrefs(Index->Xrefs, Index->Count);
+	return EFI_SUCCESS;
+}
+
+VOID
+EFIAPI
+FreeXrefIndex(
+	IN OUT PXREF_INDEX Index
+	)
+{
+	if (Index->Xrefs != NULL)
+		FreePool(Index->Xrefs);
+	ZeroMem(Index, sizeof(*Index));
+}
+
+UINTN
+EFIAPI
+FindXrefsTo(
+	IN CONST XREF_INDEX* Index,
+	IN CONST VOID* Target,
+	OUT CONST XREF** First
+	)
+{
+	*First = NULL;
+	if (Index->Xrefs == NULL || (CONST UINT8*)Target < Index->ImageBase ||
+		(UINTN)((CONST UINT8*)Target - Index->ImageBase) > MAX_UINT32)
+		return 0;
+
+	// Find the first reference with TargetRva >= the requested RVA
+	CONST UINT32 TargetRva = (UINT32)((CONST UINT8*)Target - Index->ImageBase);
+	UINTN Low = 0, High = Index->Count;
+	while (Low < High)
+	{
+		CONST UINTN Middle = Low + (High - Low) / 2;
+		if (Index->Xrefs[Middle].TargetRva < TargetRva)
+			Low = Middle + 1;
+		else
+			High = Middle;
+	}
+
+	UINTN End = Low;
+	while (End < Index->Count && Index->Xrefs[End].TargetRva == TargetRva)
+		End++;
+
+	if (End > Low)
+		*First = &Index->Xrefs[Low];
+	return End - Low;
+}
+
+//
+// Confirms that the 32-bit displacement at Base + DispOffset, which has already been found to reach Target, belongs to an
+// instruction of one of the kinds in KindMask. Returns the address of the instruction, or NULL if there is none
+//
+STATIC
+UINT8*
+ConfirmReference(
+	IN OUT PZYDIS_CONTEXT Context,
+	IN CONST UINT8* Base,
+	IN UINTN Size,
+	IN UINTN DispOffset,
+	IN UINTN Target,
+	IN UINT32 KindMask
+	)
+{
+	// Possible instruction starts, in order of preference: E8/E9 rel32, and [REX] FF 15/FF 25/8D /r disp32.
+	// A byte in the REX range before the opcode may just as well be the last byte of the previous instruction, such as the
+	// disp8 of 'lea rcx, [rsp+40h]', and both starts decode to the same target. FF 15/FF 25 never need REX, so they use
+	// the start without it; if the instruction does have a REX prefix the site is then one byte into it, which callers
+	// handle since they only backtrack from it or decode through it. lea needs REX.W for a 64-bit destination, so it
+	// tries the start with REX first
+	CONST UINT8* Disp = Base + DispOffset;
+	UINTN Starts[3];
+	UINT32 NumStarts = 0;
+	if (Disp[-1] == 0xE8 || Disp[-1] == 0xE9)
+		Starts[NumStarts++] = DispOffset - 1;
+	if (DispOffset >= 2 && Disp[-2] == 0xFF && (Disp[-1] == 0x15 || Disp[-1] == 0x25))
+		Starts[NumStarts++] = DispOffset - 2;
+	if (DispOffset >= 2 && Disp[-2] == 0x8D && (Disp[-1] & 0xC7) == 0x05)
+	{
+		if (DispOffset >= 3 && (Disp[-3] & 0xF0) == 0x40)
+			Starts[NumStarts++] = DispOffset - 3;
+		Starts[NumStarts++] = DispOffset - 2;
+	}
+
+	for (UINT32 i = 0; i < NumStarts; ++i)
+	{
+		Context->InstructionAddress = (ZyanU64)(Base + Starts[i]);
+		if (!ZYAN_SUCCESS(ZydisDecoderDecodeInstruction(&Context->Decoder,
+														&Context->DecoderContext,
+														(VOID*)Context->InstructionAddress,
+														Size - Starts[i],
+														&Context->Instruction)))
+			continue;
+
+		Context->InstructionsDecoded++;
+		if (Context->Instruction.length != DispOffset + sizeof(UINT32) - Starts[i])
+			continue;
+
+		XREF_KIND Kind;
+		UINT8 OperandIndex = 0;
+		if (Context->Instruction.mnemonic == ZYDIS_MNEMONIC_CALL)
+			Kind = XrefCall;
+		else if (Context->Instruction.mnemonic == ZYDIS_MNEMONIC_JMP)
+			Kind = XrefJmp;
+		else if (Context->Instruction.mnemonic == ZYDIS_MNEMONIC_LEA)
+		{
+			Kind = XrefLea;
+			OperandIndex = 1;
+		}
+		else
+			continue;
+
+		ZyanU64 OperandAddress = 0;
+		if ((KindMask & (1U << Kind)) != 0 &&
+			ZYAN_SUCCESS(ZydisDecodeOperands(Context)) &&
+			ZYAN_SUCCESS(ZydisCalcAbsoluteAddress(&Context->Instruction, &Context->Operands[OperandIndex], Context->InstructionAddress, &OperandAddress)) &&
+			OperandAddress == Target)
+			return (UINT8*)Context->InstructionAddress;
+	}
+
+	return NULL;
+}
+
+UINTN
+EFIAPI
+FindReferencesTo(
+	IN OUT PZYDIS_CONTEXT Context,
+	IN CONST UINT8* Base,
+	IN UINTN Size,
+	IN CONST VOID* Target,
+	IN UINT32 KindMask,
+	OUT UINT8** Sites,
+	IN UINTN MaxSites
+	)
+{
+	if (Context == NULL || Base == NULL || Sites == NULL || MaxSites == 0 || Size < 1 + sizeof(UINT32))
+		return 0;
+
+	// A displacement at offset j from Base reaches Target if j + 4 + disp32 == Target - Base, since it is the last field of
+	// all recognized encodings. Comparing modulo 2^32 is fine, as ConfirmReference() checks the full address of every hit
+	CONST UINT32 TargetOffset = (UINT32)((UINTN)Target - (UINTN)Base);
+	UINTN NumSites = 0;
+	UINTN DispOffset = 1;
+
+	// Check four displacements per 64-bit load while at least eight bytes remain
+	for (; DispOffset + sizeof(UINT64) <= Size; DispOffset += 4)
+	{
+		CONST UINT64 Word = ReadUnaligned64((CONST UINT64*)(Base + DispOffset));
+		CONST UINT32 Expected = TargetOffset - (UINT32)(DispOffset + sizeof(UINT32));
+		if ((UINT32)Word != Expected &&
+			(UINT32)(Word >> 8) != Expected - 1 &&
+			(UINT32)(Word >> 16) != Expected - 2 &&
+			(UINT32)(Word >> 24) != Expected - 3)
+			continue;
+
+		for (UINT32 k = 0; k < 4; ++k)
+		{
+			if ((UINT32)(Word >> (8 * k)) != Expected - k)
+				continue;
+
+			UINT8* Site = ConfirmReference(Context, Base, Size, DispOffset + k, (UINTN)Target, KindMask);
+			if (Site != NULL)
+			{
+				Sites[NumSites++] = Site;
+				if (NumSites == MaxSites)
+					return NumSites;
+			}
+		}
+	}
+
+	for (; DispOffset + sizeof(UINT32) <= Size; ++DispOffset)
+	{
+		if (ReadUnaligned32((CONST UINT32*)(Base + DispOffset)) != TargetOffset - (UINT32)(DispOffset + sizeof(UINT32)))
+			continue;
+
+		UINT8* Site = ConfirmReference(Context, Base, Size, DispOffset, (UINTN)Target, KindMask);
+		if (Site != NULL)
+		{
+			Sites[NumSites++] = Site;
+			if (NumSites == MaxSites)
+				break;
+		}
+	}
+
+	return NumSites;
+}
+
+UINT8*
+EFIAPI
+BacktrackToFunctionStart(
+	IN CONST UINT8* ImageBase,
+	IN PEFI_IMAGE_NT_HEADERS NtHeaders,
+	IN CONST UINT8* AddressInFunction
+	)
+{
+	// Test for null. This allows callers to do 'FindPattern(..., &Address); X = Backtrack(Address, ...)' with a single failure branch
+	if (AddressInFunction == NULL)
+		return NULL;
+	if (NtHeaders->OptionalHeader.NumberOfRvaAndSizes <= EFI_IMAGE_DIRECTORY_ENTRY_EXCEPTION)
+		return NULL;
+
+	CONST PIMAGE_RUNTIME_FUNCTION_ENTRY FunctionTable = (PIMAGE_RUNTIME_FUNCTION_ENTRY)(ImageBase + NtHeaders->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_EXCEPTION].VirtualAddress);
+	CONST UINT32 FunctionTableSize = NtHeaders->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_EXCEPTION].Size;
+	if (FunctionTableSize == 0)
+		return NULL;
+
+	// Do a binary search until we find the function that contains our address
+	CONST UINT32 RelativeAddress = (UINT32)(AddressInFunction - ImageBase);
+	PIMAGE_RUNTIME_FUNCTION_ENTRY FunctionEntry = NULL;
+	INT32 Low = 0;
+	INT32 High = (INT32)(FunctionTableSize / sizeof(IMAGE_RUNTIME_FUNCTION_ENTRY)) - 1;
+	
+	while (High >= Low)
 	{
 		CONST INT32 Middle = (Low + High) >> 1;
 		FunctionEntry = &FunctionTable[Middle];
@@ -486,3 +2483,131 @@ BacktrackToFunctionStart(
 
 	return NULL;
 }
+
+VOID
+EFIAPI
+BacktrackToFunctionStarts(
+	IN CONST UINT8* ImageBase,
+	IN PEFI_IMAGE_NT_HEADERS NtHeaders,
+	IN CONST UINT8* CONST* AddressesInFunctions,
+	IN UINTN Count,
+	OUT UINT8** FunctionStarts
+	)
+{
+	for (UINTN i = 0; i < Count; ++i)
+		FunctionStarts[i] = NULL;
+	if (NtHeaders->OptionalHeader.NumberOfRvaAndSizes <= EFI_IMAGE_DIRECTORY_ENTRY_EXCEPTION)
+		return;
+
+	CONST PIMAGE_RUNTIME_FUNCTION_ENTRY FunctionTable = (PIMAGE_RUNTIME_FUNCTION_ENTRY)(ImageBase + NtHeaders->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_EXCEPTION].VirtualAddress);
+	CONST UINT32 NumFunctions = NtHeaders->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_EXCEPTION].Size / sizeof(IMAGE_RUNTIME_FUNCTION_ENTRY);
+
+	UINT32 Cursor = 0;
+	UINT32 PreviousRelativeAddress = 0;
+	BOOLEAN HaveCursor = FALSE;
+	for (UINTN i = 0; i < Count; ++i)
+	{
+		if (AddressesInFunctions[i] == NULL)
+			continue;
+
+		CONST UINT32 RelativeAddress = (UINT32)(AddressesInFunctions[i] - ImageBase);
+		if (RelativeAddress < PreviousRelativeAddress)
+			HaveCursor = FALSE;
+		PreviousRelativeAddress = RelativeAddress;
+
+		// Search the first function that ends after the address. After the first lookup, gallop forward from the previous
+		// result to bracket it before doing the binary search, so that nearby addresses only cost a few probes
+		UINT32 Low = 0, High = NumFunctions;
+		if (HaveCursor)
+		{
+			UINT32 Step = 1;
+			Low = High = Cursor;
+			while (High < NumFunctions && FunctionTable[High].EndAddress <= RelativeAddress)
+			{
+				Low = High + 1;
+				High += Step;
+				Step <<= 1;
+			}
+			if (High > NumFunctions)
+				High = NumFunctions;
+		}
+
+		while (Low < High)
+		{
+			CONST UINT32 Middle = (Low + High) >> 1;
+			if (FunctionTable[Middle].EndAddress <= RelativeAddress)
+				Low = Middle + 1;
+			else
+				High = Middle;
+		}
+		Cursor = Low;
+		HaveCursor = TRUE;
+
+		if (Low >= NumFunctions || RelativeAddress < FunctionTable[Low].BeginAddress)
+			continue;
+
+		// If the function entry specifies indirection, get the address of the master function entry
+		CONST IMAGE_RUNTIME_FUNCTION_ENTRY* FunctionEntry = &FunctionTable[Low];
+		if ((FunctionEntry->u.UnwindData & RUNTIME_FUNCTION_INDIRECT) != 0)
+		{
+			FunctionEntry = (PIMAGE_RUNTIME_FUNCTION_ENTRY)(FunctionEntry->u.UnwindData + ImageBase - 1);
+		}
+
+		FunctionStarts[i] = (UINT8*)ImageBase + FunctionEntry->BeginAddress;
+	}
+}
+
+EFI_STATUS
+EFIAPI
+InitializeImageContext(
+	IN UINT8* ImageBase,
+	IN PEFI_IMAGE_NT_HEADERS NtHeaders,
+	OUT PIMAGE_CONTEXT ImageContext
+	)
+{
+	ZeroMem(ImageContext, sizeof(*ImageContext));
+	if (ImageBase == NULL || NtHeaders == NULL)
+		return EFI_INVALID_PARAMETER;
+
+	ImageContext->ImageBase = ImageBase;
+	ImageContext->NtHeaders = NtHeaders;
+
+	if (!ZYAN_SUCCESS(ZydisInit(NtHeaders, &ImageContext->Zydis)))
+		return EFI_LOAD_ERROR;
+
+	// Find the sections that are of interest to any of the patchers in one pass
+	CONST UINT64 TextId = SectionNameToId(".text");
+	CONST UINT64 RdataId = SectionNameToId(".rdata");
+	CONST UINT64 InitId = SectionNameToId("INIT");
+	CONST UINT64 PageId = SectionNameToId("PAGE");
+
+	PEFI_IMAGE_SECTION_HEADER Section = IMAGE_FIRST_SECTION(NtHeaders);
+	for (UINT16 i = 0; i < NtHeaders->FileHeader.NumberOfSections; ++i)
+	{
+		CONST UINT64 NameId = SectionHeaderNameId(Section);
+		if (NameId == TextId)
+			ImageContext->TextSection = Section;
+		else if (NameId == RdataId)
+			ImageContext->RdataSection = Section;
+		else if (NameId == InitId)
+			ImageContext->InitSection = Section;
+		else if (NameId == PageId)
+			ImageContext->PageSection = Section;
+
+		Section++;
+	}
+
+	if (ImageContext->TextSection == NULL && NtHeaders->FileHeader.NumberOfSections > 0)
+		ImageContext->TextSection = IMAGE_FIRST_SECTION(NtHeaders);
+
+	return EFI_SUCCESS;
+}
+
+VOID
+EFIAPI
+FreeImageContext(
+	IN OUT PIMAGE_CONTEXT ImageContext
+	)
+{
+	FreeXrefIndex(&ImageContext->XrefIndex);
+}
@@ -33,6 +33,38 @@ RtlStall(
 	IN UINTN Milliseconds
 	);
 
+//
+// Pauses for a boot stage's delay budget from the driver configuration so that its output can be read, and adds the
+// delay to the total shown by PrintKernelPatchInfo(). A budget of 0 only flushes the console.
+//
+VOID
+EFIAPI
+BootStageDelay(
+	IN UINT32 Milliseconds
+	);
+
+//
+// Buffered Print(). The formatted output is appended to a console buffer, which is written with a single OutputString()
+// call by FlushConsole(). This avoids a glyph redraw and scroll per line on slow (GOP-backed) consoles.
+// Output is limited to 511 characters per call, which is above the default Print() limit of 320.
+//
+UINTN
+EFIAPI
+ConsolePrint(
+	IN CONST CHAR16 *Format,
+	...
+	);
+
+//
+// Writes out and empties the ConsolePrint() buffer. This is called automatically by RtlSleep(), RtlStall(), WaitForKey()
+// and SetConsoleTextColour(). Any other code that changes the console state or hands it to someone else must call this first.
+//
+VOID
+EFIAPI
+FlushConsole(
+	VOID
+	);
+
 // 
 // Prints info about a loaded image
 // 
@@ -43,7 +75,8 @@ PrintLoadedImageInfo(
 	);
 
 //
-// Similar to Print(), but for use during the kernel patching phase.
+// Similar to Print(), but for use during the kernel patching phase. This only records the format string and arguments;
+// the message is formatted when it is printed by PrintKernelPatchInfo(). String arguments must therefore be literals.
 // Do not call this unless the message is specifically intended for (delayed) display output only.
 // Instead use the PRINT_KERNEL_PATCH_MSG() macro so the boot debugger receives messages with no delay.
 //
@@ -55,9 +88,9 @@ AppendKernelPatchMessage(
 	);
 
 //
-// Prints the contents of the kernel patch string buffer to the screen using OutputString() calls.
-// This is a separate function because the buffer consists of zero or more null-terminated strings,
-// which are printed sequentially to prevent issues with platforms that have small Print() buffer limits
+// Formats the recorded kernel patch messages into the console buffer. Each message is formatted separately, so the
+// per-call limit of ConsolePrint() applies to single messages rather than to the combined output.
+// The caller should call FlushConsole() afterwards, or print a prompt with WaitForKey().
 //
 VOID
 EFIAPI
@@ -65,6 +98,55 @@ PrintKernelPatchInfo(
 	VOID
 	);
 
+//
+// Starts timing a patch step. The returned index must be passed to StopPatchTiming() when the step is done.
+// Name must be a string literal. If KERNEL_PATCH_MAX_TIMINGS steps have already been recorded, the step is not timed.
+// This does not use boot services, and can be called during the kernel patching phase.
+//
+UINT32
+EFIAPI
+StartPatchTiming(
+	IN CONST CHAR16 *Name
+	);
+
+//
+// Stops timing a patch step started by StartPatchTiming().
+//
+VOID
+EFIAPI
+StopPatchTiming(
+	IN UINT32 Index
+	);
+
+//
+// RtlSleep() that also measures the TSC frequency against the sleep time, and stores it in gKernelPatchInfo.TscFrequency.
+// Used for the driver banner, so that the timings get calibrated without adding to the boot time.
+//
+VOID
+EFIAPI
+SleepAndCalibrateTsc(
+	IN UINTN Milliseconds
+	);
+
+//
+// Prints the recorded patch step timings as a table using ConsolePrint(). Steps are indented below the steps that contain them.
+//
+VOID
+EFIAPI
+PrintPatchTimings(
+	VOID
+	);
+
+//
+// Writes the driver statistics (decode counters, boot delay and patch timings) to the statistics variable.
+// Called at ExitBootServices(), after the last boot stage has been patched.
+//
+EFI_STATUS
+EFIAPI
+SaveDriverStatistics(
+	VOID
+	);
+
 //
 // Wrapper for CopyMem() that disables write protection prior to copying if needed.
 //
@@ -142,6 +224,180 @@ FindPattern(
 	OUT VOID **Found
 	);
 
+// Maximum number of 8 byte words in a pattern handled by the anchored search. Longer patterns use the plain byte loop
+#define PATTERN_MAX_WORDS		8
+
+//
+// Precomputed search data for a byte pattern with wildcards
+//
+typedef struct _PATTERN_MATCHER
+{
+	UINT32 Length;
+	UINT32 Anchor;							// Offset of the least common non-wildcard byte
+	UINT32 SecondAnchor;					// Offset of the second least common non-wildcard byte, or Anchor if there is none
+	UINT8 AnchorByte;
+	UINT8 SecondAnchorByte;
+	UINT64 AnchorBytes;						// The anchor byte repeated eight times
+	UINT32 NumWords;						// 0 if Length < sizeof(UINT64), in which case the pattern is stored in Values[0]
+	UINT32 WordOffsets[PATTERN_MAX_WORDS];	// The last word overlaps the previous one if Length is not a multiple of 8
+	UINT64 Values[PATTERN_MAX_WORDS];
+	UINT64 Masks[PATTERN_MAX_WORDS];		// 0x00 for wildcard bytes, 0xFF otherwise
+} PATTERN_MATCHER;
+
+//
+// A byte signature whose matcher is built on first use and then kept for later searches.
+// Define these with the BYTE_SIGNATURE_INIT() or MASKED_BYTE_SIGNATURE_INIT() macros.
+// A masked signature has no in-band wildcard value, so it can match a literal 0xCC (int3) byte.
+//
+typedef struct _BYTE_SIGNATURE
+{
+	CONST UINT8* Pattern;
+	CONST UINT8* Mask;			// Optional. If set, bytes with a 0x00 mask are wildcards and Wildcard is ignored
+	UINT32 PatternLength;
+	UINT8 Wildcard;
+	BOOLEAN Initialized;
+	PATTERN_MATCHER Matcher;
+} BYTE_SIGNATURE, *PBYTE_SIGNATURE;
+
+#define BYTE_SIGNATURE_INIT(Pattern, Wildcard)		{ (Pattern), NULL, sizeof(Pattern), (Wildcard), FALSE }
+#define MASKED_BYTE_SIGNATURE_INIT(Pattern, Mask)	{ (Pattern), (Mask), sizeof(Pattern), 0x00, FALSE }
+
+//
+// Finds a byte signature starting at the specified address
+//
+EFI_STATUS
+EFIAPI
+FindSignature(
+	IN OUT PBYTE_SIGNATURE Signature,
+	IN CONST VOID* Base,
+	IN UINT32 Size,
+	OUT VOID **Found
+	);
+
+//
+// Worker routine for SCAN_SCHEDULER. This has the same signature as EFI_AP_PROCEDURE.
+//
+typedef
+VOID
+(EFIAPI *SCAN_WORKER)(
+	IN OUT VOID* Argument
+	);
+
+//
+// Runs Worker(Argument) on each processor of the platform, including the calling one, and returns when all of them have finished.
+// Worker may not use any boot services. On error, Worker may have run on some processors or none.
+//
+typedef
+EFI_STATUS
+(EFIAPI *SCAN_RUN_ON_PROCESSORS)(
+	IN VOID* Platform,
+	IN SCAN_WORKER Worker,
+	IN OUT VOID* Argument
+	);
+
+#define SCAN_MAX_CHUNKS			32
+#define SCAN_MIN_CHUNK_SIZE		(256 * 1024)	// For byte scans. Decode passes use smaller chunks, as they are much slower per byte
+
+//
+// Splits large scans and decode passes into chunks and distributes them over multiple processors.
+// A zero-initialized scheduler runs everything on the calling processor. Results are always the same as those of the serial version.
+//
+typedef struct _SCAN_SCHEDULER
+{
+	SCAN_RUN_ON_PROCESSORS RunOnProcessors;	// NULL to run on the calling processor only
+	VOID* Platform;							// EFI_MP_SERVICES_PROTOCOL, or the thread pool of a host test harness
+	UINT32 NumProcessors;					// Including the calling processor
+} SCAN_SCHEDULER, *PSCAN_SCHEDULER;
+
+//
+// Multiprocessor scans are opt-in. Build with -D EFIGUARD_PARALLEL_SCAN=1 to enable them
+//
+#ifndef EFIGUARD_PARALLEL_SCAN
+#define EFIGUARD_PARALLEL_SCAN	0
+#endif
+
+//
+// Initializes a scheduler that runs on all enabled processors through EFI_MP_SERVICES_PROTOCOL.
+// If the driver was built without EFIGUARD_PARALLEL_SCAN, there is only one enabled processor or the protocol is not available,
+// the scheduler is zeroed and an error is returned. Requires boot services and a TPL below TPL_NOTIFY.
+// The scheduler must not be used after ExitBootServices().
+//
+EFI_STATUS
+EFIAPI
+InitializeScanScheduler(
+	OUT PSCAN_SCHEDULER Scheduler
+	);
+
+//
+// Same as FindSignature(), but ranges of at least 2 * SCAN_MIN_CHUNK_SIZE bytes are split into overlapping chunks
+// that are searched in parallel. The match in the lowest chunk is returned, so the result is always the first match.
+//
+EFI_STATUS
+EFIAPI
+FindSignatureParallel(
+	IN CONST SCAN_SCHEDULER* Scheduler OPTIONAL,
+	IN OUT PBYTE_SIGNATURE Signature,
+	IN CONST VOID* Base,
+	IN UINT32 Size,
+	OUT VOID **Found
+	);
+
+//
+// A single pattern to search for with FindPatterns()
+//
+typedef struct _PATTERN_SEARCH
+{
+	CONST UINT8* Pattern;
+	UINT32 PatternLength;
+	UINT8 Wildcard;
+	VOID* Found;			// Out: address of the first match, or NULL if not found
+} PATTERN_SEARCH, *PPATTERN_SEARCH;
+
+#define PATTERN_SEARCH_MAX_PATTERNS		8
+
+//
+// Finds up to PATTERN_SEARCH_MAX_PATTERNS byte patterns in a single pass over the specified address range.
+// Each Found field receives the same result FindPattern() would have returned for that pattern.
+// Returns EFI_NOT_FOUND if one or more patterns were not found.
+//
+EFI_STATUS
+EFIAPI
+FindPatterns(
+	IN OUT PPATTERN_SEARCH Searches,
+	IN UINT32 NumSearches,
+	IN CONST VOID* Base,
+	IN UINT32 Size
+	);
+
+//
+// Finds the first occurrence of a constant (GUID, magic value, ...) of at least 8 bytes in the initialized,
+// non-executable data sections of an image. If Alignment is greater than 1, only offsets that are a multiple of it are checked
+//
+EFI_STATUS
+EFIAPI
+FindConstantInDataSections(
+	IN CONST UINT8* ImageBase,
+	IN PEFI_IMAGE_NT_HEADERS NtHeaders,
+	IN CONST VOID* Constant,
+	IN UINT32 ConstantSize,
+	IN UINT32 Alignment,
+	OUT VOID **Found
+	);
+
+//
+// Finds a byte pattern starting at the specified address by comparing every offset. Slow, but simple
+//
+EFI_STATUS
+EFIAPI
+FindPatternBytewise(
+	IN CONST UINT8* Pattern,
+	IN UINT8 Wildcard,
+	IN UINT32 PatternLength,
+	IN CONST VOID* Base,
+	IN UINT32 Size,
+	OUT VOID **Found
+	);
+
 //
 // Finds a byte pattern starting at the specified address (with lots of debug spew)
 //
@@ -162,13 +418,18 @@ FindPatternVerbose(
 typedef struct _ZYDIS_CONTEXT
 {
 	ZydisDecoder Decoder;
+	ZydisDecoderContext DecoderContext;
 	ZydisDecodedInstruction Instruction;
-	ZydisDecodedOperand Operands[ZYDIS_MAX_OPERAND_COUNT];
+	ZydisDecodedOperand Operands[ZYDIS_MAX_OPERAND_COUNT];	// Only valid after ZydisDecodeOperands()
 
 	ZyanU64 InstructionAddress;
 	UINTN Length;
 	UINTN Offset;
 
+	// Decode counters for the driver statistics. The decode loops in util.c add to these; ZydisInit() zeroes them
+	UINT64 InstructionsDecoded;
+	UINT64 DecodeResyncs;
+
 #ifndef ZYDIS_DISABLE_FORMATTER
 	ZydisFormatter Formatter;
 	CHAR8 InstructionText[256];
@@ -185,6 +446,243 @@ ZydisInit(
 	OUT PZYDIS_CONTEXT Context
 	);
 
+//
+// Adds the decode counters of a context to the statistics of a boot stage. Called once per stage, when the stage is done.
+//
+VOID
+EFIAPI
+RecordDecodeStatistics(
+	IN EFIGUARD_BOOT_STAGE Stage,
+	IN CONST ZYDIS_CONTEXT* Context
+	);
+
+//
+// Decodes the operands of the instruction last decoded with ZydisDecoderDecodeInstruction() into Context->Operands.
+// Decode loops should only call this for instructions that have passed their mnemonic, length and operand count checks.
+//
+ZyanStatus
+EFIAPI
+ZydisDecodeOperands(
+	IN OUT PZYDIS_CONTEXT Context
+	);
+
+//
+// Instruction matcher callback for DecodeAndMatch(). Called for every decoded instruction in the range.
+// Returns TRUE when the matcher is done, after which it will receive no more instructions.
+//
+typedef
+BOOLEAN
+(EFIAPI*
+t_InstructionMatcher)(
+	IN OUT PZYDIS_CONTEXT Context,
+	IN OUT VOID *State
+	);
+
+typedef struct _INSTRUCTION_MATCHER
+{
+	t_InstructionMatcher Match;
+	VOID* State;			// Matcher-specific state, passed to Match()
+	BOOLEAN Done;			// Out: TRUE if Match() returned TRUE
+} INSTRUCTION_MATCHER, *PINSTRUCTION_MATCHER;
+
+//
+// Decodes all instructions in [Base, Base + Size) once and passes each one to every matcher that is not done yet.
+// Decoding stops early when all matchers are done. Returns EFI_NOT_FOUND if one or more matchers did not finish.
+//
+EFI_STATUS
+EFIAPI
+DecodeAndMatch(
+	IN OUT PZYDIS_CONTEXT Context,
+	IN CONST UINT8* Base,
+	IN UINTN Size,
+	IN OUT PINSTRUCTION_MATCHER Matchers,
+	IN UINT32 NumMatchers
+	);
+
+//
+// Same as DecodeAndMatch(), but only decodes the functions in the image's exception table (.pdata) that start in [Base, Base + Size).
+// Decoding starts at real instruction boundaries and skips padding, jump tables and other data between functions.
+// Falls back to DecodeAndMatch() on the whole range if the image has no exception table.
+// Note that leaf functions without unwind data are not in the table, so this is only suitable for finding code that is later
+// passed to BacktrackToFunctionStart(), which has the same limitation.
+//
+EFI_STATUS
+EFIAPI
+DecodeFunctionsAndMatch(
+	IN OUT PZYDIS_CONTEXT Context,
+	IN CONST UINT8* ImageBase,
+	IN PEFI_IMAGE_NT_HEADERS NtHeaders,
+	IN CONST UINT8* Base,
+	IN UINTN Size,
+	IN OUT PINSTRUCTION_MATCHER Matchers,
+	IN UINT32 NumMatchers
+	);
+
+//
+// Iterator over the functions in an image's exception table (.pdata) that start in a given address range.
+//
+typedef struct _FUNCTION_ITERATOR
+{
+	CONST UINT8* ImageBase;
+	CONST IMAGE_RUNTIME_FUNCTION_ENTRY* Entry;		// The next function to return
+	CONST IMAGE_RUNTIME_FUNCTION_ENTRY* EndEntry;	// One past the last function in the range
+} FUNCTION_ITERATOR, *PFUNCTION_ITERATOR;
+
+//
+// Initializes a function iterator for all functions that start in [Base, Base + Size).
+// Returns EFI_NOT_FOUND if the image has no exception table.
+//
+EFI_STATUS
+EFIAPI
+InitializeFunctionIterator(
+	IN CONST UINT8* ImageBase,
+	IN PEFI_IMAGE_NT_HEADERS NtHeaders,
+	IN CONST UINT8* Base,
+	IN UINTN Size,
+	OUT PFUNCTION_ITERATOR Iterator
+	);
+
+//
+// Gets the address and size of the next function. Returns FALSE if there are no more functions.
+//
+BOOLEAN
+EFIAPI
+GetNextFunction(
+	IN OUT PFUNCTION_ITERATOR Iterator,
+	OUT CONST UINT8** FunctionStart,
+	OUT UINTN* FunctionSize
+	);
+
+//
+// Decodes only as much code as is needed to see the instructions at the given sites, which must be sorted in ascending order.
+// For each site, decoding starts at the exception table entry (.pdata) that contains it, or continues where the previous site
+// in the same entry left off, and stops after the instruction that contains the site. Every decoded instruction is passed
+// to the matchers as with DecodeAndMatch(), so matchers also see the instructions leading up to a site.
+// Returns EFI_NOT_FOUND if one or more matchers did not finish or if the image has no exception table.
+//
+EFI_STATUS
+EFIAPI
+DecodeSitesAndMatch(
+	IN OUT PZYDIS_CONTEXT Context,
+	IN CONST UINT8* ImageBase,
+	IN PEFI_IMAGE_NT_HEADERS NtHeaders,
+	IN CONST UINT8* CONST* Sites,
+	IN UINTN NumSites,
+	IN OUT PINSTRUCTION_MATCHER Matchers,
+	IN UINT32 NumMatchers
+	);
+
+//
+// Same as DecodeFunctionsAndMatch(), but for matchers that are only interested in instructions containing a distinctive
+// byte sequence, such as a 32 or 64-bit constant operand. Every occurrence of the signature in [Base, Base + Size) is
+// treated as a site for DecodeSitesAndMatch(), so only the functions containing an occurrence are decoded.
+// Falls back to DecodeFunctionsAndMatch() if the signature is unsuitable for an anchored search or the image has no exception table.
+//
+EFI_STATUS
+EFIAPI
+DecodeSignatureSitesAndMatch(
+	IN OUT PZYDIS_CONTEXT Context,
+	IN CONST UINT8* ImageBase,
+	IN PEFI_IMAGE_NT_HEADERS NtHeaders,
+	IN OUT PBYTE_SIGNATURE Signature,
+	IN CONST UINT8* Base,
+	IN UINTN Size,
+	IN OUT PINSTRUCTION_MATCHER Matchers,
+	IN UINT32 NumMatchers
+	);
+
+//
+// Cross-reference kinds stored in an XREF_INDEX
+//
+typedef enum _XREF_KIND
+{
+	XrefCall,				// call rel32, call [rip + disp32]
+	XrefJmp,				// jmp rel32, jmp [rip + disp32]
+	XrefLea,				// lea REG, [rip + disp32]
+	XrefMemory				// Any other instruction with a RIP-relative memory operand
+} XREF_KIND;
+
+typedef struct _XREF
+{
+	UINT32 TargetRva;
+	UINT32 SiteRva;			// RVA of the referencing instruction
+	UINT16 Register;		// ZydisRegister of the first operand if it is a register, ZYDIS_REGISTER_NONE otherwise
+	UINT8 Kind;				// XREF_KIND
+	BOOLEAN Indirect;		// TRUE if the target is a memory operand, e.g. 'call [rip + disp32]'
+} XREF, *PXREF;
+
+//
+// Index of all call, jmp (except short jumps), lea and RIP-relative memory references in a code range, sorted by
+// target and then by site. A zero-initialized index is empty and not yet built.
+//
+typedef struct _XREF_INDEX
+{
+	CONST UINT8* ImageBase;
+	PXREF Xrefs;
+	UINTN Count;
+	UINTN Capacity;
+} XREF_INDEX, *PXREF_INDEX;
+
+//
+// Builds the cross-reference index for [Base, Base + Size) with a single decode pass using DecodeFunctionsAndMatch().
+// If a scheduler is given, the functions in the range are split into chunks that are decoded in parallel.
+// Does nothing if the index has already been built. Requires boot services, as the index is allocated from pool memory.
+//
+EFI_STATUS
+EFIAPI
+BuildXrefIndex(
+	IN CONST SCAN_SCHEDULER* Scheduler OPTIONAL,
+	IN OUT PZYDIS_CONTEXT Context,
+	IN CONST UINT8* ImageBase,
+	IN PEFI_IMAGE_NT_HEADERS NtHeaders,
+	IN CONST UINT8* Base,
+	IN UINTN Size,
+	IN OUT PXREF_INDEX Index
+	);
+
+//
+// Frees the memory used by a cross-reference index and resets it to the empty state.
+//
+VOID
+EFIAPI
+FreeXrefIndex(
+	IN OUT PXREF_INDEX Index
+	);
+
+//
+// Finds all cross-references to Target. Returns the number of references found.
+// If nonzero, *First receives the first reference; the others follow it in order of increasing site address.
+//
+UINTN
+EFIAPI
+FindXrefsTo(
+	IN CONST XREF_INDEX* Index,
+	IN CONST VOID* Target,
+	OUT CONST XREF** First
+	);
+
+//
+// Finds up to MaxSites instructions in [Base, Base + Size) that reference Target, in order of increasing address, without
+// disassembling the range. Only rel32 and RIP-relative disp32 encodings are recognized: E8/E9 (call/jmp), [REX] FF 15/FF 25
+// (call/jmp [rip + disp32]) and [REX] 8D /r (lea REG, [rip + disp32]). KindMask is a bitmask of (1 << XREF_KIND) values.
+// The range is swept by comparing each 32-bit displacement with the value that would reach Target from its position,
+// and only the hits are decoded with Zydis to confirm the instruction. Returns the number of sites found.
+// Note that unlike DecodeAndMatch(), the sweep does not know instruction boundaries, so a match can in theory be a false
+// positive embedded in other code or data that happens to decode as a valid reference to Target. For the same reason, the
+// site of a REX-prefixed FF 15/FF 25 is its opcode byte, one byte into the instruction.
+//
+UINTN
+EFIAPI
+FindReferencesTo(
+	IN OUT PZYDIS_CONTEXT Context,
+	IN CONST UINT8* Base,
+	IN UINTN Size,
+	IN CONST VOID* Target,
+	IN UINT32 KindMask,
+	OUT UINT8** Sites,
+	IN UINTN MaxSites
+	);
+
 //
 // Finds the start of a function given an address within it.
 // Returns NULL if AddressInFunction is NULL (this simplifies error checking logic in calling functions).
@@ -196,3 +694,60 @@ BacktrackToFunctionStart(
 	IN PEFI_IMAGE_NT_HEADERS NtHeaders,
 	IN CONST UINT8* AddressInFunction
 	);
+
+//
+// Batch version of BacktrackToFunctionStart() for addresses sorted in ascending order. The exception table is searched
+// forward from the previous result, so the whole batch costs about as much as a single merge pass over the table.
+// An address that is lower than its predecessor restarts the search at the beginning of the table.
+// FunctionStarts[i] receives NULL if AddressesInFunctions[i] is NULL or not in any function.
+//
+VOID
+EFIAPI
+BacktrackToFunctionStarts(
+	IN CONST UINT8* ImageBase,
+	IN PEFI_IMAGE_NT_HEADERS NtHeaders,
+	IN CONST UINT8* CONST* AddressesInFunctions,
+	IN UINTN Count,
+	OUT UINT8** FunctionStarts
+	);
+
+//
+// Analysis state for one image, shared by all locator and patch functions for that image.
+// Initialize once with InitializeImageContext() and release with FreeImageContext().
+//
+typedef struct _IMAGE_CONTEXT
+{
+	UINT8* ImageBase;
+	PEFI_IMAGE_NT_HEADERS NtHeaders;
+	ZYDIS_CONTEXT Zydis;									// Decoder initialized for the image's machine type
+
+	// Section map. Sections that do not exist are NULL, except TextSection which falls back to the first section
+	PEFI_IMAGE_SECTION_HEADER TextSection;
+	PEFI_IMAGE_SECTION_HEADER RdataSection;
+	PEFI_IMAGE_SECTION_HEADER InitSection;
+	PEFI_IMAGE_SECTION_HEADER PageSection;
+
+	XREF_INDEX XrefIndex;									// Built on demand for TextSection. Requires boot services
+	SCAN_SCHEDULER Scheduler;								// Zeroed by InitializeImageContext(). Set with InitializeScanScheduler()
+} IMAGE_CONTEXT, *PIMAGE_CONTEXT;
+
+//
+// Initializes the analysis context for an image: the decoder and section map. Does not allocate memory.
+// This also resets the section statistics, which from then on are collected for this image.
+//
+EFI_STATUS
+EFIAPI
+InitializeImageContext(
+	IN UINT8* ImageBase,
+	IN PEFI_IMAGE_NT_HEADERS NtHeaders,
+	OUT PIMAGE_CONTEXT ImageContext
+	);
+
+//
+// Frees any memory owned by an image context, such as its cross-reference index.
+//
+VOID
+EFIAPI
+FreeImageContext(
+	IN OUT PIMAGE_CONTEXT ImageContext
+	);
@@ -88,8 +88,41 @@ typedef struct _EFIGUARD_BACKDOOR_DATA {
 } EFIGUARD_BACKDOOR_DATA;
 
 
+//
+// Delay budgets, in milliseconds, for the pauses that are made during boot so that the output of a boot stage can be read
+// before it scrolls off screen. Any of these can be 0 to boot as fast as possible. Failed patches always wait for a
+// keypress and show the patch summary, regardless of these values. These can be optionally sent to the driver using the
+// SetBootDelays() pointer in the protocol.
+//
+#define EFIGUARD_DEFAULT_LOAD_IMAGE_DELAY					500
+#define EFIGUARD_DEFAULT_BOOTMGR_DELAY						2000
+#define EFIGUARD_DEFAULT_WINLOAD_DELAY						2000
+
+typedef struct _EFIGUARD_BOOT_DELAYS {
+	//
+	// Pause after printing the name of an image that is being loaded or booted.
+	// Default: EFIGUARD_DEFAULT_LOAD_IMAGE_DELAY
+	//
+	UINT32 LoadImage;
+
+	//
+	// Pause after bootmgfw.efi/bootmgr.efi has been patched successfully.
+	// Default: EFIGUARD_DEFAULT_BOOTMGR_DELAY
+	//
+	UINT32 Bootmgr;
+
+	//
+	// Pause after winload.efi has been patched successfully.
+	// Default: EFIGUARD_DEFAULT_WINLOAD_DELAY
+	//
+	UINT32 Winload;
+} EFIGUARD_BOOT_DELAYS;
+
+
 //
 // Main driver configuration data. This can be optionally sent to the driver using the Configure() pointer in the protocol.
+// The layout of this struct must not change, because loaders built against an older version of this header pass the
+// struct as they know it. New settings get their own protocol function instead.
 //
 typedef struct _EFIGUARD_CONFIGURATION_DATA {
 	//
@@ -118,11 +151,85 @@ EFIGUARD_CONFIGURE)(
 	);
 
 
+//
+// Driver statistics. These are written to a volatile variable at ExitBootServices(), after the kernel has been patched,
+// so they can be read from the OS, e.g. with 'EfiDSEFix.exe --stats'. The variable is lost on reboot.
+//
+#define EFIGUARD_STATISTICS_VARIABLE_NAME					L"EfiGuardStatistics"
+#define EFIGUARD_STATISTICS_VARIABLE_GUID					&gEfiGlobalVariableGuid
+#define EFIGUARD_STATISTICS_VARIABLE_ATTRIBUTES				(EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS)
+
+//
+// Boot stages that have their own decode counters.
+//
+typedef enum _EFIGUARD_BOOT_STAGE {
+	EfiGuardStageBootmgr,		// bootmgfw.efi and bootmgr.efi
+	EfiGuardStageWinload,		// winload.efi
+	EfiGuardStageKernel,		// ntoskrnl.exe
+	EfiGuardStageMax
+} EFIGUARD_BOOT_STAGE;
+
+typedef struct _EFIGUARD_STAGE_STATISTICS {
+	//
+	// Number of instructions decoded.
+	//
+	UINT64 InstructionsDecoded;
+
+	//
+	// Number of bytes at which decoding failed, after which decoding resumed at the next byte.
+	//
+	UINT64 DecodeResyncs;
+} EFIGUARD_STAGE_STATISTICS;
+
+//
+// Timing of one patch step. Steps are nested; a step contains the steps that start and end between its StartTsc and EndTsc.
+//
+#define EFIGUARD_MAX_STEP_TIMINGS							32
+
+typedef struct _EFIGUARD_STEP_TIMING {
+	CHAR16 Name[48];
+	UINT64 StartTsc;
+	UINT64 EndTsc; // 0 if the step did not finish
+} EFIGUARD_STEP_TIMING;
+
+typedef struct _EFIGUARD_STATISTICS {
+	EFIGUARD_STAGE_STATISTICS Stages[EfiGuardStageMax];
+
+	//
+	// Total time spent pausing after boot stages, in milliseconds.
+	//
+	UINT32 BootDelayMs;
+
+	//
+	// TSC ticks per second, measured while the driver banner is shown.
+	//
+	UINT64 TscFrequency;
+
+	//
+	// Timings of all patch steps, in the order in which they started.
+	//
+	UINT32 NumTimings;
+	EFIGUARD_STEP_TIMING Timings[EFIGUARD_MAX_STEP_TIMINGS];
+} EFIGUARD_STATISTICS;
+
+
+//
+// Sends the boot stage delay budgets to the driver. The total delay is shown in the kernel patch summary.
+//
+typedef
+EFI_STATUS
+(EFIAPI*
+EFIGUARD_SET_BOOT_DELAYS)(
+	IN CONST EFIGUARD_BOOT_DELAYS* BootDelays
+	);
+
+
 //
 // The EfiGuard bootkit driver protocol.
 //
 typedef struct _EFIGUARD_DRIVER_PROTOCOL {
 	EFIGUARD_CONFIGURE Configure;
+	EFIGUARD_SET_BOOT_DELAYS SetBootDelays;
 } EFIGUARD_DRIVER_PROTOCOL;
 
 
@@ -0,0 +1,85 @@
+//
+// Cost of finding a GUID near the end of a 4 MB image (2 MB code, 2 MB data) with FindConstantInDataSections(),
+// against the CompareGuid() loops it replaced: every byte from .rdata to the end of the image, and every 8 bytes
+// of the whole image.
+//
+
+#include "Host/HostTest.h"
+
+#define CODE_SIZE		(2 * 1024 * 1024)
+#define RDATA_SIZE		(1024 * 1024)
+#define DATA_SIZE		(1024 * 1024)
+#define REPETITIONS		50
+
+int
+main(
+	VOID
+	)
+{
+	CONST TEST_SECTION Sections[] =
+	{
+		{ ".text", CODE_SIZE, TEST_SECTION_CODE },
+		{ ".rdata", RDATA_SIZE, TEST_SECTION_RDATA },
+		{ ".data", DATA_SIZE, TEST_SECTION_DATA },
+	};
+	PEFI_IMAGE_NT_HEADERS NtHeaders;
+	UINT32 ImageSize;
+	UINT8* ImageBase = BuildTestImage(Sections, ARRAY_SIZE(Sections), &NtHeaders, &ImageSize);
+	CONST PEFI_IMAGE_SECTION_HEADER Rdata = TestGetSection(NtHeaders, ".rdata");
+	CONST PEFI_IMAGE_SECTION_HEADER Data = TestGetSection(NtHeaders, ".data");
+
+	// Random code, data that is mostly zeroes, and the GUID 8 byte aligned near the end of .data
+	TestSeedRandom(1);
+	TestRandomBytes(ImageBase + TestGetSection(NtHeaders, ".text")->VirtualAddress, CODE_SIZE, 256);
+	for (UINT32 i = 0; i < RDATA_SIZE + DATA_SIZE; ++i)
+		ImageBase[Rdata->VirtualAddress + i] = TestRandomBelow(4) == 0 ? (UINT8)TestRandom() : 0;
+	UINT8* Expected = ImageBase + Data->VirtualAddress + DATA_SIZE - 0x100;
+	CopyMem(Expected, &gEfiAcpi20TableGuid, sizeof(gEfiAcpi20TableGuid));
+
+	UINT8* Found = NULL;
+	UINT64 Start = TestNowNs();
+	for (UINT32 r = 0; r < REPETITIONS; ++r)
+	{
+		for (Found = ImageBase + Rdata->VirtualAddress; Found < ImageBase + ImageSize - sizeof(EFI_GUID); ++Found)
+		{
+			if (CompareGuid((CONST GUID*)Found, &gEfiAcpi20TableGuid))
+				break;
+		}
+	}
+	CONST double UnalignedLoop = (TestNowNs() - Start) / 1e6 / REPETITIONS;
+	BOOLEAN Match = Found == Expected;
+
+	Start = TestNowNs();
+	for (UINT32 r = 0; r < REPETITIONS; ++r)
+		FindConstantInDataSections(ImageBase, NtHeaders, &gEfiAcpi20TableGuid, sizeof(EFI_GUID), 1, (VOID**)&Found);
+	CONST double UnalignedConstant = (TestNowNs() - Start) / 1e6 / REPETITIONS;
+	Match = Match && Found == Expected;
+
+	Start = TestNowNs();
+	for (UINT32 r = 0; r < REPETITIONS; ++r)
+	{
+		for (Found = ImageBase; Found + sizeof(EFI_GUID) <= ImageBase + ImageSize; Found += sizeof(UINT64))
+		{
+			if (CompareGuid((CONST GUID*)Found, &gEfiAcpi20TableGuid))
+				break;
+		}
+	}
+	CONST double AlignedLoop = (TestNowNs() - Start) / 1e6 / REPETITIONS;
+	Match = Match && Found == Expected;
+
+	Start = TestNowNs();
+	for (UINT32 r = 0; r < REPETITIONS; ++r)
+		FindConstantInDataSections(ImageBase, NtHeaders, &gEfiAcpi20TableGuid, sizeof(EFI_GUID), sizeof(UINT64), (VOID**)&Found);
+	CONST double AlignedConstant = (TestNowNs() - Start) / 1e6 / REPETITIONS;
+	Match = Match && Found == Expected;
+
+	printf("unaligned, CompareGuid loop from .rdata to end:  %8.2f ms\n", UnalignedLoop);
+	printf("unaligned, FindConstantInDataSections:           %8.2f ms\n", UnalignedConstant);
+	printf("8-aligned, CompareGuid loop over whole image:    %8.2f ms\n", AlignedLoop);
+	printf("8-aligned, FindConstantInDataSections:           %8.2f ms\n", AlignedConstant);
+	if (!Match)
+		printf("RESULT MISMATCH\n");
+
+	free(ImageBase);
+	return EXIT_SUCCESS;
+}
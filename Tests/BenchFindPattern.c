@@ -0,0 +1,68 @@
+//
+// Search throughput of FindPattern() and FindSignature() against the byte-by-byte loop they replaced,
+// for three of the driver's signatures in an 8 MB buffer of random code-like bytes.
+//
+
+#include "Host/HostTest.h"
+
+#define BUFFER_SIZE		(8 * 1024 * 1024)
+#define REPETITIONS		5
+
+// Copies of SigKiMcaDeferredRecoveryService (PatchNtoskrnl.c), SigOslFwpKernelSetupPhase1Bytes (PatchWinload.c)
+// and SigImgArchStartBootApplicationBytes (PatchBootmgr.c)
+STATIC CONST UINT8 SigKiMcaDeferredRecoveryService[] = { 0x33, 0xC0, 0x8B, 0xD8, 0x8B, 0xF8, 0x8B, 0xE8, 0x4C, 0x8B, 0xD0 };
+STATIC CONST UINT8 SigOslFwpKernelSetupPhase1[] = { 0xE8, 0xCC, 0xCC, 0xCC, 0xCC, 0x48, 0x8B, 0x05, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0x8B, 0xCC, 0x48, 0x8B, 0x0D, 0xCC, 0xCC, 0xCC, 0xCC };
+STATIC CONST UINT8 SigImgArchStartBootApplication[] = { 0x41, 0xB8, 0x09, 0x00, 0x00, 0xD0 };
+
+STATIC CONST struct
+{
+	CONST CHAR8* Name;
+	CONST UINT8* Pattern;
+	UINT32 PatternLength;
+} mSignatures[] =
+{
+	{ "KiMcaDeferredRecovery", SigKiMcaDeferredRecoveryService, sizeof(SigKiMcaDeferredRecoveryService) },
+	{ "OslFwpKernelSetupPhase1", SigOslFwpKernelSetupPhase1, sizeof(SigOslFwpKernelSetupPhase1) },
+	{ "ImgArchStartBootApp", SigImgArchStartBootApplication, sizeof(SigImgArchStartBootApplication) },
+};
+
+int
+main(
+	VOID
+	)
+{
+	// Half common x64 opcode bytes, half random
+	STATIC CONST UINT8 CommonBytes[] = { 0x00, 0xFF, 0x48, 0x8B, 0x89, 0x24, 0xCC, 0x4C, 0x0F, 0x8D, 0x44, 0x01, 0xE8, 0x85, 0xC0, 0x83 };
+	UINT8* Buffer = malloc(BUFFER_SIZE);
+	TestSeedRandom(1);
+	for (UINT32 i = 0; i < BUFFER_SIZE; ++i)
+		Buffer[i] = TestRandomBelow(2) == 0 ? CommonBytes[TestRandomBelow(sizeof(CommonBytes))] : (UINT8)TestRandom();
+
+	printf("%-24s %14s %14s %14s\n", "Pattern", "Bytewise MB/s", "Pattern MB/s", "Signature MB/s");
+	for (UINT32 s = 0; s < ARRAY_SIZE(mSignatures); ++s)
+	{
+		VOID *Expected, *Found, *SignatureFound;
+		BYTE_SIGNATURE Signature = { mSignatures[s].Pattern, NULL, mSignatures[s].PatternLength, 0xCC, FALSE };
+
+		CONST UINT64 Start = TestNowNs();
+		for (UINT32 r = 0; r < REPETITIONS; ++r)
+			FindPatternBytewise(mSignatures[s].Pattern, 0xCC, mSignatures[s].PatternLength, Buffer, BUFFER_SIZE, &Expected);
+		CONST UINT64 Bytewise = TestNowNs();
+		for (UINT32 r = 0; r < REPETITIONS; ++r)
+			FindPattern(mSignatures[s].Pattern, 0xCC, mSignatures[s].PatternLength, Buffer, BUFFER_SIZE, &Found);
+		CONST UINT64 Anchored = TestNowNs();
+		for (UINT32 r = 0; r < REPETITIONS; ++r)
+			FindSignature(&Signature, Buffer, BUFFER_SIZE, &SignatureFound);
+		CONST UINT64 Cached = TestNowNs();
+
+		CONST double Megabytes = (double)REPETITIONS * BUFFER_SIZE / 1e6;
+		printf("%-24s %14.1f %14.1f %14.1f%s\n", mSignatures[s].Name,
+			Megabytes / ((Bytewise - Start) / 1e9),
+			Megabytes / ((Anchored - Bytewise) / 1e9),
+			Megabytes / ((Cached - Anchored) / 1e9),
+			Found == Expected && SignatureFound == Expected ? "" : "  RESULT MISMATCH");
+	}
+
+	free(Buffer);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,78 @@
+//
+// Cost of resolving the function starts of a sorted batch of addresses with BacktrackToFunctionStarts() against
+// one BacktrackToFunctionStart() call per address, for an exception table of about 30000 functions.
+//
+
+#include "Host/HostTest.h"
+
+#define TEXT_SIZE		(8 * 1024 * 1024)
+#define PDATA_SIZE		(30000 * sizeof(IMAGE_RUNTIME_FUNCTION_ENTRY))
+#define REPETITIONS		20
+
+STATIC
+INT32
+CompareAddresses(
+	IN CONST VOID* A,
+	IN CONST VOID* B
+	)
+{
+	CONST UINT8* Left = *(CONST UINT8* CONST*)A;
+	CONST UINT8* Right = *(CONST UINT8* CONST*)B;
+	return Left < Right ? -1 : Left > Right;
+}
+
+int
+main(
+	VOID
+	)
+{
+	CONST TEST_SECTION Sections[] =
+	{
+		{ ".text", TEXT_SIZE, TEST_SECTION_CODE },
+		{ ".pdata", PDATA_SIZE, TEST_SECTION_RDATA },
+	};
+	PEFI_IMAGE_NT_HEADERS NtHeaders;
+	UINT32 ImageSize;
+	UINT8* ImageBase = BuildTestImage(Sections, ARRAY_SIZE(Sections), &NtHeaders, &ImageSize);
+	CONST PEFI_IMAGE_SECTION_HEADER Text = TestGetSection(NtHeaders, ".text");
+
+	TestSeedRandom(1);
+	CONST UINT32 NumFunctions = BuildTestFunctionTable(ImageBase, NtHeaders, ".text", ".pdata", 512, 5);
+	printf("%u functions\n", NumFunctions);
+	printf("%-10s %16s %16s %8s\n", "Addresses", "Single ns/addr", "Batch ns/addr", "Speedup");
+
+	STATIC CONST UINT32 BatchSizes[] = { 16, 256, 4096, 65536 };
+	for (UINT32 b = 0; b < ARRAY_SIZE(BatchSizes); ++b)
+	{
+		CONST UINT32 Count = BatchSizes[b];
+		CONST UINT8** Addresses = malloc(Count * sizeof(*Addresses));
+		UINT8** Single = malloc(Count * sizeof(*Single));
+		UINT8** Batch = malloc(Count * sizeof(*Batch));
+		for (UINT32 i = 0; i < Count; ++i)
+			Addresses[i] = ImageBase + Text->VirtualAddress + TestRandomBelow(Text->Misc.VirtualSize);
+		qsort(Addresses, Count, sizeof(*Addresses), (int(*)(CONST VOID*, CONST VOID*))CompareAddresses);
+
+		CONST UINT64 Start = TestNowNs();
+		for (UINT32 r = 0; r < REPETITIONS; ++r)
+		{
+			for (UINT32 i = 0; i < Count; ++i)
+				Single[i] = BacktrackToFunctionStart(ImageBase, NtHeaders, Addresses[i]);
+		}
+		CONST UINT64 SingleEnd = TestNowNs();
+		for (UINT32 r = 0; r < REPETITIONS; ++r)
+			BacktrackToFunctionStarts(ImageBase, NtHeaders, Addresses, Count, Batch);
+		CONST UINT64 BatchEnd = TestNowNs();
+
+		CONST double SingleNs = (double)(SingleEnd - Start) / REPETITIONS / Count;
+		CONST double BatchNs = (double)(BatchEnd - SingleEnd) / REPETITIONS / Count;
+		printf("%-10u %16.1f %16.1f %7.2fx%s\n", Count, SingleNs, BatchNs, SingleNs / BatchNs,
+			CompareMem(Single, Batch, Count * sizeof(*Batch)) == 0 ? "" : "  RESULT MISMATCH");
+
+		free(Batch);
+		free(Single);
+		free((VOID*)Addresses);
+	}
+
+	free(ImageBase);
+	return EXIT_SUCCESS;
+}
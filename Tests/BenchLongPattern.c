@@ -0,0 +1,67 @@
+//
+// Cost of finding winload's 96 byte UTF-16 load failure string near the end of 1 MB of string data with FindPattern(),
+// which searches for patterns this long by prefix in FindLongPattern(), against the CompareMem loop it replaced.
+//
+
+#include "Host/HostTest.h"
+
+#define BUFFER_SIZE		(1024 * 1024)
+#define REPETITIONS		50
+
+// Copy of ImgpFilterValidationFailureMessage (PatchWinload.c)
+STATIC CONST CHAR16 FailureMessage[] = L"*** Windows is unable to verify the signature of";
+
+int
+main(
+	VOID
+	)
+{
+	// UTF-16 strings of letters and spaces separated by terminators, like a loader's .rdata. The letters are those of the
+	// message, so the first byte of the pattern is common
+	STATIC CONST CHAR8 Letters[] = "*** Windows is unable to verify the signature of";
+	UINT8* Buffer = malloc(BUFFER_SIZE);
+	TestSeedRandom(1);
+	for (UINT32 i = 0; i + 1 < BUFFER_SIZE; i += sizeof(CHAR16))
+	{
+		Buffer[i] = TestRandomBelow(32) == 0 ? 0 : (UINT8)Letters[TestRandomBelow(sizeof(Letters) - 1)];
+		Buffer[i + 1] = 0;
+	}
+	UINT8* Expected = Buffer + BUFFER_SIZE - 0x400;
+	CopyMem(Expected, FailureMessage, sizeof(FailureMessage) - sizeof(CHAR16));
+	CONST UINT32 PatternLength = sizeof(FailureMessage) - sizeof(CHAR16);
+
+	UINT8* Found = NULL;
+	UINT64 Start = TestNowNs();
+	for (UINT32 r = 0; r < REPETITIONS; ++r)
+	{
+		for (Found = Buffer; Found < Buffer + BUFFER_SIZE - PatternLength; ++Found)
+		{
+			if (CompareMem(Found, FailureMessage, PatternLength) == 0)
+				break;
+		}
+	}
+	CONST double CompareLoop = (TestNowNs() - Start) / 1e6 / REPETITIONS;
+	BOOLEAN Match = Found == Expected;
+
+	Start = TestNowNs();
+	for (UINT32 r = 0; r < REPETITIONS; ++r)
+		FindPatternBytewise((CONST UINT8*)FailureMessage, 0xCC, PatternLength, Buffer, BUFFER_SIZE, (VOID**)&Found);
+	CONST double Bytewise = (TestNowNs() - Start) / 1e6 / REPETITIONS;
+	Match = Match && Found == Expected;
+
+	Start = TestNowNs();
+	for (UINT32 r = 0; r < REPETITIONS; ++r)
+		FindPattern((CONST UINT8*)FailureMessage, 0xCC, PatternLength, Buffer, BUFFER_SIZE, (VOID**)&Found);
+	CONST double Prefix = (TestNowNs() - Start) / 1e6 / REPETITIONS;
+	Match = Match && Found == Expected;
+
+	printf("%u byte pattern in %u KB\n", PatternLength, BUFFER_SIZE / 1024);
+	printf("CompareMem loop:       %8.2f ms\n", CompareLoop);
+	printf("FindPatternBytewise:   %8.2f ms\n", Bytewise);
+	printf("FindPattern (prefix):  %8.2f ms\n", Prefix);
+	if (!Match)
+		printf("RESULT MISMATCH\n");
+
+	free(Buffer);
+	return EXIT_SUCCESS;
+}
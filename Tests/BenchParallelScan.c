@@ -0,0 +1,84 @@
+//
+// Wall clock time of FindSignatureParallel() over 32 MB and BuildXrefIndex() over 8 MB of code for 1 to 8 processors,
+// using the thread backed MP services protocol of the host library. Each job starts its APs as new threads, which
+// costs more than waking up parked APs on real firmware. The speedup is bounded by the number of host CPUs.
+//
+
+#include "Host/HostTest.h"
+
+#include <unistd.h>
+
+#define BUFFER_SIZE		(32 * 1024 * 1024)
+#define TEXT_SIZE		(8 * 1024 * 1024)
+#define PDATA_SIZE		(256 * 1024)
+#define REPETITIONS		5
+
+int
+main(
+	VOID
+	)
+{
+	CONST TEST_SECTION Sections[] =
+	{
+		{ ".text", TEXT_SIZE, TEST_SECTION_CODE },
+		{ ".pdata", PDATA_SIZE, TEST_SECTION_RDATA },
+	};
+	PEFI_IMAGE_NT_HEADERS NtHeaders;
+	UINT32 ImageSize;
+	UINT8* ImageBase = BuildTestImage(Sections, ARRAY_SIZE(Sections), &NtHeaders, &ImageSize);
+	UINT8* Code = ImageBase + TestGetSection(NtHeaders, ".text")->VirtualAddress;
+
+	TestSeedRandom(1);
+	CONST UINT32 NumFunctions = BuildTestFunctionTable(ImageBase, NtHeaders, ".text", ".pdata", 1024, 5);
+	CONST IMAGE_RUNTIME_FUNCTION_ENTRY* Table = (CONST IMAGE_RUNTIME_FUNCTION_ENTRY*)(ImageBase +
+		NtHeaders->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_EXCEPTION].VirtualAddress);
+	for (UINT32 i = 0; i < NumFunctions; ++i)
+		GenerateTestCode(ImageBase + Table[i].BeginAddress, Table[i].EndAddress - Table[i].BeginAddress, 0, NULL, MAX_UINT32);
+
+	// A signature that only occurs at the very end of the buffer, so that every byte is scanned
+	STATIC CONST UINT8 Pattern[] = { 0x33, 0xC0, 0x8B, 0xD8, 0x8B, 0xF8, 0x8B, 0xE8, 0x4C, 0x8B, 0xD0 };
+	UINT8* Buffer = malloc(BUFFER_SIZE);
+	TestRandomBytes(Buffer, BUFFER_SIZE, 32);
+	CopyMem(Buffer + BUFFER_SIZE - sizeof(Pattern) - 1, Pattern, sizeof(Pattern));
+
+	printf("%u functions. Host has %ld CPUs\n", NumFunctions, sysconf(_SC_NPROCESSORS_ONLN));
+	printf("%-11s %16s %16s\n", "Processors", "Signature ms", "Xref index ms");
+	STATIC CONST UINT32 ProcessorCounts[] = { 1, 2, 4, 8 };
+	for (UINT32 p = 0; p < ARRAY_SIZE(ProcessorCounts); ++p)
+	{
+		SCAN_SCHEDULER Scheduler;
+		HostSetMpServices(ProcessorCounts[p], EFI_SUCCESS);
+		InitializeScanScheduler(&Scheduler);
+
+		VOID* Found = NULL;
+		UINT64 Start = TestNowNs();
+		for (UINT32 r = 0; r < REPETITIONS; ++r)
+		{
+			BYTE_SIGNATURE Signature = BYTE_SIGNATURE_INIT(Pattern, 0xCC);
+			FindSignatureParallel(&Scheduler, &Signature, Buffer, BUFFER_SIZE, &Found);
+		}
+		CONST double SignatureMs = (TestNowNs() - Start) / 1e6 / REPETITIONS;
+
+		UINTN NumXrefs = 0;
+		Start = TestNowNs();
+		for (UINT32 r = 0; r < REPETITIONS; ++r)
+		{
+			ZYDIS_CONTEXT Context;
+			XREF_INDEX Index;
+			ZeroMem(&Index, sizeof(Index));
+			ZydisInit(NtHeaders, &Context);
+			BuildXrefIndex(&Scheduler, &Context, ImageBase, NtHeaders, Code, TEXT_SIZE, &Index);
+			NumXrefs = Index.Count;
+			FreeXrefIndex(&Index);
+		}
+		CONST double XrefMs = (TestNowNs() - Start) / 1e6 / REPETITIONS;
+
+		printf("%-11u %16.2f %16.2f%s\n", ProcessorCounts[p], SignatureMs, XrefMs,
+			Found == Buffer + BUFFER_SIZE - sizeof(Pattern) - 1 && NumXrefs != 0 ? "" : "  RESULT MISMATCH");
+	}
+
+	HostSetMpServices(0, EFI_SUCCESS);
+	free(Buffer);
+	free(ImageBase);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,145 @@
+//
+// Checks FindConstantInDataSections() against a memcmp scan of the same sections, for constants placed at random
+// aligned and unaligned offsets, in code and uninitialized sections that must be skipped, and next to near misses.
+//
+
+#include "Host/HostTest.h"
+
+#include <string.h>
+
+#define TEST_SECTION_BSS	(EFI_IMAGE_SCN_CNT_UNINITIALIZED_DATA | EFI_IMAGE_SCN_MEM_READ | EFI_IMAGE_SCN_MEM_WRITE)
+
+STATIC
+BOOLEAN
+IsSearchedSection(
+	IN CONST EFI_IMAGE_SECTION_HEADER* Section
+	)
+{
+	return (Section->Characteristics & EFI_IMAGE_SCN_CNT_INITIALIZED_DATA) != 0 &&
+		(Section->Characteristics & EFI_IMAGE_SCN_MEM_EXECUTE) == 0;
+}
+
+STATIC
+VOID*
+FindConstantLinear(
+	IN CONST UINT8* ImageBase,
+	IN PEFI_IMAGE_NT_HEADERS NtHeaders,
+	IN CONST UINT8* Constant,
+	IN UINT32 ConstantSize,
+	IN UINT32 Alignment
+	)
+{
+	CONST EFI_IMAGE_SECTION_HEADER* Section = IMAGE_FIRST_SECTION(NtHeaders);
+	for (UINT16 i = 0; i < NtHeaders->FileHeader.NumberOfSections; ++i, ++Section)
+	{
+		if (!IsSearchedSection(Section))
+			continue;
+		for (UINT32 Offset = 0; Offset + ConstantSize <= Section->Misc.VirtualSize; Offset += Alignment)
+		{
+			if (memcmp(ImageBase + Section->VirtualAddress + Offset, Constant, ConstantSize) == 0)
+				return (VOID*)(ImageBase + Section->VirtualAddress + Offset);
+		}
+	}
+	return NULL;
+}
+
+STATIC
+VOID
+FillSection(
+	IN UINT8* ImageBase,
+	IN CONST EFI_IMAGE_SECTION_HEADER* Section
+	)
+{
+	// Mostly zeroes and small values, like real data sections
+	for (UINT32 i = 0; i < Section->Misc.VirtualSize; ++i)
+		ImageBase[Section->VirtualAddress + i] = TestRandomBelow(4) == 0 ? (UINT8)TestRandomBelow(16) : 0;
+}
+
+STATIC
+VOID
+PlaceConstant(
+	IN UINT8* ImageBase,
+	IN CONST EFI_IMAGE_SECTION_HEADER* Section,
+	IN CONST UINT8* Constant,
+	IN UINT32 ConstantSize,
+	IN BOOLEAN NearMiss
+	)
+{
+	if (Section->Misc.VirtualSize < ConstantSize)
+		return;
+
+	// Prefer the section edges, where off-by-one errors live
+	CONST UINT32 MaxOffset = Section->Misc.VirtualSize - ConstantSize;
+	CONST UINT32 Choice = (UINT32)TestRandomBelow(4);
+	CONST UINT32 Offset = Choice == 0 ? 0 : Choice == 1 ? MaxOffset : (UINT32)TestRandomBelow(MaxOffset + 1);
+	UINT8* Destination = ImageBase + Section->VirtualAddress + Offset;
+	CopyMem(Destination, Constant, ConstantSize);
+	if (NearMiss)
+		Destination[TestRandomBelow(ConstantSize)] ^= (UINT8)(1 + TestRandomBelow(255));
+}
+
+int
+main(
+	VOID
+	)
+{
+	CONST TEST_SECTION Sections[] =
+	{
+		{ ".text", 0x3000, TEST_SECTION_CODE },
+		{ ".rdata", 0x2345, TEST_SECTION_RDATA },
+		{ ".data", 0x1801, TEST_SECTION_DATA },
+		{ ".bss", 0x1000, TEST_SECTION_BSS },
+		{ ".rsrc", 0x1003, TEST_SECTION_RDATA },
+	};
+	PEFI_IMAGE_NT_HEADERS NtHeaders;
+	UINT32 ImageSize;
+	UINT8* ImageBase = BuildTestImage(Sections, ARRAY_SIZE(Sections), &NtHeaders, &ImageSize);
+	CONST EFI_IMAGE_SECTION_HEADER* SectionHeaders = IMAGE_FIRST_SECTION(NtHeaders);
+
+	STATIC CONST UINT32 ConstantSizes[] = { 8, 9, sizeof(EFI_GUID), 24, 64, 65, 100 };
+	STATIC CONST UINT32 Alignments[] = { 1, 2, 4, sizeof(VOID*), 16 };
+	UINT8 Constant[100];
+	VOID* Found;
+
+	TestSeedRandom(15);
+	UINT32 NumFound = 0, NumSearches = 0;
+	for (UINT32 Iteration = 0; Iteration < 3000; ++Iteration)
+	{
+		for (UINT16 i = 0; i < NtHeaders->FileHeader.NumberOfSections; ++i)
+			FillSection(ImageBase, &SectionHeaders[i]);
+
+		CONST UINT32 ConstantSize = ConstantSizes[TestRandomBelow(ARRAY_SIZE(ConstantSizes))];
+		TestRandomBytes(Constant, ConstantSize, 256);
+		if (TestRandomBelow(2) == 0)
+			CopyMem(Constant, &gEfiAcpi20TableGuid, MIN(ConstantSize, sizeof(EFI_GUID)));
+
+		// Copies and near misses in random sections, including the ones that are not searched
+		CONST UINT32 NumCopies = (UINT32)TestRandomBelow(4);
+		for (UINT32 c = 0; c < NumCopies; ++c)
+		{
+			PlaceConstant(ImageBase, &SectionHeaders[TestRandomBelow(NtHeaders->FileHeader.NumberOfSections)], Constant, ConstantSize,
+				TestRandomBelow(3) == 0);
+		}
+
+		for (UINT32 a = 0; a < ARRAY_SIZE(Alignments); ++a)
+		{
+			VOID* Expected = FindConstantLinear(ImageBase, NtHeaders, Constant, ConstantSize, Alignments[a]);
+			CONST EFI_STATUS Status = FindConstantInDataSections(ImageBase, NtHeaders, Constant, ConstantSize, Alignments[a], &Found);
+			TEST_CHECK(Status == (Expected != NULL ? EFI_SUCCESS : EFI_NOT_FOUND) && Found == Expected,
+				"iteration %u, size %u, alignment %u: found rva 0x%x, expected 0x%x", Iteration, ConstantSize, Alignments[a],
+				Found != NULL ? (UINT32)((UINT8*)Found - ImageBase) : 0, Expected != NULL ? (UINT32)((UINT8*)Expected - ImageBase) : 0);
+			NumSearches++;
+			if (Expected != NULL)
+				NumFound++;
+		}
+	}
+	TEST_CHECK(NumFound > NumSearches / 10 && NumFound < NumSearches * 9 / 10, "%u of %u searches found", NumFound, NumSearches);
+
+	// Invalid parameters
+	TEST_CHECK(FindConstantInDataSections(ImageBase, NtHeaders, Constant, 7, 1, &Found) == EFI_INVALID_PARAMETER);
+	TEST_CHECK(FindConstantInDataSections(ImageBase, NtHeaders, Constant, 16, 0, &Found) == EFI_INVALID_PARAMETER);
+	TEST_CHECK(FindConstantInDataSections(ImageBase, NtHeaders, NULL, 16, 1, &Found) == EFI_INVALID_PARAMETER);
+
+	free(ImageBase);
+	return TestSummary("ConstantTests");
+}
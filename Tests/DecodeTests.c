@@ -0,0 +1,222 @@
+//
+// Checks the DecodeAndMatch() loop and lazy operand decoding: every matcher sees every instruction in order, matchers that
+// are done see no more instructions, the decode counters are exact, and a matcher that only decodes operands after its
+// mnemonic and operand count checks finds the same instructions as one that decodes operands for everything.
+//
+
+#include "Host/HostTest.h"
+
+#define CODE_SIZE			0x8000
+#define MAX_INSTRUCTIONS	CODE_SIZE
+
+typedef struct _RECORDING_STATE
+{
+	CONST UINT8* Code;
+	TEST_INSTRUCTION* Seen;
+	UINT32 Count;
+	UINT32 StopAfter;				// Done after this many instructions, or 0 to never finish
+} RECORDING_STATE;
+
+STATIC
+BOOLEAN
+EFIAPI
+RecordInstruction(
+	IN OUT PZYDIS_CONTEXT Context,
+	IN OUT VOID *State
+	)
+{
+	RECORDING_STATE* Recording = (RECORDING_STATE*)State;
+	TEST_INSTRUCTION* Seen = &Recording->Seen[Recording->Count++];
+	Seen->Offset = (UINT32)(Context->InstructionAddress - (UINTN)Recording->Code);
+	Seen->Length = Context->Instruction.length;
+	Seen->Mnemonic = Context->Instruction.mnemonic;
+	return Recording->Count == Recording->StopAfter;
+}
+
+typedef struct _RIP_STORE_STATE
+{
+	CONST UINT8* Code;
+	UINT32 Sites[MAX_INSTRUCTIONS];
+	UINT32 Targets[MAX_INSTRUCTIONS];
+	UINT32 Count;
+} RIP_STORE_STATE;
+
+//
+// Records every 'mov [rip+disp32], reg' with its target
+//
+STATIC
+VOID
+RecordRipStore(
+	IN CONST ZYDIS_CONTEXT* Context,
+	IN OUT RIP_STORE_STATE* Stores
+	)
+{
+	if (Context->Operands[0].type != ZYDIS_OPERAND_TYPE_MEMORY || Context->Operands[0].mem.base != ZYDIS_REGISTER_RIP ||
+		Context->Operands[1].type != ZYDIS_OPERAND_TYPE_REGISTER)
+		return;
+
+	ZyanU64 Target;
+	if (!ZYAN_SUCCESS(ZydisCalcAbsoluteAddress(&Context->Instruction, &Context->Operands[0], Context->InstructionAddress, &Target)))
+		return;
+
+	Stores->Sites[Stores->Count] = (UINT32)(Context->InstructionAddress - (UINTN)Stores->Code);
+	Stores->Targets[Stores->Count] = (UINT32)(Target - (UINTN)Stores->Code);
+	Stores->Count++;
+}
+
+//
+// Same structure as the matchers in PatchNtoskrnl.c: check the cheap instruction fields first, decode operands last
+//
+STATIC
+BOOLEAN
+EFIAPI
+MatchRipStoreLazy(
+	IN OUT PZYDIS_CONTEXT Context,
+	IN OUT VOID *State
+	)
+{
+	if (Context->Instruction.mnemonic != ZYDIS_MNEMONIC_MOV || Context->Instruction.operand_count != 2 ||
+		(Context->Instruction.attributes & ZYDIS_ATTRIB_IS_RELATIVE) == 0)
+		return FALSE;
+
+	if (ZYAN_SUCCESS(ZydisDecodeOperands(Context)))
+		RecordRipStore(Context, (RIP_STORE_STATE*)State);
+	return FALSE;
+}
+
+STATIC
+BOOLEAN
+EFIAPI
+MatchRipStoreEager(
+	IN OUT PZYDIS_CONTEXT Context,
+	IN OUT VOID *State
+	)
+{
+	if (!ZYAN_SUCCESS(ZydisDecodeOperands(Context)))
+		return FALSE;
+
+	if (Context->Instruction.mnemonic == ZYDIS_MNEMONIC_MOV)
+		RecordRipStore(Context, (RIP_STORE_STATE*)State);
+	return FALSE;
+}
+
+STATIC TEST_INSTRUCTION mGenerated[MAX_INSTRUCTIONS];
+STATIC TEST_INSTRUCTION mSeen[2][MAX_INSTRUCTIONS];
+STATIC RIP_STORE_STATE mLazyStores, mEagerStores;
+
+STATIC
+VOID
+TestDecodeAndMatch(
+	IN UINT8* Code,
+	IN PEFI_IMAGE_NT_HEADERS NtHeaders,
+	IN UINT32 JunkPercent
+	)
+{
+	CONST UINT32 NumGenerated = GenerateTestCode(Code, CODE_SIZE, JunkPercent, mGenerated, MAX_INSTRUCTIONS);
+	UINT32 InstructionBytes = 0, NumRipMovs = 0, NumRipStores = 0;
+	for (UINT32 i = 0; i < NumGenerated; ++i)
+	{
+		InstructionBytes += mGenerated[i].Length;
+		if (mGenerated[i].Mnemonic == ZYDIS_MNEMONIC_MOV && mGenerated[i].Relative)
+			NumRipMovs++;
+		if (mGenerated[i].RipStore)
+			NumRipStores++;
+	}
+
+	// All instructions are seen in order by all matchers, and nothing decodes operands unless a matcher asks for it
+	ZYDIS_CONTEXT Context;
+	TEST_CHECK(ZYAN_SUCCESS(ZydisInit(NtHeaders, &Context)));
+
+	RECORDING_STATE Recordings[2] = { { Code, mSeen[0], 0, 0 }, { Code, mSeen[1], 0, 0 } };
+	INSTRUCTION_MATCHER Matchers[2] = { { RecordInstruction, &Recordings[0] }, { RecordInstruction, &Recordings[1] } };
+	UINT64 OperandDecodes = gToyDecoderOperandDecodes;
+
+	TEST_CHECK(DecodeAndMatch(&Context, Code, CODE_SIZE, Matchers, ARRAY_SIZE(Matchers)) == EFI_NOT_FOUND);
+	TEST_CHECK(!Matchers[0].Done && !Matchers[1].Done);
+	TEST_CHECK(gToyDecoderOperandDecodes == OperandDecodes);
+	TEST_CHECK(Context.InstructionsDecoded == NumGenerated, "decoded %llu, generated %u", (unsigned long long)Context.InstructionsDecoded, NumGenerated);
+	TEST_CHECK(Context.DecodeResyncs == CODE_SIZE - InstructionBytes, "resyncs %llu, junk bytes %u",
+		(unsigned long long)Context.DecodeResyncs, CODE_SIZE - InstructionBytes);
+
+	for (UINT32 m = 0; m < ARRAY_SIZE(Recordings); ++m)
+	{
+		if (!TEST_CHECK(Recordings[m].Count == NumGenerated, "matcher %u saw %u of %u instructions", m, Recordings[m].Count, NumGenerated))
+			continue;
+		for (UINT32 i = 0; i < NumGenerated; ++i)
+		{
+			TEST_CHECK(mSeen[m][i].Offset == mGenerated[i].Offset && mSeen[m][i].Length == mGenerated[i].Length &&
+				mSeen[m][i].Mnemonic == mGenerated[i].Mnemonic, "matcher %u, instruction %u at 0x%x", m, i, mGenerated[i].Offset);
+		}
+	}
+
+	// Matchers that are done receive no more instructions, and decoding stops when all are done
+	CONST UINT32 StopFirst = 1 + TestRandomBelow(NumGenerated / 2), StopSecond = StopFirst + TestRandomBelow(NumGenerated / 2);
+	Recordings[0].Count = Recordings[1].Count = 0;
+	Recordings[0].StopAfter = StopFirst;
+	Recordings[1].StopAfter = StopSecond;
+	TEST_CHECK(ZYAN_SUCCESS(ZydisInit(NtHeaders, &Context)));
+	TEST_CHECK(DecodeAndMatch(&Context, Code, CODE_SIZE, Matchers, ARRAY_SIZE(Matchers)) == EFI_SUCCESS);
+	TEST_CHECK(Matchers[0].Done && Matchers[1].Done);
+	TEST_CHECK(Recordings[0].Count == StopFirst && Recordings[1].Count == StopSecond);
+	TEST_CHECK(Context.InstructionsDecoded == StopSecond);
+
+	// Lazy and eager operand decoding find the same stores. The lazy matcher only decodes operands of rip-relative movs
+	mLazyStores.Code = mEagerStores.Code = Code;
+	mLazyStores.Count = mEagerStores.Count = 0;
+	INSTRUCTION_MATCHER Lazy = { MatchRipStoreLazy, &mLazyStores };
+	INSTRUCTION_MATCHER Eager = { MatchRipStoreEager, &mEagerStores };
+
+	OperandDecodes = gToyDecoderOperandDecodes;
+	TEST_CHECK(ZYAN_SUCCESS(ZydisInit(NtHeaders, &Context)));
+	TEST_CHECK(DecodeAndMatch(&Context, Code, CODE_SIZE, &Lazy, 1) == EFI_NOT_FOUND);
+	CONST UINT64 LazyDecodes = gToyDecoderOperandDecodes - OperandDecodes;
+
+	OperandDecodes = gToyDecoderOperandDecodes;
+	TEST_CHECK(ZYAN_SUCCESS(ZydisInit(NtHeaders, &Context)));
+	TEST_CHECK(DecodeAndMatch(&Context, Code, CODE_SIZE, &Eager, 1) == EFI_NOT_FOUND);
+	CONST UINT64 EagerDecodes = gToyDecoderOperandDecodes - OperandDecodes;
+
+	TEST_CHECK(LazyDecodes == NumRipMovs, "lazy operand decodes %llu, rip-relative movs %u", (unsigned long long)LazyDecodes, NumRipMovs);
+	TEST_CHECK(EagerDecodes == NumGenerated);
+	TEST_CHECK(NumRipStores != 0 && LazyDecodes < EagerDecodes);
+	TEST_CHECK(mLazyStores.Count == NumRipStores && mEagerStores.Count == NumRipStores,
+		"lazy %u, eager %u, generated %u", mLazyStores.Count, mEagerStores.Count, NumRipStores);
+	if (mLazyStores.Count == mEagerStores.Count)
+	{
+		for (UINT32 i = 0; i < mLazyStores.Count; ++i)
+		{
+			TEST_CHECK(mLazyStores.Sites[i] == mEagerStores.Sites[i] && mLazyStores.Targets[i] == mEagerStores.Targets[i],
+				"store %u", i);
+		}
+	}
+
+	// The stores found are the generated ones, with their targets
+	UINT32 Store = 0;
+	for (UINT32 i = 0; i < NumGenerated && Store < mLazyStores.Count; ++i)
+	{
+		if (!mGenerated[i].RipStore)
+			continue;
+		TEST_CHECK(mLazyStores.Sites[Store] == mGenerated[i].Offset && mLazyStores.Targets[Store] == mGenerated[i].Target,
+			"store at 0x%x", mGenerated[i].Offset);
+		Store++;
+	}
+}
+
+int
+main(
+	VOID
+	)
+{
+	CONST TEST_SECTION Sections[] = { { ".text", CODE_SIZE, TEST_SECTION_CODE } };
+	PEFI_IMAGE_NT_HEADERS NtHeaders;
+	UINT32 ImageSize;
+	UINT8* ImageBase = BuildTestImage(Sections, ARRAY_SIZE(Sections), &NtHeaders, &ImageSize);
+	UINT8* Code = ImageBase + TestGetSection(NtHeaders, ".text")->VirtualAddress;
+
+	TestSeedRandom(6);
+	for (UINT32 Iteration = 0; Iteration < 20; ++Iteration)
+		TestDecodeAndMatch(Code, NtHeaders, Iteration % 2 == 0 ? 0 : 10);
+
+	free(ImageBase);
+	return TestSummary("DecodeTests");
+}
@@ -0,0 +1,170 @@
+//
+// Checks BacktrackToFunctionStarts() against BacktrackToFunctionStart() and a linear search of the exception table,
+// for sorted batches with gaps, duplicates and NULLs, unsorted batches, and chained function entries.
+//
+
+#include "Host/HostTest.h"
+
+#define TEXT_SIZE		0x40000
+#define PDATA_SIZE		0x10000
+#define MAX_ADDRESSES	4096
+
+STATIC
+UINT8*
+FindFunctionStartLinear(
+	IN CONST UINT8* ImageBase,
+	IN PEFI_IMAGE_NT_HEADERS NtHeaders,
+	IN CONST UINT8* AddressInFunction
+	)
+{
+	if (AddressInFunction == NULL)
+		return NULL;
+
+	CONST IMAGE_RUNTIME_FUNCTION_ENTRY* Table = (CONST IMAGE_RUNTIME_FUNCTION_ENTRY*)(ImageBase +
+		NtHeaders->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_EXCEPTION].VirtualAddress);
+	CONST UINT32 NumFunctions = NtHeaders->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_EXCEPTION].Size / sizeof(IMAGE_RUNTIME_FUNCTION_ENTRY);
+	CONST UINT32 RelativeAddress = (UINT32)(AddressInFunction - ImageBase);
+
+	for (UINT32 i = 0; i < NumFunctions; ++i)
+	{
+		if (RelativeAddress < Table[i].BeginAddress || RelativeAddress >= Table[i].EndAddress)
+			continue;
+		CONST IMAGE_RUNTIME_FUNCTION_ENTRY* Entry = &Table[i];
+		if ((Entry->u.UnwindData & RUNTIME_FUNCTION_INDIRECT) != 0)
+			Entry = (CONST IMAGE_RUNTIME_FUNCTION_ENTRY*)(ImageBase + Entry->u.UnwindData - 1);
+		return (UINT8*)ImageBase + Entry->BeginAddress;
+	}
+	return NULL;
+}
+
+STATIC CONST UINT8* mAddresses[MAX_ADDRESSES];
+STATIC UINT8* mStarts[MAX_ADDRESSES];
+
+STATIC
+VOID
+CheckBatch(
+	IN CONST UINT8* ImageBase,
+	IN PEFI_IMAGE_NT_HEADERS NtHeaders,
+	IN UINT32 Count
+	)
+{
+	BacktrackToFunctionStarts(ImageBase, NtHeaders, mAddresses, Count, mStarts);
+	for (UINT32 i = 0; i < Count; ++i)
+	{
+		UINT8* Expected = FindFunctionStartLinear(ImageBase, NtHeaders, mAddresses[i]);
+		TEST_CHECK(mStarts[i] == Expected, "address %u (rva 0x%x): batch 0x%x, expected 0x%x", i,
+			mAddresses[i] != NULL ? (UINT32)(mAddresses[i] - ImageBase) : 0,
+			mStarts[i] != NULL ? (UINT32)(mStarts[i] - ImageBase) : 0,
+			Expected != NULL ? (UINT32)(Expected - ImageBase) : 0);
+		TEST_CHECK(BacktrackToFunctionStart(ImageBase, NtHeaders, mAddresses[i]) == Expected);
+	}
+}
+
+STATIC
+INT32
+CompareAddresses(
+	IN CONST VOID* A,
+	IN CONST VOID* B
+	)
+{
+	CONST UINT8* Left = *(CONST UINT8* CONST*)A;
+	CONST UINT8* Right = *(CONST UINT8* CONST*)B;
+	return Left < Right ? -1 : Left > Right;
+}
+
+STATIC
+VOID
+TestBatches(
+	IN UINT8* ImageBase,
+	IN PEFI_IMAGE_NT_HEADERS NtHeaders,
+	IN UINT32 MaxFunctionLength
+	)
+{
+	CONST PEFI_IMAGE_SECTION_HEADER Text = TestGetSection(NtHeaders, ".text");
+	BuildTestFunctionTable(ImageBase, NtHeaders, ".text", ".pdata", MaxFunctionLength, 10);
+
+	// Random addresses from just before to just after .text, with NULLs mixed in
+	CONST UINT32 Count = 1 + TestRandomBelow(MAX_ADDRESSES);
+	for (UINT32 i = 0; i < Count; ++i)
+	{
+		mAddresses[i] = TestRandomBelow(20) == 0
+			? NULL
+			: ImageBase + Text->VirtualAddress - 16 + TestRandomBelow(Text->Misc.VirtualSize + 32);
+	}
+	CheckBatch(ImageBase, NtHeaders, Count);
+
+	// Sorted, where each address is close to the previous one. NULLs sort first, so move them around after sorting
+	qsort(mAddresses, Count, sizeof(mAddresses[0]), (int(*)(CONST VOID*, CONST VOID*))CompareAddresses);
+	for (UINT32 i = 0; i < Count / 20; ++i)
+	{
+		CONST UINT32 Index = TestRandomBelow(Count);
+		CONST UINT8* Swap = mAddresses[Index];
+		mAddresses[Index] = mAddresses[i];
+		mAddresses[i] = Swap;
+	}
+	qsort(mAddresses, Count, sizeof(mAddresses[0]), (int(*)(CONST VOID*, CONST VOID*))CompareAddresses);
+	CheckBatch(ImageBase, NtHeaders, Count);
+
+	// Sorted with duplicates and occasional steps backwards
+	for (UINT32 i = 1; i < Count; ++i)
+	{
+		if (TestRandomBelow(10) == 0)
+			mAddresses[i] = mAddresses[i - 1];
+		else if (TestRandomBelow(50) == 0)
+			mAddresses[i] = mAddresses[TestRandomBelow(i)];
+	}
+	CheckBatch(ImageBase, NtHeaders, Count);
+}
+
+STATIC
+VOID
+TestFunctionBoundaries(
+	IN UINT8* ImageBase,
+	IN PEFI_IMAGE_NT_HEADERS NtHeaders
+	)
+{
+	CONST UINT32 NumFunctions = BuildTestFunctionTable(ImageBase, NtHeaders, ".text", ".pdata", 64, 25);
+	CONST IMAGE_RUNTIME_FUNCTION_ENTRY* Table = (CONST IMAGE_RUNTIME_FUNCTION_ENTRY*)(ImageBase +
+		NtHeaders->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_EXCEPTION].VirtualAddress);
+
+	// First byte, last byte and one past the end of every function, in order
+	UINT32 Count = 0;
+	for (UINT32 i = 0; i < NumFunctions && Count + 3 <= MAX_ADDRESSES; ++i)
+	{
+		mAddresses[Count++] = ImageBase + Table[i].BeginAddress;
+		mAddresses[Count++] = ImageBase + Table[i].EndAddress - 1;
+		mAddresses[Count++] = ImageBase + Table[i].EndAddress;
+	}
+	CheckBatch(ImageBase, NtHeaders, Count);
+
+	// An empty exception directory finds nothing
+	NtHeaders->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_EXCEPTION].Size = 0;
+	BacktrackToFunctionStarts(ImageBase, NtHeaders, mAddresses, Count, mStarts);
+	BOOLEAN AllNull = TRUE;
+	for (UINT32 i = 0; i < Count; ++i)
+		AllNull = AllNull && mStarts[i] == NULL;
+	TEST_CHECK(AllNull);
+}
+
+int
+main(
+	VOID
+	)
+{
+	CONST TEST_SECTION Sections[] =
+	{
+		{ ".text", TEXT_SIZE, TEST_SECTION_CODE },
+		{ ".pdata", PDATA_SIZE, TEST_SECTION_RDATA },
+	};
+	PEFI_IMAGE_NT_HEADERS NtHeaders;
+	UINT32 ImageSize;
+	UINT8* ImageBase = BuildTestImage(Sections, ARRAY_SIZE(Sections), &NtHeaders, &ImageSize);
+
+	TestSeedRandom(10);
+	for (UINT32 Iteration = 0; Iteration < 200; ++Iteration)
+		TestBatches(ImageBase, NtHeaders, Iteration % 2 == 0 ? 64 : 2048);
+	TestFunctionBoundaries(ImageBase, NtHeaders);
+
+	free(ImageBase);
+	return TestSummary("FunctionTableTests");
+}
@@ -0,0 +1,903 @@
+//
+// Host implementations of the EDK2 library functions and globals used by util.c and pe.c.
+// Memory and string functions map to libc, console output goes to stdout, and the print functions
+// implement the subset of the BasePrintLib format syntax that the driver uses.
+//
+
+#include "../../EfiGuardDxe/EfiGuardDxe.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+//
+// Globals normally provided by EfiGuardDxe.c and the EDK2 libraries
+//
+KERNEL_PATCH_INFORMATION gKernelPatchInfo;
+
+EFI_GUID gEfiAcpi20TableGuid = { 0x8868e871, 0xe4f1, 0x11d3, { 0xbc, 0x22, 0x00, 0x80, 0xc7, 0x3c, 0x88, 0x81 } };
+EFI_GUID gEfiGlobalVariableGuid = { 0x8be4df61, 0x93ca, 0x11d2, { 0xaa, 0x0d, 0x00, 0xe0, 0x98, 0x03, 0x2b, 0x8c } };
+EFI_GUID gEfiLoadedImageProtocolGuid = { 0x5b1b31a1, 0x9562, 0x11d2, { 0x8e, 0x3f, 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b } };
+EFI_GUID gEfiShellProtocolGuid = { 0x6302d008, 0x7f9b, 0x4f30, { 0x87, 0xac, 0x60, 0xc9, 0xfe, 0xf5, 0xda, 0x4e } };
+EFI_GUID gEfiEventExitBootServicesGuid = { 0x27abf055, 0xb1b8, 0x4c26, { 0x80, 0x48, 0x74, 0x8f, 0x37, 0xba, 0xa2, 0xdf } };
+EFI_GUID gEfiEventVirtualAddressChangeGuid = { 0x13fa7698, 0xc831, 0x49c7, { 0x87, 0xea, 0x8f, 0x43, 0xfc, 0xc2, 0x51, 0x96 } };
+EFI_GUID gEfiDriverSupportedEfiVersionProtocolGuid = { 0x5c198761, 0x16a8, 0x4e69, { 0x97, 0x2c, 0x89, 0xd6, 0x79, 0x54, 0xf8, 0x1d } };
+EFI_GUID gEfiMpServiceProtocolGuid = EFI_MP_SERVICES_PROTOCOL_GUID;
+
+//
+// Boot services. Events can be signaled from any thread, or wait for their timer; LocateProtocol() only finds the thread backed
+// MP services protocol enabled with HostSetMpServices()
+//
+STATIC
+EFI_STATUS
+EFIAPI
+HostStall(
+	IN UINTN Microseconds
+	)
+{
+	struct timespec Delay = { (time_t)(Microseconds / 1000000), (long)(Microseconds % 1000000) * 1000 };
+	nanosleep(&Delay, NULL);
+	return EFI_SUCCESS;
+}
+
+typedef struct _HOST_EVENT
+{
+	UINT64 TriggerTime;						// In 100 ns units. Waits for a timer event only sleep
+	BOOLEAN Signaled;
+	pthread_mutex_t Lock;
+	pthread_cond_t Condition;
+} HOST_EVENT;
+
+STATIC
+EFI_STATUS
+EFIAPI
+HostCreateEvent(
+	IN UINT32 Type,
+	IN EFI_TPL NotifyTpl,
+	IN EFI_EVENT_NOTIFY NotifyFunction OPTIONAL,
+	IN VOID *NotifyContext OPTIONAL,
+	OUT EFI_EVENT *Event
+	)
+{
+	HOST_EVENT* HostEvent = calloc(1, sizeof(HOST_EVENT));
+	if (HostEvent == NULL)
+		return EFI_OUT_OF_RESOURCES;
+
+	pthread_mutex_init(&HostEvent->Lock, NULL);
+	pthread_cond_init(&HostEvent->Condition, NULL);
+	*Event = HostEvent;
+	return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+HostSetTimer(
+	IN EFI_EVENT Event,
+	IN EFI_TIMER_DELAY Type,
+	IN UINT64 TriggerTime
+	)
+{
+	((HOST_EVENT*)Event)->TriggerTime = TriggerTime;
+	return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+HostWaitForEvent(
+	IN UINTN NumberOfEvents,
+	IN EFI_EVENT *Event,
+	OUT UINTN *Index
+	)
+{
+	HOST_EVENT* HostEvent = (HOST_EVENT*)Event[0];
+	*Index = 0;
+	if (HostEvent->TriggerTime != 0)
+		return HostStall(HostEvent->TriggerTime / 10);
+
+	pthread_mutex_lock(&HostEvent->Lock);
+	while (!HostEvent->Signaled)
+		pthread_cond_wait(&HostEvent->Condition, &HostEvent->Lock);
+	HostEvent->Signaled = FALSE;
+	pthread_mutex_unlock(&HostEvent->Lock);
+	return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+HostCloseEvent(
+	IN EFI_EVENT Event
+	)
+{
+	HOST_EVENT* HostEvent = (HOST_EVENT*)Event;
+	pthread_cond_destroy(&HostEvent->Condition);
+	pthread_mutex_destroy(&HostEvent->Lock);
+	free(HostEvent);
+	return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+HostCheckEvent(
+	IN EFI_EVENT Event
+	)
+{
+	HOST_EVENT* HostEvent = (HOST_EVENT*)Event;
+	pthread_mutex_lock(&HostEvent->Lock);
+	CONST BOOLEAN Signaled = HostEvent->Signaled;
+	HostEvent->Signaled = FALSE;
+	pthread_mutex_unlock(&HostEvent->Lock);
+	return Signaled ? EFI_SUCCESS : EFI_NOT_READY;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+HostSignalEvent(
+	IN EFI_EVENT Event
+	)
+{
+	HOST_EVENT* HostEvent = (HOST_EVENT*)Event;
+	pthread_mutex_lock(&HostEvent->Lock);
+	HostEvent->Signaled = TRUE;
+	pthread_cond_broadcast(&HostEvent->Condition);
+	pthread_mutex_unlock(&HostEvent->Lock);
+	return EFI_SUCCESS;
+}
+
+//
+// MP services. Each AP is a thread that runs the procedure once. In non-blocking mode, a separate thread joins the APs
+// and then signals the wait event, like the timer callback of the real MP driver
+//
+#define HOST_MAX_PROCESSORS		64
+
+STATIC UINT32 mHostNumProcessors = 0;
+STATIC EFI_STATUS mHostStartupStatus = EFI_SUCCESS;
+STATIC volatile BOOLEAN mHostApsBusy = FALSE;
+volatile UINT32 gHostApProceduresRun = 0;
+volatile UINT32 gHostNonBlockingStartups = 0;
+
+typedef struct _HOST_AP_STARTUP
+{
+	EFI_AP_PROCEDURE Procedure;
+	VOID* Argument;
+	EFI_EVENT WaitEvent;
+	pthread_t Threads[HOST_MAX_PROCESSORS];
+	UINT32 NumThreads;
+} HOST_AP_STARTUP;
+
+STATIC
+VOID*
+HostApThread(
+	IN VOID* Argument
+	)
+{
+	HOST_AP_STARTUP* Startup = (HOST_AP_STARTUP*)Argument;
+	Startup->Procedure(Startup->Argument);
+	__atomic_add_fetch(&gHostApProceduresRun, 1, __ATOMIC_SEQ_CST);
+	return NULL;
+}
+
+STATIC
+VOID*
+HostApWaitThread(
+	IN VOID* Argument
+	)
+{
+	HOST_AP_STARTUP* Startup = (HOST_AP_STARTUP*)Argument;
+	for (UINT32 i = 0; i < Startup->NumThreads; ++i)
+		pthread_join(Startup->Threads[i], NULL);
+
+	// The APs are idle again before the event is signaled
+	CONST EFI_EVENT WaitEvent = Startup->WaitEvent;
+	free(Startup);
+	mHostApsBusy = FALSE;
+	if (WaitEvent != NULL)
+		HostSignalEvent(WaitEvent);
+	return NULL;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+HostGetNumberOfProcessors(
+	IN EFI_MP_SERVICES_PROTOCOL *This,
+	OUT UINTN *NumberOfProcessors,
+	OUT UINTN *NumberOfEnabledProcessors
+	)
+{
+	*NumberOfProcessors = *NumberOfEnabledProcessors = mHostNumProcessors;
+	return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+HostStartupAllAPs(
+	IN EFI_MP_SERVICES_PROTOCOL *This,
+	IN EFI_AP_PROCEDURE Procedure,
+	IN BOOLEAN SingleThread,
+	IN EFI_EVENT WaitEvent OPTIONAL,
+	IN UINTN TimeoutInMicroSeconds,
+	IN VOID *ProcedureArgument OPTIONAL,
+	OUT UINTN **FailedCpuList OPTIONAL
+	)
+{
+	if (EFI_ERROR(mHostStartupStatus))
+		return mHostStartupStatus;
+	if (mHostNumProcessors < 2)
+		return EFI_NOT_STARTED;
+	if (mHostApsBusy)
+		return EFI_NOT_READY;
+
+	HOST_AP_STARTUP* Startup = calloc(1, sizeof(HOST_AP_STARTUP));
+	Startup->Procedure = Procedure;
+	Startup->Argument = ProcedureArgument;
+	Startup->WaitEvent = WaitEvent;
+	Startup->NumThreads = mHostNumProcessors - 1;
+	mHostApsBusy = TRUE;
+	for (UINT32 i = 0; i < Startup->NumThreads; ++i)
+		pthread_create(&Startup->Threads[i], NULL, HostApThread, Startup);
+
+	if (WaitEvent == NULL)
+	{
+		HostApWaitThread(Startup);
+		return EFI_SUCCESS;
+	}
+
+	__atomic_add_fetch(&gHostNonBlockingStartups, 1, __ATOMIC_SEQ_CST);
+	pthread_t WaitThread;
+	pthread_create(&WaitThread, NULL, HostApWaitThread, Startup);
+	pthread_detach(WaitThread);
+	return EFI_SUCCESS;
+}
+
+STATIC EFI_MP_SERVICES_PROTOCOL mHostMpServices =
+{
+	.GetNumberOfProcessors = HostGetNumberOfProcessors,
+	.StartupAllAPs = HostStartupAllAPs,
+};
+
+VOID
+HostSetMpServices(
+	IN UINT32 NumProcessors,
+	IN EFI_STATUS StartupStatus
+	)
+{
+	mHostNumProcessors = MIN(NumProcessors, HOST_MAX_PROCESSORS);
+	mHostStartupStatus = StartupStatus;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+HostLocateProtocol(
+	IN EFI_GUID *Protocol,
+	IN VOID *Registration OPTIONAL,
+	OUT VOID **Interface
+	)
+{
+	*Interface = NULL;
+	if (mHostNumProcessors == 0 || !CompareGuid(Protocol, &gEfiMpServiceProtocolGuid))
+		return EFI_NOT_FOUND;
+
+	*Interface = &mHostMpServices;
+	return EFI_SUCCESS;
+}
+
+STATIC EFI_BOOT_SERVICES mBootServices =
+{
+	.CreateEvent = HostCreateEvent,
+	.SetTimer = HostSetTimer,
+	.WaitForEvent = HostWaitForEvent,
+	.CloseEvent = HostCloseEvent,
+	.CheckEvent = HostCheckEvent,
+	.SignalEvent = HostSignalEvent,
+	.LocateProtocol = HostLocateProtocol,
+	.Stall = HostStall,
+};
+
+//
+// Runtime services. Variables are accepted and dropped
+//
+STATIC
+EFI_STATUS
+EFIAPI
+HostSetVariable(
+	IN CHAR16 *VariableName,
+	IN EFI_GUID *VendorGuid,
+	IN UINT32 Attributes,
+	IN UINTN DataSize,
+	IN VOID *Data
+	)
+{
+	return EFI_SUCCESS;
+}
+
+STATIC EFI_RUNTIME_SERVICES mRuntimeServices =
+{
+	.SetVariable = HostSetVariable,
+};
+
+//
+// Console output. Characters are truncated to 8 bits, which is fine for the ASCII-only driver messages.
+// While a capture buffer is set, output is appended to it unchanged instead
+//
+STATIC CHAR16* mCaptureBuffer = NULL;
+STATIC UINTN mCaptureLength = 0;
+STATIC UINTN mCaptureMaxLength = 0;
+
+VOID
+HostCaptureConsole(
+	OUT CHAR16* Buffer OPTIONAL,
+	IN UINTN MaxLength
+	)
+{
+	mCaptureBuffer = Buffer;
+	mCaptureLength = 0;
+	mCaptureMaxLength = MaxLength;
+	if (Buffer != NULL && MaxLength > 0)
+		Buffer[0] = CHAR_NULL;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+HostOutputString(
+	IN EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL *This,
+	IN CHAR16 *String
+	)
+{
+	if (mCaptureBuffer != NULL)
+	{
+		for (; *String != CHAR_NULL && mCaptureLength + 1 < mCaptureMaxLength; ++String)
+			mCaptureBuffer[mCaptureLength++] = *String;
+		mCaptureBuffer[mCaptureLength] = CHAR_NULL;
+		return EFI_SUCCESS;
+	}
+
+	for (; *String != CHAR_NULL; ++String)
+	{
+		if (*String != L'\r')
+			putchar((CHAR8)*String);
+	}
+	return EFI_SUCCESS;
+}
+
+STATIC EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL mConOut =
+{
+	.OutputString = HostOutputString,
+};
+
+STATIC EFI_SYSTEM_TABLE mSystemTable =
+{
+	.ConOut = &mConOut,
+	.RuntimeServices = &mRuntimeServices,
+	.BootServices = &mBootServices,
+};
+
+EFI_BOOT_SERVICES *gBS = &mBootServices;
+EFI_RUNTIME_SERVICES *gRT = &mRuntimeServices;
+EFI_SYSTEM_TABLE *gST = &mSystemTable;
+EFI_HANDLE gImageHandle = NULL;
+
+EFI_TPL
+EFIAPI
+EfiGetCurrentTpl(
+	VOID
+	)
+{
+	return TPL_APPLICATION;
+}
+
+CHAR16*
+EFIAPI
+ConvertDevicePathToText(
+	IN CONST EFI_DEVICE_PATH_PROTOCOL *DevicePath,
+	IN BOOLEAN DisplayOnly,
+	IN BOOLEAN AllowShortcuts
+	)
+{
+	return NULL;
+}
+
+//
+// BaseLib. There are no control registers or MSRs to read in user mode, so these report WP and LA57 as off
+//
+UINTN EFIAPI AsmReadCr0(VOID) { return 0; }
+UINTN EFIAPI AsmWriteCr0(IN UINTN Cr0) { return Cr0; }
+UINTN EFIAPI AsmReadCr4(VOID) { return 0; }
+UINT64 EFIAPI AsmReadMsr64(IN UINT32 Index) { return 0; }
+
+UINT64
+EFIAPI
+AsmReadTsc(
+	VOID
+	)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __builtin_ia32_rdtsc();
+#else
+	struct timespec Now;
+	clock_gettime(CLOCK_MONOTONIC, &Now);
+	return (UINT64)Now.tv_sec * 1000000000ULL + (UINT64)Now.tv_nsec;
+#endif
+}
+
+VOID
+EFIAPI
+CpuPause(
+	VOID
+	)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#endif
+}
+
+UINTN
+EFIAPI
+StrLen(
+	IN CONST CHAR16 *String
+	)
+{
+	UINTN Length = 0;
+	while (String[Length] != CHAR_NULL)
+		Length++;
+	return Length;
+}
+
+INTN
+EFIAPI
+StrnCmp(
+	IN CONST CHAR16 *FirstString,
+	IN CONST CHAR16 *SecondString,
+	IN UINTN Length
+	)
+{
+	if (Length == 0)
+		return 0;
+
+	while (*FirstString != CHAR_NULL && *FirstString == *SecondString && Length > 1)
+	{
+		FirstString++;
+		SecondString++;
+		Length--;
+	}
+	return (INTN)*FirstString - (INTN)*SecondString;
+}
+
+INTN
+EFIAPI
+StrCmp(
+	IN CONST CHAR16 *FirstString,
+	IN CONST CHAR16 *SecondString
+	)
+{
+	return StrnCmp(FirstString, SecondString, MAX_UINTN);
+}
+
+CHAR16*
+EFIAPI
+StrStr(
+	IN CONST CHAR16 *String,
+	IN CONST CHAR16 *SearchString
+	)
+{
+	CONST UINTN SearchLength = StrLen(SearchString);
+	for (; *String != CHAR_NULL; ++String)
+	{
+		if (StrnCmp(String, SearchString, SearchLength) == 0)
+			return (CHAR16*)String;
+	}
+	return SearchLength == 0 ? (CHAR16*)String : NULL;
+}
+
+RETURN_STATUS
+EFIAPI
+StrnCpyS(
+	OUT CHAR16 *Destination,
+	IN UINTN DestMax,
+	IN CONST CHAR16 *Source,
+	IN UINTN Length
+	)
+{
+	UINTN i = 0;
+	for (; i < Length && Source[i] != CHAR_NULL; ++i)
+	{
+		if (i + 1 >= DestMax)
+			return EFI_BUFFER_TOO_SMALL;
+		Destination[i] = Source[i];
+	}
+	Destination[i] = CHAR_NULL;
+	return EFI_SUCCESS;
+}
+
+CHAR16
+EFIAPI
+CharToUpper(
+	IN CHAR16 Char
+	)
+{
+	return (Char >= L'a' && Char <= L'z') ? (CHAR16)(Char - (L'a' - L'A')) : Char;
+}
+
+UINTN EFIAPI AsciiStrLen(IN CONST CHAR8 *String) { return strlen(String); }
+INTN EFIAPI AsciiStrCmp(IN CONST CHAR8 *FirstString, IN CONST CHAR8 *SecondString) { return strcmp(FirstString, SecondString); }
+INTN EFIAPI AsciiStrnCmp(IN CONST CHAR8 *FirstString, IN CONST CHAR8 *SecondString, IN UINTN Length) { return strncmp(FirstString, SecondString, Length); }
+
+INTN
+EFIAPI
+AsciiStriCmp(
+	IN CONST CHAR8 *FirstString,
+	IN CONST CHAR8 *SecondString
+	)
+{
+	CHAR8 First, Second;
+	do
+	{
+		First = *FirstString++;
+		Second = *SecondString++;
+		if (First >= 'a' && First <= 'z')
+			First -= 'a' - 'A';
+		if (Second >= 'a' && Second <= 'z')
+			Second -= 'a' - 'A';
+	} while (First != '\0' && First == Second);
+	return (INTN)(UINT8)First - (INTN)(UINT8)Second;
+}
+
+UINT64 EFIAPI LShiftU64(IN UINT64 Operand, IN UINTN Count) { return Operand << Count; }
+UINT64 EFIAPI RShiftU64(IN UINT64 Operand, IN UINTN Count) { return Operand >> Count; }
+INTN EFIAPI LowBitSet32(IN UINT32 Operand) { return Operand != 0 ? __builtin_ctz(Operand) : -1; }
+INTN EFIAPI LowBitSet64(IN UINT64 Operand) { return Operand != 0 ? __builtin_ctzll(Operand) : -1; }
+INTN EFIAPI HighBitSet32(IN UINT32 Operand) { return Operand != 0 ? 31 - __builtin_clz(Operand) : -1; }
+UINT64 EFIAPI DivU64x32(IN UINT64 Dividend, IN UINT32 Divisor) { return Dividend / Divisor; }
+UINT64 EFIAPI MultU64x32(IN UINT64 Multiplicand, IN UINT32 Multiplier) { return Multiplicand * Multiplier; }
+UINT16 EFIAPI ReadUnaligned16(IN CONST UINT16 *Buffer) { UINT16 Value; memcpy(&Value, Buffer, sizeof(Value)); return Value; }
+UINT32 EFIAPI ReadUnaligned32(IN CONST UINT32 *Buffer) { UINT32 Value; memcpy(&Value, Buffer, sizeof(Value)); return Value; }
+UINT64 EFIAPI ReadUnaligned64(IN CONST UINT64 *Buffer) { UINT64 Value; memcpy(&Value, Buffer, sizeof(Value)); return Value; }
+
+//
+// BaseMemoryLib
+//
+VOID* EFIAPI CopyMem(OUT VOID *DestinationBuffer, IN CONST VOID *SourceBuffer, IN UINTN Length) { return memmove(DestinationBuffer, SourceBuffer, Length); }
+VOID* EFIAPI SetMem(OUT VOID *Buffer, IN UINTN Length, IN UINT8 Value) { return memset(Buffer, Value, Length); }
+VOID* EFIAPI ZeroMem(OUT VOID *Buffer, IN UINTN Length) { return memset(Buffer, 0, Length); }
+INTN EFIAPI CompareMem(IN CONST VOID *DestinationBuffer, IN CONST VOID *SourceBuffer, IN UINTN Length) { return memcmp(DestinationBuffer, SourceBuffer, Length); }
+BOOLEAN EFIAPI CompareGuid(IN CONST GUID *Guid1, IN CONST GUID *Guid2) { return memcmp(Guid1, Guid2, sizeof(GUID)) == 0; }
+VOID* EFIAPI ScanMem8(IN CONST VOID *Buffer, IN UINTN Length, IN UINT8 Value) { return memchr(Buffer, Value, Length); }
+
+VOID*
+EFIAPI
+SetMem64(
+	OUT VOID *Buffer,
+	IN UINTN Length,
+	IN UINT64 Value
+	)
+{
+	for (UINTN i = 0; i < Length / sizeof(UINT64); ++i)
+		((UINT64*)Buffer)[i] = Value;
+	return Buffer;
+}
+
+//
+// MemoryAllocationLib
+//
+VOID* EFIAPI AllocatePool(IN UINTN AllocationSize) { return malloc(AllocationSize); }
+VOID* EFIAPI AllocateZeroPool(IN UINTN AllocationSize) { return calloc(1, AllocationSize); }
+VOID EFIAPI FreePool(IN VOID *Buffer) { free(Buffer); }
+
+VOID*
+EFIAPI
+ReallocatePool(
+	IN UINTN OldSize,
+	IN UINTN NewSize,
+	IN VOID *OldBuffer OPTIONAL
+	)
+{
+	// Like the EDK2 version, always move to a new buffer, so a caller holding on to the old pointer is caught by ASan
+	VOID* NewBuffer = malloc(NewSize);
+	if (NewBuffer != NULL && OldBuffer != NULL)
+	{
+		memcpy(NewBuffer, OldBuffer, MIN(OldSize, NewSize));
+		free(OldBuffer);
+	}
+	return NewBuffer;
+}
+
+//
+// SynchronizationLib
+//
+UINT32 EFIAPI InterlockedIncrement(IN volatile UINT32 *Value) { return __atomic_add_fetch(Value, 1, __ATOMIC_SEQ_CST); }
+UINT32 EFIAPI InterlockedDecrement(IN volatile UINT32 *Value) { return __atomic_sub_fetch(Value, 1, __ATOMIC_SEQ_CST); }
+
+UINT32
+EFIAPI
+InterlockedCompareExchange32(
+	IN OUT volatile UINT32 *Value,
+	IN UINT32 CompareValue,
+	IN UINT32 ExchangeValue
+	)
+{
+	__atomic_compare_exchange_n(Value, &CompareValue, ExchangeValue, FALSE, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+	return CompareValue;
+}
+
+VOID*
+EFIAPI
+InterlockedCompareExchangePointer(
+	IN OUT VOID * volatile *Value,
+	IN VOID *CompareValue,
+	IN VOID *ExchangeValue
+	)
+{
+	__atomic_compare_exchange_n(Value, &CompareValue, ExchangeValue, FALSE, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+	return CompareValue;
+}
+
+//
+// PrintLib. The arguments come either from a VA_LIST or from a BASE_LIST, and are read with the same types
+// as BasePrintLib reads them. This is what the deferred kernel patch messages depend on.
+// Supported: flags '-', '0', ',' (ignored), '+', ' '; width and precision with '*'; 'l'/'L'; types d u x X p s S a c r g t %
+//
+typedef struct _PRINT_ARGUMENTS
+{
+	BASE_LIST BaseList;						// NULL to read from VaList
+	VA_LIST VaList;
+} PRINT_ARGUMENTS;
+
+#define PRINT_ARGUMENT(Arguments, TYPE) \
+	((Arguments)->BaseList != NULL ? BASE_ARG((Arguments)->BaseList, TYPE) : VA_ARG((Arguments)->VaList, TYPE))
+
+typedef struct _PRINT_BUFFER
+{
+	CHAR16* Buffer;
+	UINTN MaxLength;						// Excluding the terminator
+	UINTN Length;
+} PRINT_BUFFER;
+
+STATIC
+VOID
+PrintCharacter(
+	IN OUT PRINT_BUFFER* Output,
+	IN CHAR16 Character
+	)
+{
+	if (Output->Length < Output->MaxLength)
+		Output->Buffer[Output->Length++] = Character;
+}
+
+STATIC
+VOID
+PrintPadded(
+	IN OUT PRINT_BUFFER* Output,
+	IN CONST CHAR8* Ascii OPTIONAL,
+	IN CONST CHAR16* Unicode OPTIONAL,
+	IN UINTN Length,
+	IN UINTN Width,
+	IN BOOLEAN LeftJustify,
+	IN CHAR16 Pad
+	)
+{
+	if (!LeftJustify)
+	{
+		for (UINTN i = Length; i < Width; ++i)
+			PrintCharacter(Output, Pad);
+	}
+	for (UINTN i = 0; i < Length; ++i)
+		PrintCharacter(Output, Ascii != NULL ? (CHAR16)(UINT8)Ascii[i] : Unicode[i]);
+	if (LeftJustify)
+	{
+		for (UINTN i = Length; i < Width; ++i)
+			PrintCharacter(Output, L' ');
+	}
+}
+
+STATIC
+UINTN
+FormatPrintString(
+	OUT CHAR16 *StartOfBuffer,
+	IN UINTN BufferSize,
+	IN CONST CHAR16 *Format,
+	IN OUT PRINT_ARGUMENTS *Arguments
+	)
+{
+	if (BufferSize < sizeof(CHAR16))
+		return 0;
+
+	PRINT_BUFFER Output = { StartOfBuffer, BufferSize / sizeof(CHAR16) - 1, 0 };
+	for (; *Format != CHAR_NULL; ++Format)
+	{
+		if (*Format != L'%')
+		{
+			PrintCharacter(&Output, *Format);
+			continue;
+		}
+
+		BOOLEAN LeftJustify = FALSE, ZeroPad = FALSE, Long = FALSE, HavePrecision = FALSE, Sign = FALSE, Space = FALSE;
+		UINTN Width = 0, Precision = 0;
+		CHAR16 Type;
+		while ((Type = *++Format) != CHAR_NULL)
+		{
+			if (Type == L'-')
+				LeftJustify = TRUE;
+			else if (Type == L'+')
+				Sign = TRUE;
+			else if (Type == L' ')
+				Space = TRUE;
+			else if (Type == L',')
+				continue;
+			else if (Type == L'0' && !HavePrecision && Width == 0)
+				ZeroPad = TRUE;
+			else if (Type == L'.')
+				HavePrecision = TRUE;
+			else if (Type == L'*')
+			{
+				if (HavePrecision)
+					Precision = PRINT_ARGUMENT(Arguments, UINTN);
+				else
+					Width = PRINT_ARGUMENT(Arguments, UINTN);
+			}
+			else if (Type >= L'0' && Type <= L'9')
+			{
+				if (HavePrecision)
+					Precision = Precision * 10 + (Type - L'0');
+				else
+					Width = Width * 10 + (Type - L'0');
+			}
+			else if (Type == L'l' || Type == L'L')
+				Long = TRUE;
+			else
+				break;
+		}
+		if (Type == CHAR_NULL)
+			break;
+
+		CHAR8 Number[64];
+		switch (Type)
+		{
+			case L'd':
+			{
+				CONST INT64 Value = Long ? PRINT_ARGUMENT(Arguments, INT64) : PRINT_ARGUMENT(Arguments, int);
+				snprintf(Number, sizeof(Number), Sign ? "%+lld" : (Space ? "% lld" : "%lld"), (long long)Value);
+				PrintPadded(&Output, Number, NULL, strlen(Number), MAX(Width, Precision), LeftJustify, ZeroPad ? L'0' : L' ');
+				break;
+			}
+			case L'u':
+			case L'x':
+			case L'X':
+			{
+				CONST UINT64 Value = Long ? PRINT_ARGUMENT(Arguments, UINT64) : (UINT32)PRINT_ARGUMENT(Arguments, int);
+				snprintf(Number, sizeof(Number), Type == L'u' ? "%llu" : (Type == L'x' ? "%llx" : "%llX"), (unsigned long long)Value);
+				PrintPadded(&Output, Number, NULL, strlen(Number), MAX(Width, Precision), LeftJustify, ZeroPad ? L'0' : L' ');
+				break;
+			}
+			case L'p':
+			{
+				snprintf(Number, sizeof(Number), "%016llX", (unsigned long long)(UINTN)PRINT_ARGUMENT(Arguments, VOID*));
+				PrintPadded(&Output, Number, NULL, strlen(Number), Width, LeftJustify, L' ');
+				break;
+			}
+			case L'r':
+			{
+				snprintf(Number, sizeof(Number), "Status 0x%llX", (unsigned long long)PRINT_ARGUMENT(Arguments, RETURN_STATUS));
+				PrintPadded(&Output, Number, NULL, strlen(Number), Width, LeftJustify, L' ');
+				break;
+			}
+			case L'c':
+			{
+				CONST CHAR16 Character = (CHAR16)PRINT_ARGUMENT(Arguments, UINTN);
+				PrintPadded(&Output, NULL, &Character, 1, Width, LeftJustify, L' ');
+				break;
+			}
+			case L's':
+			case L'S':
+			case L'a':
+			{
+				CONST VOID* String = PRINT_ARGUMENT(Arguments, VOID*);
+				if (String == NULL)
+				{
+					PrintPadded(&Output, "<null string>", NULL, 13, Width, LeftJustify, L' ');
+					break;
+				}
+				UINTN Length = Type == L'a' ? strlen((CONST CHAR8*)String) : StrLen((CONST CHAR16*)String);
+				if (HavePrecision)
+					Length = MIN(Length, Precision);
+				PrintPadded(&Output, Type == L'a' ? (CONST CHAR8*)String : NULL, Type == L'a' ? NULL : (CONST CHAR16*)String,
+					Length, Width, LeftJustify, L' ');
+				break;
+			}
+			case L'g':
+			{
+				CONST GUID* Guid = PRINT_ARGUMENT(Arguments, GUID*);
+				snprintf(Number, sizeof(Number), "%08x-%04x-%04x-%02x%02x-%02x%02x%02x%02x%02x%02x",
+					Guid->Data1, Guid->Data2, Guid->Data3, Guid->Data4[0], Guid->Data4[1], Guid->Data4[2],
+					Guid->Data4[3], Guid->Data4[4], Guid->Data4[5], Guid->Data4[6], Guid->Data4[7]);
+				PrintPadded(&Output, Number, NULL, strlen(Number), Width, LeftJustify, L' ');
+				break;
+			}
+			case L't':
+			{
+				// EFI_TIME is not used by the driver; print the pointer so that a wrong argument slot still shows up in a diff
+				snprintf(Number, sizeof(Number), "<time %p>", PRINT_ARGUMENT(Arguments, VOID*));
+				PrintPadded(&Output, Number, NULL, strlen(Number), Width, LeftJustify, L' ');
+				break;
+			}
+			case L'%':
+			default:
+				PrintCharacter(&Output, Type);
+				break;
+		}
+	}
+
+	StartOfBuffer[Output.Length] = CHAR_NULL;
+	return Output.Length;
+}
+
+UINTN
+EFIAPI
+UnicodeVSPrint(
+	OUT CHAR16 *StartOfBuffer,
+	IN UINTN BufferSize,
+	IN CONST CHAR16 *FormatString,
+	IN VA_LIST Marker
+	)
+{
+	PRINT_ARGUMENTS Arguments;
+	Arguments.BaseList = NULL;
+	VA_COPY(Arguments.VaList, Marker);
+	CONST UINTN Length = FormatPrintString(StartOfBuffer, BufferSize, FormatString, &Arguments);
+	VA_END(Arguments.VaList);
+	return Length;
+}
+
+UINTN
+EFIAPI
+UnicodeBSPrint(
+	OUT CHAR16 *StartOfBuffer,
+	IN UINTN BufferSize,
+	IN CONST CHAR16 *FormatString,
+	IN BASE_LIST Marker
+	)
+{
+	PRINT_ARGUMENTS Arguments;
+	Arguments.BaseList = Marker;
+	return FormatPrintString(StartOfBuffer, BufferSize, FormatString, &Arguments);
+}
+
+UINTN
+EFIAPI
+UnicodeSPrint(
+	OUT CHAR16 *StartOfBuffer,
+	IN UINTN BufferSize,
+	IN CONST CHAR16 *FormatString,
+	...
+	)
+{
+	VA_LIST Marker;
+	VA_START(Marker, FormatString);
+	CONST UINTN Length = UnicodeVSPrint(StartOfBuffer, BufferSize, FormatString, Marker);
+	VA_END(Marker);
+	return Length;
+}
+
+UINTN
+EFIAPI
+Print(
+	IN CONST CHAR16 *Format,
+	...
+	)
+{
+	CHAR16 Buffer[1024];
+	VA_LIST Marker;
+	VA_START(Marker, Format);
+	CONST UINTN Length = UnicodeVSPrint(Buffer, sizeof(Buffer), Format, Marker);
+	VA_END(Marker);
+	gST->ConOut->OutputString(gST->ConOut, Buffer);
+	return Length;
+}
@@ -0,0 +1,358 @@
+#include "HostTest.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+UINT64 gTestChecks = 0;
+UINT64 gTestFailures = 0;
+
+STATIC UINT64 mRandomState = 0x9E3779B97F4A7C15ULL;
+
+VOID
+TestSeedRandom(
+	IN UINT64 Seed
+	)
+{
+	mRandomState = Seed != 0 ? Seed : 0x9E3779B97F4A7C15ULL;
+}
+
+UINT64
+TestRandom(
+	VOID
+	)
+{
+	mRandomState ^= mRandomState >> 12;
+	mRandomState ^= mRandomState << 25;
+	mRandomState ^= mRandomState >> 27;
+	return mRandomState * 0x2545F4914F6CDD1DULL;
+}
+
+UINT32
+TestRandomBelow(
+	IN UINT32 Limit
+	)
+{
+	return (UINT32)((TestRandom() >> 32) % Limit);
+}
+
+VOID
+TestRandomBytes(
+	OUT UINT8* Buffer,
+	IN UINTN Size,
+	IN UINT32 Alphabet
+	)
+{
+	for (UINTN i = 0; i < Size; ++i)
+		Buffer[i] = (UINT8)TestRandomBelow(Alphabet);
+}
+
+VOID
+TestReportFailure(
+	IN CONST CHAR8* File,
+	IN UINT32 Line,
+	IN CONST CHAR8* Condition
+	)
+{
+	// Only the first few failures are interesting; a broken search tends to fail thousands of random cases
+	if (gTestFailures <= 20)
+		printf("%s:%u: check failed: %s\n", File, Line, Condition);
+}
+
+int
+TestSummary(
+	IN CONST CHAR8* Name
+	)
+{
+	printf("%s: %llu checks, %llu failures\n", Name, (unsigned long long)gTestChecks, (unsigned long long)gTestFailures);
+	return gTestFailures == 0 && gTestChecks > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+UINT64
+TestNowNs(
+	VOID
+	)
+{
+	struct timespec Now;
+	clock_gettime(CLOCK_MONOTONIC, &Now);
+	return (UINT64)Now.tv_sec * 1000000000ULL + (UINT64)Now.tv_nsec;
+}
+
+STATIC
+VOID
+WriteRel32(
+	OUT UINT8* Code,
+	IN UINT32 Offset,
+	IN UINT32 Target,
+	IN UINT32 NextInstruction
+	)
+{
+	CONST INT32 Rel32 = (INT32)(Target - NextInstruction);
+	CopyMem(Code + Offset, &Rel32, sizeof(Rel32));
+}
+
+UINT32
+GenerateTestCode(
+	OUT UINT8* Code,
+	IN UINT32 Size,
+	IN UINT32 JunkPercent,
+	OUT TEST_INSTRUCTION* Instructions OPTIONAL,
+	IN UINT32 MaxInstructions
+	)
+{
+	UINT32 Offset = 0, Count = 0;
+	while (Offset < Size && (Instructions == NULL || Count < MaxInstructions))
+	{
+		if (JunkPercent != 0 && TestRandomBelow(100) < JunkPercent && Offset + 1 < Size)
+			Code[Offset++] = 0x06; // Invalid in 64-bit mode
+
+		TEST_INSTRUCTION Instruction;
+		ZeroMem(&Instruction, sizeof(Instruction));
+		Instruction.Offset = Offset;
+		Instruction.Target = TestRandomBelow(Size);
+
+		CONST UINT8 Rex = 0x40 | (UINT8)TestRandomBelow(16);
+		CONST UINT8 Reg = (UINT8)TestRandomBelow(8);
+		UINT8 Bytes[10];
+		UINT8 Length;
+		CONST UINT32 Kind = TestRandomBelow(14);
+		switch (Kind)
+		{
+			case 0:		// call rel32
+			case 1:		// jmp rel32
+				Bytes[0] = Kind == 0 ? 0xE8 : 0xE9;
+				Length = 5;
+				Instruction.Mnemonic = Bytes[0] == 0xE8 ? ZYDIS_MNEMONIC_CALL : ZYDIS_MNEMONIC_JMP;
+				Instruction.Relative = TRUE;
+				break;
+			case 2:		// jmp rel8
+			{
+				Bytes[0] = 0xEB;
+				INT8 Rel8 = (INT8)TestRandomBelow(256);
+				if ((INT64)Offset + 2 + Rel8 < 0 || (INT64)Offset + 2 + Rel8 >= Size)
+					Rel8 = 0;
+				Bytes[1] = (UINT8)Rel8;
+				Length = 2;
+				Instruction.Mnemonic = ZYDIS_MNEMONIC_JMP;
+				Instruction.Relative = TRUE;
+				Instruction.Target = Offset + 2 + Rel8;
+				break;
+			}
+			case 3:		// call/jmp [rip+disp32]
+				Bytes[0] = 0xFF;
+				Bytes[1] = TestRandomBelow(2) == 0 ? 0x15 : 0x25;
+				Length = 6;
+				Instruction.Mnemonic = Bytes[1] == 0x15 ? ZYDIS_MNEMONIC_CALL : ZYDIS_MNEMONIC_JMP;
+				Instruction.Relative = TRUE;
+				break;
+			case 4:		// lea reg, [rip+disp32]
+			case 5:		// mov reg, [rip+disp32]
+			case 6:		// mov [rip+disp32], reg
+			{
+				CONST UINT8 Opcodes[] = { 0x8D, 0x8B, 0x89 };
+				Bytes[0] = Rex;
+				Bytes[1] = Opcodes[TestRandomBelow(3)];
+				Bytes[2] = (UINT8)(0x05 | (Reg << 3));
+				Length = 7;
+				Instruction.Mnemonic = Bytes[1] == 0x8D ? ZYDIS_MNEMONIC_LEA : ZYDIS_MNEMONIC_MOV;
+				Instruction.Relative = TRUE;
+				Instruction.RipStore = Bytes[1] == 0x89;
+				break;
+			}
+			case 7:		// mov reg, [reg+disp8]
+				Bytes[0] = Rex;
+				Bytes[1] = 0x8B;
+				Bytes[2] = (UINT8)(0x40 | (Reg << 3) | TestRandomBelow(4));
+				Bytes[3] = (UINT8)TestRandom();
+				Length = 4;
+				Instruction.Mnemonic = ZYDIS_MNEMONIC_MOV;
+				break;
+			case 8:		// mov reg, reg
+				Bytes[0] = Rex;
+				Bytes[1] = 0x89;
+				Bytes[2] = (UINT8)(0xC0 | (Reg << 3) | TestRandomBelow(8));
+				Length = 3;
+				Instruction.Mnemonic = ZYDIS_MNEMONIC_MOV;
+				break;
+			case 9:		// mov reg, imm32
+				Bytes[0] = (UINT8)(0xB8 + Reg);
+				for (UINT8 i = 1; i < 5; ++i)
+					Bytes[i] = (UINT8)TestRandom();
+				Length = 5;
+				Instruction.Mnemonic = ZYDIS_MNEMONIC_MOV;
+				break;
+			case 10:	// mov reg, imm64
+				Bytes[0] = 0x48;
+				Bytes[1] = (UINT8)(0xB8 + Reg);
+				for (UINT8 i = 2; i < 10; ++i)
+					Bytes[i] = (UINT8)TestRandom();
+				Length = 10;
+				Instruction.Mnemonic = ZYDIS_MNEMONIC_MOV;
+				break;
+			case 11:
+				Bytes[0] = 0xC3;
+				Length = 1;
+				Instruction.Mnemonic = ZYDIS_MNEMONIC_RET;
+				break;
+			case 12:
+				Bytes[0] = 0xCC;
+				Length = 1;
+				Instruction.Mnemonic = ZYDIS_MNEMONIC_INT3;
+				break;
+			default:
+				Bytes[0] = 0x90;
+				Length = 1;
+				Instruction.Mnemonic = ZYDIS_MNEMONIC_NOP;
+				break;
+		}
+
+		// Fill the rest of the buffer with nops if the instruction does not fit
+		if (Offset + Length > Size)
+		{
+			Bytes[0] = 0x90;
+			Length = 1;
+			Instruction.Mnemonic = ZYDIS_MNEMONIC_NOP;
+			Instruction.Relative = FALSE;
+			Instruction.RipStore = FALSE;
+		}
+
+		CopyMem(Code + Offset, Bytes, Length);
+		if (Instruction.Relative && Bytes[0] != 0xEB)
+			WriteRel32(Code, Offset + Length - 4, Instruction.Target, Offset + Length);
+		if (!Instruction.Relative)
+			Instruction.Target = 0;
+
+		Instruction.Length = Length;
+		if (Instructions != NULL)
+			Instructions[Count] = Instruction;
+		Count++;
+		Offset += Length;
+	}
+
+	// Anything left after MaxInstructions is padding
+	SetMem(Code + Offset, Size - Offset, 0x06);
+	return Count;
+}
+
+UINT8*
+BuildTestImage(
+	IN CONST TEST_SECTION* Sections,
+	IN UINT32 NumSections,
+	OUT PEFI_IMAGE_NT_HEADERS* NtHeaders,
+	OUT UINT32* ImageSize
+	)
+{
+	UINT32 Size = TEST_IMAGE_HEADERS_SIZE;
+	for (UINT32 i = 0; i < NumSections; ++i)
+		Size += ALIGN_VALUE(Sections[i].Size, 0x1000);
+
+	UINT8* ImageBase = aligned_alloc(0x1000, Size);
+	if (ImageBase == NULL)
+		abort();
+	memset(ImageBase, 0, Size);
+
+	EFI_IMAGE_DOS_HEADER* DosHeader = (EFI_IMAGE_DOS_HEADER*)ImageBase;
+	DosHeader->e_magic = EFI_IMAGE_DOS_SIGNATURE;
+	DosHeader->e_lfanew = 0x80;
+
+	PEFI_IMAGE_NT_HEADERS Nt = (PEFI_IMAGE_NT_HEADERS)(ImageBase + DosHeader->e_lfanew);
+	Nt->Signature = EFI_IMAGE_NT_SIGNATURE;
+	Nt->FileHeader.Machine = IMAGE_FILE_MACHINE_X64;
+	Nt->FileHeader.NumberOfSections = (UINT16)NumSections;
+	Nt->FileHeader.SizeOfOptionalHeader = sizeof(EFI_IMAGE_OPTIONAL_HEADER64);
+	Nt->OptionalHeader.Magic = EFI_IMAGE_NT_OPTIONAL_HDR64_MAGIC;
+	Nt->OptionalHeader.ImageBase = (UINTN)ImageBase;
+	Nt->OptionalHeader.SectionAlignment = 0x1000;
+	Nt->OptionalHeader.FileAlignment = 0x1000;
+	Nt->OptionalHeader.SizeOfImage = Size;
+	Nt->OptionalHeader.SizeOfHeaders = TEST_IMAGE_HEADERS_SIZE;
+	Nt->OptionalHeader.Subsystem = EFI_IMAGE_SUBSYSTEM_NATIVE;
+	Nt->OptionalHeader.NumberOfRvaAndSizes = EFI_IMAGE_NUMBER_OF_DIRECTORY_ENTRIES;
+
+	PEFI_IMAGE_SECTION_HEADER Section = IMAGE_FIRST_SECTION(Nt);
+	if ((UINT8*)(Section + NumSections) > ImageBase + TEST_IMAGE_HEADERS_SIZE)
+		abort();
+
+	UINT32 Rva = TEST_IMAGE_HEADERS_SIZE;
+	for (UINT32 i = 0; i < NumSections; ++i, ++Section)
+	{
+		strncpy((CHAR8*)Section->Name, Sections[i].Name, EFI_IMAGE_SIZEOF_SHORT_NAME);
+		Section->Misc.VirtualSize = Sections[i].Size;
+		Section->VirtualAddress = Rva;
+		Section->SizeOfRawData = ALIGN_VALUE(Sections[i].Size, 0x1000);
+		Section->PointerToRawData = Rva;
+		Section->Characteristics = Sections[i].Characteristics;
+		Rva += Section->SizeOfRawData;
+	}
+
+	*NtHeaders = Nt;
+	*ImageSize = Size;
+	return ImageBase;
+}
+
+PEFI_IMAGE_SECTION_HEADER
+TestGetSection(
+	IN PEFI_IMAGE_NT_HEADERS NtHeaders,
+	IN CONST CHAR8* Name
+	)
+{
+	PEFI_IMAGE_SECTION_HEADER Section = IMAGE_FIRST_SECTION(NtHeaders);
+	for (UINT16 i = 0; i < NtHeaders->FileHeader.NumberOfSections; ++i, ++Section)
+	{
+		if (strncmp((CONST CHAR8*)Section->Name, Name, EFI_IMAGE_SIZEOF_SHORT_NAME) == 0)
+			return Section;
+	}
+
+	printf("Test image has no section %s\n", Name);
+	abort();
+}
+
+UINT32
+BuildTestFunctionTable(
+	IN UINT8* ImageBase,
+	IN PEFI_IMAGE_NT_HEADERS NtHeaders,
+	IN CONST CHAR8* TextName,
+	IN CONST CHAR8* PdataName,
+	IN UINT32 MaxFunctionLength,
+	IN UINT32 IndirectPercent
+	)
+{
+	CONST PEFI_IMAGE_SECTION_HEADER Text = TestGetSection(NtHeaders, TextName);
+	CONST PEFI_IMAGE_SECTION_HEADER Pdata = TestGetSection(NtHeaders, PdataName);
+	PIMAGE_RUNTIME_FUNCTION_ENTRY Table = (PIMAGE_RUNTIME_FUNCTION_ENTRY)(ImageBase + Pdata->VirtualAddress);
+	CONST UINT32 MaxEntries = Pdata->Misc.VirtualSize / sizeof(IMAGE_RUNTIME_FUNCTION_ENTRY);
+	CONST UINT32 TextEnd = Text->VirtualAddress + Text->Misc.VirtualSize;
+
+	UINT32 NumEntries = 0, Address = Text->VirtualAddress;
+	while (NumEntries < MaxEntries)
+	{
+		// Functions may follow each other directly or leave a gap of padding that is in no function
+		Address += TestRandomBelow(2) == 0 ? 0 : 1 + TestRandomBelow(16);
+		CONST UINT32 Length = 1 + TestRandomBelow(MaxFunctionLength);
+		if (Address + Length > TextEnd)
+			break;
+
+		PIMAGE_RUNTIME_FUNCTION_ENTRY Entry = &Table[NumEntries];
+		Entry->BeginAddress = Address;
+		Entry->EndAddress = Address + Length;
+		if (NumEntries > 0 && TestRandomBelow(100) < IndirectPercent)
+		{
+			// Chained entries point at the primary entry, which is never itself chained
+			UINT32 Primary = NumEntries - 1;
+			while ((Table[Primary].u.UnwindData & RUNTIME_FUNCTION_INDIRECT) != 0)
+				Primary--;
+			Entry->u.UnwindData = (UINT32)((UINT8*)&Table[Primary] - ImageBase) | RUNTIME_FUNCTION_INDIRECT;
+		}
+		else
+		{
+			Entry->u.UnwindInfoAddress = Pdata->VirtualAddress;	// Never read
+		}
+
+		Address += Length;
+		NumEntries++;
+	}
+
+	NtHeaders->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_EXCEPTION].VirtualAddress = Pdata->VirtualAddress;
+	NtHeaders->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_EXCEPTION].Size = NumEntries * sizeof(IMAGE_RUNTIME_FUNCTION_ENTRY);
+	return NumEntries;
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+//
+// Shared helpers for the host tests and benchmarks: a seeded random number generator, check counters,
+// a nanosecond clock and a builder for in-memory PE32+ images.
+//
+
+#include "../../EfiGuardDxe/EfiGuardDxe.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+//
+// Number of ZydisDecoderDecodeOperands() calls made so far. See ToyDecoder.c
+//
+extern volatile UINT64 gToyDecoderOperandDecodes;
+
+//
+// Makes LocateProtocol() find an EFI_MP_SERVICES_PROTOCOL with NumProcessors processors including the calling one, whose APs
+// are threads. 0 removes the protocol. If StartupStatus is an error, StartupAllAPs() fails with it. See HostLib.c
+//
+VOID
+HostSetMpServices(
+	IN UINT32 NumProcessors,
+	IN EFI_STATUS StartupStatus
+	);
+
+//
+// Redirects gST->ConOut output to Buffer, which receives at most MaxLength - 1 characters and a terminator.
+// NULL restores output to stdout
+//
+VOID
+HostCaptureConsole(
+	OUT CHAR16* Buffer OPTIONAL,
+	IN UINTN MaxLength
+	);
+
+//
+// Number of AP procedure calls, and of StartupAllAPs() calls in non-blocking mode, made so far
+//
+extern volatile UINT32 gHostApProceduresRun;
+extern volatile UINT32 gHostNonBlockingStartups;
+
+//
+// xorshift64* generator. Every test seeds it with a fixed value, so failures reproduce
+//
+VOID
+TestSeedRandom(
+	IN UINT64 Seed
+	);
+
+UINT64
+TestRandom(
+	VOID
+	);
+
+//
+// Returns a random value in [0, Limit). Limit must not be 0
+//
+UINT32
+TestRandomBelow(
+	IN UINT32 Limit
+	);
+
+VOID
+TestRandomBytes(
+	OUT UINT8* Buffer,
+	IN UINTN Size,
+	IN UINT32 Alphabet		// Bytes are drawn from [0, Alphabet). Small alphabets give many partial matches
+	);
+
+extern UINT64 gTestChecks;
+extern UINT64 gTestFailures;
+
+//
+// Counts a check and prints the location and a message if it fails. Evaluates to Condition
+//
+#define TEST_CHECK(Condition, ...) \
+	(gTestChecks++, (Condition) ? TRUE : (gTestFailures++, TestReportFailure(__FILE__, __LINE__, #Condition), \
+		printf("    " __VA_ARGS__), printf("\n"), FALSE))
+
+VOID
+TestReportFailure(
+	IN CONST CHAR8* File,
+	IN UINT32 Line,
+	IN CONST CHAR8* Condition
+	);
+
+//
+// Prints the check and failure counts and returns the process exit code
+//
+int
+TestSummary(
+	IN CONST CHAR8* Name
+	);
+
+UINT64
+TestNowNs(
+	VOID
+	);
+
+//
+// An instruction written by GenerateTestCode()
+//
+typedef struct _TEST_INSTRUCTION
+{
+	UINT32 Offset;
+	UINT8 Length;
+	ZydisMnemonic Mnemonic;
+	BOOLEAN Relative;				// Has a rel8/rel32 branch target or a [rip+disp32] operand
+	BOOLEAN RipStore;				// mov [rip+disp32], reg
+	UINT32 Target;					// Offset of the target in the code, if Relative
+} TEST_INSTRUCTION;
+
+//
+// Fills Code with random instructions that ToyDecoder.c can decode, with relative targets inside Code.
+// If JunkPercent is not 0, about that many percent of the instructions are preceded by an undecodable byte.
+// Returns the number of instructions, which are stored in Instructions if it is not NULL
+//
+UINT32
+GenerateTestCode(
+	OUT UINT8* Code,
+	IN UINT32 Size,
+	IN UINT32 JunkPercent,
+	OUT TEST_INSTRUCTION* Instructions OPTIONAL,
+	IN UINT32 MaxInstructions
+	);
+
+//
+// A section of an image built with BuildTestImage()
+//
+typedef struct _TEST_SECTION
+{
+	CONST CHAR8* Name;
+	UINT32 Size;
+	UINT32 Characteristics;
+} TEST_SECTION;
+
+#define TEST_SECTION_CODE	(EFI_IMAGE_SCN_CNT_CODE | EFI_IMAGE_SCN_MEM_EXECUTE | EFI_IMAGE_SCN_MEM_READ)
+#define TEST_SECTION_DATA	(EFI_IMAGE_SCN_CNT_INITIALIZED_DATA | EFI_IMAGE_SCN_MEM_READ | EFI_IMAGE_SCN_MEM_WRITE)
+#define TEST_SECTION_RDATA	(EFI_IMAGE_SCN_CNT_INITIALIZED_DATA | EFI_IMAGE_SCN_MEM_READ)
+
+#define TEST_IMAGE_HEADERS_SIZE		0x1000
+
+//
+// Builds a zero-filled PE32+ image in its loaded (section aligned) layout, with the headers in the first page and
+// each section page-aligned after the previous one. Data directories are left empty. Free the image with free()
+//
+UINT8*
+BuildTestImage(
+	IN CONST TEST_SECTION* Sections,
+	IN UINT32 NumSections,
+	OUT PEFI_IMAGE_NT_HEADERS* NtHeaders,
+	OUT UINT32* ImageSize
+	);
+
+//
+// Returns the section header with the given name. Aborts if there is none
+//
+PEFI_IMAGE_SECTION_HEADER
+TestGetSection(
+	IN PEFI_IMAGE_NT_HEADERS NtHeaders,
+	IN CONST CHAR8* Name
+	);
+
+//
+// Fills the section PdataName with a sorted exception table for functions laid out back to back in TextName, with random
+// lengths and gaps, and points the exception data directory at it. About IndirectPercent percent of the entries are
+// chained to the entry before them with RUNTIME_FUNCTION_INDIRECT. Returns the number of entries written
+//
+UINT32
+BuildTestFunctionTable(
+	IN UINT8* ImageBase,
+	IN PEFI_IMAGE_NT_HEADERS NtHeaders,
+	IN CONST CHAR8* TextName,
+	IN CONST CHAR8* PdataName,
+	IN UINT32 MaxFunctionLength,
+	IN UINT32 IndirectPercent
+	);
@@ -0,0 +1,258 @@
+#pragma once
+
+//
+// PE32/PE32+ definitions with the same layout and field names as MdePkg/Include/IndustryStandard/PeImage.h,
+// so the tests can build images that pe.c parses exactly as it would parse a real one
+//
+
+#include <Uefi.h>
+
+#define EFI_IMAGE_DOS_SIGNATURE					0x5A4D
+#define EFI_IMAGE_NT_SIGNATURE					0x00004550
+#define EFI_IMAGE_NT_OPTIONAL_HDR32_MAGIC		0x10b
+#define EFI_IMAGE_NT_OPTIONAL_HDR64_MAGIC		0x20b
+#define IMAGE_FILE_MACHINE_X64					0x8664
+#define EFI_IMAGE_SUBSYSTEM_EFI_APPLICATION		10
+#define EFI_IMAGE_SIZEOF_SHORT_NAME				8
+#define EFI_IMAGE_NUMBER_OF_DIRECTORY_ENTRIES	16
+
+#define EFI_IMAGE_DIRECTORY_ENTRY_EXPORT		0
+#define EFI_IMAGE_DIRECTORY_ENTRY_IMPORT		1
+#define EFI_IMAGE_DIRECTORY_ENTRY_RESOURCE		2
+#define EFI_IMAGE_DIRECTORY_ENTRY_EXCEPTION		3
+#define EFI_IMAGE_DIRECTORY_ENTRY_BASERELOC		5
+#define EFI_IMAGE_DIRECTORY_ENTRY_BOUND_IMPORT	11
+
+#define EFI_IMAGE_SCN_CNT_CODE					0x00000020
+#define EFI_IMAGE_SCN_CNT_INITIALIZED_DATA		0x00000040
+#define EFI_IMAGE_SCN_CNT_UNINITIALIZED_DATA	0x00000080
+#define EFI_IMAGE_SCN_MEM_EXECUTE				0x20000000
+#define EFI_IMAGE_SCN_MEM_READ					0x40000000
+#define EFI_IMAGE_SCN_MEM_WRITE					0x80000000
+
+typedef struct
+{
+	UINT16 e_magic;
+	UINT16 e_cblp;
+	UINT16 e_cp;
+	UINT16 e_crlc;
+	UINT16 e_cparhdr;
+	UINT16 e_minalloc;
+	UINT16 e_maxalloc;
+	UINT16 e_ss;
+	UINT16 e_sp;
+	UINT16 e_csum;
+	UINT16 e_ip;
+	UINT16 e_cs;
+	UINT16 e_lfarlc;
+	UINT16 e_ovno;
+	UINT16 e_res[4];
+	UINT16 e_oemid;
+	UINT16 e_oeminfo;
+	UINT16 e_res2[10];
+	UINT32 e_lfanew;
+} EFI_IMAGE_DOS_HEADER;
+
+typedef struct
+{
+	UINT16 Machine;
+	UINT16 NumberOfSections;
+	UINT32 TimeDateStamp;
+	UINT32 PointerToSymbolTable;
+	UINT32 NumberOfSymbols;
+	UINT16 SizeOfOptionalHeader;
+	UINT16 Characteristics;
+} EFI_IMAGE_FILE_HEADER;
+
+typedef struct
+{
+	UINT32 VirtualAddress;
+	UINT32 Size;
+} EFI_IMAGE_DATA_DIRECTORY;
+
+typedef struct
+{
+	UINT16 Magic;
+	UINT8 MajorLinkerVersion;
+	UINT8 MinorLinkerVersion;
+	UINT32 SizeOfCode;
+	UINT32 SizeOfInitializedData;
+	UINT32 SizeOfUninitializedData;
+	UINT32 AddressOfEntryPoint;
+	UINT32 BaseOfCode;
+	UINT32 BaseOfData;
+	UINT32 ImageBase;
+	UINT32 SectionAlignment;
+	UINT32 FileAlignment;
+	UINT16 MajorOperatingSystemVersion;
+	UINT16 MinorOperatingSystemVersion;
+	UINT16 MajorImageVersion;
+	UINT16 MinorImageVersion;
+	UINT16 MajorSubsystemVersion;
+	UINT16 MinorSubsystemVersion;
+	UINT32 Win32VersionValue;
+	UINT32 SizeOfImage;
+	UINT32 SizeOfHeaders;
+	UINT32 CheckSum;
+	UINT16 Subsystem;
+	UINT16 DllCharacteristics;
+	UINT32 SizeOfStackReserve;
+	UINT32 SizeOfStackCommit;
+	UINT32 SizeOfHeapReserve;
+	UINT32 SizeOfHeapCommit;
+	UINT32 LoaderFlags;
+	UINT32 NumberOfRvaAndSizes;
+	EFI_IMAGE_DATA_DIRECTORY DataDirectory[EFI_IMAGE_NUMBER_OF_DIRECTORY_ENTRIES];
+} EFI_IMAGE_OPTIONAL_HEADER32;
+
+typedef struct
+{
+	UINT16 Magic;
+	UINT8 MajorLinkerVersion;
+	UINT8 MinorLinkerVersion;
+	UINT32 SizeOfCode;
+	UINT32 SizeOfInitializedData;
+	UINT32 SizeOfUninitializedData;
+	UINT32 AddressOfEntryPoint;
+	UINT32 BaseOfCode;
+	UINT64 ImageBase;
+	UINT32 SectionAlignment;
+	UINT32 FileAlignment;
+	UINT16 MajorOperatingSystemVersion;
+	UINT16 MinorOperatingSystemVersion;
+	UINT16 MajorImageVersion;
+	UINT16 MinorImageVersion;
+	UINT16 MajorSubsystemVersion;
+	UINT16 MinorSubsystemVersion;
+	UINT32 Win32VersionValue;
+	UINT32 SizeOfImage;
+	UINT32 SizeOfHeaders;
+	UINT32 CheckSum;
+	UINT16 Subsystem;
+	UINT16 DllCharacteristics;
+	UINT64 SizeOfStackReserve;
+	UINT64 SizeOfStackCommit;
+	UINT64 SizeOfHeapReserve;
+	UINT64 SizeOfHeapCommit;
+	UINT32 LoaderFlags;
+	UINT32 NumberOfRvaAndSizes;
+	EFI_IMAGE_DATA_DIRECTORY DataDirectory[EFI_IMAGE_NUMBER_OF_DIRECTORY_ENTRIES];
+} EFI_IMAGE_OPTIONAL_HEADER64;
+
+typedef struct
+{
+	UINT32 Signature;
+	EFI_IMAGE_FILE_HEADER FileHeader;
+	EFI_IMAGE_OPTIONAL_HEADER32 OptionalHeader;
+} EFI_IMAGE_NT_HEADERS32;
+
+typedef struct
+{
+	UINT32 Signature;
+	EFI_IMAGE_FILE_HEADER FileHeader;
+	EFI_IMAGE_OPTIONAL_HEADER64 OptionalHeader;
+} EFI_IMAGE_NT_HEADERS64;
+
+typedef struct
+{
+	UINT8 Name[EFI_IMAGE_SIZEOF_SHORT_NAME];
+	union
+	{
+		UINT32 PhysicalAddress;
+		UINT32 VirtualSize;
+	} Misc;
+	UINT32 VirtualAddress;
+	UINT32 SizeOfRawData;
+	UINT32 PointerToRawData;
+	UINT32 PointerToRelocations;
+	UINT32 PointerToLinenumbers;
+	UINT16 NumberOfRelocations;
+	UINT16 NumberOfLinenumbers;
+	UINT32 Characteristics;
+} EFI_IMAGE_SECTION_HEADER;
+
+typedef struct
+{
+	UINT32 Characteristics;
+	UINT32 TimeDateStamp;
+	UINT16 MajorVersion;
+	UINT16 MinorVersion;
+	UINT32 Name;
+	UINT32 Base;
+	UINT32 NumberOfFunctions;
+	UINT32 NumberOfNames;
+	UINT32 AddressOfFunctions;
+	UINT32 AddressOfNames;
+	UINT32 AddressOfNameOrdinals;
+} EFI_IMAGE_EXPORT_DIRECTORY;
+
+typedef struct
+{
+	UINT16 Hint;
+	UINT8 Name[1];
+} EFI_IMAGE_IMPORT_BY_NAME;
+
+typedef struct
+{
+	union
+	{
+		UINT32 Function;
+		UINT32 Ordinal;
+		EFI_IMAGE_IMPORT_BY_NAME *AddressOfData;
+	} u1;
+} EFI_IMAGE_THUNK_DATA;
+
+typedef struct
+{
+	UINT32 Characteristics;
+	UINT32 TimeDateStamp;
+	UINT32 ForwarderChain;
+	UINT32 Name;
+	EFI_IMAGE_THUNK_DATA *FirstThunk;
+} EFI_IMAGE_IMPORT_DESCRIPTOR;
+
+typedef struct
+{
+	UINT32 Characteristics;
+	UINT32 TimeDateStamp;
+	UINT16 MajorVersion;
+	UINT16 MinorVersion;
+	UINT16 NumberOfNamedEntries;
+	UINT16 NumberOfIdEntries;
+} EFI_IMAGE_RESOURCE_DIRECTORY;
+
+typedef struct
+{
+	union
+	{
+		struct
+		{
+			UINT32 NameOffset : 31;
+			UINT32 NameIsString : 1;
+		} s;
+		UINT32 Id;
+	} u1;
+	union
+	{
+		UINT32 OffsetToData;
+		struct
+		{
+			UINT32 OffsetToDirectory : 31;
+			UINT32 DataIsDirectory : 1;
+		} s;
+	} u2;
+} EFI_IMAGE_RESOURCE_DIRECTORY_ENTRY;
+
+typedef struct
+{
+	UINT16 Length;
+	CHAR16 String[1];
+} EFI_IMAGE_RESOURCE_DIRECTORY_STRING;
+
+typedef struct
+{
+	UINT32 OffsetToData;
+	UINT32 Size;
+	UINT32 CodePage;
+	UINT32 Reserved;
+} EFI_IMAGE_RESOURCE_DATA_ENTRY;
@@ -0,0 +1,421 @@
+#pragma once
+
+//
+// Host replacement for the EDK2 headers that EfiGuardDxe/util.c and pe.c include.
+// Only what those two files use is declared here. The Library/, Protocol/ and Guid/ headers all forward to this file,
+// so the driver sources can be compiled unchanged with any include order.
+//
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+
+#ifndef MDE_CPU_X64
+#define MDE_CPU_X64 1
+#endif
+
+typedef uint8_t UINT8;
+typedef int8_t INT8;
+typedef uint16_t UINT16;
+typedef int16_t INT16;
+typedef uint32_t UINT32;
+typedef int32_t INT32;
+typedef uint64_t UINT64;
+typedef int64_t INT64;
+typedef uint64_t UINTN;
+typedef int64_t INTN;
+typedef unsigned char BOOLEAN;
+typedef char CHAR8;
+typedef uint16_t CHAR16;		// Requires -fshort-wchar, so that L"" literals are CHAR16 strings
+typedef void VOID;
+
+typedef UINTN EFI_STATUS;
+typedef UINTN RETURN_STATUS;
+typedef VOID* EFI_HANDLE;
+typedef VOID* EFI_EVENT;
+typedef UINTN EFI_TPL;
+typedef UINT64 EFI_PHYSICAL_ADDRESS;
+typedef UINT64 PHYSICAL_ADDRESS;
+
+#define IN
+#define OUT
+#define OPTIONAL
+#define CONST							const
+#define STATIC							static
+#define EFIAPI
+#define TRUE							((BOOLEAN)1)
+#define FALSE							((BOOLEAN)0)
+#undef NULL
+#define NULL							((VOID*)0)
+#define CHAR_NULL						0x0000
+
+#define MAX_UINT8						UINT8_MAX
+#define MAX_UINT16						UINT16_MAX
+#define MAX_UINT32						UINT32_MAX
+#define MAX_UINT64						UINT64_MAX
+#define MAX_UINTN						UINT64_MAX
+#define MAX_INTN						INT64_MAX
+
+#define MIN(a, b)						(((a) < (b)) ? (a) : (b))
+#define MAX(a, b)						(((a) > (b)) ? (a) : (b))
+#define ARRAY_SIZE(Array)				(sizeof(Array) / sizeof((Array)[0]))
+#define ALIGN_VALUE(Value, Alignment)	((Value) + (((Alignment) - (Value)) & ((Alignment) - 1)))
+#define OFFSET_OF(TYPE, Field)			((UINTN)offsetof(TYPE, Field))
+#define BASE_CR(Record, TYPE, Field)	((TYPE *)((CHAR8 *)(Record) - (CHAR8 *)&(((TYPE *)0)->Field)))
+#define CR(Record, TYPE, Field, Sig)	BASE_CR(Record, TYPE, Field)
+
+#define VA_LIST							va_list
+#define VA_START						va_start
+#define VA_END							va_end
+#define VA_ARG							va_arg
+#define VA_COPY							va_copy
+
+// As in MdePkg/Include/Base.h, _BASE_INT_SIZE_OF() counts UINTN slots, not bytes
+typedef UINTN *BASE_LIST;
+#define _BASE_INT_SIZE_OF(TYPE)			((sizeof(TYPE) + sizeof(UINTN) - 1) / sizeof(UINTN))
+#define BASE_ARG(Marker, TYPE)			(*(TYPE *)((Marker += _BASE_INT_SIZE_OF(TYPE)) - _BASE_INT_SIZE_OF(TYPE)))
+
+//
+// Status codes
+//
+#define ENCODE_ERROR(StatusCode)		((EFI_STATUS)(0x8000000000000000ULL | (StatusCode)))
+#define EFI_ERROR(StatusCode)			(((INTN)(EFI_STATUS)(StatusCode)) < 0)
+
+#define EFI_SUCCESS						0
+#define EFI_LOAD_ERROR					ENCODE_ERROR(1)
+#define EFI_INVALID_PARAMETER			ENCODE_ERROR(2)
+#define EFI_UNSUPPORTED					ENCODE_ERROR(3)
+#define EFI_BAD_BUFFER_SIZE				ENCODE_ERROR(4)
+#define EFI_BUFFER_TOO_SMALL			ENCODE_ERROR(5)
+#define EFI_NOT_READY					ENCODE_ERROR(6)
+#define EFI_OUT_OF_RESOURCES			ENCODE_ERROR(9)
+#define EFI_NOT_FOUND					ENCODE_ERROR(14)
+#define EFI_ACCESS_DENIED				ENCODE_ERROR(15)
+#define EFI_TIMEOUT						ENCODE_ERROR(18)
+#define EFI_NOT_STARTED					ENCODE_ERROR(19)
+#define EFI_ALREADY_STARTED				ENCODE_ERROR(20)
+#define EFI_ABORTED						ENCODE_ERROR(21)
+#define EFI_INVALID_LANGUAGE			ENCODE_ERROR(32)
+
+//
+// DebugLib
+//
+#define ASSERT(Expression)				((VOID)(Expression))
+#define ASSERT_EFI_ERROR(StatusParameter)	((VOID)(StatusParameter))
+#define DEBUG(Expression)				do { } while (FALSE)
+#define DEBUG_CODE_BEGIN()				do {
+#define DEBUG_CODE_END()				} while (FALSE)
+#define DEBUG_INFO						0x00000040
+#define DEBUG_WARN						0x00000002
+#define DEBUG_ERROR						0x80000000
+#define DEBUG_VERBOSE					0x00400000
+
+typedef struct
+{
+	UINT32 Data1;
+	UINT16 Data2;
+	UINT16 Data3;
+	UINT8 Data4[8];
+} GUID;
+
+typedef GUID EFI_GUID;
+
+typedef struct _LIST_ENTRY
+{
+	struct _LIST_ENTRY *ForwardLink;
+	struct _LIST_ENTRY *BackLink;
+} LIST_ENTRY;
+
+typedef struct
+{
+	UINT64 Signature;
+	UINT32 Revision;
+	UINT32 HeaderSize;
+	UINT32 CRC32;
+	UINT32 Reserved;
+} EFI_TABLE_HEADER;
+
+typedef struct
+{
+	UINT8 Type;
+	UINT8 SubType;
+	UINT8 Length[2];
+} EFI_DEVICE_PATH_PROTOCOL;
+
+//
+// Console I/O
+//
+typedef struct
+{
+	UINT16 ScanCode;
+	CHAR16 UnicodeChar;
+} EFI_INPUT_KEY;
+
+#define SCAN_ESC						0x0017
+
+typedef struct _EFI_SIMPLE_TEXT_INPUT_PROTOCOL EFI_SIMPLE_TEXT_INPUT_PROTOCOL;
+
+struct _EFI_SIMPLE_TEXT_INPUT_PROTOCOL
+{
+	EFI_STATUS (EFIAPI *Reset)(IN EFI_SIMPLE_TEXT_INPUT_PROTOCOL *This, IN BOOLEAN ExtendedVerification);
+	EFI_STATUS (EFIAPI *ReadKeyStroke)(IN EFI_SIMPLE_TEXT_INPUT_PROTOCOL *This, OUT EFI_INPUT_KEY *Key);
+	EFI_EVENT WaitForKey;
+};
+
+typedef struct
+{
+	INT32 MaxMode;
+	INT32 Mode;
+	INT32 Attribute;
+	INT32 CursorColumn;
+	INT32 CursorRow;
+	BOOLEAN CursorVisible;
+} EFI_SIMPLE_TEXT_OUTPUT_MODE;
+
+typedef struct _EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL;
+
+struct _EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL
+{
+	EFI_STATUS (EFIAPI *Reset)(IN EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL *This, IN BOOLEAN ExtendedVerification);
+	EFI_STATUS (EFIAPI *OutputString)(IN EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL *This, IN CHAR16 *String);
+	EFI_STATUS (EFIAPI *TestString)(IN EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL *This, IN CHAR16 *String);
+	EFI_STATUS (EFIAPI *QueryMode)(IN EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL *This, IN UINTN ModeNumber, OUT UINTN *Columns, OUT UINTN *Rows);
+	EFI_STATUS (EFIAPI *SetMode)(IN EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL *This, IN UINTN ModeNumber);
+	EFI_STATUS (EFIAPI *SetAttribute)(IN EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL *This, IN UINTN Attribute);
+	EFI_STATUS (EFIAPI *ClearScreen)(IN EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL *This);
+	EFI_STATUS (EFIAPI *SetCursorPosition)(IN EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL *This, IN UINTN Column, IN UINTN Row);
+	EFI_STATUS (EFIAPI *EnableCursor)(IN EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL *This, IN BOOLEAN Visible);
+	EFI_SIMPLE_TEXT_OUTPUT_MODE *Mode;
+};
+
+#define EFI_BLACK						0x00
+#define EFI_BLUE						0x01
+#define EFI_GREEN						0x02
+#define EFI_CYAN						0x03
+#define EFI_RED							0x04
+#define EFI_LIGHTGRAY					0x07
+#define EFI_LIGHTRED					0x0C
+#define EFI_YELLOW						0x0E
+#define EFI_WHITE						0x0F
+#define EFI_BACKGROUND_BLUE				0x10
+
+//
+// Boot and runtime services. Only the members used by the driver sources are typed; the tests fill in what they need
+//
+typedef VOID (EFIAPI *EFI_EVENT_NOTIFY)(IN EFI_EVENT Event, IN VOID *Context);
+
+typedef enum { TimerCancel, TimerPeriodic, TimerRelative } EFI_TIMER_DELAY;
+typedef enum { EfiResetCold, EfiResetWarm, EfiResetShutdown } EFI_RESET_TYPE;
+typedef enum { EFI_NATIVE_INTERFACE } EFI_INTERFACE_TYPE;
+typedef enum { AllocateAnyPages, AllocateMaxAddress, AllocateAddress } EFI_ALLOCATE_TYPE;
+typedef enum
+{
+	EfiReservedMemoryType,
+	EfiLoaderCode,
+	EfiLoaderData,
+	EfiBootServicesCode,
+	EfiBootServicesData,
+	EfiRuntimeServicesCode,
+	EfiRuntimeServicesData
+} EFI_MEMORY_TYPE;
+
+typedef EFI_STATUS (EFIAPI *EFI_IMAGE_LOAD)(IN BOOLEAN BootPolicy, IN EFI_HANDLE ParentImageHandle, IN EFI_DEVICE_PATH_PROTOCOL *DevicePath,
+	IN VOID *SourceBuffer OPTIONAL, IN UINTN SourceSize, OUT EFI_HANDLE *ImageHandle);
+typedef EFI_STATUS (EFIAPI *EFI_SET_VARIABLE)(IN CHAR16 *VariableName, IN EFI_GUID *VendorGuid, IN UINT32 Attributes,
+	IN UINTN DataSize, IN VOID *Data);
+
+typedef struct
+{
+	EFI_TABLE_HEADER Hdr;
+	EFI_TPL (EFIAPI *RaiseTPL)(IN EFI_TPL NewTpl);
+	VOID (EFIAPI *RestoreTPL)(IN EFI_TPL OldTpl);
+	EFI_STATUS (EFIAPI *AllocatePages)(IN EFI_ALLOCATE_TYPE Type, IN EFI_MEMORY_TYPE MemoryType, IN UINTN Pages, IN OUT EFI_PHYSICAL_ADDRESS *Memory);
+	EFI_STATUS (EFIAPI *FreePages)(IN EFI_PHYSICAL_ADDRESS Memory, IN UINTN Pages);
+	EFI_STATUS (EFIAPI *AllocatePool)(IN EFI_MEMORY_TYPE PoolType, IN UINTN Size, OUT VOID **Buffer);
+	EFI_STATUS (EFIAPI *FreePool)(IN VOID *Buffer);
+	EFI_STATUS (EFIAPI *CreateEvent)(IN UINT32 Type, IN EFI_TPL NotifyTpl, IN EFI_EVENT_NOTIFY NotifyFunction OPTIONAL,
+		IN VOID *NotifyContext OPTIONAL, OUT EFI_EVENT *Event);
+	EFI_STATUS (EFIAPI *SetTimer)(IN EFI_EVENT Event, IN EFI_TIMER_DELAY Type, IN UINT64 TriggerTime);
+	EFI_STATUS (EFIAPI *WaitForEvent)(IN UINTN NumberOfEvents, IN EFI_EVENT *Event, OUT UINTN *Index);
+	EFI_STATUS (EFIAPI *CloseEvent)(IN EFI_EVENT Event);
+	EFI_STATUS (EFIAPI *CheckEvent)(IN EFI_EVENT Event);
+	EFI_STATUS (EFIAPI *SignalEvent)(IN EFI_EVENT Event);
+	EFI_STATUS (EFIAPI *InstallProtocolInterface)(IN OUT EFI_HANDLE *Handle, IN EFI_GUID *Protocol, IN EFI_INTERFACE_TYPE InterfaceType, IN VOID *Interface);
+	EFI_STATUS (EFIAPI *OpenProtocol)(IN EFI_HANDLE Handle, IN EFI_GUID *Protocol, OUT VOID **Interface OPTIONAL,
+		IN EFI_HANDLE AgentHandle, IN EFI_HANDLE ControllerHandle, IN UINT32 Attributes);
+	EFI_STATUS (EFIAPI *LocateProtocol)(IN EFI_GUID *Protocol, IN VOID *Registration OPTIONAL, OUT VOID **Interface);
+	EFI_STATUS (EFIAPI *InstallMultipleProtocolInterfaces)(IN OUT EFI_HANDLE *Handle, ...);
+	EFI_STATUS (EFIAPI *UninstallMultipleProtocolInterfaces)(IN EFI_HANDLE Handle, ...);
+	EFI_STATUS (EFIAPI *CalculateCrc32)(IN VOID *Data, IN UINTN DataSize, OUT UINT32 *Crc32);
+	EFI_STATUS (EFIAPI *Stall)(IN UINTN Microseconds);
+	EFI_IMAGE_LOAD LoadImage;
+	EFI_STATUS (EFIAPI *CreateEventEx)(IN UINT32 Type, IN EFI_TPL NotifyTpl, IN EFI_EVENT_NOTIFY NotifyFunction OPTIONAL,
+		IN CONST VOID *NotifyContext OPTIONAL, IN CONST EFI_GUID *EventGroup OPTIONAL, OUT EFI_EVENT *Event);
+} EFI_BOOT_SERVICES;
+
+typedef struct
+{
+	EFI_TABLE_HEADER Hdr;
+	EFI_STATUS (EFIAPI *GetVariable)(IN CHAR16 *VariableName, IN EFI_GUID *VendorGuid, OUT UINT32 *Attributes OPTIONAL,
+		IN OUT UINTN *DataSize, OUT VOID *Data OPTIONAL);
+	EFI_SET_VARIABLE SetVariable;
+	EFI_STATUS (EFIAPI *ConvertPointer)(IN UINTN DebugDisposition, IN OUT VOID **Address);
+	VOID (EFIAPI *ResetSystem)(IN EFI_RESET_TYPE ResetType, IN EFI_STATUS ResetStatus, IN UINTN DataSize, IN VOID *ResetData OPTIONAL);
+} EFI_RUNTIME_SERVICES;
+
+typedef struct
+{
+	EFI_TABLE_HEADER Hdr;
+	EFI_SIMPLE_TEXT_INPUT_PROTOCOL *ConIn;
+	EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL *ConOut;
+	EFI_RUNTIME_SERVICES *RuntimeServices;
+	EFI_BOOT_SERVICES *BootServices;
+} EFI_SYSTEM_TABLE;
+
+#define EVT_TIMER						0x80000000
+#define EVT_NOTIFY_SIGNAL				0x00000200
+#define TPL_APPLICATION					4
+#define TPL_CALLBACK					8
+#define TPL_NOTIFY						16
+#define TPL_HIGH_LEVEL					31
+#define EFI_TIMER_PERIOD_MILLISECONDS(Milliseconds)	((UINT64)(Milliseconds) * 10000)
+#define EFI_OPEN_PROTOCOL_GET_PROTOCOL	0x00000002
+#define EFI_2_10_SYSTEM_TABLE_REVISION	((2 << 16) | 10)
+
+#define EFI_VARIABLE_NON_VOLATILE		0x00000001
+#define EFI_VARIABLE_BOOTSERVICE_ACCESS	0x00000002
+#define EFI_VARIABLE_RUNTIME_ACCESS		0x00000004
+#define EFI_VARIABLE_APPEND_WRITE		0x00000040
+
+extern EFI_BOOT_SERVICES *gBS;
+extern EFI_RUNTIME_SERVICES *gRT;
+extern EFI_SYSTEM_TABLE *gST;
+extern EFI_HANDLE gImageHandle;
+
+//
+// Protocols
+//
+typedef struct
+{
+	UINT32 Revision;
+	EFI_HANDLE ParentHandle;
+	EFI_SYSTEM_TABLE *SystemTable;
+	EFI_HANDLE DeviceHandle;
+	EFI_DEVICE_PATH_PROTOCOL *FilePath;
+	VOID *Reserved;
+	UINT32 LoadOptionsSize;
+	VOID *LoadOptions;
+	VOID *ImageBase;
+	UINT64 ImageSize;
+	EFI_MEMORY_TYPE ImageCodeType;
+	EFI_MEMORY_TYPE ImageDataType;
+	VOID *Unload;
+} EFI_LOADED_IMAGE_PROTOCOL, EFI_LOADED_IMAGE;
+
+typedef struct
+{
+	UINT32 Length;
+	UINT32 FirmwareVersion;
+} EFI_DRIVER_SUPPORTED_EFI_VERSION_PROTOCOL;
+
+typedef struct
+{
+	CHAR16* (EFIAPI *GetFilePathFromDevicePath)(IN CONST EFI_DEVICE_PATH_PROTOCOL *Path);
+} EFI_SHELL_PROTOCOL;
+
+#define EFI_MP_SERVICES_PROTOCOL_GUID \
+	{ 0x3fdda605, 0xa76e, 0x4f46, { 0xad, 0x29, 0x12, 0xf4, 0x53, 0x1b, 0x3d, 0x08 } }
+
+typedef struct _EFI_MP_SERVICES_PROTOCOL EFI_MP_SERVICES_PROTOCOL;
+
+typedef VOID (EFIAPI *EFI_AP_PROCEDURE)(IN OUT VOID *Buffer);
+
+struct _EFI_MP_SERVICES_PROTOCOL
+{
+	EFI_STATUS (EFIAPI *GetNumberOfProcessors)(IN EFI_MP_SERVICES_PROTOCOL *This, OUT UINTN *NumberOfProcessors,
+		OUT UINTN *NumberOfEnabledProcessors);
+	VOID *GetProcessorInfo;
+	EFI_STATUS (EFIAPI *StartupAllAPs)(IN EFI_MP_SERVICES_PROTOCOL *This, IN EFI_AP_PROCEDURE Procedure, IN BOOLEAN SingleThread,
+		IN EFI_EVENT WaitEvent OPTIONAL, IN UINTN TimeoutInMicroSeconds, IN VOID *ProcedureArgument OPTIONAL,
+		OUT UINTN **FailedCpuList OPTIONAL);
+	VOID *StartupThisAP;
+	VOID *SwitchBSP;
+	VOID *EnableDisableAP;
+	VOID *WhoAmI;
+};
+
+extern EFI_GUID gEfiAcpi20TableGuid;
+extern EFI_GUID gEfiGlobalVariableGuid;
+extern EFI_GUID gEfiLoadedImageProtocolGuid;
+extern EFI_GUID gEfiShellProtocolGuid;
+extern EFI_GUID gEfiEventExitBootServicesGuid;
+extern EFI_GUID gEfiEventVirtualAddressChangeGuid;
+extern EFI_GUID gEfiDriverSupportedEfiVersionProtocolGuid;
+extern EFI_GUID gEfiMpServiceProtocolGuid;
+
+//
+// BaseLib
+//
+UINTN EFIAPI AsmReadCr0(VOID);
+UINTN EFIAPI AsmWriteCr0(IN UINTN Cr0);
+UINTN EFIAPI AsmReadCr4(VOID);
+UINT64 EFIAPI AsmReadMsr64(IN UINT32 Index);
+UINT64 EFIAPI AsmReadTsc(VOID);
+VOID EFIAPI CpuPause(VOID);
+UINTN EFIAPI StrLen(IN CONST CHAR16 *String);
+INTN EFIAPI StrCmp(IN CONST CHAR16 *FirstString, IN CONST CHAR16 *SecondString);
+INTN EFIAPI StrnCmp(IN CONST CHAR16 *FirstString, IN CONST CHAR16 *SecondString, IN UINTN Length);
+CHAR16* EFIAPI StrStr(IN CONST CHAR16 *String, IN CONST CHAR16 *SearchString);
+RETURN_STATUS EFIAPI StrnCpyS(OUT CHAR16 *Destination, IN UINTN DestMax, IN CONST CHAR16 *Source, IN UINTN Length);
+CHAR16 EFIAPI CharToUpper(IN CHAR16 Char);
+UINTN EFIAPI AsciiStrLen(IN CONST CHAR8 *String);
+INTN EFIAPI AsciiStrCmp(IN CONST CHAR8 *FirstString, IN CONST CHAR8 *SecondString);
+INTN EFIAPI AsciiStrnCmp(IN CONST CHAR8 *FirstString, IN CONST CHAR8 *SecondString, IN UINTN Length);
+INTN EFIAPI AsciiStriCmp(IN CONST CHAR8 *FirstString, IN CONST CHAR8 *SecondString);
+UINT64 EFIAPI LShiftU64(IN UINT64 Operand, IN UINTN Count);
+UINT64 EFIAPI RShiftU64(IN UINT64 Operand, IN UINTN Count);
+INTN EFIAPI LowBitSet32(IN UINT32 Operand);
+INTN EFIAPI LowBitSet64(IN UINT64 Operand);
+INTN EFIAPI HighBitSet32(IN UINT32 Operand);
+UINT64 EFIAPI DivU64x32(IN UINT64 Dividend, IN UINT32 Divisor);
+UINT64 EFIAPI MultU64x32(IN UINT64 Multiplicand, IN UINT32 Multiplier);
+UINT16 EFIAPI ReadUnaligned16(IN CONST UINT16 *Buffer);
+UINT32 EFIAPI ReadUnaligned32(IN CONST UINT32 *Buffer);
+UINT64 EFIAPI ReadUnaligned64(IN CONST UINT64 *Buffer);
+
+//
+// BaseMemoryLib
+//
+VOID* EFIAPI CopyMem(OUT VOID *DestinationBuffer, IN CONST VOID *SourceBuffer, IN UINTN Length);
+VOID* EFIAPI SetMem(OUT VOID *Buffer, IN UINTN Length, IN UINT8 Value);
+VOID* EFIAPI SetMem64(OUT VOID *Buffer, IN UINTN Length, IN UINT64 Value);
+VOID* EFIAPI ZeroMem(OUT VOID *Buffer, IN UINTN Length);
+INTN EFIAPI CompareMem(IN CONST VOID *DestinationBuffer, IN CONST VOID *SourceBuffer, IN UINTN Length);
+BOOLEAN EFIAPI CompareGuid(IN CONST GUID *Guid1, IN CONST GUID *Guid2);
+VOID* EFIAPI ScanMem8(IN CONST VOID *Buffer, IN UINTN Length, IN UINT8 Value);
+
+//
+// MemoryAllocationLib
+//
+VOID* EFIAPI AllocatePool(IN UINTN AllocationSize);
+VOID* EFIAPI AllocateZeroPool(IN UINTN AllocationSize);
+VOID* EFIAPI ReallocatePool(IN UINTN OldSize, IN UINTN NewSize, IN VOID *OldBuffer OPTIONAL);
+VOID EFIAPI FreePool(IN VOID *Buffer);
+
+//
+// PrintLib and UefiLib
+//
+UINTN EFIAPI UnicodeVSPrint(OUT CHAR16 *StartOfBuffer, IN UINTN BufferSize, IN CONST CHAR16 *FormatString, IN VA_LIST Marker);
+UINTN EFIAPI UnicodeBSPrint(OUT CHAR16 *StartOfBuffer, IN UINTN BufferSize, IN CONST CHAR16 *FormatString, IN BASE_LIST Marker);
+UINTN EFIAPI UnicodeSPrint(OUT CHAR16 *StartOfBuffer, IN UINTN BufferSize, IN CONST CHAR16 *FormatString, ...);
+UINTN EFIAPI Print(IN CONST CHAR16 *Format, ...);
+EFI_TPL EFIAPI EfiGetCurrentTpl(VOID);
+CHAR16* EFIAPI ConvertDevicePathToText(IN CONST EFI_DEVICE_PATH_PROTOCOL *DevicePath, IN BOOLEAN DisplayOnly, IN BOOLEAN AllowShortcuts);
+
+//
+// SynchronizationLib
+//
+UINT32 EFIAPI InterlockedIncrement(IN volatile UINT32 *Value);
+UINT32 EFIAPI InterlockedDecrement(IN volatile UINT32 *Value);
+UINT32 EFIAPI InterlockedCompareExchange32(IN OUT volatile UINT32 *Value, IN UINT32 CompareValue, IN UINT32 ExchangeValue);
+VOID* EFIAPI InterlockedCompareExchangePointer(IN OUT VOID * volatile *Value, IN VOID *CompareValue, IN VOID *ExchangeValue);
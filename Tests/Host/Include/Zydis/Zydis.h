@@ -0,0 +1,207 @@
+#pragma once
+
+//
+// Host replacement for the part of the Zydis decoder API that util.c uses. Names and field layout follow Zydis 4,
+// but only a small subset of x86-64 is decoded; see ToyDecoder.c. The formatter is not available (ZYDIS_DISABLE_FORMATTER).
+//
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef uint8_t ZyanU8;
+typedef uint16_t ZyanU16;
+typedef uint32_t ZyanU32;
+typedef uint64_t ZyanU64;
+typedef int8_t ZyanI8;
+typedef int32_t ZyanI32;
+typedef int64_t ZyanI64;
+typedef size_t ZyanUSize;
+typedef uint32_t ZyanStatus;
+typedef uint8_t ZyanBool;
+
+#define ZYAN_TRUE						1
+#define ZYAN_FALSE						0
+
+#define ZYAN_SUCCESS(Status)			(!((Status) & 0x80000000u))
+#define ZYAN_FAILED(Status)				(((Status) & 0x80000000u) != 0)
+#define ZYAN_CHECK(Status) \
+	do { const ZyanStatus Status_ = (Status); if (!ZYAN_SUCCESS(Status_)) return Status_; } while (0)
+
+#define ZYAN_STATUS_SUCCESS				0x00100000u
+#define ZYAN_STATUS_TRUE				0x00100002u
+#define ZYAN_STATUS_FAILED				0x80100001u
+#define ZYAN_STATUS_INVALID_ARGUMENT	0x80100004u
+#define ZYDIS_STATUS_NO_MORE_DATA		0x80200000u
+#define ZYDIS_STATUS_DECODING_ERROR		0x80200001u
+
+#define ZYDIS_MAX_OPERAND_COUNT			10
+#define ZYDIS_MAX_INSTRUCTION_LENGTH	15
+
+#define ZYDIS_ATTRIB_HAS_MODRM			(1ULL << 0)
+#define ZYDIS_ATTRIB_IS_RELATIVE		(1ULL << 1)
+
+typedef enum
+{
+	ZYDIS_MACHINE_MODE_LONG_64,
+	ZYDIS_MACHINE_MODE_LONG_COMPAT_32
+} ZydisMachineMode;
+
+typedef enum
+{
+	ZYDIS_STACK_WIDTH_32,
+	ZYDIS_STACK_WIDTH_64
+} ZydisStackWidth;
+
+typedef enum
+{
+	ZYDIS_MNEMONIC_INVALID,
+	ZYDIS_MNEMONIC_CALL,
+	ZYDIS_MNEMONIC_INT3,
+	ZYDIS_MNEMONIC_JMP,
+	ZYDIS_MNEMONIC_LEA,
+	ZYDIS_MNEMONIC_MOV,
+	ZYDIS_MNEMONIC_NOP,
+	ZYDIS_MNEMONIC_RET
+} ZydisMnemonic;
+
+typedef enum
+{
+	ZYDIS_OPERAND_TYPE_UNUSED,
+	ZYDIS_OPERAND_TYPE_REGISTER,
+	ZYDIS_OPERAND_TYPE_MEMORY,
+	ZYDIS_OPERAND_TYPE_POINTER,
+	ZYDIS_OPERAND_TYPE_IMMEDIATE
+} ZydisOperandType;
+
+typedef enum
+{
+	ZYDIS_REGISTER_NONE,
+	ZYDIS_REGISTER_EAX,
+	ZYDIS_REGISTER_ECX,
+	ZYDIS_REGISTER_EDX,
+	ZYDIS_REGISTER_EBX,
+	ZYDIS_REGISTER_ESP,
+	ZYDIS_REGISTER_EBP,
+	ZYDIS_REGISTER_ESI,
+	ZYDIS_REGISTER_EDI,
+	ZYDIS_REGISTER_RAX,
+	ZYDIS_REGISTER_RCX,
+	ZYDIS_REGISTER_RDX,
+	ZYDIS_REGISTER_RBX,
+	ZYDIS_REGISTER_RSP,
+	ZYDIS_REGISTER_RBP,
+	ZYDIS_REGISTER_RSI,
+	ZYDIS_REGISTER_RDI,
+	ZYDIS_REGISTER_RIP
+} ZydisRegister;
+
+typedef struct
+{
+	ZydisMachineMode machine_mode;
+	ZydisStackWidth stack_width;
+} ZydisDecoder;
+
+typedef struct
+{
+	ZyanU8 opcode;
+	ZyanU8 modrm;
+	ZyanU8 rex_w;
+	ZyanU8 reg;				// ModRM.reg extended by REX.R, or the register of B8+r
+} ZydisDecoderContext;
+
+typedef struct
+{
+	ZydisOperandType type;
+	ZyanU8 id;
+	ZyanU16 size;
+	struct
+	{
+		ZydisRegister value;
+	} reg;
+	struct
+	{
+		ZydisRegister segment;
+		ZydisRegister base;
+		ZydisRegister index;
+		ZyanU8 scale;
+		struct
+		{
+			ZyanBool has_displacement;
+			ZyanI64 value;
+		} disp;
+	} mem;
+	struct
+	{
+		ZyanBool is_signed;
+		ZyanBool is_relative;
+		union
+		{
+			ZyanU64 u;
+			ZyanI64 s;
+		} value;
+	} imm;
+} ZydisDecodedOperand;
+
+typedef struct
+{
+	ZydisMachineMode machine_mode;
+	ZydisMnemonic mnemonic;
+	ZyanU8 length;
+	ZyanU8 operand_count;
+	ZyanU8 operand_count_visible;
+	ZyanU64 attributes;
+	struct
+	{
+		struct
+		{
+			ZyanI64 value;
+			ZyanU8 size;
+			ZyanU8 offset;
+		} disp;
+		struct
+		{
+			ZyanBool is_signed;
+			ZyanBool is_relative;
+			union
+			{
+				ZyanU64 u;
+				ZyanI64 s;
+			} value;
+			ZyanU8 size;
+			ZyanU8 offset;
+		} imm[2];
+	} raw;
+} ZydisDecodedInstruction;
+
+ZyanStatus
+ZydisDecoderInit(
+	ZydisDecoder* decoder,
+	ZydisMachineMode machine_mode,
+	ZydisStackWidth stack_width
+	);
+
+ZyanStatus
+ZydisDecoderDecodeInstruction(
+	const ZydisDecoder* decoder,
+	ZydisDecoderContext* context,
+	const void* buffer,
+	ZyanUSize length,
+	ZydisDecodedInstruction* instruction
+	);
+
+ZyanStatus
+ZydisDecoderDecodeOperands(
+	const ZydisDecoder* decoder,
+	const ZydisDecoderContext* context,
+	const ZydisDecodedInstruction* instruction,
+	ZydisDecodedOperand* operands,
+	ZyanU8 operand_count
+	);
+
+ZyanStatus
+ZydisCalcAbsoluteAddress(
+	const ZydisDecodedInstruction* instruction,
+	const ZydisDecodedOperand* operand,
+	ZyanU64 runtime_address,
+	ZyanU64* result_address
+	);
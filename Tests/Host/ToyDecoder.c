@@ -0,0 +1,359 @@
+//
+// A small x86-64 decoder implementing the Zydis API subset that util.c uses. It knows the instructions the
+// xref index and the instruction matchers care about, which is enough to generate test images whose decode
+// results can be checked exactly:
+//   [REX] E8 rel32              call rel32
+//   [REX] E9 rel32              jmp rel32
+//   [REX] EB rel8               jmp rel8
+//   [REX] FF /2, FF /4          call/jmp r/m64 (any ModRM form; mod=00 rm=101 is [rip+disp32])
+//   [REX] 8D /r                 lea r, m
+//   [REX] 8B /r, 89 /r          mov r, r/m and mov r/m, r
+//   [REX] B8+r imm32/imm64      mov r, imm
+//   C3, CC, 90                  ret, int3, nop
+// Every other opcode is a decoding error, which makes the decode loops resync one byte further.
+// ZydisDecoderDecodeOperands() calls are counted in gToyDecoderOperandDecodes.
+//
+
+#include <Zydis/Zydis.h>
+#include <string.h>
+
+#include "HostTest.h"
+
+volatile UINT64 gToyDecoderOperandDecodes;
+
+ZyanStatus
+ZydisDecoderInit(
+	ZydisDecoder* decoder,
+	ZydisMachineMode machine_mode,
+	ZydisStackWidth stack_width
+	)
+{
+	if (decoder == NULL)
+		return ZYAN_STATUS_INVALID_ARGUMENT;
+
+	decoder->machine_mode = machine_mode;
+	decoder->stack_width = stack_width;
+	return ZYAN_STATUS_SUCCESS;
+}
+
+//
+// Returns the number of bytes taken by a ModRM byte and the SIB and displacement that follow it,
+// or 0 if Length is too short. Sets the raw displacement fields of the instruction
+//
+static
+ZyanU8
+DecodeModRm(
+	const ZyanU8* Bytes,
+	ZyanUSize Length,
+	ZyanU8 Offset,
+	ZydisDecodedInstruction* Instruction
+	)
+{
+	if (Length < (ZyanUSize)Offset + 1)
+		return 0;
+
+	const ZyanU8 ModRm = Bytes[Offset];
+	const ZyanU8 Mod = ModRm >> 6, Rm = ModRm & 7;
+	ZyanU8 Size = 1;
+	ZyanU8 DispSize = 0;
+
+	if (Mod != 3 && Rm == 4)
+	{
+		if (Length < (ZyanUSize)Offset + 2)
+			return 0;
+		if (Mod == 0 && (Bytes[Offset + 1] & 7) == 5)
+			DispSize = 4;
+		Size++;
+	}
+	if (Mod == 0 && Rm == 5)
+		DispSize = 4;
+	else if (Mod == 1)
+		DispSize = 1;
+	else if (Mod == 2)
+		DispSize = 4;
+
+	if (Length < (ZyanUSize)Offset + Size + DispSize)
+		return 0;
+
+	Instruction->attributes |= ZYDIS_ATTRIB_HAS_MODRM;
+	if (DispSize != 0)
+	{
+		Instruction->raw.disp.size = DispSize * 8;
+		Instruction->raw.disp.offset = Offset + Size;
+		Instruction->raw.disp.value = DispSize == 1
+			? (ZyanI8)Bytes[Offset + Size]
+			: (ZyanI32)((ZyanU32)Bytes[Offset + Size] | ((ZyanU32)Bytes[Offset + Size + 1] << 8) |
+				((ZyanU32)Bytes[Offset + Size + 2] << 16) | ((ZyanU32)Bytes[Offset + Size + 3] << 24));
+	}
+	if (Mod == 0 && Rm == 5)
+		Instruction->attributes |= ZYDIS_ATTRIB_IS_RELATIVE;
+
+	return Size + DispSize;
+}
+
+static
+ZyanI64
+ReadImmediate(
+	const ZyanU8* Bytes,
+	ZyanU8 Size
+	)
+{
+	ZyanU64 Value = 0;
+	for (ZyanU8 i = 0; i < Size; ++i)
+		Value |= (ZyanU64)Bytes[i] << (8 * i);
+	if (Size == 1)
+		return (ZyanI8)Value;
+	if (Size == 4)
+		return (ZyanI32)Value;
+	return (ZyanI64)Value;
+}
+
+ZyanStatus
+ZydisDecoderDecodeInstruction(
+	const ZydisDecoder* decoder,
+	ZydisDecoderContext* context,
+	const void* buffer,
+	ZyanUSize length,
+	ZydisDecodedInstruction* instruction
+	)
+{
+	if (decoder == NULL || context == NULL || instruction == NULL)
+		return ZYAN_STATUS_INVALID_ARGUMENT;
+	if (buffer == NULL || length == 0)
+		return ZYDIS_STATUS_NO_MORE_DATA;
+
+	const ZyanU8* Bytes = (const ZyanU8*)buffer;
+	memset(instruction, 0, sizeof(*instruction));
+	memset(context, 0, sizeof(*context));
+	instruction->machine_mode = decoder->machine_mode;
+
+	ZyanU8 Offset = 0;
+	if (decoder->machine_mode == ZYDIS_MACHINE_MODE_LONG_64 && (Bytes[0] & 0xF0) == 0x40)
+	{
+		context->rex_w = (Bytes[0] >> 3) & 1;
+		context->reg = (ZyanU8)(((Bytes[0] >> 2) & 1) << 3);
+		Offset++;
+		if (length < 2)
+			return ZYDIS_STATUS_DECODING_ERROR;
+	}
+
+	const ZyanU8 Opcode = Bytes[Offset++];
+	context->opcode = Opcode;
+	ZyanU8 ImmSize = 0;
+
+	switch (Opcode)
+	{
+		case 0xE8:
+		case 0xE9:
+		case 0xEB:
+			instruction->mnemonic = Opcode == 0xE8 ? ZYDIS_MNEMONIC_CALL : ZYDIS_MNEMONIC_JMP;
+			instruction->attributes |= ZYDIS_ATTRIB_IS_RELATIVE;
+			instruction->operand_count = 1;
+			instruction->operand_count_visible = 1;
+			instruction->raw.imm[0].is_signed = ZYAN_TRUE;
+			instruction->raw.imm[0].is_relative = ZYAN_TRUE;
+			ImmSize = Opcode == 0xEB ? 1 : 4;
+			break;
+
+		case 0xFF:
+		{
+			if (length < (ZyanUSize)Offset + 1)
+				return ZYDIS_STATUS_DECODING_ERROR;
+			const ZyanU8 Reg = (Bytes[Offset] >> 3) & 7;
+			if (Reg != 2 && Reg != 4)
+				return ZYDIS_STATUS_DECODING_ERROR;
+			const ZyanU8 ModRmSize = DecodeModRm(Bytes, length, Offset, instruction);
+			if (ModRmSize == 0)
+				return ZYDIS_STATUS_DECODING_ERROR;
+			context->modrm = Bytes[Offset];
+			Offset += ModRmSize;
+			instruction->mnemonic = Reg == 2 ? ZYDIS_MNEMONIC_CALL : ZYDIS_MNEMONIC_JMP;
+			instruction->operand_count = 1;
+			instruction->operand_count_visible = 1;
+			break;
+		}
+
+		case 0x8D:
+		case 0x8B:
+		case 0x89:
+		{
+			if (length < (ZyanUSize)Offset + 1)
+				return ZYDIS_STATUS_DECODING_ERROR;
+			if (Opcode == 0x8D && (Bytes[Offset] >> 6) == 3)
+				return ZYDIS_STATUS_DECODING_ERROR; // lea needs a memory operand
+			const ZyanU8 ModRm = Bytes[Offset];
+			const ZyanU8 ModRmSize = DecodeModRm(Bytes, length, Offset, instruction);
+			if (ModRmSize == 0)
+				return ZYDIS_STATUS_DECODING_ERROR;
+			context->modrm = ModRm;
+			context->reg |= (ModRm >> 3) & 7;
+			Offset += ModRmSize;
+			instruction->mnemonic = Opcode == 0x8D ? ZYDIS_MNEMONIC_LEA : ZYDIS_MNEMONIC_MOV;
+			instruction->operand_count = 2;
+			instruction->operand_count_visible = 2;
+			break;
+		}
+
+		case 0xB8: case 0xB9: case 0xBA: case 0xBB: case 0xBC: case 0xBD: case 0xBE: case 0xBF:
+			instruction->mnemonic = ZYDIS_MNEMONIC_MOV;
+			instruction->operand_count = 2;
+			instruction->operand_count_visible = 2;
+			context->reg |= Opcode & 7;
+			ImmSize = context->rex_w ? 8 : 4;
+			break;
+
+		case 0xC3:
+			instruction->mnemonic = ZYDIS_MNEMONIC_RET;
+			break;
+		case 0xCC:
+			instruction->mnemonic = ZYDIS_MNEMONIC_INT3;
+			break;
+		case 0x90:
+			instruction->mnemonic = ZYDIS_MNEMONIC_NOP;
+			break;
+
+		default:
+			return ZYDIS_STATUS_DECODING_ERROR;
+	}
+
+	if (ImmSize != 0)
+	{
+		if (length < (ZyanUSize)Offset + ImmSize)
+			return ZYDIS_STATUS_DECODING_ERROR;
+		instruction->raw.imm[0].size = ImmSize * 8;
+		instruction->raw.imm[0].offset = Offset;
+		instruction->raw.imm[0].value.s = ReadImmediate(&Bytes[Offset], ImmSize);
+		Offset += ImmSize;
+	}
+
+	instruction->length = Offset;
+	return ZYAN_STATUS_SUCCESS;
+}
+
+//
+// Fills in a memory operand from the ModRM byte of the instruction. Only the base register is tracked,
+// and only well enough to tell [rip+disp32] apart from everything else
+//
+static
+void
+DecodeMemoryOperand(
+	const ZydisDecoderContext* Context,
+	const ZydisDecodedInstruction* Instruction,
+	ZydisDecodedOperand* Operand
+	)
+{
+	Operand->type = ZYDIS_OPERAND_TYPE_MEMORY;
+	Operand->size = 64;
+	Operand->mem.segment = ZYDIS_REGISTER_NONE;
+	Operand->mem.base = (Instruction->attributes & ZYDIS_ATTRIB_IS_RELATIVE) != 0 ? ZYDIS_REGISTER_RIP : ZYDIS_REGISTER_RAX;
+	Operand->mem.index = ZYDIS_REGISTER_NONE;
+	Operand->mem.disp.has_displacement = Instruction->raw.disp.size != 0;
+	Operand->mem.disp.value = Instruction->raw.disp.value;
+}
+
+static
+void
+DecodeRegisterOperand(
+	const ZydisDecoderContext* Context,
+	ZyanU8 Register,
+	ZydisDecodedOperand* Operand
+	)
+{
+	Operand->type = ZYDIS_OPERAND_TYPE_REGISTER;
+	Operand->size = Context->rex_w ? 64 : 32;
+	Operand->reg.value = (ZydisRegister)((Context->rex_w ? ZYDIS_REGISTER_RAX : ZYDIS_REGISTER_EAX) + (Register & 7));
+}
+
+ZyanStatus
+ZydisDecoderDecodeOperands(
+	const ZydisDecoder* decoder,
+	const ZydisDecoderContext* context,
+	const ZydisDecodedInstruction* instruction,
+	ZydisDecodedOperand* operands,
+	ZyanU8 operand_count
+	)
+{
+	if (decoder == NULL || context == NULL || instruction == NULL || (operands == NULL && operand_count != 0))
+		return ZYAN_STATUS_INVALID_ARGUMENT;
+
+	__atomic_add_fetch(&gToyDecoderOperandDecodes, 1, __ATOMIC_RELAXED);
+
+	ZydisDecodedOperand Decoded[2];
+	memset(Decoded, 0, sizeof(Decoded));
+
+	switch (context->opcode)
+	{
+		case 0xE8:
+		case 0xE9:
+		case 0xEB:
+			Decoded[0].type = ZYDIS_OPERAND_TYPE_IMMEDIATE;
+			Decoded[0].size = instruction->raw.imm[0].size;
+			Decoded[0].imm.is_signed = ZYAN_TRUE;
+			Decoded[0].imm.is_relative = ZYAN_TRUE;
+			Decoded[0].imm.value.s = instruction->raw.imm[0].value.s;
+			break;
+		case 0xFF:
+			if ((context->modrm >> 6) == 3)
+				DecodeRegisterOperand(context, context->modrm, &Decoded[0]);
+			else
+				DecodeMemoryOperand(context, instruction, &Decoded[0]);
+			break;
+		case 0x8D:
+		case 0x8B:
+		case 0x89:
+		{
+			ZydisDecodedOperand* RegOperand = context->opcode == 0x89 ? &Decoded[1] : &Decoded[0];
+			ZydisDecodedOperand* RmOperand = context->opcode == 0x89 ? &Decoded[0] : &Decoded[1];
+			DecodeRegisterOperand(context, context->reg, RegOperand);
+			if ((context->modrm >> 6) == 3)
+				DecodeRegisterOperand(context, context->modrm, RmOperand);
+			else
+				DecodeMemoryOperand(context, instruction, RmOperand);
+			break;
+		}
+		default:
+			if (context->opcode >= 0xB8 && context->opcode <= 0xBF)
+			{
+				DecodeRegisterOperand(context, context->reg, &Decoded[0]);
+				Decoded[1].type = ZYDIS_OPERAND_TYPE_IMMEDIATE;
+				Decoded[1].size = instruction->raw.imm[0].size;
+				Decoded[1].imm.value.s = instruction->raw.imm[0].value.s;
+			}
+			break;
+	}
+
+	for (ZyanU8 i = 0; i < operand_count && i < ZYDIS_MAX_OPERAND_COUNT; ++i)
+	{
+		memset(&operands[i], 0, sizeof(operands[i]));
+		if (i < instruction->operand_count && i < 2)
+			operands[i] = Decoded[i];
+		operands[i].id = i;
+	}
+	return ZYAN_STATUS_SUCCESS;
+}
+
+ZyanStatus
+ZydisCalcAbsoluteAddress(
+	const ZydisDecodedInstruction* instruction,
+	const ZydisDecodedOperand* operand,
+	ZyanU64 runtime_address,
+	ZyanU64* result_address
+	)
+{
+	if (instruction == NULL || operand == NULL || result_address == NULL)
+		return ZYAN_STATUS_INVALID_ARGUMENT;
+
+	if (operand->type == ZYDIS_OPERAND_TYPE_MEMORY && operand->mem.base == ZYDIS_REGISTER_RIP)
+	{
+		*result_address = runtime_address + instruction->length + (ZyanU64)operand->mem.disp.value;
+		return ZYAN_STATUS_SUCCESS;
+	}
+	if (operand->type == ZYDIS_OPERAND_TYPE_IMMEDIATE)
+	{
+		*result_address = operand->imm.is_relative
+			? runtime_address + instruction->length + (ZyanU64)operand->imm.value.s
+			: operand->imm.value.u;
+		return ZYAN_STATUS_SUCCESS;
+	}
+	return ZYAN_STATUS_INVALID_ARGUMENT;
+}
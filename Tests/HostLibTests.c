@@ -0,0 +1,173 @@
+//
+// Checks the host replacements that the other tests rely on: the print formatter, the PE image builder
+// and the toy instruction decoder.
+//
+
+#include "Host/HostTest.h"
+
+#include <string.h>
+
+STATIC
+BOOLEAN
+StrEqualsAscii(
+	IN CONST CHAR16* String,
+	IN CONST CHAR8* Expected
+	)
+{
+	for (; *Expected != '\0'; ++String, ++Expected)
+	{
+		if (*String != (CHAR16)(UINT8)*Expected)
+			return FALSE;
+	}
+	return *String == CHAR_NULL;
+}
+
+STATIC
+BOOLEAN
+FormatsAs(
+	IN CONST CHAR8* Expected,
+	IN CONST CHAR16* Format,
+	...
+	)
+{
+	CHAR16 Buffer[256];
+	VA_LIST Marker;
+	VA_START(Marker, Format);
+	UnicodeVSPrint(Buffer, sizeof(Buffer), Format, Marker);
+	VA_END(Marker);
+	return StrEqualsAscii(Buffer, Expected);
+}
+
+STATIC
+VOID
+TestPrint(
+	VOID
+	)
+{
+	TEST_CHECK(FormatsAs("a 12 -3 ff FF 00000000deadbeef", L"a %u %d %x %X %016llx", 12, -3, 0xFF, 0xFF, 0xDEADBEEFULL));
+	TEST_CHECK(FormatsAs("[   7|7   |007]", L"[%4u|%-4u|%03u]", 7, 7, 7));
+	TEST_CHECK(FormatsAs("[  5]", L"[%*u]", (UINTN)3, 5));
+	TEST_CHECK(FormatsAs("wide ascii 100%", L"%s %a 100%%", L"wide", "ascii"));
+	TEST_CHECK(FormatsAs("abc", L"%.3s", L"abcdef"));
+	TEST_CHECK(FormatsAs("18446744073709551615", L"%llu", MAX_UINT64));
+
+	// A BASE_LIST holds each argument in a UINTN-sized slot, and must give the same output as the VA_LIST version
+	UINTN Arguments[4] = { 42, (UINTN)L"str", 0x1234, 0 };
+	CHAR16 Buffer[64];
+	UnicodeBSPrint(Buffer, sizeof(Buffer), L"%u %s %llx", (BASE_LIST)Arguments);
+	TEST_CHECK(StrEqualsAscii(Buffer, "42 str 1234"));
+
+	// Output is truncated to the buffer size, including the terminator
+	TEST_CHECK(UnicodeSPrint(Buffer, 4 * sizeof(CHAR16), L"%u", 123456) == 3);
+	TEST_CHECK(StrEqualsAscii(Buffer, "123"));
+}
+
+STATIC
+VOID
+TestImageBuilder(
+	VOID
+	)
+{
+	CONST TEST_SECTION Sections[] =
+	{
+		{ ".text", 0x2345, TEST_SECTION_CODE },
+		{ ".data", 0x100, TEST_SECTION_DATA },
+	};
+	PEFI_IMAGE_NT_HEADERS NtHeaders;
+	UINT32 ImageSize;
+	UINT8* ImageBase = BuildTestImage(Sections, ARRAY_SIZE(Sections), &NtHeaders, &ImageSize);
+
+	TEST_CHECK(ImageSize == 0x1000 + 0x3000 + 0x1000);
+	TEST_CHECK(RtlpImageNtHeaderEx(ImageBase, ImageSize) == NtHeaders);
+	TEST_CHECK(TestGetSection(NtHeaders, ".data")->VirtualAddress == 0x4000);
+
+	CONST PEFI_IMAGE_SECTION_HEADER Data = FindSectionByRva(NtHeaders, 0x4010);
+	TEST_CHECK(Data != NULL && Data->VirtualAddress == 0x4000);
+	TEST_CHECK(FindSectionByRva(NtHeaders, 0x800) == NULL);
+	TEST_CHECK(SectionHeaderNameId(TestGetSection(NtHeaders, ".text")) == SectionNameToId(".text"));
+
+	free(ImageBase);
+}
+
+STATIC
+VOID
+TestToyDecoder(
+	VOID
+	)
+{
+	// call rel32; lea rcx, [rip+0x10]; mov eax, [rip-0x20]; jmp [rip+0]; jmp rel8; ret; invalid
+	CONST UINT8 Code[] =
+	{
+		0xE8, 0x10, 0x00, 0x00, 0x00,
+		0x48, 0x8D, 0x0D, 0x10, 0x00, 0x00, 0x00,
+		0x8B, 0x05, 0xE0, 0xFF, 0xFF, 0xFF,
+		0xFF, 0x25, 0x00, 0x00, 0x00, 0x00,
+		0xEB, 0xFE,
+		0xC3,
+		0x0F,
+	};
+	CONST struct
+	{
+		ZydisMnemonic Mnemonic;
+		UINT8 Length;
+		BOOLEAN Relative;
+		INT64 Target;			// Relative to the start of Code, or -1 for none
+	} Expected[] =
+	{
+		{ ZYDIS_MNEMONIC_CALL, 5, TRUE, 5 + 0x10 },
+		{ ZYDIS_MNEMONIC_LEA, 7, TRUE, 12 + 0x10 },
+		{ ZYDIS_MNEMONIC_MOV, 6, TRUE, 18 - 0x20 },
+		{ ZYDIS_MNEMONIC_JMP, 6, TRUE, 24 },
+		{ ZYDIS_MNEMONIC_JMP, 2, TRUE, 24 },
+		{ ZYDIS_MNEMONIC_RET, 1, FALSE, -1 },
+	};
+
+	ZYDIS_CONTEXT Context;
+	ZeroMem(&Context, sizeof(Context));
+	ZydisDecoderInit(&Context.Decoder, ZYDIS_MACHINE_MODE_LONG_64, ZYDIS_STACK_WIDTH_64);
+
+	UINTN Offset = 0;
+	for (UINT32 i = 0; i < ARRAY_SIZE(Expected); ++i)
+	{
+		if (!TEST_CHECK(ZYAN_SUCCESS(ZydisDecoderDecodeInstruction(&Context.Decoder, &Context.DecoderContext, Code + Offset,
+			sizeof(Code) - Offset, &Context.Instruction)), "instruction %u", i))
+			return;
+
+		TEST_CHECK(Context.Instruction.mnemonic == Expected[i].Mnemonic, "instruction %u", i);
+		TEST_CHECK(Context.Instruction.length == Expected[i].Length, "instruction %u", i);
+		TEST_CHECK(((Context.Instruction.attributes & ZYDIS_ATTRIB_IS_RELATIVE) != 0) == Expected[i].Relative, "instruction %u", i);
+
+		CONST UINT64 OperandDecodes = gToyDecoderOperandDecodes;
+		Context.InstructionAddress = (ZyanU64)(UINTN)(Code + Offset);
+		TEST_CHECK(ZYAN_SUCCESS(ZydisDecodeOperands(&Context)));
+		TEST_CHECK(gToyDecoderOperandDecodes == OperandDecodes + 1);
+
+		if (Expected[i].Target >= 0)
+		{
+			// The relative operand is the memory operand for lea/mov, and the first one otherwise
+			CONST UINT8 OperandIndex = Context.Instruction.mnemonic == ZYDIS_MNEMONIC_LEA || Context.Instruction.mnemonic == ZYDIS_MNEMONIC_MOV ? 1 : 0;
+			ZyanU64 Target = 0;
+			TEST_CHECK(ZYAN_SUCCESS(ZydisCalcAbsoluteAddress(&Context.Instruction, &Context.Operands[OperandIndex],
+				Context.InstructionAddress, &Target)), "instruction %u", i);
+			TEST_CHECK(Target == (ZyanU64)(UINTN)(Code + Expected[i].Target), "instruction %u", i);
+		}
+		Offset += Context.Instruction.length;
+	}
+
+	TEST_CHECK(Context.Operands[0].type == ZYDIS_OPERAND_TYPE_UNUSED || Context.Instruction.operand_count == 0);
+	TEST_CHECK(!ZYAN_SUCCESS(ZydisDecoderDecodeInstruction(&Context.Decoder, &Context.DecoderContext, Code + Offset,
+		sizeof(Code) - Offset, &Context.Instruction)));
+	TEST_CHECK(ZydisDecoderDecodeInstruction(&Context.Decoder, &Context.DecoderContext, Code, 0, &Context.Instruction) ==
+		ZYDIS_STATUS_NO_MORE_DATA);
+}
+
+int
+main(
+	VOID
+	)
+{
+	TestPrint();
+	TestImageBuilder();
+	TestToyDecoder();
+	return TestSummary("HostLibTests");
+}
@@ -0,0 +1,128 @@
+//
+// Checks that kernel patch messages recorded by AppendKernelPatchMessage() and printed later by PrintKernelPatchInfo()
+// read the same as the same format string and arguments formatted immediately with UnicodeSPrint(), for every argument
+// type PrintLib reads from a BASE_LIST, including '*' widths, and that ring buffer wrap-around keeps the newest messages.
+//
+
+#include "Host/HostTest.h"
+
+#define MESSAGE_LENGTH		256
+#define NUM_MESSAGES		(3 * KERNEL_PATCH_MSG_MAX_RECORDS)
+#define CAPTURE_LENGTH		((KERNEL_PATCH_MSG_MAX_RECORDS + 8) * MESSAGE_LENGTH)
+
+STATIC CHAR16 mExpected[NUM_MESSAGES][MESSAGE_LENGTH];
+STATIC CHAR16 mExpectedOutput[CAPTURE_LENGTH];
+STATIC CHAR16 mOutput[CAPTURE_LENGTH];
+
+//
+// Formats a message into mExpected[Index] immediately, and records it for deferred printing. The arguments are
+// evaluated twice, so they must not have side effects
+//
+#define RECORD_MESSAGE(Index, Format, ...) \
+	do { \
+		UnicodeSPrint(mExpected[(Index)], sizeof(mExpected[(Index)]), (Format), ##__VA_ARGS__); \
+		AppendKernelPatchMessage((Format), ##__VA_ARGS__); \
+	} while (FALSE)
+
+STATIC CONST CHAR16* CONST mNames[] = { L"ntoskrnl.exe", L"KeInitAmd64SpecificState", L"", L"CI.dll" };
+STATIC CONST CHAR8* CONST mAsciiNames[] = { "SeCodeIntegrityQueryInformation", "x", "" };
+
+STATIC
+VOID
+RecordRandomMessage(
+	IN UINT32 Index
+	)
+{
+	CONST UINT64 Value = TestRandom() >> TestRandomBelow(64);
+	CONST UINT32 Small = (UINT32)TestRandom();
+	CONST CHAR16* Name = mNames[TestRandomBelow(ARRAY_SIZE(mNames))];
+	CONST CHAR8* AsciiName = mAsciiNames[TestRandomBelow(ARRAY_SIZE(mAsciiNames))];
+	CONST EFI_STATUS Status = TestRandomBelow(2) == 0 ? EFI_SUCCESS : EFI_NOT_FOUND;
+
+	switch (TestRandomBelow(8))
+	{
+		case 0:
+			RECORD_MESSAGE(Index, L"    Found %s at 0x%llX.\r\n", Name, Value);
+			break;
+		case 1:
+			RECORD_MESSAGE(Index, L"Offset %d, size %u, flags %x\r\n", (INT32)Small, Small >> 3, Small ^ 0x5A5A);
+			break;
+		case 2:
+			RECORD_MESSAGE(Index, L"%-34a|%016lx|%c\r\n", AsciiName, Value, (CHAR16)(L'A' + Small % 26));
+			break;
+		case 3:
+			RECORD_MESSAGE(Index, L"[%*u] %p %r\r\n", (UINTN)(Small % 12), Small, (VOID*)(UINTN)Value, Status);
+			break;
+		case 4:
+			RECORD_MESSAGE(Index, L"No arguments, 100%% literal\r\n");
+			break;
+		case 5:
+			// Fills every slot of the argument buffer
+			RECORD_MESSAGE(Index, L"%lld %lld %lld %lld %lld %lld\r\n", (INT64)Value, -(INT64)Value, (INT64)Small,
+				(INT64)-1, (INT64)0, (INT64)(Value >> 7));
+			break;
+		case 6:
+			RECORD_MESSAGE(Index, L"%.*s and %-*a!\r\n", (UINTN)(Small % 8), Name, (UINTN)(Small % 20), AsciiName);
+			break;
+		default:
+			RECORD_MESSAGE(Index, L"%d%u%x%X%ld%lu\r\n", -(INT32)(Small % 1000), Small, Small, Small, -(INT64)Value, Value);
+			break;
+	}
+}
+
+//
+// Prints the recorded messages and compares the output with the expected messages First..NumMessages - 1
+//
+STATIC
+VOID
+CheckPrintedMessages(
+	IN UINT32 NumMessages,
+	IN UINT32 Iteration
+	)
+{
+	CONST UINT32 First = NumMessages > KERNEL_PATCH_MSG_MAX_RECORDS ? NumMessages - KERNEL_PATCH_MSG_MAX_RECORDS : 0;
+	UINTN Length = 0;
+	if (First > 0)
+		Length += UnicodeSPrint(mExpectedOutput, sizeof(mExpectedOutput), L"[%u earlier messages were dropped]\r\n", First);
+	for (UINT32 i = First; i < NumMessages; ++i)
+		Length += UnicodeSPrint(mExpectedOutput + Length, sizeof(mExpectedOutput) - Length * sizeof(CHAR16), L"%s", mExpected[i]);
+	UnicodeSPrint(mExpectedOutput + Length, sizeof(mExpectedOutput) - Length * sizeof(CHAR16), L"Total boot stage delay: %u ms.\r\n", 0);
+
+	HostCaptureConsole(mOutput, ARRAY_SIZE(mOutput));
+	PrintKernelPatchInfo();
+	FlushConsole();
+	HostCaptureConsole(NULL, 0);
+
+	UINTN Mismatch = 0;
+	while (mOutput[Mismatch] != CHAR_NULL && mOutput[Mismatch] == mExpectedOutput[Mismatch])
+		Mismatch++;
+	TEST_CHECK(mOutput[Mismatch] == mExpectedOutput[Mismatch], "iteration %u, %u messages: output differs at character %llu",
+		Iteration, NumMessages, (unsigned long long)Mismatch);
+}
+
+int
+main(
+	VOID
+	)
+{
+	TestSeedRandom(20);
+	for (UINT32 Iteration = 0; Iteration < 200; ++Iteration)
+	{
+		// Up to three times the ring buffer size, so that most iterations wrap around
+		ZeroMem(&gKernelPatchInfo, sizeof(gKernelPatchInfo));
+		CONST UINT32 NumMessages = Iteration == 0 ? 0 : TestRandomBelow(NUM_MESSAGES + 1);
+		for (UINT32 i = 0; i < NumMessages; ++i)
+			RecordRandomMessage(i);
+		TEST_CHECK(gKernelPatchInfo.NumMessages == NumMessages);
+		CheckPrintedMessages(NumMessages, Iteration);
+	}
+
+	// A message with more arguments than fit is replaced by a notice
+	ZeroMem(&gKernelPatchInfo, sizeof(gKernelPatchInfo));
+	AppendKernelPatchMessage(L"%llx %llx %llx %llx %llx %llx %llx\r\n", 1ull, 2ull, 3ull, 4ull, 5ull, 6ull, 7ull);
+	UnicodeSPrint(mExpected[0], sizeof(mExpected[0]), L"[Kernel patch message with too many arguments]\r\n");
+	CheckPrintedMessages(1, 0);
+
+	ZeroMem(&gKernelPatchInfo, sizeof(gKernelPatchInfo));
+	return TestSummary("KernelPatchMessageTests");
+}
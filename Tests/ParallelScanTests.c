@@ -0,0 +1,174 @@
+//
+// Checks the multiprocessor scan scheduler against the serial scans, using the thread backed MP services protocol of
+// the host library: FindSignatureParallel() against FindSignature() with matches on and across chunk boundaries, and
+// BuildXrefIndex() with and without a scheduler. Also checks that the calling processor takes part in each job, and that
+// scans still complete on the calling processor alone if the APs cannot be started.
+//
+
+#include "Host/HostTest.h"
+
+#define BUFFER_SIZE		(4 * 1024 * 1024)
+#define TEXT_SIZE		(2 * 1024 * 1024)
+#define PDATA_SIZE		(64 * 1024)
+
+STATIC
+VOID
+TestInitializeScanScheduler(
+	VOID
+	)
+{
+	SCAN_SCHEDULER Scheduler;
+
+	HostSetMpServices(0, EFI_SUCCESS);
+	TEST_CHECK(InitializeScanScheduler(&Scheduler) == EFI_NOT_FOUND && Scheduler.RunOnProcessors == NULL);
+
+	HostSetMpServices(1, EFI_SUCCESS);
+	TEST_CHECK(InitializeScanScheduler(&Scheduler) == EFI_UNSUPPORTED && Scheduler.RunOnProcessors == NULL);
+
+	// The calling processor is counted
+	HostSetMpServices(4, EFI_SUCCESS);
+	TEST_CHECK(InitializeScanScheduler(&Scheduler) == EFI_SUCCESS && Scheduler.RunOnProcessors != NULL && Scheduler.NumProcessors == 4);
+}
+
+STATIC
+VOID
+TestFindSignatureParallel(
+	IN UINT32 NumProcessors,
+	IN EFI_STATUS StartupStatus
+	)
+{
+	SCAN_SCHEDULER Scheduler;
+	HostSetMpServices(NumProcessors, StartupStatus);
+	TEST_CHECK(InitializeScanScheduler(&Scheduler) == EFI_SUCCESS);
+
+	UINT8* Buffer = malloc(BUFFER_SIZE);
+	for (UINT32 Iteration = 0; Iteration < 40; ++Iteration)
+	{
+		TestRandomBytes(Buffer, BUFFER_SIZE, 16);
+
+		UINT8 Pattern[24];
+		CONST UINT32 PatternLength = 8 + TestRandomBelow(sizeof(Pattern) - 8);
+		TestRandomBytes(Pattern, PatternLength, 256);
+		Pattern[PatternLength - 1] = 0xF0;		// Outside the alphabet of the buffer, so only planted copies match
+
+		// Plant copies at random offsets, and across the boundaries of the chunks the scan is split into
+		CONST UINT32 ChunkSize = BUFFER_SIZE / MIN(NumProcessors * 4, SCAN_MAX_CHUNKS);
+		CONST UINT32 NumCopies = TestRandomBelow(4);
+		for (UINT32 c = 0; c < NumCopies; ++c)
+		{
+			UINT32 Offset = TestRandomBelow(2) == 0
+				? TestRandomBelow(BUFFER_SIZE - PatternLength)
+				: ChunkSize * (1 + TestRandomBelow(BUFFER_SIZE / ChunkSize - 1)) - TestRandomBelow(PatternLength + 2);
+			Offset = MIN(Offset, BUFFER_SIZE - PatternLength);
+			CopyMem(Buffer + Offset, Pattern, PatternLength);
+		}
+
+		BYTE_SIGNATURE Serial = { Pattern, NULL, PatternLength, 0xCC, FALSE };
+		BYTE_SIGNATURE Parallel = { Pattern, NULL, PatternLength, 0xCC, FALSE };
+		VOID *Expected, *Found;
+		CONST UINT32 ApProcedures = gHostApProceduresRun;
+		CONST UINT32 Startups = gHostNonBlockingStartups;
+		CONST EFI_STATUS ExpectedStatus = FindSignature(&Serial, Buffer, BUFFER_SIZE, &Expected);
+		CONST EFI_STATUS Status = FindSignatureParallel(&Scheduler, &Parallel, Buffer, BUFFER_SIZE, &Found);
+		TEST_CHECK(Status == ExpectedStatus && Found == Expected, "%u processors, iteration %u: found %p, expected %p",
+			NumProcessors, Iteration, Found, Expected);
+
+		// Each AP runs the worker once. The calling processor is not an AP, so it is not counted here
+		CONST BOOLEAN Started = !EFI_ERROR(StartupStatus);
+		TEST_CHECK(gHostNonBlockingStartups - Startups == (Started ? 1 : 0));
+		TEST_CHECK(gHostApProceduresRun - ApProcedures == (Started ? NumProcessors - 1 : 0));
+	}
+	free(Buffer);
+}
+
+STATIC
+BOOLEAN
+XrefIndexesEqual(
+	IN CONST XREF_INDEX* A,
+	IN CONST XREF_INDEX* B
+	)
+{
+	return A->Count == B->Count && CompareMem(A->Xrefs, B->Xrefs, A->Count * sizeof(XREF)) == 0;
+}
+
+STATIC
+VOID
+TestBuildXrefIndex(
+	IN UINT8* ImageBase,
+	IN PEFI_IMAGE_NT_HEADERS NtHeaders,
+	IN UINT32 NumProcessors,
+	IN EFI_STATUS StartupStatus
+	)
+{
+	SCAN_SCHEDULER Scheduler;
+	HostSetMpServices(NumProcessors, StartupStatus);
+	TEST_CHECK(InitializeScanScheduler(&Scheduler) == EFI_SUCCESS);
+
+	CONST PEFI_IMAGE_SECTION_HEADER Text = TestGetSection(NtHeaders, ".text");
+	UINT8* Code = ImageBase + Text->VirtualAddress;
+
+	for (UINT32 Iteration = 0; Iteration < 4; ++Iteration)
+	{
+		// Functions of random code, with gaps of junk bytes between them
+		SetMem(Code, TEXT_SIZE, 0x06);
+		CONST UINT32 NumFunctions = BuildTestFunctionTable(ImageBase, NtHeaders, ".text", ".pdata", 2048, 5);
+		CONST IMAGE_RUNTIME_FUNCTION_ENTRY* Table = (CONST IMAGE_RUNTIME_FUNCTION_ENTRY*)(ImageBase +
+			NtHeaders->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_EXCEPTION].VirtualAddress);
+		for (UINT32 i = 0; i < NumFunctions; ++i)
+		{
+			GenerateTestCode(ImageBase + Table[i].BeginAddress, Table[i].EndAddress - Table[i].BeginAddress,
+				Iteration * 5, NULL, MAX_UINT32);
+		}
+
+		ZYDIS_CONTEXT Context;
+		XREF_INDEX Expected, Index;
+		ZeroMem(&Expected, sizeof(Expected));
+		ZeroMem(&Index, sizeof(Index));
+		TEST_CHECK(ZYAN_SUCCESS(ZydisInit(NtHeaders, &Context)));
+		TEST_CHECK(BuildXrefIndex(NULL, &Context, ImageBase, NtHeaders, Code, TEXT_SIZE, &Expected) == EFI_SUCCESS);
+
+		CONST UINT32 Startups = gHostNonBlockingStartups;
+		TEST_CHECK(ZYAN_SUCCESS(ZydisInit(NtHeaders, &Context)));
+		TEST_CHECK(BuildXrefIndex(&Scheduler, &Context, ImageBase, NtHeaders, Code, TEXT_SIZE, &Index) == EFI_SUCCESS);
+		TEST_CHECK(XrefIndexesEqual(&Index, &Expected), "%u processors, iteration %u: %llu xrefs, expected %llu",
+			NumProcessors, Iteration, (unsigned long long)Index.Count, (unsigned long long)Expected.Count);
+		TEST_CHECK(Expected.Count > NumFunctions);
+		TEST_CHECK(gHostNonBlockingStartups - Startups == (EFI_ERROR(StartupStatus) ? 0 : 1));
+
+		FreeXrefIndex(&Index);
+		FreeXrefIndex(&Expected);
+	}
+}
+
+int
+main(
+	VOID
+	)
+{
+	CONST TEST_SECTION Sections[] =
+	{
+		{ ".text", TEXT_SIZE, TEST_SECTION_CODE },
+		{ ".pdata", PDATA_SIZE, TEST_SECTION_RDATA },
+	};
+	PEFI_IMAGE_NT_HEADERS NtHeaders;
+	UINT32 ImageSize;
+	UINT8* ImageBase = BuildTestImage(Sections, ARRAY_SIZE(Sections), &NtHeaders, &ImageSize);
+
+	TestSeedRandom(19);
+	TestInitializeScanScheduler();
+
+	STATIC CONST UINT32 ProcessorCounts[] = { 2, 3, 8 };
+	for (UINT32 p = 0; p < ARRAY_SIZE(ProcessorCounts); ++p)
+	{
+		TestFindSignatureParallel(ProcessorCounts[p], EFI_SUCCESS);
+		TestBuildXrefIndex(ImageBase, NtHeaders, ProcessorCounts[p], EFI_SUCCESS);
+	}
+
+	// If the APs cannot be started, the calling processor does all of the work
+	TestFindSignatureParallel(4, EFI_NOT_READY);
+	TestBuildXrefIndex(ImageBase, NtHeaders, 4, EFI_NOT_READY);
+
+	HostSetMpServices(0, EFI_SUCCESS);
+	free(ImageBase);
+	return TestSummary("ParallelScanTests");
+}
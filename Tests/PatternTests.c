@@ -0,0 +1,294 @@
+//
+// Compares the anchored pattern matcher behind FindPattern(), FindSignature() and FindPatterns() with the
+// byte-by-byte reference search on random buffers. Patterns of up to PATTERN_MAX_WORDS * 8 bytes go through the
+// SWAR matcher (or its fallback for patterns without anchor bytes), longer ones through FindLongPattern()'s prefix search.
+//
+
+#include "Host/HostTest.h"
+
+#include <string.h>
+
+#define WILDCARD			0xCC
+#define MAX_BUFFER_SIZE		600
+
+//
+// Fills Pattern with the bytes at a random offset of Buffer, replacing some with wildcards or random bytes.
+// Most patterns thus occur in the buffer, but not necessarily at the offset they were taken from
+//
+STATIC
+VOID
+RandomPattern(
+	IN CONST UINT8* Buffer,
+	IN UINT32 Size,
+	OUT UINT8* Pattern,
+	OUT UINT8* Mask OPTIONAL,
+	IN UINT32 PatternLength
+	)
+{
+	CONST UINT32 Offset = Size > PatternLength ? TestRandomBelow(Size - PatternLength) : 0;
+	for (UINT32 i = 0; i < PatternLength; ++i)
+	{
+		Pattern[i] = Offset + i < Size ? Buffer[Offset + i] : (UINT8)TestRandom();
+		if (TestRandomBelow(50) == 0)
+			Pattern[i] = (UINT8)TestRandom();
+
+		CONST BOOLEAN IsWildcard = TestRandomBelow(4) == 0;
+		if (Mask != NULL)
+			Mask[i] = IsWildcard ? 0x00 : 0xFF;
+		else if (IsWildcard)
+			Pattern[i] = WILDCARD;
+	}
+}
+
+//
+// Returns a copy of a random buffer in a heap block of exactly Size bytes, so that reads past the end are caught by ASan
+//
+STATIC
+UINT8*
+RandomBuffer(
+	IN UINT32 Size
+	)
+{
+	UINT8* Buffer = malloc(Size > 0 ? Size : 1);
+	CONST UINT32 Alphabet = 1 + TestRandomBelow(6);
+	for (UINT32 i = 0; i < Size; ++i)
+	{
+		// Mostly a small alphabet, so that patterns have many partial matches. Some 0xCC bytes test literal int3 matches
+		CONST UINT32 Kind = TestRandomBelow(8);
+		Buffer[i] = Kind == 0 ? (UINT8)TestRandom() : (Kind == 1 ? 0xCC : (UINT8)(0x40 + TestRandomBelow(Alphabet)));
+	}
+	return Buffer;
+}
+
+//
+// Byte-by-byte search for a masked pattern, with the same bounds as FindPatternBytewise()
+//
+STATIC
+VOID*
+FindMaskedBytewise(
+	IN CONST UINT8* Pattern,
+	IN CONST UINT8* Mask,
+	IN UINT32 PatternLength,
+	IN CONST UINT8* Base,
+	IN UINT32 Size
+	)
+{
+	for (CONST UINT8* Address = Base; Address < (CONST UINT8*)((UINTN)Base + Size - PatternLength); ++Address)
+	{
+		UINT32 i;
+		for (i = 0; i < PatternLength; ++i)
+		{
+			if (Mask[i] != 0x00 && Address[i] != Pattern[i])
+				break;
+		}
+		if (i == PatternLength)
+			return (VOID*)Address;
+	}
+	return NULL;
+}
+
+STATIC
+VOID
+TestFindPattern(
+	VOID
+	)
+{
+	for (UINT32 Iteration = 0; Iteration < 200000; ++Iteration)
+	{
+		CONST UINT32 Size = TestRandomBelow(MAX_BUFFER_SIZE);
+		UINT8* Buffer = RandomBuffer(Size);
+		UINT8 Pattern[PATTERN_MAX_WORDS * sizeof(UINT64)];
+		CONST UINT32 PatternLength = 1 + TestRandomBelow(sizeof(Pattern));
+		RandomPattern(Buffer, Size, Pattern, NULL, PatternLength);
+
+		VOID* Found = (VOID*)1;
+		VOID* Expected = (VOID*)1;
+		CONST EFI_STATUS Status = FindPattern(Pattern, WILDCARD, PatternLength, Buffer, Size, &Found);
+		CONST EFI_STATUS ExpectedStatus = FindPatternBytewise(Pattern, WILDCARD, PatternLength, Buffer, Size, &Expected);
+		TEST_CHECK(Status == ExpectedStatus && Found == Expected,
+			"iteration %u: size %u, pattern length %u: found %p, expected %p", Iteration, Size, PatternLength, Found, Expected);
+
+		free(Buffer);
+	}
+}
+
+STATIC
+VOID
+TestFindLongPattern(
+	VOID
+	)
+{
+	CONST UINT32 MaxPrefix = PATTERN_MAX_WORDS * sizeof(UINT64);
+	for (UINT32 Iteration = 0; Iteration < 20000; ++Iteration)
+	{
+		CONST UINT32 Size = TestRandomBelow(MAX_BUFFER_SIZE);
+		UINT8* Buffer = RandomBuffer(Size);
+		UINT8 Pattern[MaxPrefix + 80];
+		CONST UINT32 PatternLength = MaxPrefix + 1 + TestRandomBelow(sizeof(Pattern) - MaxPrefix);
+		RandomPattern(Buffer, Size, Pattern, NULL, PatternLength);
+
+		// Prefixes without an anchor byte fall back to the bytewise search
+		if (TestRandomBelow(20) == 0)
+			SetMem(Pattern, MaxPrefix, WILDCARD);
+
+		VOID* Found = (VOID*)1;
+		VOID* Expected = (VOID*)1;
+		CONST EFI_STATUS Status = FindPattern(Pattern, WILDCARD, PatternLength, Buffer, Size, &Found);
+		CONST EFI_STATUS ExpectedStatus = FindPatternBytewise(Pattern, WILDCARD, PatternLength, Buffer, Size, &Expected);
+		TEST_CHECK(Status == ExpectedStatus && Found == Expected,
+			"iteration %u: size %u, pattern length %u: found %p, expected %p", Iteration, Size, PatternLength, Found, Expected);
+
+		free(Buffer);
+	}
+
+	// Many prefix matches whose remainder differs, then a full match at the last start offset searched
+	STATIC UINT8 Repeated[1024];
+	UINT8 Pattern[MaxPrefix + 16];
+	SetMem(Repeated, sizeof(Repeated), 0x41);
+	SetMem(Pattern, sizeof(Pattern), 0x41);
+	Pattern[sizeof(Pattern) - 1] = 0x42;
+	Repeated[sizeof(Repeated) - 2] = 0x42;
+
+	VOID* Found;
+	TEST_CHECK(FindPattern(Pattern, WILDCARD, sizeof(Pattern), Repeated, sizeof(Repeated), &Found) == EFI_SUCCESS &&
+		Found == &Repeated[sizeof(Repeated) - 1 - sizeof(Pattern)]);
+
+	// One byte further is past the last start offset, as in FindPatternBytewise()
+	Repeated[sizeof(Repeated) - 2] = 0x41;
+	Repeated[sizeof(Repeated) - 1] = 0x42;
+	TEST_CHECK(FindPattern(Pattern, WILDCARD, sizeof(Pattern), Repeated, sizeof(Repeated), &Found) == EFI_NOT_FOUND && Found == NULL);
+	TEST_CHECK(FindPattern(Pattern, WILDCARD, sizeof(Pattern), Repeated, sizeof(Pattern), &Found) == EFI_NOT_FOUND);
+}
+
+STATIC
+VOID
+TestFindPatternEdgeCases(
+	VOID
+	)
+{
+	UINT8 Buffer[64];
+	SetMem(Buffer, sizeof(Buffer), 0x11);
+	Buffer[40] = 0x22;
+	Buffer[41] = 0x33;
+
+	VOID* Found;
+	CONST UINT8 Match[] = { 0x22, 0x33 };
+	TEST_CHECK(FindPattern(Match, WILDCARD, sizeof(Match), Buffer, sizeof(Buffer), &Found) == EFI_SUCCESS && Found == &Buffer[40]);
+
+	// A pattern of only wildcards has no anchor byte and matches at the start
+	CONST UINT8 AllWildcards[] = { WILDCARD, WILDCARD, WILDCARD };
+	TEST_CHECK(FindPattern(AllWildcards, WILDCARD, sizeof(AllWildcards), Buffer, sizeof(Buffer), &Found) == EFI_SUCCESS &&
+		Found == Buffer);
+
+	// The last start offset searched is Size - PatternLength - 1, as in the original loop
+	TEST_CHECK(FindPattern(Match, WILDCARD, sizeof(Match), Buffer, 43, &Found) == EFI_SUCCESS && Found == &Buffer[40]);
+	TEST_CHECK(FindPattern(Match, WILDCARD, sizeof(Match), Buffer, 42, &Found) == EFI_NOT_FOUND && Found == NULL);
+
+	// Patterns longer than the buffer are not found
+	TEST_CHECK(FindPattern(Match, WILDCARD, sizeof(Match), Buffer, 1, &Found) == EFI_NOT_FOUND && Found == NULL);
+	TEST_CHECK(FindPattern(Match, WILDCARD, sizeof(Match), Buffer, 0, &Found) == EFI_NOT_FOUND && Found == NULL);
+
+	TEST_CHECK(FindPattern(NULL, WILDCARD, sizeof(Match), Buffer, sizeof(Buffer), &Found) == EFI_INVALID_PARAMETER);
+	TEST_CHECK(FindPattern(Match, WILDCARD, sizeof(Match), Buffer, sizeof(Buffer), NULL) == EFI_INVALID_PARAMETER);
+}
+
+STATIC
+VOID
+TestFindSignature(
+	VOID
+	)
+{
+	for (UINT32 Iteration = 0; Iteration < 100000; ++Iteration)
+	{
+		CONST UINT32 Size = TestRandomBelow(MAX_BUFFER_SIZE);
+		UINT8* Buffer = RandomBuffer(Size);
+		UINT8 Pattern[PATTERN_MAX_WORDS * sizeof(UINT64)], Mask[PATTERN_MAX_WORDS * sizeof(UINT64)];
+		CONST UINT32 PatternLength = 1 + TestRandomBelow(sizeof(Pattern));
+		CONST BOOLEAN Masked = TestRandomBelow(2) == 0;
+		RandomPattern(Buffer, Size, Pattern, Masked ? Mask : NULL, PatternLength);
+
+		if (!Masked)
+		{
+			for (UINT32 i = 0; i < PatternLength; ++i)
+				Mask[i] = Pattern[i] == WILDCARD ? 0x00 : 0xFF;
+		}
+		VOID* CONST Expected = FindMaskedBytewise(Pattern, Mask, PatternLength, Buffer, Size);
+
+		BYTE_SIGNATURE Signature = { Pattern, Masked ? Mask : NULL, PatternLength, WILDCARD, FALSE };
+
+		// The second search uses the matcher cached by the first
+		for (UINT32 Search = 0; Search < 2; ++Search)
+		{
+			VOID* Found = (VOID*)1;
+			CONST EFI_STATUS Status = FindSignature(&Signature, Buffer, Size, &Found);
+			TEST_CHECK(Signature.Initialized);
+			TEST_CHECK((Status == EFI_SUCCESS) == (Expected != NULL) && Found == Expected,
+				"iteration %u, search %u: size %u, pattern length %u, masked %u: found %p, expected %p",
+				Iteration, Search, Size, PatternLength, Masked, Found, Expected);
+		}
+
+		free(Buffer);
+	}
+
+	// A masked signature can match a literal 0xCC byte
+	CONST UINT8 Int3Pattern[] = { 0xC3, 0xCC, 0xCC, 0x48 };
+	CONST UINT8 Int3Mask[] = { 0xFF, 0xFF, 0xFF, 0xFF };
+	CONST UINT8 Code[] = { 0xC3, 0x90, 0x90, 0x48, 0xC3, 0xCC, 0xCC, 0x48, 0x00 };
+	BYTE_SIGNATURE Int3Signature = MASKED_BYTE_SIGNATURE_INIT(Int3Pattern, Int3Mask);
+	VOID* Found;
+	TEST_CHECK(FindSignature(&Int3Signature, Code, sizeof(Code), &Found) == EFI_SUCCESS && Found == &Code[4]);
+}
+
+STATIC
+VOID
+TestFindPatterns(
+	VOID
+	)
+{
+	for (UINT32 Iteration = 0; Iteration < 100000; ++Iteration)
+	{
+		CONST UINT32 Size = 1 + TestRandomBelow(MAX_BUFFER_SIZE);
+		UINT8* Buffer = RandomBuffer(Size);
+
+		PATTERN_SEARCH Searches[PATTERN_SEARCH_MAX_PATTERNS];
+		UINT8 Patterns[PATTERN_SEARCH_MAX_PATTERNS][40];
+		CONST UINT32 NumSearches = 1 + TestRandomBelow(PATTERN_SEARCH_MAX_PATTERNS);
+		for (UINT32 i = 0; i < NumSearches; ++i)
+		{
+			Searches[i].PatternLength = 1 + TestRandomBelow(sizeof(Patterns[i]));
+			Searches[i].Pattern = Patterns[i];
+			Searches[i].Wildcard = WILDCARD;
+			Searches[i].Found = (VOID*)1;
+			RandomPattern(Buffer, Size, Patterns[i], NULL, Searches[i].PatternLength);
+		}
+
+		CONST EFI_STATUS Status = FindPatterns(Searches, NumSearches, Buffer, Size);
+
+		BOOLEAN AllFound = TRUE;
+		for (UINT32 i = 0; i < NumSearches; ++i)
+		{
+			VOID* Expected;
+			if (EFI_ERROR(FindPattern(Searches[i].Pattern, WILDCARD, Searches[i].PatternLength, Buffer, Size, &Expected)))
+				AllFound = FALSE;
+			TEST_CHECK(Searches[i].Found == Expected, "iteration %u, pattern %u: size %u, pattern length %u: found %p, expected %p",
+				Iteration, i, Size, Searches[i].PatternLength, Searches[i].Found, Expected);
+		}
+		TEST_CHECK((Status == EFI_SUCCESS) == AllFound, "iteration %u", Iteration);
+
+		free(Buffer);
+	}
+}
+
+int
+main(
+	VOID
+	)
+{
+	TestSeedRandom(2);
+	TestFindPattern();
+	TestFindLongPattern();
+	TestFindPatternEdgeCases();
+	TestFindSignature();
+	TestFindPatterns();
+	return TestSummary("PatternTests");
+}
@@ -0,0 +1,342 @@
+//
+// Checks FindResourceDataById() against a linear search of randomly generated resource trees, including named entries,
+// missing IDs, language neutral lookups and leaves at the wrong level, and FindIATAddressForImport() against the thunk
+// tables it was generated from.
+//
+
+#include "Host/HostTest.h"
+
+#include <string.h>
+
+#define SECTION_SIZE	0x40000
+#define ID_RANGE		48		// Small enough that random lookups often hit
+
+//
+// Bump allocator for building directories inside a section
+//
+typedef struct _SECTION_BUILDER
+{
+	UINT8* ImageBase;
+	UINT32 SectionRva;
+	UINT32 Used;
+	UINT32 Size;
+} SECTION_BUILDER;
+
+STATIC
+UINT32
+SectionAllocate(
+	IN OUT SECTION_BUILDER* Builder,
+	IN UINT32 Size
+	)
+{
+	CONST UINT32 Offset = ALIGN_VALUE(Builder->Used, 8);
+	if (Offset + Size > Builder->Size)
+	{
+		printf("Test section is full\n");
+		abort();
+	}
+	Builder->Used = Offset + Size;
+	ZeroMem(Builder->ImageBase + Builder->SectionRva + Offset, Size);
+	return Offset;
+}
+
+STATIC
+VOID*
+SectionPointer(
+	IN CONST SECTION_BUILDER* Builder,
+	IN UINT32 Offset
+	)
+{
+	return Builder->ImageBase + Builder->SectionRva + Offset;
+}
+
+STATIC
+UINT32
+BuildDataEntry(
+	IN OUT SECTION_BUILDER* Builder
+	)
+{
+	CONST UINT32 Offset = SectionAllocate(Builder, sizeof(EFI_IMAGE_RESOURCE_DATA_ENTRY));
+	EFI_IMAGE_RESOURCE_DATA_ENTRY* DataEntry = SectionPointer(Builder, Offset);
+	DataEntry->OffsetToData = Builder->SectionRva + (UINT32)TestRandomBelow(SECTION_SIZE);
+	DataEntry->Size = 1 + (UINT32)TestRandomBelow(0x1000);
+	return Offset;
+}
+
+//
+// Builds one directory of a Type -> Name -> Language tree (Level 0, 1, 2) and returns its offset
+//
+STATIC
+UINT32
+BuildResourceDirectory(
+	IN OUT SECTION_BUILDER* Builder,
+	IN UINT32 Level
+	)
+{
+	CONST UINT16 NumNamed = (UINT16)TestRandomBelow(3);
+	CONST UINT16 NumIds = (UINT16)TestRandomBelow(Level == 0 ? 24 : 8);
+	CONST UINT32 Offset = SectionAllocate(Builder, sizeof(EFI_IMAGE_RESOURCE_DIRECTORY) +
+		(NumNamed + NumIds) * sizeof(EFI_IMAGE_RESOURCE_DIRECTORY_ENTRY));
+	EFI_IMAGE_RESOURCE_DIRECTORY* Directory = SectionPointer(Builder, Offset);
+	Directory->NumberOfNamedEntries = NumNamed;
+	Directory->NumberOfIdEntries = NumIds;
+
+	// Named entries come first. Their names are never read by ID lookups
+	EFI_IMAGE_RESOURCE_DIRECTORY_ENTRY* Entries = (EFI_IMAGE_RESOURCE_DIRECTORY_ENTRY*)(Directory + 1);
+	for (UINT16 i = 0; i < NumNamed; ++i)
+	{
+		Entries[i].u1.s.NameIsString = 1;
+		Entries[i].u1.s.NameOffset = (UINT32)TestRandomBelow(ID_RANGE);
+		Entries[i].u2.OffsetToData = BuildDataEntry(Builder);
+	}
+
+	// ID entries follow in ascending order of distinct IDs
+	UINT32 Id = 0;
+	for (UINT16 i = 0; i < NumIds; ++i)
+	{
+		Id += 1 + (UINT32)TestRandomBelow(ID_RANGE / (NumIds + 1) + 1);
+		EFI_IMAGE_RESOURCE_DIRECTORY_ENTRY* Entry = &Entries[NumNamed + i];
+		Entry->u1.Id = Id;
+
+		// Leaves belong at level 2, but occasionally put one at the wrong level
+		CONST BOOLEAN Leaf = (Level == 2) != (TestRandomBelow(10) == 0);
+		if (Leaf)
+		{
+			Entry->u2.OffsetToData = BuildDataEntry(Builder);
+		}
+		else
+		{
+			// At level 2, this is a directory entry pointing at a data entry
+			Entry->u2.s.OffsetToDirectory = Level < 2 ? BuildResourceDirectory(Builder, Level + 1) : BuildDataEntry(Builder);
+			Entry->u2.s.DataIsDirectory = 1;
+		}
+	}
+	return Offset;
+}
+
+STATIC
+CONST EFI_IMAGE_RESOURCE_DIRECTORY_ENTRY*
+FindEntryLinear(
+	IN CONST EFI_IMAGE_RESOURCE_DIRECTORY* Directory,
+	IN UINT16 Id
+	)
+{
+	CONST EFI_IMAGE_RESOURCE_DIRECTORY_ENTRY* Entries = (CONST EFI_IMAGE_RESOURCE_DIRECTORY_ENTRY*)(Directory + 1);
+	for (UINT32 i = Directory->NumberOfNamedEntries; i < (UINT32)Directory->NumberOfNamedEntries + Directory->NumberOfIdEntries; ++i)
+	{
+		if (!Entries[i].u1.s.NameIsString && Entries[i].u1.Id == Id)
+			return &Entries[i];
+	}
+	return NULL;
+}
+
+//
+// Picks the ID of an existing entry most of the time, otherwise any ID. Returns the subdirectory of the entry if it has one
+//
+STATIC
+UINT16
+PickId(
+	IN CONST UINT8* ResourceBase,
+	IN OUT CONST EFI_IMAGE_RESOURCE_DIRECTORY** Directory
+	)
+{
+	UINT16 Id = (UINT16)TestRandomBelow(ID_RANGE + 2);
+	if (*Directory == NULL)
+		return Id;
+
+	if ((*Directory)->NumberOfIdEntries > 0 && TestRandomBelow(4) != 0)
+	{
+		CONST EFI_IMAGE_RESOURCE_DIRECTORY_ENTRY* Entries = (CONST EFI_IMAGE_RESOURCE_DIRECTORY_ENTRY*)(*Directory + 1);
+		Id = (UINT16)Entries[(*Directory)->NumberOfNamedEntries + TestRandomBelow((*Directory)->NumberOfIdEntries)].u1.Id;
+	}
+
+	CONST EFI_IMAGE_RESOURCE_DIRECTORY_ENTRY* Entry = FindEntryLinear(*Directory, Id);
+	*Directory = Entry != NULL && Entry->u2.s.DataIsDirectory
+		? (CONST EFI_IMAGE_RESOURCE_DIRECTORY*)(ResourceBase + Entry->u2.s.OffsetToDirectory)
+		: NULL;
+	return Id;
+}
+
+STATIC
+EFI_STATUS
+FindResourceLinear(
+	IN CONST UINT8* ResourceBase,
+	IN CONST UINT8* ImageBase,
+	IN UINT16 TypeId,
+	IN UINT16 NameId,
+	IN UINT16 LanguageId,
+	OUT VOID** ResourceData,
+	OUT UINT32* ResourceSize
+	)
+{
+	*ResourceData = NULL;
+	*ResourceSize = 0;
+
+	CONST EFI_IMAGE_RESOURCE_DIRECTORY_ENTRY* Entry = FindEntryLinear((CONST EFI_IMAGE_RESOURCE_DIRECTORY*)ResourceBase, TypeId);
+	if (Entry == NULL || !Entry->u2.s.DataIsDirectory)
+		return EFI_NOT_FOUND;
+	Entry = FindEntryLinear((CONST EFI_IMAGE_RESOURCE_DIRECTORY*)(ResourceBase + Entry->u2.s.OffsetToDirectory), NameId);
+	if (Entry == NULL || !Entry->u2.s.DataIsDirectory)
+		return EFI_NOT_FOUND;
+
+	CONST EFI_IMAGE_RESOURCE_DIRECTORY* Languages = (CONST EFI_IMAGE_RESOURCE_DIRECTORY*)(ResourceBase + Entry->u2.s.OffsetToDirectory);
+	if (LanguageId != 0)
+		Entry = FindEntryLinear(Languages, LanguageId);
+	else
+		Entry = Languages->NumberOfIdEntries > 0 ? (CONST EFI_IMAGE_RESOURCE_DIRECTORY_ENTRY*)(Languages + 1) + Languages->NumberOfNamedEntries : NULL;
+	if (Entry == NULL || Entry->u2.s.DataIsDirectory)
+		return EFI_INVALID_LANGUAGE;
+
+	CONST EFI_IMAGE_RESOURCE_DATA_ENTRY* DataEntry = (CONST EFI_IMAGE_RESOURCE_DATA_ENTRY*)(ResourceBase + Entry->u2.OffsetToData);
+	*ResourceData = (VOID*)(ImageBase + DataEntry->OffsetToData);
+	*ResourceSize = DataEntry->Size;
+	return EFI_SUCCESS;
+}
+
+STATIC
+VOID
+TestResources(
+	IN UINT8* ImageBase,
+	IN PEFI_IMAGE_NT_HEADERS NtHeaders
+	)
+{
+	CONST PEFI_IMAGE_SECTION_HEADER Rsrc = TestGetSection(NtHeaders, ".rsrc");
+	PEFI_IMAGE_DATA_DIRECTORY Directory = &NtHeaders->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_RESOURCE];
+
+	// No resource directory
+	VOID* Data;
+	UINT32 Size;
+	Directory->VirtualAddress = Directory->Size = 0;
+	TEST_CHECK(FindResourceDataById(ImageBase, RT_VERSION, 1, 0, &Data, &Size) == EFI_NOT_FOUND && Data == NULL && Size == 0);
+
+	UINT32 Found = 0, Lookups = 0;
+	for (UINT32 Tree = 0; Tree < 2000; ++Tree)
+	{
+		SECTION_BUILDER Builder = { ImageBase, Rsrc->VirtualAddress, 0, Rsrc->Misc.VirtualSize };
+		CONST UINT32 Root = BuildResourceDirectory(&Builder, 0);
+		TEST_CHECK(Root == 0);
+		Directory->VirtualAddress = Rsrc->VirtualAddress;
+		Directory->Size = Builder.Used;
+
+		for (UINT32 Query = 0; Query < 200; ++Query)
+		{
+			CONST UINT8* ResourceBase = ImageBase + Rsrc->VirtualAddress;
+			CONST EFI_IMAGE_RESOURCE_DIRECTORY* Level = (CONST EFI_IMAGE_RESOURCE_DIRECTORY*)ResourceBase;
+			CONST UINT16 TypeId = PickId(ResourceBase, &Level);
+			CONST UINT16 NameId = PickId(ResourceBase, &Level);
+			CONST UINT16 LanguageId = TestRandomBelow(4) == 0 ? 0 : PickId(ResourceBase, &Level);
+
+			VOID* ExpectedData;
+			UINT32 ExpectedSize;
+			CONST EFI_STATUS Expected = FindResourceLinear(ResourceBase, ImageBase, TypeId, NameId, LanguageId,
+				&ExpectedData, &ExpectedSize);
+			CONST EFI_STATUS Status = FindResourceDataById(ImageBase, TypeId, NameId, LanguageId, &Data, &Size);
+			TEST_CHECK(Status == Expected && Data == ExpectedData && Size == ExpectedSize,
+				"tree %u, type %u name %u language %u: status 0x%llx, expected 0x%llx", Tree, TypeId, NameId, LanguageId,
+				(unsigned long long)Status, (unsigned long long)Expected);
+
+			// The data pointer is optional
+			TEST_CHECK(FindResourceDataById(ImageBase, TypeId, NameId, LanguageId, NULL, &Size) == Expected && Size == ExpectedSize);
+
+			Lookups++;
+			if (Expected == EFI_SUCCESS)
+				Found++;
+		}
+	}
+
+	// Make sure the trees produce a useful mix of hits and misses
+	TEST_CHECK(Found > Lookups / 10 && Found < Lookups * 9 / 10, "%u of %u lookups found", Found, Lookups);
+	Directory->VirtualAddress = Directory->Size = 0;
+}
+
+STATIC CONST CHAR8* CONST mDllNames[] = { "ntoskrnl.exe", "HAL.dll", "CI.dll", "kdcom.dll" };
+
+STATIC
+VOID
+TestImports(
+	IN UINT8* ImageBase,
+	IN PEFI_IMAGE_NT_HEADERS NtHeaders
+	)
+{
+	CONST PEFI_IMAGE_SECTION_HEADER Idata = TestGetSection(NtHeaders, ".idata");
+	PEFI_IMAGE_DATA_DIRECTORY Directory = &NtHeaders->OptionalHeader.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_IMPORT];
+	VOID* IatAddress;
+
+	for (UINT32 Table = 0; Table < 500; ++Table)
+	{
+		SECTION_BUILDER Builder = { ImageBase, Idata->VirtualAddress, 0, Idata->Misc.VirtualSize };
+		CONST UINT32 NumDlls = ARRAY_SIZE(mDllNames);
+		CONST UINT32 Descriptors = SectionAllocate(&Builder, (NumDlls + 1) * sizeof(IMAGE_IMPORT_DESCRIPTOR));
+		UINT32 NumImports[ARRAY_SIZE(mDllNames)];
+
+		for (UINT32 d = 0; d < NumDlls; ++d)
+		{
+			NumImports[d] = 1 + (UINT32)TestRandomBelow(32);
+			CONST UINT32 Name = SectionAllocate(&Builder, (UINT32)strlen(mDllNames[d]) + 1);
+			CopyMem(SectionPointer(&Builder, Name), mDllNames[d], strlen(mDllNames[d]) + 1);
+			CONST UINT32 Thunks = SectionAllocate(&Builder, (NumImports[d] + 1) * sizeof(IMAGE_THUNK_DATA64));
+			CONST UINT32 Iat = SectionAllocate(&Builder, (NumImports[d] + 1) * sizeof(IMAGE_THUNK_DATA64));
+
+			for (UINT32 i = 0; i < NumImports[d]; ++i)
+			{
+				// Import number 5 of every DLL is by ordinal, the others by name "FunctionN"
+				CONST UINT32 ByName = SectionAllocate(&Builder, sizeof(IMAGE_IMPORT_BY_NAME) + 24);
+				snprintf(((PIMAGE_IMPORT_BY_NAME)SectionPointer(&Builder, ByName))->Name, 24, "Function%u", i);
+				PIMAGE_THUNK_DATA64 Thunk = (PIMAGE_THUNK_DATA64)SectionPointer(&Builder, Thunks) + i;
+				Thunk->u1.AddressOfData = i == 5 ? IMAGE_ORDINAL_FLAG64 | i : Idata->VirtualAddress + ByName;
+				((PIMAGE_THUNK_DATA64)SectionPointer(&Builder, Iat))[i] = *Thunk;
+			}
+
+			// Half of the descriptors have no original first thunk, and are looked up through the IAT
+			PIMAGE_IMPORT_DESCRIPTOR Descriptor = (PIMAGE_IMPORT_DESCRIPTOR)SectionPointer(&Builder, Descriptors) + d;
+			Descriptor->u.OriginalFirstThunk = Idata->VirtualAddress + (TestRandomBelow(2) == 0 ? Thunks : Iat);
+			Descriptor->Name = Idata->VirtualAddress + Name;
+			Descriptor->FirstThunk = Idata->VirtualAddress + Iat;
+		}
+		Directory->VirtualAddress = Idata->VirtualAddress + Descriptors;
+		Directory->Size = (NumDlls + 1) * sizeof(IMAGE_IMPORT_DESCRIPTOR);
+
+		for (UINT32 Query = 0; Query < 50; ++Query)
+		{
+			CONST UINT32 d = (UINT32)TestRandomBelow(NumDlls);
+			CONST UINT32 i = (UINT32)TestRandomBelow(NumImports[d] + 2);
+			CHAR8 FunctionName[24];
+			snprintf(FunctionName, sizeof(FunctionName), TestRandomBelow(2) == 0 ? "Function%u" : "FUNCTION%u", i);
+
+			CONST PIMAGE_IMPORT_DESCRIPTOR Descriptor = (PIMAGE_IMPORT_DESCRIPTOR)(ImageBase + Directory->VirtualAddress) + d;
+			CONST BOOLEAN Exists = i < NumImports[d] && i != 5;
+			CONST EFI_STATUS Status = FindIATAddressForImport(ImageBase, NtHeaders, mDllNames[d], FunctionName, &IatAddress);
+			TEST_CHECK(Exists
+				? Status == EFI_SUCCESS && IatAddress == ImageBase + Descriptor->FirstThunk + i * sizeof(IMAGE_THUNK_DATA64)
+				: Status == EFI_NOT_FOUND && IatAddress == NULL,
+				"%s!%s", mDllNames[d], FunctionName);
+		}
+		TEST_CHECK(FindIATAddressForImport(ImageBase, NtHeaders, "missing.dll", "Function0", &IatAddress) == EFI_NOT_FOUND);
+	}
+
+	Directory->VirtualAddress = Directory->Size = 0;
+	TEST_CHECK(FindIATAddressForImport(ImageBase, NtHeaders, "HAL.dll", "Function0", &IatAddress) == EFI_NOT_FOUND && IatAddress == NULL);
+}
+
+int
+main(
+	VOID
+	)
+{
+	CONST TEST_SECTION Sections[] =
+	{
+		{ ".text", 0x1000, TEST_SECTION_CODE },
+		{ ".idata", SECTION_SIZE, TEST_SECTION_RDATA },
+		{ ".rsrc", SECTION_SIZE, TEST_SECTION_RDATA },
+	};
+	PEFI_IMAGE_NT_HEADERS NtHeaders;
+	UINT32 ImageSize;
+	UINT8* ImageBase = BuildTestImage(Sections, ARRAY_SIZE(Sections), &NtHeaders, &ImageSize);
+
+	TestSeedRandom(13);
+	TestResources(ImageBase, NtHeaders);
+	TestImports(ImageBase, NtHeaders);
+
+	free(ImageBase);
+	return TestSummary("ResourceTests");
+}